@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+
+#define ASSET_PACK_MAGIC 0x4B415041			// "APAK", little endian
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_ALIGNMENT 256			// Blob offsets - SPIR-V words, vertices and copy sources read in place
+#define ASSET_NAME_SIZE 40					// Including the terminator
+
+
+enum class AssetType : uint32_t
+{
+	Shader = 1,			// SPIR-V module
+	Texture,			// KTX2 container
+	Mesh				// Vertex array in the full layout, see VertexFormat.h
+};
+
+
+// File header - the table of contents follows it directly
+struct AssetPackHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entry_count;
+	uint32_t padding;
+	uint64_t file_size;						// Checked against the mapping, catches truncated copies
+	uint64_t data_offset;					// First blob
+};
+
+
+// Table of contents entry - sorted by name, 64 bytes so the table stays aligned
+struct AssetEntry
+{
+	char name[ASSET_NAME_SIZE];				// File name without directories
+	uint32_t type;							// AssetType
+	uint32_t padding;
+	uint64_t offset;						// From the start of the pack, ASSET_PACK_ALIGNMENT aligned
+	uint64_t size;
+};
+
+
+// Read-only pack mapped into the address space - loads read blobs in place and copy straight into staging memory
+//  - The file handle is closed once mapped, the view keeps the file alive
+//  - willNeed() starts readahead for one blob ahead of its copy, dontNeed() lets the kernel drop it after the upload
+class AssetPack
+{
+public:
+	~AssetPack();
+
+	void open(const std::string& path);										// Throws on a missing or malformed pack
+	void close();
+	bool isOpen() const { return base != nullptr; }
+
+	const AssetEntry* find(const std::string& name, AssetType type) const;	// Directories are ignored, null when absent
+	const uint8_t* data(const AssetEntry& entry) const { return base + entry.offset; }
+	void willNeed(const AssetEntry& entry) const;
+	void dontNeed(const AssetEntry& entry) const;
+
+	uint32_t entryCount() const { return entry_count; }
+	const AssetEntry* entries() const { return toc; }
+	size_t size() const { return mapped_size; }
+
+	static std::string assetName(const std::string& path);					// Last path component
+
+private:
+	const uint8_t* base = nullptr;
+	size_t mapped_size = 0;
+	const AssetEntry* toc = nullptr;
+	uint32_t entry_count = 0;
+
+	void advise(const AssetEntry& entry, bool need) const;
+};
+
+
+// Input of the offline packer
+struct AssetSource
+{
+	std::string name;
+	AssetType type;
+	std::vector <uint8_t> bytes;
+};
+
+uint64_t writeAssetPack(const std::string& path, std::vector <AssetSource>& assets);	// Sorts assets by name, throws on duplicates, returns bytes written
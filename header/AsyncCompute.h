@@ -0,0 +1,47 @@
+#pragma once
+
+#include "FrameScheduler.h"
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+
+
+// Per-frame compute work, overlapped with graphics when a compute-only queue family exists
+//  - Async: passes go to their own queue and command buffer, graphics waits on the compute timeline only at the stages that read the results
+//  - Inline: passes are recorded at the top of the graphics command buffer behind a barrier - the serialized baseline
+//  - Buffers and images shared with graphics should use VK_SHARING_MODE_CONCURRENT over sharedFamilies()
+class AsyncCompute
+{
+public:
+	typedef std::function<void(VkCommandBuffer)> Pass;
+
+	void create(VkDevice device, uint32_t compute_family, uint32_t graphics_family, bool use_async);
+	void destroy();
+
+	void addPass(const Pass& pass);															// Recorded every frame in registration order
+	uint64_t submit(FrameScheduler& scheduler);												// Async - submit this frame's passes, compute timeline value or 0 if none
+	void recordInline(VkCommandBuffer command_buffer);										// Inline - record passes plus a compute -> graphics barrier
+
+	bool isAsync() const { return async; }
+	bool hasWork() const { return !passes.empty(); }
+	uint32_t familyIndex() const { return family; }
+	std::vector <uint32_t> sharedFamilies() const;											// Queue families that touch shared resources
+	VkPipelineStageFlags waitStages() const { return consumer_stages; }					// Graphics stages that read compute results
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueue queue = VK_NULL_HANDLE;
+	uint32_t family = 0;
+	uint32_t graphics_family = 0;
+	bool async = false;
+
+	VkCommandPool command_pool = VK_NULL_HANDLE;
+	VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+	uint64_t last_submit = 0;																// Compute timeline value of the previous submit
+	VkPipelineStageFlags consumer_stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+	std::vector <Pass> passes;
+};
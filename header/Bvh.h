@@ -0,0 +1,80 @@
+#pragma once
+
+#include "SceneGraph.h"
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+
+
+struct BvhBuildNode;
+
+
+// Axis aligned bounding box
+struct Aabb
+{
+	float min[3];
+	float max[3];
+};
+
+Aabb transformBounds(const Mat4& matrix, const Aabb& local);					// Bounds of a transformed box
+bool invertMatrix(const Mat4& matrix, Mat4& result);							// Column-major inverse, false when singular
+Mat4 multiplyMatrix(const Mat4& a, const Mat4& b);								// a * b, column-major
+
+
+// Ray for picking - hits beyond max_t are ignored
+struct Ray
+{
+	float origin[3];
+	float direction[3];
+	float max_t;
+};
+
+
+// Bounding volume hierarchy over object bounds
+//  - Built with binned SAH, large subtrees on worker threads or jobs, then collapsed to a 4-wide tree
+//  - Nodes are flattened depth-first and store their four child boxes as SoA, so one SIMD test covers every child
+//  - refit() updates bounds of moved objects and their ancestors only, topology is kept until the next build()
+class Bvh
+{
+public:
+	void build(const Aabb* bounds, uint32_t count, uint32_t thread_count = 0);			// 0 = hardware concurrency
+	void build(const Aabb* bounds, uint32_t count, JobSystem& jobs, FrameArena& arena);	// Subtrees as jobs, task storage from arena
+	void refit(const Aabb* bounds, uint32_t first, uint32_t last);						// Objects [first, last) moved
+
+	// Queries append object indices
+	void cullFrustum(const float planes[6][4], std::vector<uint32_t>& visible) const;	// Planes point inwards, ax + by + cz + d >= 0 is inside
+	void queryRadius(const float center[3], float radius, std::vector<uint32_t>& found) const;
+
+	// Nearest hit - exact may refine an object's hit distance, returning false rejects it
+	bool raycast(const Ray& ray, uint32_t& object, float& t,
+		const std::function<bool(uint32_t object, float& t)>& exact = nullptr) const;
+
+	uint32_t objectCount() const { return static_cast<uint32_t>(object_bounds.size()); }
+	size_t nodeCount() const { return nodes.size(); }
+
+private:
+	// Four children per node - SoA boxes, each child is an inner node or a leaf range of objects
+	struct alignas(64) Node
+	{
+		float min_x[4], min_y[4], min_z[4];
+		float max_x[4], max_y[4], max_z[4];
+		uint32_t child[4];																// Node index, or first entry in objects for leaves
+		uint32_t count[4];																// Objects in a leaf, 0 for inner nodes and empty lanes
+	};
+
+	std::vector <Node> nodes;															// Depth-first, children after their parent
+	std::vector <uint32_t> objects;														// Leaf ranges index into this
+	std::vector <Aabb> object_bounds;													// Copy of the last build / refit input
+	std::vector <uint32_t> object_lane;													// Object -> node * 4 + lane of its leaf
+	std::vector <uint32_t> parent_lane;													// Node -> parent * 4 + lane, UINT32_MAX for the root
+	std::vector <uint8_t> refit_queued;													// Scratch for refit()
+
+	void buildTree(const Aabb* bounds, uint32_t count, uint32_t spawn_depth, JobSystem* jobs, FrameArena* arena);
+	uint32_t flatten(const BvhBuildNode* build_node);
+	void setLane(uint32_t node, uint32_t lane, const Aabb& box);
+	Aabb nodeBounds(uint32_t node) const;
+	Aabb leafBounds(uint32_t first, uint32_t count) const;
+	void refitNode(uint32_t node);
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "SceneGraph.h"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+
+
+#define CLUSTER_GRID_X 16					// Screen tiles across
+#define CLUSTER_GRID_Y 9					// Screen tiles down
+#define CLUSTER_GRID_Z 24					// Depth slices, exponential in view depth for perspective projections
+#define CLUSTER_COUNT (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+#define CLUSTER_GROUP_SIZE 64				// Specialized into local_size_x of the assignment shader - clusters per group, lights per shared tile
+#define CLUSTER_MAX_LIGHTS 8192
+#define CLUSTER_AVERAGE_LIGHTS 64			// Index list capacity per cluster on average, the lists past it are cut short
+#define CLUSTER_DEPTH_RANGE 10000.0f		// Far / near limit of the slices, an infinite far plane is clamped to it
+
+
+enum class LightType : uint32_t
+{
+	Point = 0,
+	Spot
+};
+
+
+// One light as the shaders read it - std430, mirrored in cluster_lighting.glsl
+struct Light
+{
+	float position[3];						// World space
+	float range;							// Nothing is lit past it
+	float color[3];							// Linear, intensity folded in
+	uint32_t type;							// LightType
+	float direction[3];						// Spot only, unit length
+	float spot_cos_outer;					// Spot only, cosine of the half angle where it reaches zero
+	float spot_cos_inner;					// Spot only, cosine of the half angle where it is full
+	float padding[3];
+};
+
+
+// Clustered forward lighting - lights are binned into a view space froxel grid on the GPU every frame
+//  - Assign: one invocation per cluster tests every light against its froxel, with the lights staged through shared memory,
+//    then reserves a compact range of the index list for the ones that touch it
+//  - Shading: a fragment finds its cluster from its clip position and view depth and loops over that range only
+//  - Params and lights are host written, the grid and the index list never leave the device
+//  - The lighting set is set 1 of the base pipeline and set 0 of the assignment pipeline
+class ClusteredLighting
+{
+public:
+	void create(VkDevice device, VkPhysicalDevice physical_device);			// Buffers and the lighting set
+	void createPipeline(VkShaderModule assign_shader);
+	void destroy();
+
+	// Host writes - only while no submitted frame reads them
+	void setLights(const Light* lights, uint32_t count);					// At most CLUSTER_MAX_LIGHTS
+	void setView(const Mat4& view, const Mat4& projection, const float ambient[3]);
+
+	// Recorded outside render passes, ahead of every pass that shades with the lists
+	void recordAssign(VkCommandBuffer command_buffer);
+
+	uint32_t lightCount() const { return light_count; }
+	VkDescriptorSetLayout setLayout() const { return set_layout; }
+	VkDescriptorSet descriptorSet() const { return set; }
+
+private:
+	// Everything the assignment and the shading share - std140, mirrored in cluster_lighting.glsl
+	struct Params
+	{
+		Mat4 view;
+		Mat4 inverse_projection;
+		float ambient[4];
+		uint32_t grid[4];						// Clusters along x, y, z, then the light count
+		float depth_scale;						// Slice = log(|view z|) * scale + bias, or view z * scale + bias when linear
+		float depth_bias;
+		float near_z;							// Signed view z of the near plane
+		uint32_t exponential;					// Perspective projection
+	};
+
+	struct MappedBuffer
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* mapped = nullptr;									// Null for device local buffers
+	};
+
+	static constexpr uint32_t BINDING_COUNT = 5;
+	static constexpr VkDeviceSize INDEX_CAPACITY = (VkDeviceSize)CLUSTER_COUNT * CLUSTER_AVERAGE_LIGHTS;
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+	VkDescriptorSetLayout set_layout = VK_NULL_HANDLE;
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	VkPipeline assign_pipeline = VK_NULL_HANDLE;
+
+	MappedBuffer params;													// Params, rewritten every frame
+	MappedBuffer lights;													// CLUSTER_MAX_LIGHTS lights
+	MappedBuffer grid;														// Offset and count per cluster
+	MappedBuffer indices;													// Light indices, one compact range per cluster
+	MappedBuffer counter;													// Index list use, reset before every assignment
+	uint32_t light_count = 0;
+
+	void createMapped(VkDeviceSize size, VkBufferUsageFlags usage, MappedBuffer& target);
+	void createLocal(VkDeviceSize size, VkBufferUsageFlags usage, MappedBuffer& target);
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "SceneGraph.h"
+#include "ClusteredLighting.h"
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+
+
+#define TRACE_MAGIC 0x31435254				// "TRC1", little endian
+#define TRACE_VERSION 2
+
+
+// Record types - each record is a TraceRecord header and size bytes of payload, frames end at their Submit
+enum class TraceOp : uint32_t
+{
+	Config = 1,			// TraceConfig, first record of the file
+	Texture,			// KTX2 path, uploaded before the first frame
+	Effects,			// Mask of enabled PostEffect bits, a change re-bakes the render pass
+	PostParams,			// PostParams
+	ClearColor,			// VkClearColorValue
+	Camera,				// TraceCamera
+	Instances,			// TraceInstances, then the world matrices of [begin, end)
+	Submit,				// TraceSubmit
+	Lights,				// Ambient RGB, then every Light - written when either changed
+	Count
+};
+
+
+struct TraceRecord
+{
+	uint32_t op;
+	uint32_t size;							// Payload bytes
+};
+
+
+// Settings that shape resource creation - what the setters take before initVulkan()
+struct TraceConfig
+{
+	uint32_t width;							// Main window or offscreen extent
+	uint32_t height;
+	uint32_t occlusion_culling;
+	uint32_t vertex_layout;					// VertexLayout
+	uint32_t async_compute;
+	uint32_t debug_bounds;
+	float frame_budget_ms;					// 0 = native resolution
+	float upscale_sharpness;
+};
+
+
+// View and projection apart, as clustered lighting needs them
+struct TraceCamera
+{
+	Mat4 view;
+	Mat4 projection;
+};
+
+
+// Scene instance count and the world matrices uploaded for it
+struct TraceInstances
+{
+	uint32_t count;
+	uint32_t begin;
+	uint32_t end;
+	uint32_t padding;
+};
+
+
+// Graphics submit that ended the frame - replay checks it re-issues the same
+struct TraceSubmit
+{
+	uint32_t command_buffers;
+	uint32_t draws;
+};
+
+
+// Capture side - the render thread appends a frame's records into memory, endFrame() writes them with one fwrite
+//  - State records are dropped when equal to the last one of their op, so a static camera costs nothing per frame
+//  - Closes itself once the frame limit is written
+class TraceWriter
+{
+public:
+	~TraceWriter();
+
+	bool open(const std::string& path, uint32_t frame_count);
+	void close();
+	bool isOpen() const { return output != nullptr; }
+
+	void write(TraceOp op, const void* data, uint32_t size);
+	void write(TraceOp op, const void* head, uint32_t head_size, const void* data, uint32_t size);	// Payload in two parts
+	void writeState(TraceOp op, const void* data, uint32_t size);			// Skipped when unchanged
+	void endFrame(const TraceSubmit& submit);
+
+	uint32_t framesWritten() const { return frames_written; }
+	uint64_t bytesWritten() const { return bytes_written; }
+
+private:
+	FILE* output = nullptr;
+	std::vector <uint8_t> pending;											// Records of the frame being captured
+	std::vector <uint8_t> last_state[(uint32_t)TraceOp::Count];			// Last payload per state op
+	uint32_t frame_limit = 0;
+	uint32_t frames_written = 0;
+	uint64_t bytes_written = 0;
+};
+
+
+// Replay side - the whole trace is read and validated up front, so the replay loop does no file IO
+class TraceReader
+{
+public:
+	struct Command
+	{
+		TraceOp op;
+		uint32_t size;
+		const uint8_t* data;					// Into the loaded trace
+	};
+
+	void open(const std::string& path);										// Throws on a malformed trace
+
+	const TraceConfig& config() const { return trace_config; }
+	const std::vector <std::string>& texturePaths() const { return texture_paths; }
+	uint32_t frameCount() const { return static_cast<uint32_t>(frames.size()); }
+	const std::vector <Command>& frame(uint32_t index) const { return frames[index]; }	// Ends with its Submit, payload sizes checked against their op
+	const TraceSubmit& submit(uint32_t index) const { return submits[index]; }
+
+private:
+	std::vector <uint8_t> bytes;
+	TraceConfig trace_config{};
+	std::vector <std::string> texture_paths;
+	std::vector <std::vector <Command>> frames;
+	std::vector <TraceSubmit> submits;										// One per frame
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Bvh.h"
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+
+
+
+#define DEBUG_DRAW_CAPACITY 65536			// Vertices per frame slot, further primitives are dropped
+#define DEBUG_DRAW_SLOTS 2					// One filling while the other is drawn
+#define DEBUG_SPHERE_SEGMENTS 24			// Per great circle
+
+
+// Line list vertex - world space, color is R8G8B8A8
+struct DebugVertex
+{
+	float position[3];
+	uint32_t color;
+};
+
+inline uint32_t debugColor(float r, float g, float b, float a = 1.0f)
+{
+	auto channel = [](float v) { return (uint32_t)(v <= 0.0f ? 0.0f : v >= 1.0f ? 255.0f : v * 255.0f + 0.5f); };
+	return channel(r) | (channel(g) << 8) | (channel(b) << 16) | (channel(a) << 24);
+}
+
+
+// Immediate-mode debug lines, drawn over the finished frame in one batched draw
+//  - Primitives are appended lock-free from any thread into a persistently mapped, host coherent ring of frame slots
+//  - seal() flips the slot once per frame, after the previous frame completed, so the slot filled next is never in flight,
+//    then waits until every reservation made before the flip has been written
+//  - Nothing queued means no command buffer, no render pass and no draw
+class DebugDraw
+{
+public:
+	static DebugDraw& instance();
+
+	void create(VkDevice device, VkPhysicalDevice physical_device, VkFormat color_format, VkImageLayout layout);	// layout the image is in before and after
+	void createPipeline(VkShaderModule vertex_shader, VkShaderModule fragment_shader);
+	void destroy();
+
+	VkRenderPass renderPass() const { return render_pass; }
+	uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }	// Vertices that did not fit
+
+	// Any thread - ignored until create()
+	void line(const float a[3], const float b[3], uint32_t color);
+	void box(const Aabb& bounds, uint32_t color);
+	void sphere(const float center[3], float radius, uint32_t color);
+	void frustum(const Mat4& view_projection, uint32_t color);					// Edges of the clip volume, Vulkan depth [0, 1]
+	void axes(const Mat4& transform, float size);								// X red, Y green, Z blue
+
+	// Render thread - the vertex count of the slot drawn this frame, 0 when nothing was queued
+	uint32_t seal();
+	void record(VkCommandBuffer command_buffer, VkFramebuffer framebuffer, VkExtent2D extent, const Mat4& view_projection);
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	DebugVertex* mapped = nullptr;
+	VkRenderPass render_pass = VK_NULL_HANDLE;
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+
+	// Slot and reservation share one word, so a reservation always belongs to exactly one side of a flip
+	std::atomic<uint64_t> state{ 0 };											// Filling slot << 32 | vertices reserved in it
+	std::atomic<uint32_t> committed[DEBUG_DRAW_SLOTS] = {};					// Vertices written (or dropped) per slot
+	std::atomic<uint64_t> dropped{ 0 };
+	uint32_t draw_slot = 0;
+	uint32_t draw_count = 0;
+
+	void append(const DebugVertex* vertices, uint32_t count);
+};
+
+
+// Shorthands for the shared instance
+inline void debugLine(const float a[3], const float b[3], uint32_t color) { DebugDraw::instance().line(a, b, color); }
+inline void debugBox(const Aabb& bounds, uint32_t color) { DebugDraw::instance().box(bounds, color); }
+inline void debugSphere(const float center[3], float radius, uint32_t color) { DebugDraw::instance().sphere(center, radius, color); }
+inline void debugFrustum(const Mat4& view_projection, uint32_t color) { DebugDraw::instance().frustum(view_projection, color); }
+inline void debugAxes(const Mat4& transform, float size) { DebugDraw::instance().axes(transform, size); }
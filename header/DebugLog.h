@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+
+
+
+#define DEBUG_LOG_CAPACITY 1024				// Ring slots, must be a power of two
+#define DEBUG_LOG_MESSAGE_SIZE 512			// Message text is truncated to this size
+#define DEBUG_LOG_SUMMARY_SECONDS 5			// Interval between repeat summaries
+
+
+// Asynchronous sink for validation layer messages
+//  - push() is lock-free and safe to call from any driver thread
+//  - A background thread drains the ring, deduplicates message IDs and rate limits per severity
+class DebugLog
+{
+public:
+	DebugLog();
+	~DebugLog();
+
+	// Severity buckets, in order of VkDebugUtilsMessageSeverityFlagBitsEXT
+	enum Severity
+	{
+		SEVERITY_VERBOSE = 0,
+		SEVERITY_INFO,
+		SEVERITY_WARNING,
+		SEVERITY_ERROR,
+		SEVERITY_COUNT
+	};
+
+	void start();																		// Start the drain thread
+	void stop();																		// Drain remaining messages and join
+	bool push(VkDebugUtilsMessageSeverityFlagBitsEXT severity,							// Queue a message, returns false when dropped
+		VkDebugUtilsMessageTypeFlagsEXT type, const VkDebugUtilsMessengerCallbackDataEXT* data);
+
+	void setRateLimit(Severity severity, uint32_t messages_per_second);				// 0 = unlimited
+	uint64_t receivedCount(Severity severity) const;									// Messages seen per severity
+	uint64_t droppedCount() const;														// Messages lost to a full ring
+
+	static Severity severityIndex(VkDebugUtilsMessageSeverityFlagBitsEXT severity);	// Map flag bit to bucket
+
+private:
+	// Ring slot - sequence number tracks producer/consumer ownership
+	struct Slot
+	{
+		std::atomic<uint64_t> sequence;
+		Severity severity;
+		VkDebugUtilsMessageTypeFlagsEXT type;
+		uint32_t key;
+		char text[DEBUG_LOG_MESSAGE_SIZE];
+	};
+
+	// Per message ID repeat tracking
+	struct RepeatEntry
+	{
+		uint64_t total = 0;
+		uint64_t since_summary = 0;
+		bool printed = false;				// Full text went out once - a rate limited first occurrence has not
+		Severity severity = SEVERITY_VERBOSE;
+		std::string preview;
+	};
+
+	// Token bucket per severity
+	struct RateLimit
+	{
+		uint32_t per_second = 0;
+		uint32_t used = 0;
+		uint64_t suppressed = 0;
+	};
+
+	Slot* slots;																		// Ring storage
+	alignas(64) std::atomic<uint64_t> enqueue_pos{ 0 };								// Producer cursor
+	alignas(64) std::atomic<uint64_t> dequeue_pos{ 0 };								// Consumer cursor
+	alignas(64) std::atomic<uint64_t> received[SEVERITY_COUNT];						// Per severity message totals
+	std::atomic<uint64_t> dropped{ 0 };												// Lost to full ring
+
+	std::thread drain_thread;
+	std::atomic<bool> running{ false };
+
+	// Drain thread state - only touched by the drain thread
+	std::unordered_map<uint32_t, RepeatEntry> repeats;
+	RateLimit limits[SEVERITY_COUNT];
+	std::chrono::steady_clock::time_point window_start;
+	std::chrono::steady_clock::time_point last_summary;
+	std::string output;
+
+	void drainLoop();																	// Background thread body
+	size_t drain();																		// Pop and format everything queued
+	void emit(const Slot& slot);														// Dedup + rate limit one message
+	void summarize(bool final_summary);													// Report repeats and suppressions
+	void flush();																		// Write batched output to stderr
+
+	static uint32_t hashMessage(int32_t id, const char* name, const char* text);		// Stable key for dedup
+	static const char* severityName(Severity severity);
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <type_traits>
+
+
+
+// Deferred destruction of GPU resources
+//  - Each retired handle is tagged with the last frame that may use it
+//  - flush() destroys entries once that frame is known complete, so no vkDeviceWaitIdle is needed
+//  - retire() is thread safe, flush() runs on the render thread
+class DeletionQueue
+{
+public:
+	enum Type
+	{
+		PIPELINE,
+		PIPELINE_LAYOUT,
+		RENDER_PASS,
+		FRAMEBUFFER,
+		IMAGE_VIEW,
+		IMAGE,
+		BUFFER,
+		MEMORY,
+		SAMPLER,
+		SHADER_MODULE,
+		DESCRIPTOR_POOL,
+		DESCRIPTOR_SET_LAYOUT,
+		SWAPCHAIN,
+		SEMAPHORE,
+		FENCE,
+		QUERY_POOL,
+		COMMAND_POOL
+	};
+
+	void init(VkDevice device);
+
+	template <typename Handle>
+	void retire(Type type, Handle handle, uint64_t last_used_frame);		// Queue for destruction after last_used_frame
+
+	void flush(uint64_t completed_frame);									// Destroy everything no longer in use
+	void flushAll();														// Destroy everything - device must be idle
+	size_t pendingCount();
+
+private:
+	struct Entry
+	{
+		Type type;
+		uint64_t handle;													// Handle bits, pointer or 64-bit depending on platform
+		uint64_t frame;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	std::mutex mutex;
+	std::vector <Entry> entries;
+	std::vector <Entry> ready;												// Reused scratch for flush()
+
+	void destroy(const Entry& entry);
+};
+
+
+// Non-dispatchable handles are pointers on 64-bit and uint64_t on 32-bit builds
+template <typename Handle>
+inline uint64_t handleBits(Handle handle)
+{
+	if constexpr (std::is_pointer<Handle>::value) return (uint64_t)(uintptr_t)handle;
+	else return (uint64_t)handle;
+}
+
+template <typename Handle>
+inline Handle handleFromBits(uint64_t bits)
+{
+	if constexpr (std::is_pointer<Handle>::value) return (Handle)(uintptr_t)bits;
+	else return (Handle)bits;
+}
+
+
+template <typename Handle>
+void DeletionQueue::retire(Type type, Handle handle, uint64_t last_used_frame)
+{
+	if (handleBits(handle) == 0) return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.push_back({ type, handleBits(handle), last_used_frame });
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <cstdint>
+
+
+
+// 64-bit draw sort key, most significant field first - ascending order groups passes, then state, then depth
+#define DRAW_KEY_PASS_SHIFT 60				// 4 bits
+#define DRAW_KEY_LAYER_SHIFT 56				// 4 bits
+#define DRAW_KEY_PIPELINE_SHIFT 44			// 12 bits
+#define DRAW_KEY_MATERIAL_SHIFT 24			// 20 bits
+#define DRAW_KEY_DEPTH_BITS 24
+
+#define DRAW_PASS_OPAQUE 0
+#define DRAW_PASS_TRANSLUCENT 1
+
+#define DRAW_SORT_SERIAL_COUNT 8192			// Fewer keys sort on the calling thread
+#define DRAW_SORT_MIN_CHUNK 4096			// Keys per job in the parallel sort
+
+
+inline uint64_t makeDrawKey(uint32_t pass, uint32_t layer, uint32_t pipeline, uint32_t material, uint32_t depth)
+{
+	return ((uint64_t)(pass & 0xF) << DRAW_KEY_PASS_SHIFT) | ((uint64_t)(layer & 0xF) << DRAW_KEY_LAYER_SHIFT) |
+		((uint64_t)(pipeline & 0xFFF) << DRAW_KEY_PIPELINE_SHIFT) | ((uint64_t)(material & 0xFFFFF) << DRAW_KEY_MATERIAL_SHIFT) |
+		(uint64_t)(depth & ((1u << DRAW_KEY_DEPTH_BITS) - 1));
+}
+
+inline uint32_t drawKeyPipeline(uint64_t key) { return (uint32_t)(key >> DRAW_KEY_PIPELINE_SHIFT) & 0xFFF; }
+inline uint32_t drawKeyMaterial(uint64_t key) { return (uint32_t)(key >> DRAW_KEY_MATERIAL_SHIFT) & 0xFFFFF; }
+
+// Depth field from [0, 1] - back to front for translucent passes
+uint32_t drawKeyDepth(float depth, bool back_to_front);
+
+
+// Binds a recorder that skips redundant ones would issue walking the keys in order
+//  - A pipeline change rebinds the material as well
+struct DrawBindCounts
+{
+	uint32_t pipelines = 0;
+	uint32_t materials = 0;
+};
+
+DrawBindCounts countDrawBinds(const uint64_t* keys, uint32_t count);
+
+
+// Stable LSD radix sort of keys carrying a 32-bit payload, 8 bits per pass
+//  - Digits every key shares are skipped, so unused key fields cost one histogram read and no scatter
+//  - Scratch must hold count entries each, the result always ends up in keys and values
+void radixSort(uint64_t* keys, uint32_t* values, uint32_t count, uint64_t* scratch_keys, uint32_t* scratch_values);
+
+// Same sort split across the job system - histogram and scatter run per chunk, offsets are summed in between
+void radixSort(uint64_t* keys, uint32_t* values, uint32_t count, uint64_t* scratch_keys, uint32_t* scratch_values, JobSystem& jobs, FrameArena& arena);
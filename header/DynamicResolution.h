@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+
+
+#define RESOLUTION_SCALE_MIN 0.5f				// Lowest fraction of the window extent per axis
+#define RESOLUTION_SCALE_STEP 0.05f				// Scales are quantized so small swings never re-record
+#define RESOLUTION_SMOOTHING 0.2f				// Weight of the newest frame in the moving average
+#define RESOLUTION_HEADROOM 0.85f				// Scale up only below this fraction of the budget
+#define RESOLUTION_SETTLE_DOWN 4				// Frames after a change before scaling down again
+#define RESOLUTION_SETTLE_UP 30					// Frames after a change before scaling up again
+
+
+// Push constants of the upscale pass - mirrored in upscale.frag
+struct UpscaleParams
+{
+	float uv_scale[2];						// Rendered fraction of the scene image
+	float sharpness;						// Unsharp mask strength, 0 = bilinear only
+};
+
+
+// GPU time of the graphics submit, from a timestamp at each end
+//  - Both command buffers are recorded once and replayed, the single frame in flight means one query pair is enough
+//  - read() never blocks, it reports the previous frame once the timeline says it has completed
+class GpuFrameTimer
+{
+public:
+	void create(VkDevice device, VkPhysicalDevice physical_device, uint32_t queue_family, VkCommandPool command_pool);
+	void destroy();
+
+	bool supported() const { return pool != VK_NULL_HANDLE; }				// False when the queue has no timestamps
+	VkCommandBuffer beginCommands() const { return begin_commands; }		// First in the submit
+	VkCommandBuffer endCommands() const { return end_commands; }			// Last in the submit
+	bool read(double& milliseconds);										// False until a submitted pair has landed
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkCommandPool command_pool = VK_NULL_HANDLE;
+	VkQueryPool pool = VK_NULL_HANDLE;
+	VkCommandBuffer begin_commands = VK_NULL_HANDLE;
+	VkCommandBuffer end_commands = VK_NULL_HANDLE;
+	double period_ms = 0.0;													// Milliseconds per timestamp tick
+	uint64_t valid_mask = 0;												// timestampValidBits of the queue family
+};
+
+
+// Render scale from measured GPU time against a budget
+//  - Over budget scales down straight to the estimate, pixel cost is taken as proportional to area
+//  - Under budget with headroom scales up one step at a time, and only after a longer settle - hysteresis
+class ResolutionController
+{
+public:
+	void setBudget(double milliseconds) { budget_ms = milliseconds; }
+	bool update(double gpu_ms);												// True when the scale changed
+
+	float scale() const { return current_scale; }
+	double averageMs() const { return average_ms; }
+
+private:
+	double budget_ms = 0.0;
+	double average_ms = 0.0;												// Restarted after every change
+	float current_scale = 1.0f;
+	uint32_t settled_frames = 0;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Readback.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+
+
+
+// Output container for exported frames
+enum class ExportFormat
+{
+	Y4M,				// YUV4MPEG2 stream, playable and pipeable into ffmpeg
+	Raw					// Headerless planar I420 frames
+};
+
+
+// Convert one BGRA/RGBA row pair into I420 planes (BT.709, limited range)
+//  - Gamma-encoded bytes are used as-is: _SRGB targets already store R'G'B'
+//  - red_shift is the bit offset of red inside each 32-bit pixel (16 for BGRA, 0 for RGBA)
+void convertRowPairI420(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint32_t red_shift,
+	uint8_t* luma0, uint8_t* luma1, uint8_t* cb, uint8_t* cr);
+
+
+// Streams read back frames to a file or stdout as Y4M or raw I420
+//  - submit() holds the readback slot and queues the frame for a worker, never converting on the caller
+//  - Workers convert with SIMD kernels, a writer thread emits finished frames in order as single large writes
+class FrameExporter
+{
+public:
+	FrameExporter();
+	~FrameExporter();
+
+	bool open(const std::string& path, ExportFormat format, uint32_t fps);		// "-" writes to stdout
+	void submit(ReadbackRing& ring, const ReadbackRing::Frame& frame);			// Queue a frame delivered by collect()
+	void waitForRelease();														// Block until a worker returns a readback slot
+	void finish();																// Flush everything and close
+
+	bool isOpen() const { return output != nullptr; }
+	uint64_t framesWritten() const { return frames_written; }
+
+private:
+	// Frame waiting for or undergoing conversion
+	struct Job
+	{
+		ReadbackRing* ring;
+		ReadbackRing::Frame frame;
+		uint64_t sequence;
+	};
+
+	// Converted frame, sequence decides write order
+	struct Packet
+	{
+		std::vector<uint8_t> data;
+		uint64_t sequence = 0;
+		bool ready = false;
+	};
+
+	FILE* output = nullptr;
+	bool owns_output = false;
+	ExportFormat format = ExportFormat::Y4M;
+	uint32_t fps = 60;
+	bool header_written = false;
+	uint32_t width = 0;															// Set once by submit() under the mutex, read-only after
+	uint32_t height = 0;
+
+	std::vector <std::thread> workers;
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable job_ready;											// Workers wait for jobs
+	std::condition_variable packet_ready;										// Writer waits for the next sequence
+	std::condition_variable slot_released;										// Producer waits for a free readback slot or packet
+	std::deque <Job> jobs;
+	std::vector <Packet> packets;												// Ring indexed by sequence
+	uint64_t next_sequence = 0;													// Assigned by submit()
+	uint64_t write_sequence = 0;												// Next packet the writer emits
+	uint64_t frames_written = 0;
+	bool stopping = false;
+
+	void workerLoop();
+	void writerLoop();
+	void convert(const ReadbackRing::Frame& frame, Packet& packet);				// BGRA -> I420 into the packet buffer
+	void writeHeader(uint32_t frame_width, uint32_t frame_height);
+};
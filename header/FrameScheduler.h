@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+
+
+// Queues the scheduler keeps a timeline for
+enum class QueueKind : uint32_t
+{
+	Graphics,
+	Compute,
+	Transfer,
+	Count
+};
+
+
+// Cross-queue frame scheduling on timeline semaphores (Vulkan 1.2)
+//  - One timeline per queue, every submit signals the next value on its queue's timeline
+//  - Cross-queue dependencies are (queue, value) wait points, the CPU waits or polls the same points instead of fences
+//  - Swap chain acquire and present still need binary semaphores, submit() accepts them alongside timeline points
+class FrameScheduler
+{
+public:
+	// Something a submit waits on - value is ignored for binary semaphores
+	struct WaitPoint
+	{
+		VkSemaphore semaphore;
+		uint64_t value;
+		VkPipelineStageFlags stages;
+	};
+
+	void create(VkDevice device);
+	void destroy();
+
+	WaitPoint after(QueueKind queue, uint64_t value, VkPipelineStageFlags stages) const;		// Wait for a timeline value
+	static WaitPoint binary(VkSemaphore semaphore, VkPipelineStageFlags stages);				// Wait for a binary semaphore
+
+	// Submit command buffers to a queue, signaling its next timeline value plus an optional binary semaphore
+	uint64_t submit(VkQueue queue, QueueKind kind, const VkCommandBuffer* command_buffers, uint32_t command_buffer_count,
+		const std::vector<WaitPoint>& waits, VkSemaphore binary_signal = VK_NULL_HANDLE);
+
+	uint64_t submitted(QueueKind queue) const { return values[index(queue)]; }					// Last value handed to a submit
+	uint64_t completed(QueueKind queue) const;													// Value the GPU has reached
+	bool poll(QueueKind queue, uint64_t value) const { return completed(queue) >= value; }
+	void wait(QueueKind queue, uint64_t value) const;											// Block until the queue reaches value
+	void waitIdle() const;																		// Block until every submitted value is reached
+
+	VkSemaphore semaphore(QueueKind queue) const { return timelines[index(queue)]; }
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkSemaphore timelines[(uint32_t)QueueKind::Count] = {};
+	uint64_t values[(uint32_t)QueueKind::Count] = {};											// Monotonic, render thread only
+
+	static uint32_t index(QueueKind queue) { return static_cast<uint32_t>(queue); }
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Renderer.h"
+#include "ImageDiff.h"
+
+
+
+// Options for the golden-image regression run
+struct GoldenOptions
+{
+	std::string reference_dir = "golden";		// <scene>.ppm reference images
+	std::string output_dir;						// Failure artifacts, defaults to reference_dir
+	bool update = false;						// Overwrite references instead of comparing
+	uint8_t tolerance = 2;						// Allowed per-channel difference
+	double max_mismatch_ratio = 0.0;			// Fraction of pixels allowed past tolerance
+	uint32_t width = 256;
+	uint32_t height = 256;
+};
+
+
+// Renders scripted scenes headless and compares them against stored references
+//  - Readbacks go through the renderer's ring so comparisons overlap the next scene's frames
+//  - Runs on any Vulkan device, including lavapipe with no GPU present
+class GoldenSuite
+{
+public:
+	GoldenSuite(Renderer& renderer, const GoldenOptions& options);
+
+	int run();										// Returns the number of failed scenes
+
+private:
+	// Scripted scene - applied to the renderer before its frames are drawn
+	struct Scene
+	{
+		const char* name;
+		VkClearColorValue clear_color;
+		uint32_t frames;							// Frames drawn, the last one is captured
+	};
+
+	Renderer& renderer;
+	GoldenOptions options;
+	std::vector <Scene> scenes;
+	std::vector <uint8_t> heatmap;
+	uint32_t passed = 0;
+	uint32_t failed = 0;
+
+	void check(const ReadbackRing::Frame& frame);		// Compare one completed readback
+	void collect();										// Check every readback the GPU has finished
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <mutex>
+#include <ostream>
+#include <cstddef>
+#include <cstdint>
+
+
+
+#define HOST_POOL_CLASSES 8					// Size classes 16 B .. 2 KiB, doubling
+#define HOST_POOL_CHUNK (64 * 1024)			// Bytes carved into blocks when a class runs dry
+#define HOST_ARENA_SIZE (64 * 1024)			// Per-thread arena for command scope allocations
+#define HOST_SCOPE_COUNT 5					// VkSystemAllocationScope values
+
+
+// VkAllocationCallbacks for every Vulkan create / destroy call
+//  - Small allocations come from per size class free lists, so repeated create / destroy reuses blocks
+//  - Command scope allocations (freed before the call returns) bump a per-thread arena that rewinds when empty
+//  - Bytes and counts are tracked per allocation scope with their peaks, driver internal allocations separately
+//  - One process-wide instance, since objects must be destroyed with the callbacks they were created with
+class HostAllocator
+{
+public:
+	struct ScopeStats
+	{
+		uint64_t bytes;						// Live
+		uint64_t count;
+		uint64_t peak_bytes;
+		uint64_t peak_count;
+		uint64_t allocations;				// Lifetime totals
+		uint64_t reallocations;
+		uint64_t frees;
+		uint64_t pooled;					// Served from a size class free list
+		uint64_t arena;						// Served from a command arena
+		uint64_t internal_bytes;			// Driver internal allocations it reported to us
+	};
+
+	static HostAllocator& instance();
+
+	const VkAllocationCallbacks* callbacks() const { return enabled ? &vk_callbacks : nullptr; }
+	ScopeStats stats(VkSystemAllocationScope scope) const;
+	void report(std::ostream& out) const;
+
+	static const char* scopeName(VkSystemAllocationScope scope);
+
+private:
+	HostAllocator();
+	~HostAllocator();
+	HostAllocator(const HostAllocator&) = delete;
+	HostAllocator& operator=(const HostAllocator&) = delete;
+
+	// Sits directly before every returned pointer
+	struct Header
+	{
+		uint32_t offset;					// Returned pointer - block start
+		uint8_t source;						// Pool class, or one of the SOURCE_ values
+		uint8_t scope;
+		uint16_t reserved;
+		uint64_t size;						// Requested size, for realloc and stats
+	};
+
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	// Free list per size class - guarded by a spin lock, held only for a pointer swap
+	struct SizeClass
+	{
+		std::atomic_flag lock = ATOMIC_FLAG_INIT;
+		FreeBlock* free_list = nullptr;
+	};
+
+	struct Counters
+	{
+		std::atomic<uint64_t> bytes{ 0 };
+		std::atomic<uint64_t> count{ 0 };
+		std::atomic<uint64_t> peak_bytes{ 0 };
+		std::atomic<uint64_t> peak_count{ 0 };
+		std::atomic<uint64_t> allocations{ 0 };
+		std::atomic<uint64_t> reallocations{ 0 };
+		std::atomic<uint64_t> frees{ 0 };
+		std::atomic<uint64_t> pooled{ 0 };
+		std::atomic<uint64_t> arena{ 0 };
+		std::atomic<uint64_t> internal_bytes{ 0 };
+	};
+
+	bool enabled = true;														// RENDERER_HOST_ALLOCATOR=0 hands the driver nullptr
+	VkAllocationCallbacks vk_callbacks{};
+	SizeClass classes[HOST_POOL_CLASSES];
+	Counters counters[HOST_SCOPE_COUNT];
+
+	std::mutex chunk_mutex;
+	void* chunks = nullptr;														// Linked through their first pointer, freed at exit
+
+	void* allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+	void* reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	void release(void* memory);
+	void refill(uint32_t size_class);
+	void track(uint8_t scope, int64_t bytes, int64_t count);
+
+	static VKAPI_ATTR void* VKAPI_CALL onAllocation(void* user, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void* VKAPI_CALL onReallocation(void* user, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void VKAPI_CALL onFree(void* user, void* memory);
+	static VKAPI_ATTR void VKAPI_CALL onInternalAllocation(void* user, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void VKAPI_CALL onInternalFree(void* user, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+};
+
+
+// Shorthand for create / destroy call sites
+inline const VkAllocationCallbacks* hostAllocator()
+{
+	return HostAllocator::instance().callbacks();
+}
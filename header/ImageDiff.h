@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+
+// Result of a per-pixel tolerance comparison
+struct ImageDiffResult
+{
+	uint64_t mismatched = 0;		// Pixels where any colour channel exceeded the tolerance
+	uint32_t max_delta = 0;			// Largest channel difference seen
+};
+
+
+// Compare two 4-byte-per-pixel images (alpha ignored)
+//  - heatmap is optional, receives one BGRA pixel per input pixel
+//  - Uses AVX2 or SSE2 when the CPU supports them
+ImageDiffResult diffImages(const uint8_t* actual, const uint8_t* expected, size_t pixel_count, uint8_t tolerance, uint8_t* heatmap);
+
+// Binary PPM (P6) helpers - pixels are kept as BGRA in memory to match the B8G8R8A8 render targets
+bool readPPM(const std::string& path, uint32_t& width, uint32_t& height, std::vector<uint8_t>& bgra);
+bool writePPM(const std::string& path, uint32_t width, uint32_t height, const uint8_t* bgra);
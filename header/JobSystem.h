@@ -0,0 +1,227 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+
+
+#define JOB_DEQUE_SIZE 4096					// Tasks per worker deque, must be a power of two
+#define JOB_INJECT_SIZE 1024				// Tasks queued from threads outside the pool, must be a power of two
+#define JOB_MAX_WORKERS 32
+#define JOB_SPIN_ROUNDS 64					// Failed steal rounds before a worker sleeps
+
+
+// Linear allocator for transient per-frame data
+//  - allocate() is a lock-free bump, safe from any worker
+//  - reset() rewinds in O(1) once everything allocated from it is dead - destructors are not run
+class FrameArena
+{
+public:
+	void create(size_t bytes);
+	void destroy();
+
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));		// Throws when the arena is exhausted
+	void reset();
+
+	template <typename T, typename... Args>
+	T* make(Args&&... args) { return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...); }
+
+	template <typename T>
+	T* allocateArray(size_t count) { return static_cast<T*>(allocate(sizeof(T) * std::max<size_t>(count, 1), alignof(T))); }	// Uninitialized
+
+	size_t used() const { return std::min(offset.load(std::memory_order_relaxed), size); }
+	size_t highWater() const { return high_water; }								// Largest frame so far, for sizing
+	size_t capacity() const { return size; }
+
+private:
+	std::unique_ptr<uint8_t[]> memory;
+	size_t size = 0;
+	std::atomic<size_t> offset{ 0 };
+	size_t high_water = 0;
+};
+
+
+struct JobCounter;
+
+
+// One unit of work - lives in a FrameArena, never freed individually
+struct JobTask
+{
+	void (*function)(void* data) = nullptr;
+	void* data = nullptr;
+	JobCounter* signal = nullptr;			// Decremented when the task finishes
+	JobTask* next = nullptr;				// Continuation list link
+};
+
+
+// Outstanding task count - reaching zero releases every task queued behind it with runAfter()
+//  - Lives until every task signaling it has finished and every wait() on it returned
+struct JobCounter
+{
+	std::atomic<uint32_t> pending{ 0 };
+	std::atomic_flag lock = ATOMIC_FLAG_INIT;	// Guards continuations against the zero transition
+	JobTask* continuations = nullptr;
+
+	bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+
+// Task scheduler with a work-stealing deque per worker
+//  - Workers push follow-up tasks to their own deque and pop LIFO, idle workers steal FIFO from the others
+//  - Threads outside the pool submit through a shared injection queue
+//  - wait() runs other tasks until its counter reaches zero, so waiting inside a task cannot deadlock
+//  - Task and closure storage comes from a FrameArena, nothing is heap allocated per task
+class JobSystem
+{
+public:
+	~JobSystem() { stop(); }
+
+	void start(uint32_t worker_count = 0);											// 0 = hardware concurrency - 1, the waiting thread makes up the rest
+	void stop();
+
+	// Closures are copied into the arena and destroyed after running
+	template <typename Work>
+	void run(FrameArena& arena, Work&& work, JobCounter* signal = nullptr);
+
+	template <typename Work>
+	void runAfter(JobCounter& dependency, FrameArena& arena, Work&& work, JobCounter* signal = nullptr);
+
+	// body(begin, end) over [0, count) in chunks of at most grain - body is shared by the chunks and never destroyed
+	template <typename Body>
+	void parallelFor(FrameArena& arena, uint32_t count, uint32_t grain, Body&& body, JobCounter& signal);
+
+	void wait(JobCounter& counter);
+
+	uint32_t workerCount() const { return worker_count; }
+	uint32_t concurrency() const { return workerCount() + 1; }						// Workers plus the waiting thread
+	uint64_t stealCount() const { return steals.load(std::memory_order_relaxed); }
+
+private:
+	// Chase-Lev deque - the owner pushes and pops at the bottom, thieves take from the top
+	struct WorkDeque
+	{
+		alignas(64) std::atomic<int64_t> top{ 0 };
+		alignas(64) std::atomic<int64_t> bottom{ 0 };
+		std::atomic<JobTask*> slots[JOB_DEQUE_SIZE];
+
+		bool push(JobTask* task);
+		JobTask* pop();
+		JobTask* steal();
+	};
+
+	std::vector <std::thread> workers;
+	uint32_t worker_count = 0;														// Fixed before any worker starts
+	std::unique_ptr<WorkDeque[]> deques;											// One per worker
+	std::atomic<bool> running{ false };
+	std::atomic<uint64_t> steals{ 0 };
+
+	// Injection queue for submitting threads outside the pool
+	std::mutex inject_mutex;
+	JobTask* inject[JOB_INJECT_SIZE] = {};
+	uint32_t inject_head = 0;
+	uint32_t inject_tail = 0;
+
+	// Sleeping workers - epoch moves whenever work is published
+	std::mutex sleep_mutex;
+	std::condition_variable sleep_cv;
+	std::atomic<uint32_t> sleepers{ 0 };
+	uint64_t epoch = 0;
+
+	template <typename Work>
+	static JobTask* makeTask(FrameArena& arena, Work&& work, JobCounter* signal);
+
+	void submit(JobTask* task);
+	void execute(JobTask* task);
+	void release(JobCounter& counter);
+	JobTask* findTask(int32_t self);
+	JobTask* popInjected();
+	void wake(bool all);
+	void workerLoop(uint32_t index);
+};
+
+
+// Counter that waits for its tasks when it leaves scope - for counters on a stack that can unwind while tasks still signal them
+//  - An explicit jobs.wait(scope.counter) earlier is fine, the destructor then returns at once
+struct JobScope
+{
+	JobSystem& jobs;
+	JobCounter counter;
+
+	explicit JobScope(JobSystem& jobs) : jobs(jobs) {}
+	~JobScope() { jobs.wait(counter); }
+	JobScope(const JobScope&) = delete;
+	JobScope& operator=(const JobScope&) = delete;
+};
+
+
+template <typename Work>
+JobTask* JobSystem::makeTask(FrameArena& arena, Work&& work, JobCounter* signal)
+{
+	typedef typename std::decay<Work>::type Closure;
+
+	JobTask* task = arena.make<JobTask>();
+	task->data = arena.make<Closure>(std::forward<Work>(work));
+	task->function = [](void* data)
+	{
+		Closure* closure = static_cast<Closure*>(data);
+		(*closure)();
+		closure->~Closure();
+	};
+	task->signal = signal;
+	return task;
+}
+
+
+template <typename Work>
+void JobSystem::run(FrameArena& arena, Work&& work, JobCounter* signal)
+{
+	JobTask* task = makeTask(arena, std::forward<Work>(work), signal);
+	if (signal != nullptr) signal->pending.fetch_add(1, std::memory_order_relaxed);
+	submit(task);
+}
+
+
+template <typename Work>
+void JobSystem::runAfter(JobCounter& dependency, FrameArena& arena, Work&& work, JobCounter* signal)
+{
+	JobTask* task = makeTask(arena, std::forward<Work>(work), signal);
+	if (signal != nullptr) signal->pending.fetch_add(1, std::memory_order_relaxed);
+
+	// Park behind the dependency unless it already finished
+	while (dependency.lock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+	bool parked = !dependency.done();
+	if (parked)
+	{
+		task->next = dependency.continuations;
+		dependency.continuations = task;
+	}
+	dependency.lock.clear(std::memory_order_release);
+
+	if (!parked) submit(task);
+}
+
+
+template <typename Body>
+void JobSystem::parallelFor(FrameArena& arena, uint32_t count, uint32_t grain, Body&& body, JobCounter& signal)
+{
+	if (count == 0) return;
+	grain = std::max(1u, grain);
+
+	typedef typename std::decay<Body>::type Shared;
+	Shared* shared = arena.make<Shared>(std::forward<Body>(body));
+	for (uint32_t begin = 0; begin < count; begin += grain)
+	{
+		uint32_t end = std::min(count, begin + grain);
+		run(arena, [shared, begin, end]() { (*shared)(begin, end); }, &signal);
+	}
+}
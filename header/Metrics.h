@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <string>
+#include <cstdint>
+
+
+
+#define METRICS_BUCKET_COUNT 10				// Histogram upper bounds, +Inf is implicit
+#define METRICS_POLL_MS 250					// Accept timeout, bounds how long stop() waits
+#define METRICS_REQUEST_MS 100				// Time a client gets to send its request line
+
+
+// Latency histogram with fixed bounds, safe to observe from any thread
+//  - observe() is a handful of relaxed atomic adds, the reader sees a slightly torn but monotonic view
+class MetricsHistogram
+{
+public:
+	static const double BOUNDS[METRICS_BUCKET_COUNT];							// Seconds, ascending
+
+	void observe(double seconds);
+
+	uint64_t bucket(uint32_t index) const { return buckets[index].load(std::memory_order_relaxed); }	// Not cumulative
+	uint64_t count() const { return samples.load(std::memory_order_relaxed); }
+	double sum() const { return sum_ns.load(std::memory_order_relaxed) * 1e-9; }
+
+private:
+	std::atomic<uint64_t> buckets[METRICS_BUCKET_COUNT + 1] = {};				// Last one is +Inf
+	std::atomic<uint64_t> samples{ 0 };
+	std::atomic<uint64_t> sum_ns{ 0 };
+};
+
+
+// Prometheus text exposition format
+class MetricsWriter
+{
+public:
+	explicit MetricsWriter(std::string& target) : out(target) {}
+
+	void counter(const char* name, const char* help, double value, const char* labels = nullptr);
+	void gauge(const char* name, const char* help, double value, const char* labels = nullptr);
+	void histogram(const char* name, const char* help, const MetricsHistogram& histogram);
+
+	// Labelled families - declare once, then one sample per label set
+	void declare(const char* name, const char* help, const char* type);
+	void sample(const char* name, double value, const char* labels);
+
+private:
+	std::string& out;
+};
+
+
+// Serves metrics to local scrapers from a background thread
+//  - Endpoint is a Unix socket path, or a port number for HTTP on 127.0.0.1
+//  - Every connection gets one HTTP/1.0 response, so curl --unix-socket, curl and socat all work
+//  - The snapshot callback runs on the server thread, it must only read atomics or thread-safe queries
+class MetricsServer
+{
+public:
+	~MetricsServer() { stop(); }
+
+	void start(const std::string& endpoint, std::function<void(std::string&)> snapshot);	// Throws when the endpoint cannot be bound
+	void stop();
+
+	bool active() const { return running.load(std::memory_order_relaxed); }
+	uint64_t scrapeCount() const { return scrapes.load(std::memory_order_relaxed); }
+
+private:
+	std::thread server_thread;
+	std::atomic<bool> running{ false };
+	std::atomic<uint64_t> scrapes{ 0 };
+	intptr_t listen_socket = -1;
+	std::string socket_path;													// Unlinked on stop, empty for TCP
+	std::function<void(std::string&)> write_snapshot;
+
+	void serveLoop();
+	void respond(intptr_t client);
+};
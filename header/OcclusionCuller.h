@@ -0,0 +1,85 @@
+#pragma once
+
+#include "DeletionQueue.h"
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+
+
+#define OCCLUSION_GROUP_SIZE 64				// Specialized into local_size_x of the select and test shaders
+#define OCCLUSION_TILE_SIZE 8				// Specialized into local_size_x / y of the pyramid reduction
+#define OCCLUSION_MAX_LEVELS 16
+
+
+// Depth and hierarchical-Z pyramid of one render target
+//  - Depth is written by both draw phases and sampled by the pyramid reduction
+//  - Mip 0 of the pyramid is half the depth resolution, each texel holds the farthest depth it covers
+struct OcclusionTarget
+{
+	VkImage depth_image = VK_NULL_HANDLE;
+	VkDeviceMemory depth_memory = VK_NULL_HANDLE;
+	VkImageView depth_view = VK_NULL_HANDLE;
+	VkExtent2D extent = { 0, 0 };
+
+	VkImage pyramid_image = VK_NULL_HANDLE;					// Null when occlusion culling is off
+	VkDeviceMemory pyramid_memory = VK_NULL_HANDLE;
+	VkImageView pyramid_view = VK_NULL_HANDLE;				// Every level, read by the occlusion test
+	std::vector <VkImageView> level_views;					// One per level, written by the reduction
+	VkExtent2D pyramid_extent = { 0, 0 };
+	uint32_t levels = 0;
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	std::vector <VkDescriptorSet> reduce_sets;				// Level i reads depth (i = 0) or level i - 1
+	VkDescriptorSet test_set = VK_NULL_HANDLE;
+};
+
+
+// Two-phase occlusion culling against a hierarchical depth pyramid, all on the GPU
+//  - Select: frustum survivors that were visible last frame form the phase 1 draw list
+//  - Phase 1 draws them, the pyramid is reduced from their depth
+//  - Test: every frustum survivor is tested against the pyramid, the newly visible form the phase 2 draw list
+//    and the result becomes next frame's visibility - a stale or garbage flag only costs a phase 2 draw
+//  - Lists, counts and visibility live in the window's instance set (set 0), the pyramid in a per-target set (set 1)
+class OcclusionCuller
+{
+public:
+	static constexpr VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+	static constexpr VkFormat PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+
+	void create(VkDevice device, VkPhysicalDevice physical_device);			// Enough for depth only targets
+	void createPipelines(VkDescriptorSetLayout instance_layout, VkShaderModule select_shader, VkShaderModule reduce_shader, VkShaderModule test_shader);
+	void destroy();
+
+	void createTarget(OcclusionTarget& target, VkExtent2D extent, bool pyramid);		// Depth only when pyramid is false
+	void retireTarget(OcclusionTarget& target, DeletionQueue& retired, uint64_t frame);
+	void destroyTarget(OcclusionTarget& target);
+
+	// Recorded outside render passes, around phase 1 - capacity is the instance capacity the lists were sized for
+	void recordSelect(VkCommandBuffer command_buffer, VkDescriptorSet instance_set, VkBuffer phase_buffer, uint32_t vertex_count, uint32_t capacity);
+	void recordPyramid(VkCommandBuffer command_buffer, OcclusionTarget& target);
+	void recordTest(VkCommandBuffer command_buffer, VkDescriptorSet instance_set, OcclusionTarget& target, VkExtent2D render_extent, uint32_t capacity);
+
+private:
+	// Read by the test - the reduction takes its sizes from the images
+	struct PushConstants
+	{
+		uint32_t levels;
+		uint32_t capacity;						// Phase 2 list starts here
+		float uv_scale[2];						// Rendered fraction of the target, dynamic resolution draws into a corner
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+	VkDescriptorSetLayout pyramid_layout = VK_NULL_HANDLE;
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	VkPipeline select_pipeline = VK_NULL_HANDLE;
+	VkPipeline reduce_pipeline = VK_NULL_HANDLE;
+	VkPipeline test_pipeline = VK_NULL_HANDLE;
+	VkSampler sampler = VK_NULL_HANDLE;										// Nearest, clamped - texels are reduced by hand
+
+	void createImage(VkFormat format, VkExtent2D extent, uint32_t levels, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& memory);
+	VkImageView createView(VkImage image, VkFormat format, VkImageAspectFlags aspect, uint32_t base_level, uint32_t level_count);
+	VkPipeline createPipeline(VkShaderModule shader, const VkSpecializationInfo* specialization);
+};
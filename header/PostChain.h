@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+
+
+// Post effects in chain order - each enabled effect becomes one subpass
+enum class PostEffect : uint32_t
+{
+	Tonemap,			// HDR scene -> display range (ACES fit)
+	Grade,				// Contrast and saturation
+	Vignette,			// Edge darkening
+	Count
+};
+
+
+// Push constants shared by every post subpass - mirrors post_params.glsl
+struct PostParams
+{
+	float exposure = 1.0f;
+	float contrast = 1.05f;
+	float saturation = 1.1f;
+	float vignette_strength = 0.35f;
+	float vignette_radius = 0.95f;
+	float vignette_softness = 0.45f;
+};
+
+
+// Runtime configuration of the post-processing subpass chain
+//  - setEnabled() / toggle() are safe from any thread, the render thread rebuilds on the next frame
+//  - Only per-pixel effects fit: input attachments cannot read neighbouring pixels
+class PostChain
+{
+public:
+	void setEnabled(PostEffect effect, bool enabled);
+	void toggle(PostEffect effect);
+	bool isEnabled(PostEffect effect) const;
+	bool consumeDirty();														// True once after each change
+	std::vector <PostEffect> activeEffects() const;								// Enabled effects in chain order
+
+	static const char* name(PostEffect effect);
+	static bool parse(const std::string& name, PostEffect& effect);
+
+	PostParams params;															// Render thread only once running
+
+private:
+	std::atomic<uint32_t> mask{ 0 };
+	std::atomic<bool> dirty{ false };
+};
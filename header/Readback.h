@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+
+
+// Ring of host-visible buffers for copying rendered images back without stalling
+//  - acquire() hands out a free slot tagged with the frame that will fill it
+//  - collect() hands finished slots to the caller once that frame has completed on the GPU
+//  - A consumer may hold() a slot during collect() and release() it later from any thread
+class ReadbackRing
+{
+public:
+	// Completed readback handed to collect() callbacks
+	struct Frame
+	{
+		const uint8_t* pixels;			// Tightly packed rows, 4 bytes per pixel
+		VkExtent2D extent;
+		VkFormat format;
+		uint64_t frame;					// Frame number the copy was recorded in
+		uint64_t tag;					// Caller supplied identifier
+		uint32_t slot;					// Slot index for hold() / release()
+	};
+
+	void create(VkDevice device, VkPhysicalDevice physical_device, uint32_t slot_count, VkDeviceSize slot_size);
+	void destroy();
+
+	int32_t acquire(uint64_t frame, uint64_t tag);											// Free slot index, -1 when all are in flight
+	void recordCopy(VkCommandBuffer command_buffer, uint32_t slot, VkImage image,				// Copy image into slot, restoring its layout
+		VkImageLayout layout, VkFormat format, VkExtent2D extent);
+
+	template <typename Consumer>
+	size_t collect(uint64_t completed_frame, Consumer&& consume);							// Deliver slots finished by completed_frame
+
+	void hold(uint32_t slot);																// Keep a delivered slot mapped past collect()
+	void release(uint32_t slot);															// Return a held slot, thread safe
+
+	uint32_t slotCount() const { return (uint32_t)slots.size(); }
+	VkDeviceSize slotSize() const { return slot_size; }
+	uint32_t pendingCount() const;															// Slots awaiting the GPU or collection
+	uint64_t skippedCount() const { return skipped; }										// acquire() calls refused
+
+private:
+	// Slot ownership - only release() is called off the owning thread
+	enum SlotState : uint8_t
+	{
+		SLOT_FREE = 0,
+		SLOT_PENDING,								// Copy recorded, waiting on GPU or collection
+		SLOT_HELD									// Delivered, consumer still reading
+	};
+
+	struct Slot
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		uint8_t* mapped = nullptr;					// Persistently mapped
+		uint64_t frame = 0;
+		uint64_t tag = 0;
+		VkExtent2D extent{};
+		VkFormat format = VK_FORMAT_UNDEFINED;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	std::vector <Slot> slots;
+	std::unique_ptr<std::atomic<uint8_t>[]> states;		// SlotState per slot
+	VkDeviceSize slot_size = 0;
+	bool coherent = true;							// False when HOST_CACHED memory needs invalidation
+	uint32_t next_slot = 0;
+	uint64_t skipped = 0;
+
+	void invalidate(Slot& slot);
+};
+
+
+template <typename Consumer>
+size_t ReadbackRing::collect(uint64_t completed_frame, Consumer&& consume)
+{
+	size_t delivered = 0;
+
+	// Deliver oldest first so consumers see frames in order
+	for (uint32_t n = 0; n < slots.size(); n++)
+	{
+		int32_t oldest = -1;
+		for (uint32_t i = 0; i < slots.size(); i++)
+		{
+			if (states[i].load(std::memory_order_acquire) == SLOT_PENDING && slots[i].frame <= completed_frame
+				&& (oldest < 0 || slots[i].frame < slots[oldest].frame))
+			{
+				oldest = (int32_t)i;
+			}
+		}
+		if (oldest < 0) break;
+
+		Slot& slot = slots[oldest];
+		invalidate(slot);
+		Frame frame{ slot.mapped, slot.extent, slot.format, slot.frame, slot.tag, (uint32_t)oldest };
+		consume(frame);
+
+		// Consumers that called hold() free the slot themselves
+		uint8_t expected = SLOT_PENDING;
+		states[oldest].compare_exchange_strong(expected, SLOT_FREE, std::memory_order_acq_rel);
+		delivered++;
+	}
+	return delivered;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "OcclusionCuller.h"
+
+#include <SDL2/SDL.h>
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+
+// One presentation target - SDL window, surface, swap chain and its per-image resources
+//  - Any number of targets share the Renderer's device, render pass, pipeline and queues
+//  - A headless target has no window or surface, its only image is the offscreen image
+struct RenderWindow
+{
+	std::string title;
+	uint32_t width = 0;
+	uint32_t height = 0;
+
+	SDL_Window* window = nullptr;
+	uint32_t id = 0;										// SDL window ID, matches SDL_WindowEvent::windowID
+	uint32_t view = 0;										// Occlusion history slot in SceneInstances - the window's index
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
+	VkSwapchainKHR swap_chain = VK_NULL_HANDLE;
+	VkFormat image_format = VK_FORMAT_UNDEFINED;
+	VkExtent2D extent = { 0, 0 };
+
+	std::vector <VkImage> images;							// Swap chain images or the offscreen image
+	std::vector <VkImageView> image_views;
+	std::vector <VkFramebuffer> frame_buffers;
+	std::vector <VkFramebuffer> occlusion_frame_buffers;	// Phase 1 - scene color and depth, empty when occlusion culling is off
+	std::vector <VkFramebuffer> debug_frame_buffers;		// Debug lines over the finished image
+	VkSemaphore image_available = VK_NULL_HANDLE;			// Signaled by this target's acquire
+
+	// Cached render pass per image, replayed until command_generation moves on
+	std::vector <VkCommandBuffer> command_buffers;
+	std::vector <uint64_t> recorded_generation;				// Generation each cached buffer was recorded at
+
+	// Post chain intermediates - scene color then ping-pong, transient where the device allows
+	VkImage post_images[2] = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+	VkDeviceMemory post_memory[2] = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+	VkImageView post_views[2] = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+	VkDescriptorPool post_pool = VK_NULL_HANDLE;
+	std::vector <VkDescriptorSet> post_sets;				// Input attachment set per post subpass
+
+	// Depth for the scene subpass, and the Hi-Z pyramid built from it
+	OcclusionTarget occlusion;
+
+	// Dynamic resolution - final scene color, stretched over the swap chain image by the upscale pass
+	VkImage scaled_image = VK_NULL_HANDLE;
+	VkDeviceMemory scaled_memory = VK_NULL_HANDLE;
+	VkImageView scaled_view = VK_NULL_HANDLE;
+	VkDescriptorPool upscale_pool = VK_NULL_HANDLE;
+	VkDescriptorSet upscale_set = VK_NULL_HANDLE;
+	std::vector <VkFramebuffer> upscale_frame_buffers;		// One per swap chain image
+
+	// Render thread state
+	bool minimized = false;									// Skipped while minimized or hidden
+	bool resized = false;									// Swap chain needs rebuilding
+	uint32_t image_index = 0;								// Image acquired for the frame being recorded
+};
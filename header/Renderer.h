@@ -14,6 +14,37 @@
 #include <cstdint>
 #include <iomanip>
 #include <fstream>
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <chrono>
+
+#include "DebugLog.h"
+#include "SPSCQueue.h"
+#include "Readback.h"
+#include "FrameExport.h"
+#include "DeletionQueue.h"
+#include "RenderWindow.h"
+#include "FrameScheduler.h"
+#include "AsyncCompute.h"
+#include "PostChain.h"
+#include "JobSystem.h"
+#include "SceneGraph.h"
+#include "SceneInstances.h"
+#include "OcclusionCuller.h"
+#include "ClusteredLighting.h"
+#include "DynamicResolution.h"
+#include "ShaderVariants.h"
+#include "VertexFormat.h"
+#include "DrawSort.h"
+#include "DebugDraw.h"
+#include "TextureLoader.h"
+#include "CommandTrace.h"
+#include "AssetPack.h"
+#include "Bvh.h"
+#include "VulkanHelpers.h"
+#include "HostAllocator.h"
+#include "Metrics.h"
 
 
 
@@ -22,8 +53,43 @@
 
 #define CLAMP(x, lo, hi)    ((x) < (lo) ? (lo) : (x) > (hi) ? (hi) : (x))
 
-#define SHADER_VERT_FILE_DIR "C:/Users/Thugs4Less/Desktop/Program Projects/Vulkan/src/shaders/vert.spv"
-#define SHADER_FRAG_FILE_DIR "C:/Users/Thugs4Less/Desktop/Program Projects/Vulkan/src/shaders/frag.spv"
+#define EXPORT_READBACK_SLOTS 4
+
+// Frames the CPU may run ahead of the GPU - deliberately one
+//  - Instance, camera and lighting buffers are mapped once and rewritten every frame, and the cached window passes bind them,
+//    so a second frame in flight would need every one of them, their sets and the cached passes once per frame
+//  - Within the frame the timelines still overlap async compute with graphics, and the debug ring fills its next slot meanwhile
+#define FRAMES_IN_FLIGHT 1
+#define FRAME_ARENA_SLOTS FRAMES_IN_FLIGHT			// Frames whose transient task data can be alive at once
+#define FRAME_ARENA_SIZE (4 << 20)					// Bytes per slot, see FrameArena::highWater()
+
+#define SHADER_DIR "C:/Users/Thugs4Less/Desktop/Program Projects/Vulkan/src/shaders/"
+#define SHADER_VERT_FILE_DIR SHADER_DIR "vert.spv"
+#define SHADER_FRAG_FILE_DIR SHADER_DIR "frag.spv"
+#define SHADER_VERT_PACKED_FILE_DIR SHADER_DIR "vert_packed.spv"				// shader_base.vert with PACKED_VERTICES
+#define SHADER_POST_VERT_FILE_DIR SHADER_DIR "post_fullscreen.spv"
+#define SHADER_POST_TONEMAP_FILE_DIR SHADER_DIR "post_tonemap.spv"
+#define SHADER_POST_GRADE_FILE_DIR SHADER_DIR "post_grade.spv"
+#define SHADER_POST_VIGNETTE_FILE_DIR SHADER_DIR "post_vignette.spv"
+#define SHADER_OCCLUSION_SELECT_FILE_DIR SHADER_DIR "occlusion_select.spv"
+#define SHADER_HIZ_REDUCE_FILE_DIR SHADER_DIR "hiz_reduce.spv"
+#define SHADER_OCCLUSION_TEST_FILE_DIR SHADER_DIR "occlusion_test.spv"
+#define SHADER_UPSCALE_FILE_DIR SHADER_DIR "upscale.spv"
+#define SHADER_UPSCALE_SHARPEN_FILE_DIR SHADER_DIR "upscale_sharpen.spv"		// upscale.frag with SHARPEN
+#define SHADER_DEBUG_VERT_FILE_DIR SHADER_DIR "debug_draw_vert.spv"
+#define SHADER_DEBUG_FRAG_FILE_DIR SHADER_DIR "debug_draw_frag.spv"
+#define SHADER_CLUSTER_ASSIGN_FILE_DIR SHADER_DIR "cluster_assign.spv"
+
+#define MESH_BASE_ASSET "base.mesh"				// Replaces the triangle when the asset pack holds it
+
+
+// Validation layer tiers, selected at runtime
+enum class ValidationTier
+{
+	Off,				// No layers or messenger
+	ErrorsOnly,			// Validation layer reporting errors only
+	Full				// All severities plus GPU-assisted validation
+};
 
 
 class Renderer
@@ -32,15 +98,51 @@ public:
 	Renderer();
 	~Renderer();
 
+	void setValidationTier(ValidationTier tier);		// Must be called before initVulkan()
+	void setHeadless(uint32_t width, uint32_t height);	// Render offscreen with no window or swap chain
+	void addWindow(const std::string& title, uint32_t width, uint32_t height);	// Extra viewport, must be called before initVulkan()
+	void setAsyncCompute(bool enabled);					// Dedicated compute queue when available, must be called before initVulkan()
+	void addComputePass(const AsyncCompute::Pass& pass);	// Compute work recorded every frame ahead of graphics
+	void setPostEffect(PostEffect effect, bool enabled);	// Any thread, takes effect next frame
+	void setScene(SceneGraph* scene_graph);				// Instances drawn from the base pipeline, null draws the single triangle
+	void setCamera(const Mat4& view_projection);		// Render thread, or before runOffline()
+	void setCamera(const Mat4& view, const Mat4& projection);	// Same, clustered lighting slices depth from the projection alone
+	void setLights(const Light* light_list, uint32_t count);	// Replaces every light, at most CLUSTER_MAX_LIGHTS - render thread, or before runOffline()
+	void setAmbientLight(float r, float g, float b);	// Added to the lights, unused without any
+	void setOcclusionCulling(bool enabled);				// Two-phase Hi-Z culling on the GPU, must be called before initVulkan()
+	void setVertexLayout(VertexLayout layout);			// Full or quantized mesh vertices, must be called before initVulkan()
+	void setFrameBudget(double milliseconds);			// Dynamic resolution against this GPU time, 0 = native, must be called before initVulkan()
+	void setUpscaleSharpness(float sharpness);			// 0 = bilinear upscale, must be called before initVulkan()
+	void setDebugBounds(bool enabled);					// Visible instance bounds as debug lines, render thread
+	void addTexture(const std::string& path);			// KTX2 file, uploaded by initVulkan()
+	void setAssetPack(const std::string& path);			// Shaders, textures and the base mesh come from here before loose files, must be called before initVulkan()
+	bool pick(const Ray& ray, NodeId& node);			// Nearest scene node whose bounds the ray hits, as of the last frame
+	void setPreferredDevice(const std::string& name);	// Pick the first suitable GPU whose name contains this
+	void setExporter(FrameExporter* frame_exporter);		// Stream every rendered frame, must be opened already
+	void setMetricsEndpoint(const std::string& endpoint);	// Unix socket path or loopback port, must be called before initVulkan()
+	void runOffline(uint32_t frame_count);				// Render a fixed number of frames without an event loop
+	void setCapture(const std::string& path, uint32_t frame_count);	// Trace the first frames' renderer inputs, must be called before initVulkan()
+	void runReplay(const std::string& path, uint32_t loops);	// Headless replay of a trace in place of initVulkan(), prints per-frame timings
+
+	friend class GoldenSuite;
+
 private:
 	// Application Deubuger Mode
 	bool debug_mode = true;
 
-	// SDL Window
-	SDL_Window* window;
+	// SDL Windows - windows[0] is the main window, closing it quits
+	std::vector <RenderWindow> windows;
+	std::vector <uint32_t> frame_windows;						// Windows drawn in the frame being recorded
 	SDL_WindowFlags window_flags;
 	SDL_Event event;
 
+	// Threading - SDL events on the main thread, drawFrame() on the render thread
+	std::thread render_thread;									// Owns drawFrame()
+	std::atomic<bool> running{ false };							// Cleared on SDL_QUIT
+	SPSCQueue <SDL_Event, 256> event_queue;						// Main thread -> render thread
+	uint64_t dropped_events = 0;								// Events lost to a full queue
+	std::exception_ptr render_error;							// Rethrown on the main thread after join
+
 	// Vulkan Setup Components 
 	VkInstance instance;										// Vulkan Instance
 	VkDebugUtilsMessengerEXT debug_messenger;					// Vulkan Debugger
@@ -50,33 +152,164 @@ private:
 	VkQueue present_queue;										// Queue for Presenting
 	uint32_t queue_family_index = 0;							// Graphics Family indice
 	uint32_t present_family_index = 0;
+	AsyncCompute compute;										// Compute passes, async or inline on graphics
+	bool async_compute = true;									// Overridden by RENDERER_ASYNC_COMPUTE=0|1
 	VkDebugReportCallbackEXT debug_report = VK_NULL_HANDLE;		// Debugger callback report
 
 
-	// Vulkan Presentation Components
-	VkSurfaceKHR surface;										// Window Surface
-	VkSwapchainKHR swap_chain = VK_NULL_HANDLE;					// Swap Chain
-	VkFormat swap_chain_image_format;							// Format of swapchain
-	VkExtent2D swap_chain_extent;								// Extent / resolution
-	VkPipeline pipelineLayout;									// Pipeline for rendering
+	// Vulkan Presentation Components - surfaces and swap chains live in each RenderWindow
+	VkPipelineLayout pipelineLayout;							// Pipeline for rendering
 	VkPipeline graphicsPipeline;
 	VkRenderPass render_pass;									// Renderer Pass
 	VkCommandPool commandPool;									// Command pool
-	VkCommandBuffer commandBuffer;								// Command Buffer
+	VkCommandBuffer commandBuffer;								// Per-frame prologue - inline compute, light assignment
+	VkCommandBuffer copyCommandBuffer;							// Per-frame epilogue - readback copies
+	VkCommandBuffer debugCommandBuffer;							// Per-frame debug lines - recorded only when some are queued
+
+	// Cached Command Buffers - window passes are recorded once and replayed
+	uint64_t command_generation = 1;							// Bumped when anything a cached pass references changes
+	std::atomic<uint64_t> passes_recorded{ 0 };					// Cache misses, for profiling
+	VkClearColorValue recorded_clear_color{};					// Values baked into the cached passes
+	PostParams recorded_post_params{};
+
+	// Post Processing - subpasses reading the previous output as an input attachment
+	PostChain post_chain;										// Runtime effect selection
+	std::vector <PostEffect> post_effects;						// Chain baked into the current render pass
+	VkFormat post_format = VK_FORMAT_R16G16B16A16_SFLOAT;		// HDR scene and intermediate color
+	VkDescriptorSetLayout post_set_layout = VK_NULL_HANDLE;
+	VkPipelineLayout post_layout = VK_NULL_HANDLE;
+	std::vector <VkPipeline> post_pipelines;					// One per post subpass
 
-	// Vulkan Buffers
-	std::vector <VkImage> swapChainImages;						// Images in swap chain
-	std::vector <VkImageView> swapChainImageViews;				// Image views
-	std::vector <VkFramebuffer> swapChainFrameBuffers;			// Frame Buffesr
+	// Scene Instances - the BVH culls on the host, the visible list and indirect draw are read by the cached passes
+	SceneGraph* scene = nullptr;								// Not owned
+	SceneInstances instances;									// Set 0 of the base pipeline
+	Mat4 camera = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+	Mat4 camera_view = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };			// camera = projection * view, identity view when set as one matrix
+	Mat4 camera_projection = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+	Bvh bvh;													// Over world bounds of every instance
+	std::vector <Aabb> instance_bounds;							// Indexed like SceneGraph::worldMatrices()
+	std::vector <uint32_t> visible_instances;					// Frustum survivors of the last frame, in draw key order
+	std::vector <uint64_t> draw_keys;							// One per visible instance
+	std::vector <uint64_t> sort_scratch_keys;
+	std::vector <uint32_t> sort_scratch_values;
+	bool rebuild_instances = false;								// Full upload and BVH build this frame, else changed range and refit
+	bool debug_bounds = false;									// Culling task draws every visible box through DebugDraw
+
+	// Mesh - vertex buffer of the base pipeline, quantized at import when the layout is packed
+	struct ScenePush													// Vertex push constants, mirrored in shader_base.vert
+	{
+		int32_t list_base;												// Negative draws the visible list
+		int32_t padding[3];
+		MeshQuantization quantization;
+	};
+	VertexLayout vertex_layout = VertexLayout::Full;
+	VkBuffer mesh_buffer = VK_NULL_HANDLE;
+	VkDeviceMemory mesh_memory = VK_NULL_HANDLE;
+	uint32_t mesh_vertex_count = 0;
+	MeshQuantization mesh_quantization{};
+	VertexStats mesh_stats;												// Reported at import and in the metrics
+	Aabb mesh_bounds = { { 0, 0, 0 }, { 0, 0, 0 } };						// Object space, culled per instance
+	const char* mesh_name = "triangle";
 
-	// Synchronization objects
-	VkSemaphore imageAvailableSemaphore;
-	VkSemaphore renderFinishedSemaphore;
-	VkFence inFlightFence;
+	// Asset Pack - mapped once, loads read blobs in place and fall back to loose files for anything it lacks
+	AssetPack assets;
+	std::string asset_pack_path;								// Empty = loose files only
+	uint32_t asset_loads = 0;									// Shaders, textures and meshes loaded
+	uint32_t asset_loads_packed = 0;							// Of those, read from the pack
+	double asset_load_seconds = 0.0;							// Read or mapped through the copy into Vulkan memory
+
+	// Textures - KTX2 blocks uploaded as stored or transcoded, RGBA8 only when the device samples no block format
+	std::vector <std::string> texture_paths;					// Loaded in order by initVulkan()
+	std::vector <Texture> textures;
+
+	// Occlusion Culling - phase 1 draws last frame's visible set, phase 2 what the depth pyramid newly reveals
+	OcclusionCuller occlusion;									// Depth targets always, pyramid and compute pipelines when enabled
+	bool occlusion_culling = true;								// Overridden by RENDERER_OCCLUSION=0|1
+	VkRenderPass occlusion_pass = VK_NULL_HANDLE;				// Phase 1 - clears scene color and depth, leaves depth readable
+	VkPipeline occlusion_pipeline = VK_NULL_HANDLE;				// Base pipeline against occlusion_pass
+
+	// Clustered Lighting - lights are binned into froxels by a compute pass in the prologue, fragments shade their cluster's list
+	ClusteredLighting lighting;									// Set 1 of the base pipeline
+	std::vector <Light> lights;
+	float ambient_light[3] = { 0.05f, 0.05f, 0.05f };
+	bool lights_dirty = false;									// Uploaded, and traced, by the next frame
+
+	// Dynamic Resolution - the scene renders into a corner of a window sized image, the upscale pass fills the swap chain image
+	bool dynamic_resolution = false;							// Derived from the frame budget
+	double frame_budget_ms = 0.0;								// Overridden by RENDERER_FRAME_BUDGET_MS, 0 = native resolution
+	GpuFrameTimer gpu_timer;									// Timestamps around the graphics submit
+	double last_gpu_ms = -1.0;									// Previous graphics submit, negative until its timestamps landed
+	ResolutionController resolution;							// Scale changes re-record the cached passes
+	float upscale_sharpness = 0.25f;
+	VkRenderPass upscale_pass = VK_NULL_HANDLE;
+	VkDescriptorSetLayout upscale_set_layout = VK_NULL_HANDLE;
+	VkPipelineLayout upscale_layout = VK_NULL_HANDLE;
+	VkPipeline upscale_pipeline = VK_NULL_HANDLE;
+	VkSampler upscale_sampler = VK_NULL_HANDLE;					// Bilinear, clamped
+
+	// Command Trace - each frame's renderer inputs are captured after simulation, replay feeds them back without one
+	TraceWriter capture;
+	std::string capture_path;									// Empty = no capture
+	uint32_t capture_frames = 0;
+	bool replaying = false;										// Scene matrices come from the trace, scene update is skipped
+	SceneGraph replay_scene;									// One root per captured instance
+
+	// Frame Tasks - simulation, culling and upload run as jobs, recording and submit stay on the render thread
+	JobSystem jobs;												// Work-stealing workers, the render thread helps while waiting
+	FrameArena frame_arenas[FRAME_ARENA_SLOTS];					// Task and scratch storage, reset when the slot comes round again
+	std::vector <VkCommandBuffer> frame_command_buffers;		// Reused each frame
+	std::vector <FrameScheduler::WaitPoint> frame_waits;
+
+	// Headless Rendering - an offscreen image stands in for the main window's swap chain
+	bool headless = false;
+	VkImage offscreen_image = VK_NULL_HANDLE;
+	VkDeviceMemory offscreen_memory = VK_NULL_HANDLE;
+	std::string preferred_device;								// Device name filter, empty = first suitable
+
+	// Frame Tracking
+	uint64_t frame_number = 0;									// Frames submitted
+	uint64_t completed_frame = 0;								// Frames known to be finished on the GPU
+	DeletionQueue deletion_queue;								// Resources destroyed once their last frame completes
+	VkClearColorValue clear_color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+
+	// Image Readback
+	ReadbackRing readback;										// Host visible copies of rendered frames
+	int32_t readback_slot = -1;									// Slot filled by the next recorded frame
+	FrameExporter* exporter = nullptr;							// Frame stream export, null when disabled
+
+	// Synchronization objects - acquire semaphores are per window
+	VkSemaphore renderFinishedSemaphore;						// Waited by the single batched present
+	FrameScheduler scheduler;									// Timeline per queue - replaces the frame fence
+
+
+	// Live Metrics - drawFrame() only does relaxed atomic updates, the server thread formats them on scrape
+	struct FrameMetrics
+	{
+		MetricsHistogram frame_time;							// drawFrame() start to start
+		MetricsHistogram fence_wait;							// Blocked on the previous frame's timeline value
+		MetricsHistogram acquire;								// Every acquire of a frame together
+		std::atomic<uint64_t> submits{ 0 };						// Graphics and compute queue submits
+		std::atomic<uint64_t> draws{ 0 };						// Draw commands in the submitted window passes
+		std::atomic<uint64_t> swap_chain_recreations{ 0 };
+		std::atomic<uint32_t> visible_instances{ 0 };			// Instance count of the last indirect draw
+		MetricsHistogram gpu_time;								// Graphics submit, measured with timestamps
+		std::atomic<uint32_t> render_scale_percent{ 100 };		// Dynamic resolution scale per axis
+		std::atomic<uint32_t> debug_vertices{ 0 };				// Debug line vertices drawn by the last frame
+		std::atomic<uint64_t> texture_bytes{ 0 };				// Every texture level as uploaded
+		std::atomic<uint64_t> texture_rgba_bytes{ 0 };			// The same levels as RGBA8
+		std::atomic<uint32_t> lights{ 0 };						// Binned by the last frame
+	};
+	FrameMetrics metrics;
+	MetricsServer metrics_server;
+	std::string metrics_endpoint;								// Overridden by RENDERER_METRICS, empty = disabled
+	std::chrono::steady_clock::time_point last_frame_start;
+	bool memory_budget = false;									// VK_EXT_memory_budget enabled on the device
 
 
 	// Validation Layers for Vulkan Elementsdf
-	const bool enableValidationLayers = true;
+	ValidationTier validation_tier = ValidationTier::ErrorsOnly;							// Overridden by RENDERER_VALIDATION=off|errors|full
+	bool enableValidationLayers = true;														// Derived from validation tier
+	DebugLog debug_log;																		// Async sink for debug callback messages
 	const std::vector <const char*> validationLayers = {"VK_LAYER_KHRONOS_validation"};		// Validation layers for instance & device
 	std::vector <const char*> SDL_extensions{};													// SDL extensions
 	std::vector <const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};			// Device extensions
@@ -86,6 +319,7 @@ private:
 	{
 		uint32_t graphicsFamily = -1;
 		uint32_t presentFamily = -1;
+		uint32_t computeFamily = -1;		// Compute without graphics, -1 when the device has none
 
 		bool hasEntry() { return (graphicsFamily != -1 && presentFamily != -1); }
 	};
@@ -106,9 +340,11 @@ public: // Delete 'public' later *
 	void initVulkan();						// Initialize Vulkan App
 	void deInitVulkan();					// DeInitialize Vulkan App
 	void eventHandler();					// Main loop for application
+	void renderLoop();						// Render thread body
+	void processRenderEvents();				// Consume queued SDL events on render thread
 
 	VkResult errorHandler(VkResult error);	// Error Handling for Vulkan results
-	void createWindow();					// Initialize and setup SDL window
+	void createWindow();					// Initialize SDL and every window
 	void createInstance();					// Initialize Vulkan Application instance
 	void checkSDLExtensions();				// Connect SDL Extensions to Vulkan Application
 	bool checkValidationLayers();			// Check for all Validation Layers
@@ -126,22 +362,60 @@ public: // Delete 'public' later *
 	QueueFamilyIndices queryQueueFamilies(VkPhysicalDevice device);						// Find Queue Families for instanced device
 	bool checkDeviceExtensions(VkPhysicalDevice device);								// Check for needed Device Extensions
 	void createLogicalDevice();															// Create Logical Device from Physical GPU 
-	void createSurface();																// Create Surface for graphics
-	void createSwapChain();																// Create Swap Chain for
-	SwapChainProperties querySwapChainProp(VkPhysicalDevice device);					// Query the Properties in Swap Chain
-	void setSwapChainProp(SwapChainProperties& swapChainProperties);					// Fill SwapChain Properties
-	void createImageViews();
+	void createSurface();																// Create Surface for every window
+	void createSwapChain(RenderWindow& target);											// Create Swap Chain for a window
+	SwapChainProperties querySwapChainProp(VkPhysicalDevice device, VkSurfaceKHR surface);	// Query the Properties in Swap Chain
+	void setSwapChainProp(SwapChainProperties& swapChainProperties, RenderWindow& target);	// Fill SwapChain Properties
+	void recreateSwapChain(RenderWindow& target);										// Rebuild swap chain after resize / out of date
+	void createImageViews(RenderWindow& target);
+	void createOffscreenTarget(RenderWindow& target);									// Headless replacement for the swap chain
+	RenderWindow* findWindow(uint32_t id);												// Window for an SDL window ID, null if unknown
+	void createReadback(uint32_t slot_count);											// Allocate readback ring sized for the target
+	void resizeReadback();																// Drain and regrow the ring once the main window outgrows it
+	bool requestReadback(uint64_t tag);													// Copy the next frame back to the host
+	void exportFrames();																// Hand finished readbacks to the exporter
+	void finishExport();																// Drain the last frames into the exporter
 
 
 	bool readFile(std::string fileName, std::vector<char> &buffer);						// Reads in Files
 	VkShaderModule createShaderModule(std::vector<char> &buffer);						// Create Module from Shader Files
+	VkShaderModule createShaderModule(const void* code, size_t size);
+	VkShaderModule loadShaderModule(const std::string& path);							// From the asset pack, else read from path
+	void countAssetLoad(std::chrono::steady_clock::time_point start, bool packed);		// Load profile, printed by initVulkan()
 	void createGraphicsPipeline();														// Graphics Pipeline for Rendering
 	void createRenderPass();															// Create the Renderpass for Frame bufers
-	void createFrameBuffers();															// Create Frame Buffers for Rendering
+	void createOcclusionPass();															// Phase 1 render pass, null when occlusion culling is off
+	void createOcclusionPipelines();													// Select, reduce and test compute pipelines
+	void createMesh();																	// Base triangle in the chosen vertex layout
+	void loadTexture(const std::string& path);											// Transcode on the job system, upload and wait
+	void createUpscalePipeline();														// Upscale render pass, pipeline and sampler
+	void createScaledTarget(RenderWindow& target);										// Window sized scene image and its upscale framebuffers
+	void retireScaledTarget(RenderWindow& target);
+	VkExtent2D renderExtent(const RenderWindow& target);								// Part of the window the scene is drawn into
+	void createPostPipelines();															// Pipelines for each post subpass
+	void createPostTargets(RenderWindow& target);										// Intermediate attachments and input sets
+	void retirePostTargets(RenderWindow& target);										// Hand intermediates to the deletion queue
+	void rebuildPostChain();															// Re-bake render pass and pipelines for a new chain
+	void createFrameBuffers(RenderWindow& target);										// Create Frame Buffers for Rendering
+	void createDebugPipeline();															// Debug line pipeline on the DebugDraw render pass
+	void createDebugFrameBuffers(RenderWindow& target);									// Debug pass over each image, independent of the post chain
 	void createCommandPool();
 	void createCommandBuffer();															// Create Command Buffer
-	void writeCommandBuffer(VkCommandBuffer command_buffer, uint32_t image_index);		// Writes to Command buffers
+	bool writePrologue(VkCommandBuffer command_buffer);									// Per-frame work ahead of the window passes
+	bool writeEpilogue(VkCommandBuffer command_buffer);									// Per-frame work after the window passes
+	bool writeDebugPass(VkCommandBuffer command_buffer);								// Queued debug lines over every window, false when none
+	void recordWindowPass(VkCommandBuffer command_buffer, RenderWindow& target, uint32_t image_index);
+	VkCommandBuffer cachedWindowPass(RenderWindow& target);							// Re-records only when stale
+	void invalidateCommandBuffers();
+	void prepareInstances();																// Grow instance buffers, pick rebuild or refit
+	void uploadInstances();																	// Task - copy changed world matrices
+	void cullInstances(FrameArena& arena);													// Task - refit / build the BVH, cull, write the indirect draw
+	void sortVisibleInstances(FrameArena& arena);											// Draw key order, front to back
+	void updateLighting();																	// Upload changed lights and this frame's cluster params
+	void captureFrame();																	// Trace this frame's inputs, after prepareInstances()
+	void replayFrame(const std::vector <TraceReader::Command>& commands);					// Apply one traced frame ahead of drawFrame()
 
 	void createSyncObjects();
 	void drawFrame();																	// Draws each Frame
-};
\ No newline at end of file
+	void writeMetrics(std::string& out);												// Metrics server thread - atomics and thread-safe queries only
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+
+// Bounded lock-free single-producer / single-consumer queue
+//  - Capacity must be a power of two
+//  - push() only from the producer thread, pop() only from the consumer thread
+template <typename T, size_t Capacity>
+class SPSCQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "SPSCQueue capacity must be a power of two");
+
+public:
+	// Returns false when full, the item is not queued
+	bool push(const T& item)
+	{
+		size_t tail = write_pos.load(std::memory_order_relaxed);
+		if (tail - cached_read >= Capacity)
+		{
+			cached_read = read_pos.load(std::memory_order_acquire);
+			if (tail - cached_read >= Capacity) return false;
+		}
+
+		items[tail & (Capacity - 1)] = item;
+		write_pos.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Returns false when empty
+	bool pop(T& item)
+	{
+		size_t head = read_pos.load(std::memory_order_relaxed);
+		if (head == cached_write)
+		{
+			cached_write = write_pos.load(std::memory_order_acquire);
+			if (head == cached_write) return false;
+		}
+
+		item = items[head & (Capacity - 1)];
+		read_pos.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool empty() const
+	{
+		return read_pos.load(std::memory_order_acquire) == write_pos.load(std::memory_order_acquire);
+	}
+
+private:
+	T items[Capacity];
+
+	// Producer and consumer cursors on separate cache lines
+	alignas(64) std::atomic<size_t> write_pos{ 0 };
+	size_t cached_read = 0;							// Producer's last view of read_pos
+	alignas(64) std::atomic<size_t> read_pos{ 0 };
+	size_t cached_write = 0;						// Consumer's last view of write_pos
+};
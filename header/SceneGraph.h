@@ -0,0 +1,84 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+
+typedef uint32_t NodeId;									// Stable node handle, independent of storage order
+
+
+// Column-major 4x4 matrix, same layout as a GLSL mat4
+struct alignas(16) Mat4
+{
+	float m[16];
+};
+
+
+// Transform hierarchy stored as structure-of-arrays
+//  - Nodes are kept sorted by depth, so every parent precedes its children and each level is one contiguous range
+//  - update() recomputes world matrices only for dirty nodes and their subtrees, large levels are split across threads
+//  - World matrices are stored in that internal order, ready to copy into an instance buffer; instanceIndex() maps a node to its slot
+class SceneGraph
+{
+public:
+	static constexpr NodeId NO_PARENT = UINT32_MAX;
+
+	void reserve(size_t count);
+	void clear();
+	NodeId addNode(NodeId parent = NO_PARENT);										// Identity transform, dirty
+
+	void setTranslation(NodeId node, float x, float y, float z);
+	void setRotation(NodeId node, float x, float y, float z, float w);				// Unit quaternion
+	void setScale(NodeId node, float x, float y, float z);
+
+	void update(uint32_t thread_count = 0);											// 0 = hardware concurrency
+	void update(JobSystem& jobs, FrameArena& arena);								// Levels split across the job system, scratch from arena
+
+	size_t size() const { return parent.size(); }
+	const Mat4& world(NodeId node) const { return world_matrices[slot[node]]; }
+	uint32_t instanceIndex(NodeId node) const { return slot[node]; }
+	NodeId nodeAt(uint32_t instance) const { return node_of[instance]; }				// Inverse of instanceIndex()
+	const Mat4* worldMatrices() const { return world_matrices.data(); }
+
+	// Copy the matrices written by the last update() into a mapped buffer laid out like worldMatrices()
+	size_t uploadChanged(void* destination) const;									// Returns matrices copied
+	uint32_t changedBegin() const { return changed_begin; }
+	uint32_t changedEnd() const { return changed_end; }
+
+	// Trace replay of a graph of roots - world matrices are written as if update() had produced them, and the changed
+	// range grows to cover them until resetChanged(); update() would recompute them from the local transforms
+	void setWorld(uint32_t begin, uint32_t end, const Mat4* matrices);
+	void resetChanged() { changed_begin = changed_end = 0; }
+
+	static bool checkKernels(uint32_t block_count = 256);							// Scalar and every supported SIMD path agree on random blocks, mismatches go to stderr
+
+private:
+	// Local TRS - one array per component so kernels load several nodes per register
+	std::vector <float> tx, ty, tz;
+	std::vector <float> rx, ry, rz, rw;
+	std::vector <float> sx, sy, sz;
+
+	std::vector <uint32_t> parent;													// Internal index of the parent, NO_PARENT for roots
+	std::vector <uint32_t> depth;
+	std::vector <uint8_t> dirty;													// Local transform changed since the last update
+	std::vector <uint8_t> changed;													// World matrix recomputed by the current update
+	std::vector <Mat4> world_matrices;
+
+	std::vector <uint32_t> level_begin = { 0 };										// Start of each depth level plus an end sentinel
+	std::vector <uint32_t> slot;													// NodeId -> internal index
+	std::vector <NodeId> node_of;													// Internal index -> NodeId
+	bool needs_sort = false;														// A node was added above the deepest level
+	bool any_dirty = false;															// Some node changed since the last update
+
+	uint32_t changed_begin = 0;														// Internal range written by the last update
+	uint32_t changed_end = 0;
+
+	void sortByDepth();
+	bool beginUpdate();
+	void finishUpdate(uint32_t first_changed, uint32_t last_changed);
+	void updateRange(uint32_t begin, uint32_t end, uint32_t& first_changed, uint32_t& last_changed);
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "SceneGraph.h"
+#include "DeletionQueue.h"
+#include "Bvh.h"
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+
+
+// Per-instance data read by the base pipeline, kept in persistently mapped host-visible buffers
+//  - Set 0: world matrices (binding 0), visible instance indices (binding 1), camera and visible count (binding 2)
+//  - Occlusion culling adds world bounds (binding 3), and device local phase draw lists (binding 4),
+//    last frame's visibility (binding 5) and the two phase draw commands (binding 6)
+//  - Bindings 4 to 6 are an occlusion history per view - each window tests against its own depth, so each gets
+//    its own lists and visibility, and a set that shares bindings 0 to 3 with the other views
+//  - The indirect draw command sits behind the camera, so culling changes what is drawn without re-recording
+//  - Buffers only grow - a reallocation rewrites the descriptor set, so passes that bound it must be re-recorded
+class SceneInstances
+{
+public:
+	static constexpr VkDeviceSize DRAW_OFFSET = 256;						// VkDrawIndirectCommand inside the frame buffer
+	static constexpr VkDeviceSize PHASE_DRAW_SIZE = 2 * sizeof(VkDrawIndirectCommand);	// Phase 1 then phase 2
+
+	void create(VkDevice device, VkPhysicalDevice physical_device, uint32_t view_count);	// One view per window
+	void destroy();
+	bool reserve(uint32_t count, DeletionQueue& retired, uint64_t frame);	// True when the buffers were replaced
+
+	// Host writes - only while no submitted frame reads them
+	Mat4* worldMatrices() { return world.mapped ? static_cast<Mat4*>(world.mapped) : nullptr; }
+	uint32_t* visibleIndices() { return visible.mapped ? static_cast<uint32_t*>(visible.mapped) : nullptr; }
+	void writeBounds(const Aabb* world_bounds, uint32_t first, uint32_t last);	// Instances [first, last)
+	void setCamera(const Mat4& view_projection);
+	void setDraw(uint32_t vertex_count, uint32_t instance_count);
+
+	uint32_t capacity() const { return instance_capacity; }
+	VkDescriptorSetLayout setLayout() const { return set_layout; }
+	VkDescriptorSet descriptorSet(uint32_t view) const { return views[view].set; }
+	VkBuffer drawBuffer() const { return frame.buffer; }
+	VkBuffer phaseDrawBuffer(uint32_t view) const { return views[view].phase_draws.buffer; }
+
+private:
+	struct MappedBuffer
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* mapped = nullptr;									// Null for device local buffers
+	};
+
+	// Occlusion history of one view - device local, only the occlusion shaders touch it
+	struct View
+	{
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		MappedBuffer draw_lists;											// Phase 1 at [0, capacity), phase 2 at [capacity, 2 * capacity)
+		MappedBuffer visibility;											// Non-zero when the instance passed last frame's test
+		MappedBuffer phase_draws;											// Filled by the occlusion shaders, never grows
+	};
+
+	static constexpr uint32_t BINDING_COUNT = 7;
+	static constexpr VkDeviceSize CAMERA_SIZE = sizeof(Mat4) + 16;			// View projection, then the visible count padded to a vec4
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+	VkDescriptorSetLayout set_layout = VK_NULL_HANDLE;
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	std::vector <View> views;
+
+	MappedBuffer world;
+	MappedBuffer visible;
+	MappedBuffer frame;														// Camera at 0, draw command at DRAW_OFFSET
+	MappedBuffer bounds;													// Min then max per instance, padded to vec4
+	uint32_t instance_capacity = 0;
+
+	void createMapped(VkDeviceSize size, VkBufferUsageFlags usage, MappedBuffer& target);
+	void createLocal(VkDeviceSize size, VkBufferUsageFlags usage, MappedBuffer& target);
+	void retire(MappedBuffer& target, DeletionQueue& retired, uint64_t frame);
+	void writeSets();
+};
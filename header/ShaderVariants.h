@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+
+
+#define SPECIALIZATION_MAX_CONSTANTS 8		// Per shader stage
+
+
+// Shader variants come in two kinds
+//  - Feature defines are compiled offline into separate SPIR-V permutations, see src/shaders/Makefile
+//  - Runtime tunables are specialization constants, fixed when the pipeline is created so the driver folds them
+//    and strips the branches they disable - ids are listed next to each constant_id in the shaders
+
+
+// Specialization constants of one shader stage, every value is 32 bits
+//  - Storage is inline, info() stays valid for the lifetime of the object and must outlive pipeline creation
+class SpecializationConstants
+{
+public:
+	SpecializationConstants& set(uint32_t id, uint32_t value);
+	SpecializationConstants& set(uint32_t id, int32_t value);
+	SpecializationConstants& set(uint32_t id, float value);
+	SpecializationConstants& set(uint32_t id, bool value);						// Stored as VkBool32
+
+	const VkSpecializationInfo* info();											// Null when nothing was set
+
+private:
+	VkSpecializationMapEntry entries[SPECIALIZATION_MAX_CONSTANTS];
+	uint32_t data[SPECIALIZATION_MAX_CONSTANTS];
+	uint32_t count = 0;
+	VkSpecializationInfo specialization{};
+
+	void add(uint32_t id, uint32_t bits);
+};
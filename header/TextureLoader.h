@@ -0,0 +1,91 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+
+#define TEXTURE_MAX_LEVELS 16
+#define TEXTURE_LEVEL_ALIGNMENT 16				// Staging offset of every level, a multiple of every block size
+
+
+// Texel block of a format - 1x1 for uncompressed RGBA8
+struct TextureBlock
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t bytes;
+};
+
+bool textureBlock(VkFormat format, TextureBlock& block);					// False for formats the loader does not handle
+VkDeviceSize textureLevelSize(VkFormat format, uint32_t width, uint32_t height);
+const char* textureFormatName(VkFormat format);							// Short name for reports, e.g. "BC7"
+
+
+// KTX2 container, read whole into bytes or parsed in place from memory that outlives the upload
+//  - Only 2D textures with one layer and one face, level 0 is the largest
+//  - Basis Universal payloads (UASTC, or ETC1S with BasisLZ) store VK_FORMAT_UNDEFINED and are transcoded at upload
+struct Ktx2Texture
+{
+	std::string name;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t levels = 0;
+	uint32_t supercompression = 0;											// 0 none, 1 BasisLZ, 2 Zstandard
+	bool uastc = false;
+	bool etc1s = false;
+	bool srgb = false;														// From the transfer function of the data format descriptor
+	bool alpha = false;
+	uint64_t level_offset[TEXTURE_MAX_LEVELS] = {};
+	uint64_t level_length[TEXTURE_MAX_LEVELS] = {};
+	std::vector <uint8_t> bytes;											// Empty when parsed in place
+	const uint8_t* data = nullptr;											// Whole container, bytes or the caller's memory
+	size_t size = 0;
+
+	bool basis() const { return uastc || etc1s; }
+};
+
+void loadKtx2(const std::string& path, Ktx2Texture& texture);				// Throws on malformed or unsupported containers
+void loadKtx2(const std::string& path, const uint8_t* data, size_t size, Ktx2Texture& texture);	// No copy, path only names errors
+
+
+// How the levels reach the staging buffer
+enum class TextureUpload
+{
+	Direct,					// Stored blocks copied as they are
+	Transcoded,				// Basis Universal into a block format the device samples
+	Decoded					// No sampleable block format - expanded to RGBA8 on the host
+};
+
+
+// Sampled image of one loaded texture, and what it costs against RGBA8
+struct Texture
+{
+	std::string name;
+	VkImage image = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	TextureUpload upload = TextureUpload::Direct;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t levels = 0;
+	VkDeviceSize bytes = 0;													// Every level as uploaded
+	VkDeviceSize rgba_bytes = 0;											// The same levels as RGBA8
+};
+
+
+// Upload format for the device
+//  - Stored block formats are kept when the device samples them, BC1 - BC5 decode to RGBA8 otherwise
+//  - Basis payloads take the first sampleable of BC7 / ASTC 4x4 / ETC2 / BC1 / BC3, RGBA8 last
+//    (ETC1S prefers ETC2 and BC1, which it converts to without requantizing)
+VkFormat chooseTextureFormat(VkPhysicalDevice physical_device, const Ktx2Texture& texture, TextureUpload& upload);
+
+// Every level in format, written straight into the mapped staging buffer at offsets
+//  - Transcoding and decoding run on the job system, one level or a band of block rows per task
+void writeTextureLevels(const Ktx2Texture& texture, VkFormat format, uint8_t* staging, const VkDeviceSize* offsets, JobSystem& jobs, FrameArena& arena);
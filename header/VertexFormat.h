@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+
+
+
+#define VERTEX_ATTRIBUTE_COUNT 4			// Most attributes any layout describes
+
+
+// Vertex layouts the base pipeline can read
+//  - Full is plain floats, as imported
+//  - Packed is quantized at import and decoded in shader_base.vert (vert_packed.spv)
+enum class VertexLayout
+{
+	Full,
+	Packed
+};
+
+
+// Imported vertex - 48 bytes
+struct Vertex
+{
+	float position[3];
+	float normal[3];
+	float tangent[4];						// w is the bitangent sign
+	float uv[2];
+};
+
+
+// Quantized vertex - 20 bytes
+//  - Position is unorm16 against the mesh bounds, w holds the bitangent sign (0 = negative)
+//  - Normal and tangent are octahedral snorm16 pairs
+//  - UV is half float
+struct PackedVertex
+{
+	uint16_t position[4];
+	int16_t normal[2];
+	int16_t tangent[2];
+	uint16_t uv[2];
+};
+
+
+// Per mesh decode - position = origin + unorm * extent, pushed after the list base in shader_base.vert
+struct MeshQuantization
+{
+	float origin[4];
+	float extent[4];
+};
+
+
+// Import time report for one mesh
+struct VertexStats
+{
+	uint32_t vertex_count = 0;
+	size_t full_bytes = 0;
+	size_t packed_bytes = 0;
+	float max_position_error = 0.0f;		// Largest decoded distance from the source, in mesh units
+};
+
+
+// Quantize count vertices into packed - SIMD when the CPU has it, the decode is checked on the way out
+VertexStats quantizeVertices(const Vertex* vertices, size_t count, PackedVertex* packed, MeshQuantization& quantization);
+
+// Binding 0 and its attributes for a layout - returns the attribute count
+uint32_t vertexInputDescription(VertexLayout layout, VkVertexInputBindingDescription& binding, VkVertexInputAttributeDescription* attributes);
+
+// Conversions shared by both quantization paths
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+
+
+// Find a memory type matching the filter and property flags - returns UINT32_MAX when none match
+uint32_t findMemoryType(VkPhysicalDevice physical_device, uint32_t type_filter, VkMemoryPropertyFlags properties);
+
+// Create a buffer with dedicated memory - throws on failure
+void createBuffer(VkDevice device, VkPhysicalDevice physical_device, VkDeviceSize size, VkBufferUsageFlags usage,
+	VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory);
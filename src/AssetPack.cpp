@@ -0,0 +1,236 @@
+#include "AssetPack.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+
+static uint64_t alignPack(uint64_t offset)
+{
+	return (offset + ASSET_PACK_ALIGNMENT - 1) & ~(uint64_t)(ASSET_PACK_ALIGNMENT - 1);
+}
+
+
+AssetPack::~AssetPack()
+{
+	close();
+}
+
+
+void AssetPack::open(const std::string& path)
+{
+	close();
+
+	// Map the whole file read-only - nothing is read until a page is touched
+	void* view = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("[!] Asset Error - Failed to open " + path + ".");
+	}
+	LARGE_INTEGER file_size{};
+	GetFileSizeEx(file, &file_size);
+	size = (size_t)file_size.QuadPart;
+	HANDLE mapping = size != 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	if (mapping != nullptr) view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (mapping != nullptr) CloseHandle(mapping);
+	CloseHandle(file);
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		throw std::runtime_error("[!] Asset Error - Failed to open " + path + ".");
+	}
+	struct stat info{};
+	fstat(file, &info);
+	size = (size_t)info.st_size;
+	if (size != 0) view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (view == MAP_FAILED) view = nullptr;
+	::close(file);
+
+	// Blobs are read ahead one at a time by willNeed(), not by faulting neighbours in
+	if (view != nullptr) madvise(view, size, MADV_RANDOM);
+#endif
+	if (view == nullptr)
+	{
+		throw std::runtime_error("[!] Asset Error - Failed to map " + path + ".");
+	}
+	base = static_cast<const uint8_t*>(view);
+	mapped_size = size;
+
+	// Everything the lookups trust is checked once here
+	AssetPackHeader header{};
+	if (size >= sizeof(header)) std::memcpy(&header, base, sizeof(header));
+	if (header.magic != ASSET_PACK_MAGIC || header.version != ASSET_PACK_VERSION)
+	{
+		close();
+		throw std::runtime_error("[!] Asset Error - " + path + " is not a version " + std::to_string(ASSET_PACK_VERSION) + " asset pack.");
+	}
+	if (header.file_size != size || sizeof(header) + (uint64_t)header.entry_count * sizeof(AssetEntry) > size)
+	{
+		close();
+		throw std::runtime_error("[!] Asset Error - " + path + " is truncated.");
+	}
+
+	toc = reinterpret_cast<const AssetEntry*>(base + sizeof(header));
+	entry_count = header.entry_count;
+	for (uint32_t i = 0; i < entry_count; i++)
+	{
+		const AssetEntry& entry = toc[i];
+		bool valid = entry.name[ASSET_NAME_SIZE - 1] == '\0' && entry.offset % ASSET_PACK_ALIGNMENT == 0 &&
+			entry.offset <= size && entry.size <= size - entry.offset && (i == 0 || std::strcmp(toc[i - 1].name, entry.name) < 0);
+		if (!valid)
+		{
+			close();
+			throw std::runtime_error("[!] Asset Error - " + path + " has a bad entry " + std::to_string(i) + ".");
+		}
+	}
+}
+
+
+void AssetPack::close()
+{
+	if (base == nullptr) return;
+#ifdef _WIN32
+	UnmapViewOfFile(base);
+#else
+	munmap(const_cast<uint8_t*>(base), mapped_size);
+#endif
+	base = nullptr;
+	mapped_size = 0;
+	toc = nullptr;
+	entry_count = 0;
+}
+
+
+// Binary search - the packer sorted the table by name
+const AssetEntry* AssetPack::find(const std::string& name, AssetType type) const
+{
+	if (base == nullptr) return nullptr;
+
+	std::string key = assetName(name);
+	const AssetEntry* end = toc + entry_count;
+	const AssetEntry* entry = std::lower_bound(toc, end, key, [](const AssetEntry& a, const std::string& b) { return std::strcmp(a.name, b.c_str()) < 0; });
+	if (entry == end || key != entry->name || entry->type != (uint32_t)type) return nullptr;
+	return entry;
+}
+
+
+void AssetPack::willNeed(const AssetEntry& entry) const
+{
+	advise(entry, true);
+}
+
+
+void AssetPack::dontNeed(const AssetEntry& entry) const
+{
+	advise(entry, false);
+}
+
+
+// Hints work on whole pages, so the range is widened to the pages the blob touches
+void AssetPack::advise(const AssetEntry& entry, bool need) const
+{
+	if (base == nullptr || entry.size == 0) return;
+
+#ifdef _WIN32
+	// PrefetchVirtualMemory needs Windows 8, working set trimming is left to the system
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+	if (need)
+	{
+		WIN32_MEMORY_RANGE_ENTRY range = { const_cast<uint8_t*>(base + entry.offset), (SIZE_T)entry.size };
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+#else
+	(void)need;
+#endif
+#else
+	const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+	uintptr_t begin = (uintptr_t)(base + entry.offset) & ~(page - 1);
+	uintptr_t end = (uintptr_t)(base + entry.offset + entry.size);
+	madvise((void*)begin, end - begin, need ? MADV_WILLNEED : MADV_DONTNEED);
+#endif
+}
+
+
+std::string AssetPack::assetName(const std::string& path)
+{
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+
+uint64_t writeAssetPack(const std::string& path, std::vector <AssetSource>& assets)
+{
+	std::sort(assets.begin(), assets.end(), [](const AssetSource& a, const AssetSource& b) { return a.name < b.name; });
+
+	// Table of contents, blob offsets decided up front
+	std::vector <AssetEntry> toc(assets.size());
+	uint64_t offset = alignPack(sizeof(AssetPackHeader) + toc.size() * sizeof(AssetEntry));
+	const uint64_t data_offset = offset;
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		const AssetSource& asset = assets[i];
+		if (asset.name.empty() || asset.name.size() >= ASSET_NAME_SIZE)
+		{
+			throw std::runtime_error("[!] Asset Error - Name '" + asset.name + "' must be 1 to " + std::to_string(ASSET_NAME_SIZE - 1) + " characters.");
+		}
+		if (i > 0 && asset.name == assets[i - 1].name)
+		{
+			throw std::runtime_error("[!] Asset Error - " + asset.name + " is packed twice.");
+		}
+
+		AssetEntry& entry = toc[i];
+		std::memset(&entry, 0, sizeof(entry));
+		std::memcpy(entry.name, asset.name.c_str(), asset.name.size());
+		entry.type = (uint32_t)asset.type;
+		entry.offset = offset;
+		entry.size = asset.bytes.size();
+		offset = alignPack(offset + entry.size);
+	}
+
+	AssetPackHeader header{};
+	header.magic = ASSET_PACK_MAGIC;
+	header.version = ASSET_PACK_VERSION;
+	header.entry_count = static_cast<uint32_t>(toc.size());
+	header.file_size = offset;
+	header.data_offset = data_offset;
+
+	FILE* output = std::fopen(path.c_str(), "wb");
+	if (output == nullptr)
+	{
+		throw std::runtime_error("[!] Asset Error - Failed to create " + path + ".");
+	}
+
+	// Zero padding up to each blob, the last blob is padded too so the file size is aligned
+	static const uint8_t zeros[ASSET_PACK_ALIGNMENT] = {};
+	uint64_t written = 0;
+	auto pad = [&](uint64_t to) { written += std::fwrite(zeros, 1, (size_t)(to - written), output); };
+	written += std::fwrite(&header, 1, sizeof(header), output);
+	written += std::fwrite(toc.data(), 1, toc.size() * sizeof(AssetEntry), output);
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		pad(toc[i].offset);
+		written += std::fwrite(assets[i].bytes.data(), 1, assets[i].bytes.size(), output);
+	}
+	pad(offset);
+	bool failed = std::fclose(output) != 0 || written != offset;
+	if (failed)
+	{
+		throw std::runtime_error("[!] Asset Error - Failed to write " + path + ".");
+	}
+	return written;
+}
@@ -0,0 +1,98 @@
+#include "AssetPack.h"
+#include "VertexFormat.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+// Offline asset packer - AssetPacker <out.pack> <file>...
+//  - Entries are named after the file, the type comes from the extension: .spv shader, .ktx2 texture, .mesh vertex array
+//  - Inputs are checked here so the renderer can trust the blobs it maps
+
+
+
+static bool endsWith(const std::string& name, const char* suffix)
+{
+	size_t length = std::strlen(suffix);
+	return name.size() >= length && name.compare(name.size() - length, length, suffix) == 0;
+}
+
+
+// Header checks only - the loaders validate the contents when they read them
+static bool readAsset(const std::string& path, AssetSource& asset)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		std::cerr << "[!] Failed to open " << path << "\n";
+		return false;
+	}
+	size_t size = (size_t)file.tellg();
+	asset.bytes.resize(size);
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(asset.bytes.data()), size);
+	asset.name = AssetPack::assetName(path);
+
+	static const uint8_t ktx2_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	const uint32_t spirv_magic = 0x07230203;
+	uint32_t first_word = 0;
+	if (size >= sizeof(first_word)) std::memcpy(&first_word, asset.bytes.data(), sizeof(first_word));
+
+	if (endsWith(asset.name, ".spv"))
+	{
+		asset.type = AssetType::Shader;
+		if (size % 4 == 0 && first_word == spirv_magic) return true;
+		std::cerr << "[!] " << path << " is not a SPIR-V module\n";
+	}
+	else if (endsWith(asset.name, ".ktx2"))
+	{
+		asset.type = AssetType::Texture;
+		if (size >= sizeof(ktx2_identifier) && std::memcmp(asset.bytes.data(), ktx2_identifier, sizeof(ktx2_identifier)) == 0) return true;
+		std::cerr << "[!] " << path << " is not a KTX2 file\n";
+	}
+	else if (endsWith(asset.name, ".mesh"))
+	{
+		asset.type = AssetType::Mesh;
+		if (size != 0 && size % sizeof(Vertex) == 0) return true;
+		std::cerr << "[!] " << path << " is not a whole number of " << sizeof(Vertex) << " byte vertices\n";
+	}
+	else std::cerr << "[!] " << path << " has no known asset extension (.spv, .ktx2, .mesh)\n";
+	return false;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: AssetPacker <out.pack> <file>...\n";
+		return -1;
+	}
+
+	std::vector <AssetSource> assets(argc - 2);
+	for (int i = 2; i < argc; i++)
+	{
+		if (!readAsset(argv[i], assets[i - 2])) return -1;
+	}
+
+	// Read the result back through the loader, so a pack that was written is one the renderer accepts
+	try
+	{
+		uint64_t written = writeAssetPack(argv[1], assets);
+		AssetPack pack;
+		pack.open(argv[1]);
+		static const char* type_names[] = { "", "shader", "texture", "mesh" };
+		for (uint32_t i = 0; i < pack.entryCount(); i++)
+		{
+			const AssetEntry& entry = pack.entries()[i];
+			std::cout << "[Pack] " << entry.name << ": " << type_names[entry.type] << ", " << entry.size << " bytes at " << entry.offset << "\n";
+		}
+		std::cout << "[Pack] " << argv[1] << ": " << pack.entryCount() << " assets, " << written << " bytes\n";
+	}
+	catch (const std::exception& error)
+	{
+		std::cerr << error.what() << "\n";
+		return -1;
+	}
+	return 0;
+}
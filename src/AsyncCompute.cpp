@@ -0,0 +1,118 @@
+#include "AsyncCompute.h"
+#include "HostAllocator.h"
+
+#include <stdexcept>
+
+
+void AsyncCompute::create(VkDevice dev, uint32_t compute_family, uint32_t graphics, bool use_async)
+{
+	device = dev;
+	graphics_family = graphics;
+	async = use_async;
+	family = async ? compute_family : graphics_family;
+
+	// Inline passes share the graphics command buffer, nothing else to create
+	if (!async) return;
+
+	vkGetDeviceQueue(device, family, 0, &queue);
+
+	VkCommandPoolCreateInfo pool_create_info{};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	pool_create_info.queueFamilyIndex = family;
+
+	if (vkCreateCommandPool(device, &pool_create_info, hostAllocator(), &command_pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Compute Error - Failed to create compute command pool.");
+	}
+
+	VkCommandBufferAllocateInfo alloc_info{};
+	alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	alloc_info.commandPool = command_pool;
+	alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	alloc_info.commandBufferCount = 1;
+
+	if (vkAllocateCommandBuffers(device, &alloc_info, &command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Compute Error - Failed to allocate compute command buffer.");
+	}
+	last_submit = 0;
+}
+
+
+void AsyncCompute::destroy()
+{
+	if (device == VK_NULL_HANDLE) return;
+
+	if (command_pool != VK_NULL_HANDLE) vkDestroyCommandPool(device, command_pool, hostAllocator());
+
+	command_pool = VK_NULL_HANDLE;
+	command_buffer = VK_NULL_HANDLE;
+	device = VK_NULL_HANDLE;
+}
+
+
+void AsyncCompute::addPass(const Pass& pass)
+{
+	passes.push_back(pass);
+}
+
+
+std::vector <uint32_t> AsyncCompute::sharedFamilies() const
+{
+	if (family == graphics_family) return { graphics_family };
+	return { graphics_family, family };
+}
+
+
+// The command buffer is re-recorded each frame once the previous submit has reached its timeline value
+uint64_t AsyncCompute::submit(FrameScheduler& scheduler)
+{
+	if (!async || passes.empty()) return 0;
+
+	scheduler.wait(QueueKind::Compute, last_submit);
+
+	vkResetCommandBuffer(command_buffer, 0);
+
+	VkCommandBufferBeginInfo begin_info{};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Compute Error - Failed to begin compute command buffer.");
+	}
+
+	for (const auto& pass : passes)
+	{
+		pass(command_buffer);
+	}
+
+	if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Compute Error - Failed to record compute command buffer.");
+	}
+
+	last_submit = scheduler.submit(queue, QueueKind::Compute, &command_buffer, 1, {});
+	return last_submit;
+}
+
+
+void AsyncCompute::recordInline(VkCommandBuffer graphics_command_buffer)
+{
+	if (async || passes.empty()) return;
+
+	for (const auto& pass : passes)
+	{
+		pass(graphics_command_buffer);
+	}
+
+	// Results must land before any graphics stage reads them
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+	vkCmdPipelineBarrier(graphics_command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, consumer_stages, 0,
+		1, &barrier, 0, nullptr, 0, nullptr);
+}
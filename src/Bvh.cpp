@@ -0,0 +1,820 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BVH_X86 1
+#include <immintrin.h>
+#endif
+
+
+#define BVH_BINS 16							// SAH candidate splits per axis
+#define BVH_LEAF_SIZE 2						// Always a leaf at or below this
+#define BVH_MAX_LEAF 8						// Never a leaf above this
+#define BVH_PARALLEL_MIN 16384				// Subtrees at least this large build on their own thread
+#define BVH_EMPTY UINT32_MAX				// Unused child lane
+
+// Offsets of the SoA child boxes inside a node
+#define BOX_MIN_X 0
+#define BOX_MIN_Y 4
+#define BOX_MIN_Z 8
+#define BOX_MAX_X 12
+#define BOX_MAX_Y 16
+#define BOX_MAX_Z 20
+
+
+// Object as seen by the build - partitioned in place so every pass reads memory in order
+struct BvhBuildRef
+{
+	Aabb box;
+	float centroid[3];
+	uint32_t object;
+};
+
+
+// Binary SAH tree, collapsed into the 4-wide layout once complete
+struct BvhBuildNode
+{
+	Aabb bounds;
+	uint32_t first = 0;
+	uint32_t count = 0;
+	std::unique_ptr<BvhBuildNode> children[2];
+
+	bool isLeaf() const { return children[0] == nullptr; }
+};
+
+
+static inline Aabb emptyBounds()
+{
+	return { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+}
+
+static inline void grow(Aabb& box, const Aabb& other)
+{
+	for (int a = 0; a < 3; a++)
+	{
+		box.min[a] = std::min(box.min[a], other.min[a]);
+		box.max[a] = std::max(box.max[a], other.max[a]);
+	}
+}
+
+static inline float surfaceArea(const Aabb& box)
+{
+	float dx = std::max(0.0f, box.max[0] - box.min[0]);
+	float dy = std::max(0.0f, box.max[1] - box.min[1]);
+	float dz = std::max(0.0f, box.max[2] - box.min[2]);
+	return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+static inline bool boxOutside(const Aabb& box, const float planes[6][4])
+{
+	for (int p = 0; p < 6; p++)
+	{
+		float x = planes[p][0] >= 0.0f ? box.max[0] : box.min[0];
+		float y = planes[p][1] >= 0.0f ? box.max[1] : box.min[1];
+		float z = planes[p][2] >= 0.0f ? box.max[2] : box.min[2];
+		if (planes[p][0] * x + planes[p][1] * y + planes[p][2] * z + planes[p][3] < 0.0f) return true;
+	}
+	return false;
+}
+
+// Slab test - entry distance in t, false on a miss
+static inline bool rayBox(const Aabb& box, const float origin[3], const float inv_dir[3], float max_t, float& t)
+{
+	float t_near = 0.0f;
+	float t_far = max_t;
+	for (int a = 0; a < 3; a++)
+	{
+		float t1 = (box.min[a] - origin[a]) * inv_dir[a];
+		float t2 = (box.max[a] - origin[a]) * inv_dir[a];
+		t_near = std::max(t_near, std::min(t1, t2));
+		t_far = std::min(t_far, std::max(t1, t2));
+	}
+	t = t_near;
+	return t_near <= t_far;
+}
+
+static inline bool sphereBox(const Aabb& box, const float center[3], float radius_sq)
+{
+	float distance_sq = 0.0f;
+	for (int a = 0; a < 3; a++)
+	{
+		float d = std::max(0.0f, std::max(box.min[a] - center[a], center[a] - box.max[a]));
+		distance_sq += d * d;
+	}
+	return distance_sq <= radius_sq;
+}
+
+
+Aabb transformBounds(const Mat4& matrix, const Aabb& local)
+{
+	// Arvo - each output axis takes the extreme of every weighted input axis
+	Aabb result;
+	for (int r = 0; r < 3; r++)
+	{
+		result.min[r] = result.max[r] = matrix.m[12 + r];
+		for (int c = 0; c < 3; c++)
+		{
+			float a = matrix.m[c * 4 + r] * local.min[c];
+			float b = matrix.m[c * 4 + r] * local.max[c];
+			result.min[r] += std::min(a, b);
+			result.max[r] += std::max(a, b);
+		}
+	}
+	return result;
+}
+
+
+// Cofactors
+bool invertMatrix(const Mat4& matrix, Mat4& result)
+{
+	const float* m = matrix.m;
+	float* r = result.m;
+
+	r[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+	r[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+	r[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+	r[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+	r[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+	r[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+	r[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+	r[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+	r[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+	r[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+	r[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+	r[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+	r[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+	r[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+	r[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+	r[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+	float determinant = m[0] * r[0] + m[1] * r[4] + m[2] * r[8] + m[3] * r[12];
+	if (std::fabs(determinant) < 1e-20f) return false;
+
+	float scale = 1.0f / determinant;
+	for (int i = 0; i < 16; i++) r[i] *= scale;
+	return true;
+}
+
+
+Mat4 multiplyMatrix(const Mat4& a, const Mat4& b)
+{
+	Mat4 result;
+	for (int c = 0; c < 4; c++)
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			result.m[c * 4 + r] = a.m[r] * b.m[c * 4] + a.m[4 + r] * b.m[c * 4 + 1] + a.m[8 + r] * b.m[c * 4 + 2] + a.m[12 + r] * b.m[c * 4 + 3];
+		}
+	}
+	return result;
+}
+
+
+// Four child boxes against the frustum - outside: rejected by some plane, inside: within every plane
+static inline void planeTest4Scalar(const float* box, const float planes[6][4], uint32_t& outside, uint32_t& inside)
+{
+	outside = 0;
+	inside = 0xF;
+	for (uint32_t lane = 0; lane < 4; lane++)
+	{
+		for (int p = 0; p < 6; p++)
+		{
+			const float* plane = planes[p];
+			float px = plane[0] >= 0.0f ? box[BOX_MAX_X + lane] : box[BOX_MIN_X + lane];
+			float py = plane[1] >= 0.0f ? box[BOX_MAX_Y + lane] : box[BOX_MIN_Y + lane];
+			float pz = plane[2] >= 0.0f ? box[BOX_MAX_Z + lane] : box[BOX_MIN_Z + lane];
+			float nx = plane[0] >= 0.0f ? box[BOX_MIN_X + lane] : box[BOX_MAX_X + lane];
+			float ny = plane[1] >= 0.0f ? box[BOX_MIN_Y + lane] : box[BOX_MAX_Y + lane];
+			float nz = plane[2] >= 0.0f ? box[BOX_MIN_Z + lane] : box[BOX_MAX_Z + lane];
+			if (plane[0] * px + plane[1] * py + plane[2] * pz + plane[3] < 0.0f) outside |= 1u << lane;
+			if (plane[0] * nx + plane[1] * ny + plane[2] * nz + plane[3] < 0.0f) inside &= ~(1u << lane);
+		}
+	}
+}
+
+static inline uint32_t rayTest4Scalar(const float* box, const float origin[3], const float inv_dir[3], float max_t, float* t_near)
+{
+	uint32_t hits = 0;
+	for (uint32_t lane = 0; lane < 4; lane++)
+	{
+		Aabb child = { { box[BOX_MIN_X + lane], box[BOX_MIN_Y + lane], box[BOX_MIN_Z + lane] },
+			{ box[BOX_MAX_X + lane], box[BOX_MAX_Y + lane], box[BOX_MAX_Z + lane] } };
+		if (rayBox(child, origin, inv_dir, max_t, t_near[lane])) hits |= 1u << lane;
+	}
+	return hits;
+}
+
+static inline uint32_t sphereTest4Scalar(const float* box, const float center[3], float radius_sq)
+{
+	uint32_t hits = 0;
+	for (uint32_t lane = 0; lane < 4; lane++)
+	{
+		Aabb child = { { box[BOX_MIN_X + lane], box[BOX_MIN_Y + lane], box[BOX_MIN_Z + lane] },
+			{ box[BOX_MAX_X + lane], box[BOX_MAX_Y + lane], box[BOX_MAX_Z + lane] } };
+		if (sphereBox(child, center, radius_sq)) hits |= 1u << lane;
+	}
+	return hits;
+}
+
+
+#ifdef BVH_X86
+
+__attribute__((target("sse2")))
+static inline void planeTest4SSE2(const float* box, const float planes[6][4], uint32_t& outside, uint32_t& inside)
+{
+	__m128 out = _mm_setzero_ps();
+	__m128 partial = _mm_setzero_ps();
+	const __m128 zero = _mm_setzero_ps();
+
+	for (int p = 0; p < 6; p++)
+	{
+		const float* plane = planes[p];
+
+		// Plane signs pick which corner is furthest along (p) and against (n) the normal
+		__m128 px = _mm_load_ps(box + (plane[0] >= 0.0f ? BOX_MAX_X : BOX_MIN_X));
+		__m128 py = _mm_load_ps(box + (plane[1] >= 0.0f ? BOX_MAX_Y : BOX_MIN_Y));
+		__m128 pz = _mm_load_ps(box + (plane[2] >= 0.0f ? BOX_MAX_Z : BOX_MIN_Z));
+		__m128 nx = _mm_load_ps(box + (plane[0] >= 0.0f ? BOX_MIN_X : BOX_MAX_X));
+		__m128 ny = _mm_load_ps(box + (plane[1] >= 0.0f ? BOX_MIN_Y : BOX_MAX_Y));
+		__m128 nz = _mm_load_ps(box + (plane[2] >= 0.0f ? BOX_MIN_Z : BOX_MAX_Z));
+
+		__m128 a = _mm_set1_ps(plane[0]), b = _mm_set1_ps(plane[1]), c = _mm_set1_ps(plane[2]), d = _mm_set1_ps(plane[3]);
+		__m128 p_distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, px), _mm_mul_ps(b, py)), _mm_add_ps(_mm_mul_ps(c, pz), d));
+		__m128 n_distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, nx), _mm_mul_ps(b, ny)), _mm_add_ps(_mm_mul_ps(c, nz), d));
+		out = _mm_or_ps(out, _mm_cmplt_ps(p_distance, zero));
+		partial = _mm_or_ps(partial, _mm_cmplt_ps(n_distance, zero));
+	}
+
+	outside = (uint32_t)_mm_movemask_ps(out);
+	inside = ~(uint32_t)_mm_movemask_ps(partial) & 0xF;
+}
+
+__attribute__((target("sse2")))
+static inline uint32_t rayTest4SSE2(const float* box, const float origin[3], const float inv_dir[3], float max_t, float* t_near)
+{
+	__m128 near_t = _mm_setzero_ps();
+	__m128 far_t = _mm_set1_ps(max_t);
+	static const int min_offsets[3] = { BOX_MIN_X, BOX_MIN_Y, BOX_MIN_Z };
+	static const int max_offsets[3] = { BOX_MAX_X, BOX_MAX_Y, BOX_MAX_Z };
+
+	for (int a = 0; a < 3; a++)
+	{
+		__m128 o = _mm_set1_ps(origin[a]);
+		__m128 inv = _mm_set1_ps(inv_dir[a]);
+		__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(box + min_offsets[a]), o), inv);
+		__m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(box + max_offsets[a]), o), inv);
+		near_t = _mm_max_ps(near_t, _mm_min_ps(t1, t2));
+		far_t = _mm_min_ps(far_t, _mm_max_ps(t1, t2));
+	}
+
+	_mm_storeu_ps(t_near, near_t);
+	return (uint32_t)_mm_movemask_ps(_mm_cmple_ps(near_t, far_t));
+}
+
+__attribute__((target("sse2")))
+static inline uint32_t sphereTest4SSE2(const float* box, const float center[3], float radius_sq)
+{
+	__m128 distance_sq = _mm_setzero_ps();
+	static const int min_offsets[3] = { BOX_MIN_X, BOX_MIN_Y, BOX_MIN_Z };
+	static const int max_offsets[3] = { BOX_MAX_X, BOX_MAX_Y, BOX_MAX_Z };
+
+	for (int a = 0; a < 3; a++)
+	{
+		__m128 c = _mm_set1_ps(center[a]);
+		__m128 below = _mm_sub_ps(_mm_load_ps(box + min_offsets[a]), c);
+		__m128 above = _mm_sub_ps(c, _mm_load_ps(box + max_offsets[a]));
+		__m128 d = _mm_max_ps(_mm_max_ps(below, above), _mm_setzero_ps());
+		distance_sq = _mm_add_ps(distance_sq, _mm_mul_ps(d, d));
+	}
+	return (uint32_t)_mm_movemask_ps(_mm_cmple_ps(distance_sq, _mm_set1_ps(radius_sq)));
+}
+
+static const bool bvh_has_sse2 = __builtin_cpu_supports("sse2");
+
+#endif
+
+
+static inline void planeTest4(const float* box, const float planes[6][4], uint32_t& outside, uint32_t& inside)
+{
+#ifdef BVH_X86
+	if (bvh_has_sse2) return planeTest4SSE2(box, planes, outside, inside);
+#endif
+	planeTest4Scalar(box, planes, outside, inside);
+}
+
+static inline uint32_t rayTest4(const float* box, const float origin[3], const float inv_dir[3], float max_t, float* t_near)
+{
+#ifdef BVH_X86
+	if (bvh_has_sse2) return rayTest4SSE2(box, origin, inv_dir, max_t, t_near);
+#endif
+	return rayTest4Scalar(box, origin, inv_dir, max_t, t_near);
+}
+
+static inline uint32_t sphereTest4(const float* box, const float center[3], float radius_sq)
+{
+#ifdef BVH_X86
+	if (bvh_has_sse2) return sphereTest4SSE2(box, center, radius_sq);
+#endif
+	return sphereTest4Scalar(box, center, radius_sq);
+}
+
+
+// Binned SAH over refs [first, first + count) - large halves recurse as a job, or on a new thread, while spawn_depth lasts
+static std::unique_ptr<BvhBuildNode> buildRange(BvhBuildRef* refs,
+	uint32_t first, uint32_t count, uint32_t spawn_depth, JobSystem* jobs, FrameArena* arena)
+{
+	auto node = std::make_unique<BvhBuildNode>();
+	node->first = first;
+	node->count = count;
+
+	node->bounds = emptyBounds();
+	Aabb centroid_bounds = emptyBounds();
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		const float* c = refs[i].centroid;
+		grow(node->bounds, refs[i].box);
+		grow(centroid_bounds, { { c[0], c[1], c[2] }, { c[0], c[1], c[2] } });
+	}
+	if (count <= BVH_LEAF_SIZE) return node;
+
+	// Bin all three axes in one pass over the range
+	float scale[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+		scale[axis] = extent > 0.0f ? BVH_BINS / extent : 0.0f;
+	}
+
+	Aabb bin_bounds[3][BVH_BINS];
+	uint32_t bin_count[3][BVH_BINS] = {};
+	for (auto& axis_bins : bin_bounds)
+	{
+		for (auto& bin : axis_bins) bin = emptyBounds();
+	}
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		const float* c = refs[i].centroid;
+		const Aabb& box = refs[i].box;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			uint32_t bin = std::min((uint32_t)BVH_BINS - 1, (uint32_t)((c[axis] - centroid_bounds.min[axis]) * scale[axis]));
+			bin_count[axis][bin]++;
+			grow(bin_bounds[axis][bin], box);
+		}
+	}
+
+	// Cheapest bin boundary - sweep from the right, then score each boundary from the left
+	int best_axis = -1;
+	uint32_t best_split = 0;
+	float best_cost = FLT_MAX;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (scale[axis] == 0.0f) continue;
+
+		float right_area[BVH_BINS];
+		uint32_t right_count[BVH_BINS];
+		Aabb sweep = emptyBounds();
+		uint32_t sweep_count = 0;
+		for (int b = BVH_BINS - 1; b > 0; b--)
+		{
+			grow(sweep, bin_bounds[axis][b]);
+			sweep_count += bin_count[axis][b];
+			right_area[b] = surfaceArea(sweep);
+			right_count[b] = sweep_count;
+		}
+
+		sweep = emptyBounds();
+		sweep_count = 0;
+		for (uint32_t b = 0; b < BVH_BINS - 1; b++)
+		{
+			grow(sweep, bin_bounds[axis][b]);
+			sweep_count += bin_count[axis][b];
+			if (sweep_count == 0 || right_count[b + 1] == 0) continue;
+
+			float cost = surfaceArea(sweep) * sweep_count + right_area[b + 1] * right_count[b + 1];
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best_axis = axis;
+				best_split = b;
+			}
+		}
+	}
+
+	// Traversal costs one object test, so splitting must beat testing everything here
+	float parent_area = std::max(surfaceArea(node->bounds), FLT_MIN);
+	bool split_pays = best_axis >= 0 && 1.0f + best_cost / parent_area < (float)count;
+	if (!split_pays && count <= BVH_MAX_LEAF) return node;
+
+	uint32_t middle = first + count / 2;
+	if (best_axis >= 0)
+	{
+		float axis_scale = scale[best_axis];
+		float min_centroid = centroid_bounds.min[best_axis];
+		BvhBuildRef* split = std::partition(refs + first, refs + first + count, [&](const BvhBuildRef& ref)
+		{
+			uint32_t bin = std::min((uint32_t)BVH_BINS - 1, (uint32_t)((ref.centroid[best_axis] - min_centroid) * axis_scale));
+			return bin <= best_split;
+		});
+		middle = (uint32_t)(split - refs);
+	}
+
+	// Coincident centroids - any even split will do
+	if (middle == first || middle == first + count) middle = first + count / 2;
+
+	uint32_t left_count = middle - first;
+	uint32_t right_count = count - left_count;
+	if (spawn_depth > 0 && count >= BVH_PARALLEL_MIN && jobs != nullptr)
+	{
+		JobCounter left_done;
+		jobs->run(*arena, [&]() { node->children[0] = buildRange(refs, first, left_count, spawn_depth - 1, jobs, arena); }, &left_done);
+		node->children[1] = buildRange(refs, middle, right_count, spawn_depth - 1, jobs, arena);
+		jobs->wait(left_done);
+	}
+	else if (spawn_depth > 0 && count >= BVH_PARALLEL_MIN)
+	{
+		std::thread left([&]() { node->children[0] = buildRange(refs, first, left_count, spawn_depth - 1, nullptr, nullptr); });
+		node->children[1] = buildRange(refs, middle, right_count, spawn_depth - 1, nullptr, nullptr);
+		left.join();
+	}
+	else
+	{
+		node->children[0] = buildRange(refs, first, left_count, 0, nullptr, nullptr);
+		node->children[1] = buildRange(refs, middle, right_count, 0, nullptr, nullptr);
+	}
+	return node;
+}
+
+
+void Bvh::build(const Aabb* bounds, uint32_t count, uint32_t thread_count)
+{
+	// Each spawn level doubles the threads in use
+	uint32_t threads = thread_count ? thread_count : std::max(1u, std::thread::hardware_concurrency());
+	uint32_t spawn_depth = 0;
+	while ((1u << spawn_depth) < threads) spawn_depth++;
+
+	buildTree(bounds, count, spawn_depth, nullptr, nullptr);
+}
+
+
+void Bvh::build(const Aabb* bounds, uint32_t count, JobSystem& jobs, FrameArena& arena)
+{
+	// Two extra levels leave idle workers something to steal when subtrees are uneven
+	uint32_t spawn_depth = 2;
+	while ((1u << spawn_depth) < jobs.concurrency() * 4) spawn_depth++;
+
+	buildTree(bounds, count, spawn_depth, &jobs, &arena);
+}
+
+
+void Bvh::buildTree(const Aabb* bounds, uint32_t count, uint32_t spawn_depth, JobSystem* jobs, FrameArena* arena)
+{
+	nodes.clear();
+	parent_lane.clear();
+	object_bounds.assign(bounds, bounds + count);
+	object_lane.assign(count, UINT32_MAX);
+	objects.resize(count);
+	if (count == 0) return;
+
+	std::vector <BvhBuildRef> refs(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		refs[i].box = bounds[i];
+		refs[i].object = i;
+		for (int a = 0; a < 3; a++)
+		{
+			refs[i].centroid[a] = 0.5f * (bounds[i].min[a] + bounds[i].max[a]);
+		}
+	}
+
+	std::unique_ptr<BvhBuildNode> root = buildRange(refs.data(), 0, count, spawn_depth, jobs, arena);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		objects[i] = refs[i].object;
+	}
+
+	nodes.reserve(count / 2 + 1);
+	flatten(root.get());
+	refit_queued.assign(nodes.size(), 0);
+}
+
+
+// Emit a 4-wide node for a binary subtree - its children are found by opening the largest inner grandchildren
+uint32_t Bvh::flatten(const BvhBuildNode* build_node)
+{
+	uint32_t index = static_cast<uint32_t>(nodes.size());
+	nodes.emplace_back();
+	parent_lane.push_back(UINT32_MAX);
+
+	const BvhBuildNode* slots[4] = {};
+	uint32_t used = 0;
+	if (build_node->isLeaf())
+	{
+		slots[used++] = build_node;
+	}
+	else
+	{
+		slots[used++] = build_node->children[0].get();
+		slots[used++] = build_node->children[1].get();
+	}
+
+	while (used < 4)
+	{
+		int open = -1;
+		float open_area = -1.0f;
+		for (uint32_t i = 0; i < used; i++)
+		{
+			if (!slots[i]->isLeaf() && surfaceArea(slots[i]->bounds) > open_area)
+			{
+				open = (int)i;
+				open_area = surfaceArea(slots[i]->bounds);
+			}
+		}
+		if (open < 0) break;
+
+		const BvhBuildNode* opened = slots[open];
+		slots[open] = opened->children[0].get();
+		slots[used++] = opened->children[1].get();
+	}
+
+	// nodes may reallocate while children are emitted, so index rather than hold a reference
+	for (uint32_t lane = 0; lane < 4; lane++)
+	{
+		if (lane >= used)
+		{
+			setLane(index, lane, emptyBounds());
+			nodes[index].child[lane] = BVH_EMPTY;
+			nodes[index].count[lane] = 0;
+			continue;
+		}
+
+		const BvhBuildNode* slot = slots[lane];
+		setLane(index, lane, slot->bounds);
+		if (slot->isLeaf())
+		{
+			nodes[index].child[lane] = slot->first;
+			nodes[index].count[lane] = slot->count;
+			for (uint32_t i = slot->first; i < slot->first + slot->count; i++)
+			{
+				object_lane[objects[i]] = index * 4 + lane;
+			}
+		}
+		else
+		{
+			uint32_t child = flatten(slot);
+			nodes[index].child[lane] = child;
+			nodes[index].count[lane] = 0;
+			parent_lane[child] = index * 4 + lane;
+		}
+	}
+	return index;
+}
+
+
+void Bvh::setLane(uint32_t node, uint32_t lane, const Aabb& box)
+{
+	Node& target = nodes[node];
+	target.min_x[lane] = box.min[0];
+	target.min_y[lane] = box.min[1];
+	target.min_z[lane] = box.min[2];
+	target.max_x[lane] = box.max[0];
+	target.max_y[lane] = box.max[1];
+	target.max_z[lane] = box.max[2];
+}
+
+
+Aabb Bvh::nodeBounds(uint32_t node) const
+{
+	const Node& source = nodes[node];
+	Aabb box = emptyBounds();
+	for (uint32_t lane = 0; lane < 4; lane++)
+	{
+		if (source.child[lane] == BVH_EMPTY) continue;
+		grow(box, { { source.min_x[lane], source.min_y[lane], source.min_z[lane] }, { source.max_x[lane], source.max_y[lane], source.max_z[lane] } });
+	}
+	return box;
+}
+
+
+Aabb Bvh::leafBounds(uint32_t first, uint32_t count) const
+{
+	Aabb box = emptyBounds();
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		grow(box, object_bounds[objects[i]]);
+	}
+	return box;
+}
+
+
+void Bvh::refitNode(uint32_t node)
+{
+	for (uint32_t lane = 0; lane < 4; lane++)
+	{
+		uint32_t child = nodes[node].child[lane];
+		if (child == BVH_EMPTY) continue;
+
+		uint32_t count = nodes[node].count[lane];
+		setLane(node, lane, count > 0 ? leafBounds(child, count) : nodeBounds(child));
+	}
+}
+
+
+void Bvh::refit(const Aabb* bounds, uint32_t first, uint32_t last)
+{
+	if (nodes.empty() || first >= last) return;
+
+	std::copy(bounds + first, bounds + last, object_bounds.begin() + first);
+
+	// Many movers - one reverse sweep visits every child before its parent
+	if ((size_t)(last - first) * 4 > object_bounds.size())
+	{
+		for (size_t n = nodes.size(); n-- > 0;)
+		{
+			refitNode((uint32_t)n);
+		}
+		return;
+	}
+
+	// Few movers - walk their ancestors, deepest index first so children finish before parents
+	std::priority_queue <uint32_t> pending;
+	for (uint32_t object = first; object < last; object++)
+	{
+		uint32_t node = object_lane[object] / 4;
+		if (!refit_queued[node])
+		{
+			refit_queued[node] = 1;
+			pending.push(node);
+		}
+	}
+
+	while (!pending.empty())
+	{
+		uint32_t node = pending.top();
+		pending.pop();
+		refit_queued[node] = 0;
+		refitNode(node);
+
+		if (parent_lane[node] == UINT32_MAX) continue;
+		uint32_t parent = parent_lane[node] / 4;
+		if (!refit_queued[parent])
+		{
+			refit_queued[parent] = 1;
+			pending.push(parent);
+		}
+	}
+}
+
+
+void Bvh::cullFrustum(const float planes[6][4], std::vector<uint32_t>& visible) const
+{
+	if (nodes.empty()) return;
+
+	// Subtrees found fully inside skip every further plane test
+	struct Entry
+	{
+		uint32_t node;
+		bool inside;
+	};
+	std::vector <Entry> stack;
+	stack.reserve(64);
+	stack.push_back({ 0, false });
+
+	while (!stack.empty())
+	{
+		Entry entry = stack.back();
+		stack.pop_back();
+		const Node& node = nodes[entry.node];
+
+		uint32_t outside = 0;
+		uint32_t inside = 0xF;
+		if (!entry.inside) planeTest4(node.min_x, planes, outside, inside);
+
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			if (node.child[lane] == BVH_EMPTY || (outside & (1u << lane))) continue;
+			bool lane_inside = entry.inside || (inside & (1u << lane));
+
+			if (node.count[lane] == 0)
+			{
+				stack.push_back({ node.child[lane], lane_inside });
+				continue;
+			}
+
+			for (uint32_t i = node.child[lane]; i < node.child[lane] + node.count[lane]; i++)
+			{
+				if (lane_inside || !boxOutside(object_bounds[objects[i]], planes)) visible.push_back(objects[i]);
+			}
+		}
+	}
+}
+
+
+void Bvh::queryRadius(const float center[3], float radius, std::vector<uint32_t>& found) const
+{
+	if (nodes.empty()) return;
+
+	const float radius_sq = radius * radius;
+	std::vector <uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		uint32_t hits = sphereTest4(node.min_x, center, radius_sq);
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			if (node.child[lane] == BVH_EMPTY || !(hits & (1u << lane))) continue;
+
+			if (node.count[lane] == 0)
+			{
+				stack.push_back(node.child[lane]);
+				continue;
+			}
+
+			for (uint32_t i = node.child[lane]; i < node.child[lane] + node.count[lane]; i++)
+			{
+				if (sphereBox(object_bounds[objects[i]], center, radius_sq)) found.push_back(objects[i]);
+			}
+		}
+	}
+}
+
+
+bool Bvh::raycast(const Ray& ray, uint32_t& object, float& t, const std::function<bool(uint32_t object, float& t)>& exact) const
+{
+	if (nodes.empty()) return false;
+
+	float inv_dir[3];
+	for (int a = 0; a < 3; a++)
+	{
+		inv_dir[a] = 1.0f / ray.direction[a];
+	}
+
+	// Nearest children are pushed last so they are visited first, entries beyond the best hit are dropped
+	struct Entry
+	{
+		uint32_t node;
+		float t;
+	};
+	std::vector <Entry> stack;
+	stack.reserve(64);
+	stack.push_back({ 0, 0.0f });
+
+	float best = ray.max_t;
+	bool found = false;
+
+	while (!stack.empty())
+	{
+		Entry entry = stack.back();
+		stack.pop_back();
+		if (entry.t > best) continue;
+		const Node& node = nodes[entry.node];
+
+		float t_near[4];
+		uint32_t hits = rayTest4(node.min_x, ray.origin, inv_dir, best, t_near);
+
+		Entry children[4];
+		uint32_t child_count = 0;
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			if (node.child[lane] == BVH_EMPTY || !(hits & (1u << lane))) continue;
+
+			if (node.count[lane] == 0)
+			{
+				children[child_count++] = { node.child[lane], t_near[lane] };
+				continue;
+			}
+
+			for (uint32_t i = node.child[lane]; i < node.child[lane] + node.count[lane]; i++)
+			{
+				float hit_t;
+				if (!rayBox(object_bounds[objects[i]], ray.origin, inv_dir, best, hit_t)) continue;
+				if (exact && !exact(objects[i], hit_t)) continue;
+				if (hit_t > best) continue;
+
+				best = hit_t;
+				object = objects[i];
+				found = true;
+			}
+		}
+
+		for (uint32_t i = 1; i < child_count; i++)
+		{
+			for (uint32_t j = i; j > 0 && children[j - 1].t < children[j].t; j--) std::swap(children[j - 1], children[j]);
+		}
+		stack.insert(stack.end(), children, children + child_count);
+	}
+
+	if (found) t = best;
+	return found;
+}
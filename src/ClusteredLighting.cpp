@@ -0,0 +1,241 @@
+#include "ClusteredLighting.h"
+#include "HostAllocator.h"
+#include "VulkanHelpers.h"
+#include "ShaderVariants.h"
+#include "Bvh.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+
+void ClusteredLighting::create(VkDevice dev, VkPhysicalDevice physical)
+{
+	device = dev;
+	physical_device = physical;
+
+	// Set Layout - params (binding 0), lights (1), grid (2), index list (3), index list use (4, assignment only)
+	VkDescriptorSetLayoutBinding bindings[BINDING_COUNT]{};
+	for (uint32_t i = 0; i < BINDING_COUNT; i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorCount = 1;
+		bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].stageFlags = i == 4 ? VK_SHADER_STAGE_COMPUTE_BIT : VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layout_create_info{};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_create_info.bindingCount = BINDING_COUNT;
+	layout_create_info.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(device, &layout_create_info, hostAllocator(), &set_layout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Lighting Error - Failed to create lighting set layout.");
+	}
+
+	VkDescriptorPoolSize pool_sizes[2]{};
+	pool_sizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	pool_sizes[0].descriptorCount = BINDING_COUNT - 1;
+	pool_sizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	pool_sizes[1].descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo pool_create_info{};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets = 1;
+	pool_create_info.poolSizeCount = 2;
+	pool_create_info.pPoolSizes = pool_sizes;
+
+	if (vkCreateDescriptorPool(device, &pool_create_info, hostAllocator(), &pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Lighting Error - Failed to create lighting descriptor pool.");
+	}
+
+	VkDescriptorSetAllocateInfo set_alloc_info{};
+	set_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	set_alloc_info.descriptorPool = pool;
+	set_alloc_info.descriptorSetCount = 1;
+	set_alloc_info.pSetLayouts = &set_layout;
+
+	if (vkAllocateDescriptorSets(device, &set_alloc_info, &set) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Lighting Error - Failed to allocate lighting descriptor set.");
+	}
+
+	// Sized for the limits up front, so the set is written once and the cached passes never re-record for lights
+	createMapped(sizeof(Params), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, params);
+	createMapped(sizeof(Light) * CLUSTER_MAX_LIGHTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, lights);
+	createLocal(sizeof(uint32_t) * 2 * CLUSTER_COUNT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, grid);
+	createLocal(sizeof(uint32_t) * INDEX_CAPACITY, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, indices);
+	createLocal(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, counter);
+
+	VkDescriptorBufferInfo buffer_infos[BINDING_COUNT]{};
+	buffer_infos[0] = { params.buffer, 0, sizeof(Params) };
+	buffer_infos[1] = { lights.buffer, 0, VK_WHOLE_SIZE };
+	buffer_infos[2] = { grid.buffer, 0, VK_WHOLE_SIZE };
+	buffer_infos[3] = { indices.buffer, 0, VK_WHOLE_SIZE };
+	buffer_infos[4] = { counter.buffer, 0, VK_WHOLE_SIZE };
+
+	VkWriteDescriptorSet writes[BINDING_COUNT]{};
+	for (uint32_t i = 0; i < BINDING_COUNT; i++)
+	{
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = set;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &buffer_infos[i];
+	}
+	vkUpdateDescriptorSets(device, BINDING_COUNT, writes, 0, nullptr);
+
+	Mat4 identity = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+	const float black[3] = { 0.0f, 0.0f, 0.0f };
+	setLights(nullptr, 0);
+	setView(identity, identity, black);
+}
+
+
+void ClusteredLighting::createPipeline(VkShaderModule assign_shader)
+{
+	VkPipelineLayoutCreateInfo layout_create_info{};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layout_create_info.setLayoutCount = 1;
+	layout_create_info.pSetLayouts = &set_layout;
+
+	if (vkCreatePipelineLayout(device, &layout_create_info, hostAllocator(), &layout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Lighting Error - Failed to create pipeline layout.");
+	}
+
+	// Workgroup size is specialized from the same constant the dispatch divides by
+	SpecializationConstants group;
+	group.set(0, (uint32_t)CLUSTER_GROUP_SIZE);
+
+	VkComputePipelineCreateInfo pipeline_create_info{};
+	pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipeline_create_info.stage.module = assign_shader;
+	pipeline_create_info.stage.pName = "main";
+	pipeline_create_info.stage.pSpecializationInfo = group.info();
+	pipeline_create_info.layout = layout;
+
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_create_info, hostAllocator(), &assign_pipeline) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Lighting Error - Failed to create compute pipeline.");
+	}
+}
+
+
+void ClusteredLighting::destroy()
+{
+	for (MappedBuffer* target : { &params, &lights, &grid, &indices, &counter })
+	{
+		if (target->mapped != nullptr) vkUnmapMemory(device, target->memory);
+		vkDestroyBuffer(device, target->buffer, hostAllocator());
+		vkFreeMemory(device, target->memory, hostAllocator());
+		*target = MappedBuffer{};
+	}
+	vkDestroyPipeline(device, assign_pipeline, hostAllocator());
+	vkDestroyPipelineLayout(device, layout, hostAllocator());
+	vkDestroyDescriptorPool(device, pool, hostAllocator());
+	vkDestroyDescriptorSetLayout(device, set_layout, hostAllocator());
+	assign_pipeline = VK_NULL_HANDLE;
+	layout = VK_NULL_HANDLE;
+	pool = VK_NULL_HANDLE;
+	set_layout = VK_NULL_HANDLE;
+	light_count = 0;
+}
+
+
+void ClusteredLighting::setLights(const Light* source, uint32_t count)
+{
+	light_count = std::min(count, (uint32_t)CLUSTER_MAX_LIGHTS);
+	if (light_count != 0) std::memcpy(lights.mapped, source, sizeof(Light) * light_count);
+}
+
+
+// Slices are spaced from the projection's own near and far planes, read back through its inverse
+void ClusteredLighting::setView(const Mat4& view, const Mat4& projection, const float ambient[3])
+{
+	Params written{};
+	written.view = view;
+	if (!invertMatrix(projection, written.inverse_projection))
+	{
+		written.inverse_projection = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+	}
+	written.ambient[0] = ambient[0];
+	written.ambient[1] = ambient[1];
+	written.ambient[2] = ambient[2];
+	written.grid[0] = CLUSTER_GRID_X;
+	written.grid[1] = CLUSTER_GRID_Y;
+	written.grid[2] = CLUSTER_GRID_Z;
+	written.grid[3] = light_count;
+
+	// View z where the view axis crosses clip depth 0 and 1
+	const float* inverse = written.inverse_projection.m;
+	auto viewZ = [inverse](float depth) { return (inverse[10] * depth + inverse[14]) / (inverse[11] * depth + inverse[15]); };
+	float near_z = viewZ(0.0f);
+	float far_z = viewZ(1.0f);
+
+	// Perspective - w follows view z, so equal slices in log depth keep froxels roughly cubic
+	const float slices = (float)CLUSTER_GRID_Z;
+	written.exponential = projection.m[11] != 0.0f && std::isfinite(near_z) && near_z != 0.0f;
+	if (written.exponential)
+	{
+		float limit = std::fabs(near_z) * CLUSTER_DEPTH_RANGE;
+		if (!std::isfinite(far_z) || std::fabs(far_z) > limit || far_z == near_z) far_z = std::copysign(limit, near_z);
+		written.depth_scale = slices / std::log(std::fabs(far_z / near_z));
+		written.depth_bias = -std::log(std::fabs(near_z)) * written.depth_scale;
+	}
+	else
+	{
+		if (!std::isfinite(near_z)) near_z = 0.0f;
+		if (!std::isfinite(far_z) || far_z == near_z) far_z = near_z + 1.0f;
+		written.depth_scale = slices / (far_z - near_z);
+		written.depth_bias = -near_z * written.depth_scale;
+	}
+	written.near_z = near_z;
+	std::memcpy(params.mapped, &written, sizeof(written));
+}
+
+
+void ClusteredLighting::recordAssign(VkCommandBuffer command_buffer)
+{
+	// Shading of the previous frame finished before this submit started, so only the counter reset needs ordering
+	vkCmdFillBuffer(command_buffer, counter.buffer, 0, sizeof(uint32_t), 0);
+
+	VkMemoryBarrier reset{};
+	reset.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	reset.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	reset.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &reset, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, assign_pipeline);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &set, 0, nullptr);
+	vkCmdDispatch(command_buffer, (CLUSTER_COUNT + CLUSTER_GROUP_SIZE - 1) / CLUSTER_GROUP_SIZE, 1, 1);
+
+	VkMemoryBarrier assigned{};
+	assigned.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	assigned.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	assigned.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &assigned, 0, nullptr, 0, nullptr);
+}
+
+
+void ClusteredLighting::createMapped(VkDeviceSize size, VkBufferUsageFlags usage, MappedBuffer& target)
+{
+	// Coherent so host writes before the submit need no flush
+	createBuffer(device, physical_device, size, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, target.buffer, target.memory);
+	if (vkMapMemory(device, target.memory, 0, VK_WHOLE_SIZE, 0, &target.mapped) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Lighting Error - Failed to map lighting buffer.");
+	}
+}
+
+
+void ClusteredLighting::createLocal(VkDeviceSize size, VkBufferUsageFlags usage, MappedBuffer& target)
+{
+	createBuffer(device, physical_device, size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, target.buffer, target.memory);
+}
@@ -0,0 +1,199 @@
+#include "CommandTrace.h"
+#include "PostChain.h"
+
+#include <stdexcept>
+#include <fstream>
+#include <cstring>
+
+
+
+TraceWriter::~TraceWriter()
+{
+	close();
+}
+
+
+bool TraceWriter::open(const std::string& path, uint32_t frame_count)
+{
+	close();
+	output = std::fopen(path.c_str(), "wb");
+	if (output == nullptr) return false;
+
+	const uint32_t header[2] = { TRACE_MAGIC, TRACE_VERSION };
+	std::fwrite(header, sizeof(header), 1, output);
+	pending.clear();
+	for (auto& state : last_state)
+	{
+		state.clear();
+	}
+	frame_limit = frame_count;
+	frames_written = 0;
+	bytes_written = sizeof(header);
+	return true;
+}
+
+
+// Records of a frame that never reached its submit are dropped
+void TraceWriter::close()
+{
+	if (output == nullptr) return;
+	std::fclose(output);
+	output = nullptr;
+	pending.clear();
+}
+
+
+void TraceWriter::write(TraceOp op, const void* data, uint32_t size)
+{
+	write(op, data, size, nullptr, 0);
+}
+
+
+void TraceWriter::write(TraceOp op, const void* head, uint32_t head_size, const void* data, uint32_t size)
+{
+	if (output == nullptr) return;
+
+	TraceRecord record = { (uint32_t)op, head_size + size };
+	size_t offset = pending.size();
+	pending.resize(offset + sizeof(record) + record.size);
+	std::memcpy(&pending[offset], &record, sizeof(record));
+	if (head_size != 0) std::memcpy(&pending[offset + sizeof(record)], head, head_size);
+	if (size != 0) std::memcpy(&pending[offset + sizeof(record) + head_size], data, size);
+}
+
+
+void TraceWriter::writeState(TraceOp op, const void* data, uint32_t size)
+{
+	if (output == nullptr) return;
+
+	std::vector <uint8_t>& last = last_state[(uint32_t)op];
+	if (last.size() == size && std::memcmp(last.data(), data, size) == 0) return;
+	last.assign((const uint8_t*)data, (const uint8_t*)data + size);
+	write(op, data, size);
+}
+
+
+void TraceWriter::endFrame(const TraceSubmit& submit)
+{
+	if (output == nullptr) return;
+
+	write(TraceOp::Submit, &submit, sizeof(submit));
+	std::fwrite(pending.data(), 1, pending.size(), output);
+	bytes_written += pending.size();
+	pending.clear();
+
+	if (++frames_written >= frame_limit) close();
+}
+
+
+void TraceReader::open(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("[!] Trace Error - Failed to open " + path + ".");
+	}
+	size_t size = (size_t)file.tellg();
+	bytes.resize(size);
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(bytes.data()), size);
+
+	uint32_t header[2] = { 0, 0 };
+	if (size >= sizeof(header)) std::memcpy(header, bytes.data(), sizeof(header));
+	if (header[0] != TRACE_MAGIC)
+	{
+		throw std::runtime_error("[!] Trace Error - " + path + " is not a command trace.");
+	}
+	if (header[1] != TRACE_VERSION)
+	{
+		throw std::runtime_error("[!] Trace Error - " + path + " has version " + std::to_string(header[1]) + ", expected " + std::to_string(TRACE_VERSION) + ".");
+	}
+
+	// Split into frames, checking every payload against its op before replay trusts it
+	bool configured = false;
+	uint32_t instance_count = 0;
+	std::vector <Command> commands;
+	texture_paths.clear();
+	frames.clear();
+	submits.clear();
+	size_t offset = sizeof(header);
+	while (offset + sizeof(TraceRecord) <= size)
+	{
+		TraceRecord record;
+		std::memcpy(&record, &bytes[offset], sizeof(record));
+		offset += sizeof(record);
+		if (record.size > size - offset)
+		{
+			break;																	// Truncated capture - keep the complete frames
+		}
+
+		Command command = { (TraceOp)record.op, record.size, &bytes[offset] };
+		offset += record.size;
+
+		uint64_t expected = UINT64_MAX;
+		switch (command.op)
+		{
+		case TraceOp::Config: expected = sizeof(TraceConfig); break;
+		case TraceOp::Effects: expected = sizeof(uint32_t); break;
+		case TraceOp::PostParams: expected = sizeof(PostParams); break;
+		case TraceOp::ClearColor: expected = sizeof(VkClearColorValue); break;
+		case TraceOp::Camera: expected = sizeof(TraceCamera); break;
+		case TraceOp::Submit: expected = sizeof(TraceSubmit); break;
+		case TraceOp::Instances:
+		{
+			TraceInstances instances{};
+			if (command.size >= sizeof(instances)) std::memcpy(&instances, command.data, sizeof(instances));
+			// A new count rebuilds the scene, which captures every matrix - so the count is bounded by the payload
+			bool full = instances.begin == 0 && instances.end == instances.count;
+			if (command.size >= sizeof(instances) && instances.begin <= instances.end && instances.end <= instances.count && (instances.count == instance_count || full))
+			{
+				expected = sizeof(instances) + (uint64_t)(instances.end - instances.begin) * sizeof(Mat4);
+				instance_count = instances.count;
+			}
+			break;
+		}
+		case TraceOp::Lights:
+		{
+			uint64_t light_count = command.size >= 3 * sizeof(float) ? (command.size - 3 * sizeof(float)) / sizeof(Light) : UINT64_MAX;
+			if (light_count <= CLUSTER_MAX_LIGHTS) expected = 3 * sizeof(float) + light_count * sizeof(Light);
+			break;
+		}
+		case TraceOp::Texture: expected = command.size; break;
+		default:
+			throw std::runtime_error("[!] Trace Error - " + path + " has an unknown record " + std::to_string(record.op) + ".");
+		}
+		if (command.size != expected)
+		{
+			throw std::runtime_error("[!] Trace Error - " + path + " has a bad record " + std::to_string(record.op) + ".");
+		}
+
+		// Config and textures come before the first frame, everything else belongs to the frame its Submit ends
+		if (command.op == TraceOp::Config)
+		{
+			std::memcpy(&trace_config, command.data, sizeof(trace_config));
+			configured = true;
+		}
+		else if (command.op == TraceOp::Texture) texture_paths.emplace_back((const char*)command.data, command.size);
+		else
+		{
+			commands.push_back(command);
+			if (command.op == TraceOp::Submit)
+			{
+				TraceSubmit submit;
+				std::memcpy(&submit, command.data, sizeof(submit));
+				submits.push_back(submit);
+				frames.push_back(std::move(commands));
+				commands.clear();
+			}
+		}
+	}
+
+	if (!configured || trace_config.width == 0 || trace_config.height == 0)
+	{
+		throw std::runtime_error("[!] Trace Error - " + path + " has no renderer config.");
+	}
+	if (frames.empty())
+	{
+		throw std::runtime_error("[!] Trace Error - " + path + " has no complete frame.");
+	}
+}
@@ -0,0 +1,419 @@
+#include "DebugDraw.h"
+#include "HostAllocator.h"
+#include "VulkanHelpers.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <thread>
+#include <cstring>
+#include <cstddef>
+#include <cmath>
+
+
+static inline void setVertex(DebugVertex& vertex, float x, float y, float z, uint32_t color)
+{
+	vertex.position[0] = x;
+	vertex.position[1] = y;
+	vertex.position[2] = z;
+	vertex.color = color;
+}
+
+
+// Twelve edges between eight corners, corner bit 0 = x, bit 1 = y, bit 2 = z
+static const uint8_t BOX_EDGES[24] = { 0, 1, 2, 3, 4, 5, 6, 7, 0, 2, 1, 3, 4, 6, 5, 7, 0, 4, 1, 5, 2, 6, 3, 7 };
+
+
+DebugDraw& DebugDraw::instance()
+{
+	static DebugDraw debug_draw;
+	return debug_draw;
+}
+
+
+void DebugDraw::create(VkDevice dev, VkPhysicalDevice physical_device, VkFormat color_format, VkImageLayout image_layout)
+{
+	device = dev;
+
+	// Render Pass - drawn over the finished image, which stays in its presentable layout
+	VkAttachmentDescription color_attachment{};
+	color_attachment.format = color_format;
+	color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	color_attachment.initialLayout = image_layout;
+	color_attachment.finalLayout = image_layout;
+
+	VkAttachmentReference color_ref{};
+	color_ref.attachment = 0;
+	color_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &color_ref;
+
+	// Earlier passes in the submit wrote the image at color output, the lines blend over it
+	VkSubpassDependency external{};
+	external.srcSubpass = VK_SUBPASS_EXTERNAL;
+	external.dstSubpass = 0;
+	external.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	external.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	external.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	external.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	VkRenderPassCreateInfo render_pass_create_info{};
+	render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	render_pass_create_info.attachmentCount = 1;
+	render_pass_create_info.pAttachments = &color_attachment;
+	render_pass_create_info.subpassCount = 1;
+	render_pass_create_info.pSubpasses = &subpass;
+	render_pass_create_info.dependencyCount = 1;
+	render_pass_create_info.pDependencies = &external;
+
+	if (vkCreateRenderPass(device, &render_pass_create_info, hostAllocator(), &render_pass) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Debug Draw Error - Failed to create render pass.");
+	}
+
+	// Ring - every slot mapped for the lifetime of the renderer, coherent so appends need no flush
+	createBuffer(device, physical_device, sizeof(DebugVertex) * DEBUG_DRAW_CAPACITY * DEBUG_DRAW_SLOTS, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, memory);
+
+	void* data = nullptr;
+	if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Debug Draw Error - Failed to map vertex ring.");
+	}
+
+	// Primitives queued before create() were dropped, start from an empty slot
+	state.store(0, std::memory_order_relaxed);
+	for (auto& slot_committed : committed) slot_committed.store(0, std::memory_order_relaxed);
+	draw_slot = draw_count = 0;
+	mapped = static_cast<DebugVertex*>(data);
+}
+
+
+void DebugDraw::createPipeline(VkShaderModule vertex_shader, VkShaderModule fragment_shader)
+{
+	VkPushConstantRange push_range{};
+	push_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	push_range.offset = 0;
+	push_range.size = sizeof(Mat4);
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_range;
+
+	if (vkCreatePipelineLayout(device, &pipeline_layout_create_info, hostAllocator(), &layout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Debug Draw Error - Failed to create pipeline layout.");
+	}
+
+	VkPipelineShaderStageCreateInfo stages[2]{};
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].module = vertex_shader;
+	stages[0].pName = "main";
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].module = fragment_shader;
+	stages[1].pName = "main";
+
+	// Vertex Input - world position, packed color
+	VkVertexInputBindingDescription binding{};
+	binding.binding = 0;
+	binding.stride = sizeof(DebugVertex);
+	binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	VkVertexInputAttributeDescription attributes[2]{};
+	attributes[0].location = 0;
+	attributes[0].binding = 0;
+	attributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attributes[0].offset = offsetof(DebugVertex, position);
+	attributes[1].location = 1;
+	attributes[1].binding = 0;
+	attributes[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+	attributes[1].offset = offsetof(DebugVertex, color);
+
+	VkPipelineVertexInputStateCreateInfo vertex_input_create_info{};
+	vertex_input_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertex_input_create_info.vertexBindingDescriptionCount = 1;
+	vertex_input_create_info.pVertexBindingDescriptions = &binding;
+	vertex_input_create_info.vertexAttributeDescriptionCount = 2;
+	vertex_input_create_info.pVertexAttributeDescriptions = attributes;
+
+	VkPipelineInputAssemblyStateCreateInfo assembly_create_info{};
+	assembly_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	assembly_create_info.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+
+	VkPipelineViewportStateCreateInfo viewport_create_info{};
+	viewport_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewport_create_info.viewportCount = 1;
+	viewport_create_info.scissorCount = 1;
+
+	VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamic_create_info{};
+	dynamic_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamic_create_info.dynamicStateCount = 2;
+	dynamic_create_info.pDynamicStates = dynamic_states;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer_create_info{};
+	rasterizer_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer_create_info.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer_create_info.lineWidth = 1.0f;
+	rasterizer_create_info.cullMode = VK_CULL_MODE_NONE;
+	rasterizer_create_info.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisample_create_info{};
+	multisample_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisample_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	// Alpha blended - overflow padding has zero alpha and leaves no trace
+	VkPipelineColorBlendAttachmentState color_blend_attachment{};
+	color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	color_blend_attachment.blendEnable = VK_TRUE;
+	color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	color_blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
+	color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo color_blend_create_info{};
+	color_blend_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	color_blend_create_info.attachmentCount = 1;
+	color_blend_create_info.pAttachments = &color_blend_attachment;
+
+	VkGraphicsPipelineCreateInfo pipeline_create_info{};
+	pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipeline_create_info.stageCount = 2;
+	pipeline_create_info.pStages = stages;
+	pipeline_create_info.pVertexInputState = &vertex_input_create_info;
+	pipeline_create_info.pInputAssemblyState = &assembly_create_info;
+	pipeline_create_info.pViewportState = &viewport_create_info;
+	pipeline_create_info.pRasterizationState = &rasterizer_create_info;
+	pipeline_create_info.pMultisampleState = &multisample_create_info;
+	pipeline_create_info.pColorBlendState = &color_blend_create_info;
+	pipeline_create_info.pDynamicState = &dynamic_create_info;
+	pipeline_create_info.layout = layout;
+	pipeline_create_info.renderPass = render_pass;
+	pipeline_create_info.subpass = 0;
+
+	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_create_info, hostAllocator(), &pipeline) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Debug Draw Error - Failed to create pipeline.");
+	}
+}
+
+
+void DebugDraw::destroy()
+{
+	if (device == VK_NULL_HANDLE) return;
+
+	// Appends after this point are ignored
+	mapped = nullptr;
+	if (memory != VK_NULL_HANDLE) vkUnmapMemory(device, memory);
+
+	vkDestroyPipeline(device, pipeline, hostAllocator());
+	vkDestroyPipelineLayout(device, layout, hostAllocator());
+	vkDestroyRenderPass(device, render_pass, hostAllocator());
+	vkDestroyBuffer(device, buffer, hostAllocator());
+	vkFreeMemory(device, memory, hostAllocator());
+
+	pipeline = VK_NULL_HANDLE;
+	layout = VK_NULL_HANDLE;
+	render_pass = VK_NULL_HANDLE;
+	buffer = VK_NULL_HANDLE;
+	memory = VK_NULL_HANDLE;
+	device = VK_NULL_HANDLE;
+}
+
+
+// One reservation per primitive, so a primitive is either drawn whole or dropped whole
+void DebugDraw::append(const DebugVertex* vertices, uint32_t count)
+{
+	DebugVertex* ring = mapped;
+	if (ring == nullptr || count == 0) return;
+
+	uint64_t previous = state.fetch_add(count, std::memory_order_acq_rel);
+	uint32_t slot = (uint32_t)(previous >> 32);
+	uint32_t offset = (uint32_t)previous;
+
+	DebugVertex* destination = ring + (size_t)slot * DEBUG_DRAW_CAPACITY;
+	if (offset + count <= DEBUG_DRAW_CAPACITY)
+	{
+		std::memcpy(destination + offset, vertices, sizeof(DebugVertex) * count);
+	}
+	else
+	{
+		// Straddles the end - the part that fits is padded with invisible vertices so the slot stays gap free
+		if (offset < DEBUG_DRAW_CAPACITY) std::memset(destination + offset, 0, sizeof(DebugVertex) * (DEBUG_DRAW_CAPACITY - offset));
+		dropped.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	// Release - seal() sees every vertex of the reservation once the slot is fully committed
+	committed[slot].fetch_add(count, std::memory_order_release);
+}
+
+
+void DebugDraw::line(const float a[3], const float b[3], uint32_t color)
+{
+	DebugVertex vertices[2];
+	setVertex(vertices[0], a[0], a[1], a[2], color);
+	setVertex(vertices[1], b[0], b[1], b[2], color);
+	append(vertices, 2);
+}
+
+
+void DebugDraw::box(const Aabb& bounds, uint32_t color)
+{
+	DebugVertex vertices[24];
+	for (int i = 0; i < 24; i++)
+	{
+		uint8_t corner = BOX_EDGES[i];
+		setVertex(vertices[i], (corner & 1) ? bounds.max[0] : bounds.min[0], (corner & 2) ? bounds.max[1] : bounds.min[1],
+			(corner & 4) ? bounds.max[2] : bounds.min[2], color);
+	}
+	append(vertices, 24);
+}
+
+
+// Three great circles, one per axis plane
+void DebugDraw::sphere(const float center[3], float radius, uint32_t color)
+{
+	float cosines[DEBUG_SPHERE_SEGMENTS + 1];
+	float sines[DEBUG_SPHERE_SEGMENTS + 1];
+	for (int i = 0; i <= DEBUG_SPHERE_SEGMENTS; i++)
+	{
+		float angle = 6.28318531f * (float)(i % DEBUG_SPHERE_SEGMENTS) / (float)DEBUG_SPHERE_SEGMENTS;
+		cosines[i] = std::cos(angle) * radius;
+		sines[i] = std::sin(angle) * radius;
+	}
+
+	DebugVertex vertices[DEBUG_SPHERE_SEGMENTS * 6];
+	DebugVertex* vertex = vertices;
+	for (int plane = 0; plane < 3; plane++)
+	{
+		int u = plane == 0 ? 1 : 0;
+		int v = plane == 2 ? 1 : 2;
+		for (int i = 0; i < DEBUG_SPHERE_SEGMENTS; i++)
+		{
+			for (int end = 0; end < 2; end++)
+			{
+				float point[3] = { center[0], center[1], center[2] };
+				point[u] += cosines[i + end];
+				point[v] += sines[i + end];
+				setVertex(*vertex++, point[0], point[1], point[2], color);
+			}
+		}
+	}
+	append(vertices, DEBUG_SPHERE_SEGMENTS * 6);
+}
+
+
+// Clip volume corners unprojected through the inverse - x, y in [-1, 1], z in [0, 1]
+void DebugDraw::frustum(const Mat4& view_projection, uint32_t color)
+{
+	Mat4 inverse;
+	if (!invertMatrix(view_projection, inverse)) return;
+
+	float corners[8][3];
+	for (int corner = 0; corner < 8; corner++)
+	{
+		float clip[3] = { (corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : 0.0f };
+		const float* m = inverse.m;
+		float w = m[3] * clip[0] + m[7] * clip[1] + m[11] * clip[2] + m[15];
+		if (std::fabs(w) < 1e-20f) return;
+		for (int r = 0; r < 3; r++)
+		{
+			corners[corner][r] = (m[r] * clip[0] + m[4 + r] * clip[1] + m[8 + r] * clip[2] + m[12 + r]) / w;
+		}
+	}
+
+	DebugVertex vertices[24];
+	for (int i = 0; i < 24; i++)
+	{
+		const float* point = corners[BOX_EDGES[i]];
+		setVertex(vertices[i], point[0], point[1], point[2], color);
+	}
+	append(vertices, 24);
+}
+
+
+void DebugDraw::axes(const Mat4& transform, float size)
+{
+	static const uint32_t AXIS_COLORS[3] = { 0xff0000ff, 0xff00ff00, 0xffff0000 };
+	const float* m = transform.m;
+
+	DebugVertex vertices[6];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const float* column = &m[axis * 4];
+		setVertex(vertices[axis * 2], m[12], m[13], m[14], AXIS_COLORS[axis]);
+		setVertex(vertices[axis * 2 + 1], m[12] + column[0] * size, m[13] + column[1] * size, m[14] + column[2] * size, AXIS_COLORS[axis]);
+	}
+	append(vertices, 6);
+}
+
+
+// Called once per frame after the previous submit completed - that frame drew the slot being flipped to
+uint32_t DebugDraw::seal()
+{
+	draw_count = 0;
+	if (mapped == nullptr) return 0;
+
+	// Empty frames skip the flip, the filling slot simply stays put
+	uint64_t current = state.load(std::memory_order_relaxed);
+	if ((uint32_t)current == 0) return 0;
+
+	uint32_t slot = (uint32_t)(current >> 32);
+	uint64_t next = (uint64_t)(slot ^ 1) << 32;
+	uint64_t previous = state.exchange(next, std::memory_order_acq_rel);
+	uint32_t reserved = (uint32_t)previous;
+
+	// Reservations made before the flip may still be copying
+	while (committed[slot].load(std::memory_order_acquire) != reserved)
+	{
+		std::this_thread::yield();
+	}
+	committed[slot].store(0, std::memory_order_relaxed);
+
+	draw_slot = slot;
+	draw_count = std::min(reserved, (uint32_t)DEBUG_DRAW_CAPACITY);
+	return draw_count;
+}
+
+
+void DebugDraw::record(VkCommandBuffer command_buffer, VkFramebuffer framebuffer, VkExtent2D extent, const Mat4& view_projection)
+{
+	if (draw_count == 0 || pipeline == VK_NULL_HANDLE) return;
+
+	VkRenderPassBeginInfo render_pass_info{};
+	render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	render_pass_info.renderPass = render_pass;
+	render_pass_info.framebuffer = framebuffer;
+	render_pass_info.renderArea.offset = { 0, 0 };
+	render_pass_info.renderArea.extent = extent;
+
+	vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+
+	VkViewport viewport{};
+	viewport.width = (float)extent.width;
+	viewport.height = (float)extent.height;
+	viewport.maxDepth = 1.0f;
+	VkRect2D scissor{ { 0, 0 }, extent };
+	vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+	vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	vkCmdPushConstants(command_buffer, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Mat4), &view_projection);
+
+	VkDeviceSize offset = sizeof(DebugVertex) * (VkDeviceSize)draw_slot * DEBUG_DRAW_CAPACITY;
+	vkCmdBindVertexBuffers(command_buffer, 0, 1, &buffer, &offset);
+	vkCmdDraw(command_buffer, draw_count, 1, 0, 0);
+
+	vkCmdEndRenderPass(command_buffer);
+}
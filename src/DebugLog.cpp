@@ -0,0 +1,280 @@
+#include "DebugLog.h"
+
+#include <iostream>
+#include <cstring>
+#include <sstream>
+
+
+// Constructor & Deconstructors
+DebugLog::DebugLog()
+{
+	slots = new Slot[DEBUG_LOG_CAPACITY];
+	for (uint64_t i = 0; i < DEBUG_LOG_CAPACITY; i++)
+	{
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	for (int i = 0; i < SEVERITY_COUNT; i++)
+	{
+		received[i].store(0, std::memory_order_relaxed);
+	}
+
+	// Default print budgets - errors are never rate limited
+	limits[SEVERITY_VERBOSE].per_second = 20;
+	limits[SEVERITY_INFO].per_second = 20;
+	limits[SEVERITY_WARNING].per_second = 50;
+	limits[SEVERITY_ERROR].per_second = 0;
+}
+
+DebugLog::~DebugLog()
+{
+	stop();
+	delete[] slots;
+}
+
+
+void DebugLog::start()
+{
+	if (running.exchange(true)) return;
+
+	window_start = std::chrono::steady_clock::now();
+	last_summary = window_start;
+	drain_thread = std::thread(&DebugLog::drainLoop, this);
+}
+
+
+void DebugLog::stop()
+{
+	if (!running.exchange(false)) return;
+
+	drain_thread.join();
+
+	// Catch anything pushed after the last drain
+	drain();
+	summarize(true);
+	flush();
+}
+
+
+// Lock-free bounded MPMC enqueue - callback may fire from several driver threads
+bool DebugLog::push(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type, const VkDebugUtilsMessengerCallbackDataEXT* data)
+{
+	Severity index = severityIndex(severity);
+	received[index].fetch_add(1, std::memory_order_relaxed);
+
+	Slot* slot;
+	uint64_t pos = enqueue_pos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		slot = &slots[pos & (DEBUG_LOG_CAPACITY - 1)];
+		uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+		int64_t diff = (int64_t)seq - (int64_t)pos;
+
+		if (diff == 0)
+		{
+			if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+		}
+		else if (diff < 0)
+		{
+			// Ring full - never block the driver thread
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else
+		{
+			pos = enqueue_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	const char* text = data->pMessage ? data->pMessage : "";
+	slot->severity = index;
+	slot->type = type;
+	slot->key = hashMessage(data->messageIdNumber, data->pMessageIdName, text);
+	strncpy(slot->text, text, DEBUG_LOG_MESSAGE_SIZE - 1);
+	slot->text[DEBUG_LOG_MESSAGE_SIZE - 1] = '\0';
+
+	slot->sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+
+void DebugLog::setRateLimit(Severity severity, uint32_t messages_per_second)
+{
+	limits[severity].per_second = messages_per_second;
+}
+
+
+uint64_t DebugLog::receivedCount(Severity severity) const
+{
+	return received[severity].load(std::memory_order_relaxed);
+}
+
+
+uint64_t DebugLog::droppedCount() const
+{
+	return dropped.load(std::memory_order_relaxed);
+}
+
+
+DebugLog::Severity DebugLog::severityIndex(VkDebugUtilsMessageSeverityFlagBitsEXT severity)
+{
+	if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) return SEVERITY_ERROR;
+	if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) return SEVERITY_WARNING;
+	if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) return SEVERITY_INFO;
+	return SEVERITY_VERBOSE;
+}
+
+
+// Background thread - drain, then sleep briefly when idle
+void DebugLog::drainLoop()
+{
+	while (running.load(std::memory_order_acquire))
+	{
+		size_t drained = drain();
+
+		auto now = std::chrono::steady_clock::now();
+		if (now - last_summary >= std::chrono::seconds(DEBUG_LOG_SUMMARY_SECONDS))
+		{
+			summarize(false);
+			last_summary = now;
+		}
+		flush();
+
+		if (drained == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+}
+
+
+size_t DebugLog::drain()
+{
+	size_t count = 0;
+	uint64_t pos = dequeue_pos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		Slot& slot = slots[pos & (DEBUG_LOG_CAPACITY - 1)];
+		uint64_t seq = slot.sequence.load(std::memory_order_acquire);
+		if ((int64_t)seq - (int64_t)(pos + 1) < 0) break;
+
+		emit(slot);
+		count++;
+
+		// Hand the slot back to producers one lap ahead
+		slot.sequence.store(pos + DEBUG_LOG_CAPACITY, std::memory_order_release);
+		pos++;
+	}
+	dequeue_pos.store(pos, std::memory_order_relaxed);
+	return count;
+}
+
+
+void DebugLog::emit(const Slot& slot)
+{
+	// Reset rate limit budgets every second
+	auto now = std::chrono::steady_clock::now();
+	if (now - window_start >= std::chrono::seconds(1))
+	{
+		for (auto& limit : limits) limit.used = 0;
+		window_start = now;
+	}
+
+	// Repeated IDs are counted once their full text has printed
+	RepeatEntry& entry = repeats[slot.key];
+	entry.total++;
+	if (entry.printed)
+	{
+		entry.since_summary++;
+		return;
+	}
+	entry.severity = slot.severity;
+	entry.preview.assign(slot.text, strnlen(slot.text, 96));
+
+	RateLimit& limit = limits[slot.severity];
+	if (limit.per_second != 0 && limit.used >= limit.per_second)
+	{
+		limit.suppressed++;
+		return;
+	}
+	limit.used++;
+	entry.printed = true;
+
+	output += "\nDebug Callback - Validation layer [";
+	output += severityName(slot.severity);
+	output += "]: ";
+	output += slot.text;
+	output += '\n';
+}
+
+
+void DebugLog::summarize(bool final_summary)
+{
+	for (auto& repeat : repeats)
+	{
+		RepeatEntry& entry = repeat.second;
+		if (entry.since_summary == 0) continue;
+
+		std::ostringstream line;
+		line << "[" << severityName(entry.severity) << "] repeated x" << entry.since_summary
+			<< " (total " << entry.total << "): " << entry.preview << "\n";
+		output += line.str();
+		entry.since_summary = 0;
+	}
+
+	for (int i = 0; i < SEVERITY_COUNT; i++)
+	{
+		if (limits[i].suppressed == 0) continue;
+
+		output += "[";
+		output += severityName((Severity)i);
+		output += "] rate limited " + std::to_string(limits[i].suppressed) + " messages\n";
+		limits[i].suppressed = 0;
+	}
+
+	uint64_t lost = dropped.load(std::memory_order_relaxed);
+	if (final_summary && lost != 0)
+	{
+		output += "[!] Debug log ring overflowed, " + std::to_string(lost) + " messages dropped\n";
+	}
+}
+
+
+// One write per drain pass instead of a flush per message
+void DebugLog::flush()
+{
+	if (output.empty()) return;
+
+	std::cerr << output;
+	std::cerr.flush();
+	output.clear();
+}
+
+
+// FNV-1a - messages without an ID number fall back to the ID name or text
+uint32_t DebugLog::hashMessage(int32_t id, const char* name, const char* text)
+{
+	if (id != 0) return (uint32_t)id;
+
+	const char* source = (name != nullptr && name[0] != '\0') ? name : text;
+	uint32_t hash = 2166136261u;
+	for (const char* c = source; *c != '\0'; c++)
+	{
+		hash ^= (uint8_t)*c;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+
+const char* DebugLog::severityName(Severity severity)
+{
+	switch (severity)
+	{
+	case SEVERITY_VERBOSE:	return "VERBOSE";
+	case SEVERITY_INFO:		return "INFO";
+	case SEVERITY_WARNING:	return "WARNING";
+	case SEVERITY_ERROR:	return "ERROR";
+	default:				return "UNKNOWN";
+	}
+}
@@ -0,0 +1,120 @@
+#include "DeletionQueue.h"
+#include "HostAllocator.h"
+
+
+void DeletionQueue::init(VkDevice dev)
+{
+	device = dev;
+}
+
+
+void DeletionQueue::flush(uint64_t completed_frame)
+{
+	// Pull finished entries out under the lock, destroy outside it
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (entries.empty()) return;
+
+		size_t keep = 0;
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].frame <= completed_frame) ready.push_back(entries[i]);
+			else entries[keep++] = entries[i];
+		}
+		entries.resize(keep);
+	}
+
+	for (const auto& entry : ready)
+	{
+		destroy(entry);
+	}
+	ready.clear();
+}
+
+
+void DeletionQueue::flushAll()
+{
+	flush(UINT64_MAX);
+}
+
+
+size_t DeletionQueue::pendingCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return entries.size();
+}
+
+
+void DeletionQueue::destroy(const Entry& entry)
+{
+	switch (entry.type)
+	{
+	case PIPELINE:
+		vkDestroyPipeline(device, handleFromBits<VkPipeline>(entry.handle), hostAllocator());
+		break;
+
+	case PIPELINE_LAYOUT:
+		vkDestroyPipelineLayout(device, handleFromBits<VkPipelineLayout>(entry.handle), hostAllocator());
+		break;
+
+	case RENDER_PASS:
+		vkDestroyRenderPass(device, handleFromBits<VkRenderPass>(entry.handle), hostAllocator());
+		break;
+
+	case FRAMEBUFFER:
+		vkDestroyFramebuffer(device, handleFromBits<VkFramebuffer>(entry.handle), hostAllocator());
+		break;
+
+	case IMAGE_VIEW:
+		vkDestroyImageView(device, handleFromBits<VkImageView>(entry.handle), hostAllocator());
+		break;
+
+	case IMAGE:
+		vkDestroyImage(device, handleFromBits<VkImage>(entry.handle), hostAllocator());
+		break;
+
+	case BUFFER:
+		vkDestroyBuffer(device, handleFromBits<VkBuffer>(entry.handle), hostAllocator());
+		break;
+
+	case MEMORY:
+		vkFreeMemory(device, handleFromBits<VkDeviceMemory>(entry.handle), hostAllocator());
+		break;
+
+	case SAMPLER:
+		vkDestroySampler(device, handleFromBits<VkSampler>(entry.handle), hostAllocator());
+		break;
+
+	case SHADER_MODULE:
+		vkDestroyShaderModule(device, handleFromBits<VkShaderModule>(entry.handle), hostAllocator());
+		break;
+
+	case DESCRIPTOR_POOL:
+		vkDestroyDescriptorPool(device, handleFromBits<VkDescriptorPool>(entry.handle), hostAllocator());
+		break;
+
+	case DESCRIPTOR_SET_LAYOUT:
+		vkDestroyDescriptorSetLayout(device, handleFromBits<VkDescriptorSetLayout>(entry.handle), hostAllocator());
+		break;
+
+	case SWAPCHAIN:
+		vkDestroySwapchainKHR(device, handleFromBits<VkSwapchainKHR>(entry.handle), hostAllocator());
+		break;
+
+	case SEMAPHORE:
+		vkDestroySemaphore(device, handleFromBits<VkSemaphore>(entry.handle), hostAllocator());
+		break;
+
+	case FENCE:
+		vkDestroyFence(device, handleFromBits<VkFence>(entry.handle), hostAllocator());
+		break;
+
+	case QUERY_POOL:
+		vkDestroyQueryPool(device, handleFromBits<VkQueryPool>(entry.handle), hostAllocator());
+		break;
+
+	case COMMAND_POOL:
+		vkDestroyCommandPool(device, handleFromBits<VkCommandPool>(entry.handle), hostAllocator());
+		break;
+	}
+}
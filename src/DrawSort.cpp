@@ -0,0 +1,213 @@
+#include "DrawSort.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+
+uint32_t drawKeyDepth(float depth, bool back_to_front)
+{
+	const uint32_t max_depth = (1u << DRAW_KEY_DEPTH_BITS) - 1;
+	uint32_t quantized = (uint32_t)(std::min(std::max(depth, 0.0f), 1.0f) * (float)max_depth);
+	return back_to_front ? max_depth - quantized : quantized;
+}
+
+
+DrawBindCounts countDrawBinds(const uint64_t* keys, uint32_t count)
+{
+	DrawBindCounts counts;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		bool new_pipeline = i == 0 || drawKeyPipeline(keys[i]) != drawKeyPipeline(keys[i - 1]);
+		bool new_material = new_pipeline || drawKeyMaterial(keys[i]) != drawKeyMaterial(keys[i - 1]);
+		counts.pipelines += new_pipeline ? 1 : 0;
+		counts.materials += new_material ? 1 : 0;
+	}
+	return counts;
+}
+
+
+namespace
+{
+	// Ping-pong buffers and per chunk offsets shared by the pass steps
+	struct RadixState
+	{
+		uint64_t* keys[2];
+		uint32_t* values[2];
+		uint32_t count = 0;
+		uint32_t chunk_size = 0;
+		uint32_t chunk_count = 0;
+		uint32_t* totals = nullptr;						// chunk_count x RADIX_PASSES x RADIX_BUCKETS, summed into chunk 0
+		uint32_t* offsets = nullptr;					// chunk_count x RADIX_BUCKETS
+		uint32_t shift = 0;
+		uint32_t source = 0;
+
+		uint32_t begin(uint32_t chunk) const { return std::min(count, chunk * chunk_size); }
+		uint32_t end(uint32_t chunk) const { return std::min(count, (chunk + 1) * chunk_size); }
+	};
+
+
+	// Every digit of every pass in one read of the keys
+	void countDigits(RadixState& state, uint32_t chunk)
+	{
+		uint32_t* totals = state.totals + chunk * RADIX_PASSES * RADIX_BUCKETS;
+		std::memset(totals, 0, sizeof(uint32_t) * RADIX_PASSES * RADIX_BUCKETS);
+		const uint64_t* keys = state.keys[0];
+		for (uint32_t i = state.begin(chunk); i < state.end(chunk); i++)
+		{
+			uint64_t key = keys[i];
+			for (uint32_t pass = 0; pass < RADIX_PASSES; pass++)
+			{
+				totals[pass * RADIX_BUCKETS + ((key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1))]++;
+			}
+		}
+	}
+
+
+	// Digit counts of this chunk in the current order
+	void countChunk(RadixState& state, uint32_t chunk)
+	{
+		uint32_t* offsets = state.offsets + chunk * RADIX_BUCKETS;
+		std::memset(offsets, 0, sizeof(uint32_t) * RADIX_BUCKETS);
+		const uint64_t* keys = state.keys[state.source];
+		for (uint32_t i = state.begin(chunk); i < state.end(chunk); i++)
+		{
+			offsets[(keys[i] >> state.shift) & (RADIX_BUCKETS - 1)]++;
+		}
+	}
+
+
+	void scatterChunk(RadixState& state, uint32_t chunk)
+	{
+		uint32_t* offsets = state.offsets + chunk * RADIX_BUCKETS;
+		const uint64_t* keys = state.keys[state.source];
+		const uint32_t* values = state.values[state.source];
+		uint64_t* out_keys = state.keys[state.source ^ 1];
+		uint32_t* out_values = state.values[state.source ^ 1];
+		for (uint32_t i = state.begin(chunk); i < state.end(chunk); i++)
+		{
+			uint64_t key = keys[i];
+			uint32_t slot = offsets[(key >> state.shift) & (RADIX_BUCKETS - 1)]++;
+			out_keys[slot] = key;
+			out_values[slot] = values[i];
+		}
+	}
+
+
+	// for_each(step) runs step(chunk) for every chunk and returns once all have finished
+	template <typename ForEach>
+	void sortPasses(RadixState& state, ForEach&& for_each)
+	{
+		for_each([&state](uint32_t chunk) { countDigits(state, chunk); });
+		for (uint32_t chunk = 1; chunk < state.chunk_count; chunk++)
+		{
+			const uint32_t* partial = state.totals + chunk * RADIX_PASSES * RADIX_BUCKETS;
+			for (uint32_t i = 0; i < RADIX_PASSES * RADIX_BUCKETS; i++) state.totals[i] += partial[i];
+		}
+
+		for (uint32_t pass = 0; pass < RADIX_PASSES; pass++)
+		{
+			// Every key has the same digit - the scatter would copy them in order
+			const uint32_t* totals = state.totals + pass * RADIX_BUCKETS;
+			if (std::find(totals, totals + RADIX_BUCKETS, state.count) != totals + RADIX_BUCKETS) continue;
+
+			state.shift = pass * RADIX_BITS;
+			for_each([&state](uint32_t chunk) { countChunk(state, chunk); });
+
+			// Digit major, chunk minor - equal digits keep chunk order, so the sort stays stable
+			uint32_t running = 0;
+			for (uint32_t digit = 0; digit < RADIX_BUCKETS; digit++)
+			{
+				for (uint32_t chunk = 0; chunk < state.chunk_count; chunk++)
+				{
+					uint32_t& offset = state.offsets[chunk * RADIX_BUCKETS + digit];
+					uint32_t n = offset;
+					offset = running;
+					running += n;
+				}
+			}
+
+			for_each([&state](uint32_t chunk) { scatterChunk(state, chunk); });
+			state.source ^= 1;
+		}
+	}
+}
+
+
+void radixSort(uint64_t* keys, uint32_t* values, uint32_t count, uint64_t* scratch_keys, uint32_t* scratch_values)
+{
+	if (count < 2) return;
+
+	uint32_t totals[RADIX_PASSES * RADIX_BUCKETS];
+	uint32_t offsets[RADIX_BUCKETS];
+	RadixState state;
+	state.keys[0] = keys;
+	state.keys[1] = scratch_keys;
+	state.values[0] = values;
+	state.values[1] = scratch_values;
+	state.count = count;
+	state.chunk_size = count;
+	state.chunk_count = 1;
+	state.totals = totals;
+	state.offsets = offsets;
+
+	sortPasses(state, [](auto&& step) { step(0); });
+
+	if (state.source != 0)
+	{
+		std::memcpy(keys, scratch_keys, sizeof(uint64_t) * count);
+		std::memcpy(values, scratch_values, sizeof(uint32_t) * count);
+	}
+}
+
+
+void radixSort(uint64_t* keys, uint32_t* values, uint32_t count, uint64_t* scratch_keys, uint32_t* scratch_values, JobSystem& jobs, FrameArena& arena)
+{
+	const uint32_t chunk_count = std::min(jobs.concurrency(), (count + DRAW_SORT_MIN_CHUNK - 1) / DRAW_SORT_MIN_CHUNK);
+	if (count < DRAW_SORT_SERIAL_COUNT || chunk_count < 2)
+	{
+		radixSort(keys, values, count, scratch_keys, scratch_values);
+		return;
+	}
+
+	RadixState state;
+	state.keys[0] = keys;
+	state.keys[1] = scratch_keys;
+	state.values[0] = values;
+	state.values[1] = scratch_values;
+	state.count = count;
+	state.chunk_count = chunk_count;
+	state.chunk_size = (count + chunk_count - 1) / chunk_count;
+	state.totals = arena.allocateArray<uint32_t>((size_t)chunk_count * RADIX_PASSES * RADIX_BUCKETS);
+	state.offsets = arena.allocateArray<uint32_t>((size_t)chunk_count * RADIX_BUCKETS);
+
+	// Steps only touch their own chunk, the serial parts run here between them
+	sortPasses(state, [&jobs, &arena, chunk_count](auto&& step)
+	{
+		JobCounter done;
+		auto* shared = &step;
+		jobs.parallelFor(arena, chunk_count, 1, [shared](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t chunk = begin; chunk < end; chunk++) (*shared)(chunk);
+		}, done);
+		jobs.wait(done);
+	});
+
+	if (state.source != 0)
+	{
+		JobCounter copied;
+		jobs.parallelFor(arena, chunk_count, 1, [&state](uint32_t begin, uint32_t end)
+		{
+			uint32_t first = state.begin(begin);
+			uint32_t last = state.end(end - 1);
+			std::memcpy(state.keys[0] + first, state.keys[1] + first, sizeof(uint64_t) * (last - first));
+			std::memcpy(state.values[0] + first, state.values[1] + first, sizeof(uint32_t) * (last - first));
+		}, copied);
+		jobs.wait(copied);
+	}
+}
@@ -0,0 +1,124 @@
+#include "DynamicResolution.h"
+#include "HostAllocator.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+
+void GpuFrameTimer::create(VkDevice dev, VkPhysicalDevice physical_device, uint32_t queue_family, VkCommandPool pool_for_commands)
+{
+	device = dev;
+	command_pool = pool_for_commands;
+
+	// Queues without timestamps leave the timer unsupported, the caller keeps full resolution
+	uint32_t family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, nullptr);
+	std::vector<VkQueueFamilyProperties> families(family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, families.data());
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+	uint32_t valid_bits = queue_family < family_count ? families[queue_family].timestampValidBits : 0;
+	if (valid_bits == 0 || properties.limits.timestampPeriod <= 0.0f) return;
+	valid_mask = valid_bits >= 64 ? UINT64_MAX : ((uint64_t)1 << valid_bits) - 1;
+	period_ms = properties.limits.timestampPeriod * 1e-6;
+
+	VkQueryPoolCreateInfo pool_create_info{};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	pool_create_info.queryCount = 2;
+
+	if (vkCreateQueryPool(device, &pool_create_info, hostAllocator(), &pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Timer Error - Failed to create timestamp query pool.");
+	}
+
+	VkCommandBuffer command_buffers[2];
+	VkCommandBufferAllocateInfo alloc_info{};
+	alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	alloc_info.commandPool = command_pool;
+	alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	alloc_info.commandBufferCount = 2;
+
+	if (vkAllocateCommandBuffers(device, &alloc_info, command_buffers) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Timer Error - Failed to allocate timestamp command buffers.");
+	}
+	begin_commands = command_buffers[0];
+	end_commands = command_buffers[1];
+
+	// Replayed every frame - the previous frame has completed, so resetting the pair here is safe
+	VkCommandBufferBeginInfo begin_info{};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+	vkBeginCommandBuffer(begin_commands, &begin_info);
+	vkCmdResetQueryPool(begin_commands, pool, 0, 2);
+	vkCmdWriteTimestamp(begin_commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool, 0);
+	vkEndCommandBuffer(begin_commands);
+
+	vkBeginCommandBuffer(end_commands, &begin_info);
+	vkCmdWriteTimestamp(end_commands, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool, 1);
+	if (vkEndCommandBuffer(end_commands) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Timer Error - Failed to record timestamp command buffers.");
+	}
+}
+
+
+void GpuFrameTimer::destroy()
+{
+	if (pool == VK_NULL_HANDLE) return;
+
+	VkCommandBuffer command_buffers[2] = { begin_commands, end_commands };
+	vkFreeCommandBuffers(device, command_pool, 2, command_buffers);
+	vkDestroyQueryPool(device, pool, hostAllocator());
+	pool = VK_NULL_HANDLE;
+	begin_commands = end_commands = VK_NULL_HANDLE;
+}
+
+
+bool GpuFrameTimer::read(double& milliseconds)
+{
+	if (pool == VK_NULL_HANDLE) return false;
+
+	uint64_t ticks[2];
+	if (vkGetQueryPoolResults(device, pool, 0, 2, sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) return false;
+
+	// Counters narrower than 64 bits wrap
+	uint64_t elapsed = ((ticks[1] & valid_mask) - (ticks[0] & valid_mask)) & valid_mask;
+	milliseconds = (double)elapsed * period_ms;
+	return true;
+}
+
+
+bool ResolutionController::update(double gpu_ms)
+{
+	if (budget_ms <= 0.0) return false;
+
+	average_ms = average_ms > 0.0 ? average_ms + RESOLUTION_SMOOTHING * (gpu_ms - average_ms) : gpu_ms;
+	settled_frames++;
+
+	float next = current_scale;
+	if (average_ms > budget_ms && settled_frames >= RESOLUTION_SETTLE_DOWN)
+	{
+		// Area cost - the scale that would have met the budget, rounded down to a step
+		float estimate = current_scale * (float)std::sqrt(budget_ms / average_ms);
+		next = std::floor(estimate / RESOLUTION_SCALE_STEP) * RESOLUTION_SCALE_STEP;
+		next = std::min(next, current_scale - RESOLUTION_SCALE_STEP);
+	}
+	else if (average_ms < budget_ms * RESOLUTION_HEADROOM && settled_frames >= RESOLUTION_SETTLE_UP)
+	{
+		next = current_scale + RESOLUTION_SCALE_STEP;
+	}
+
+	next = std::clamp(next, RESOLUTION_SCALE_MIN, 1.0f);
+	if (std::fabs(next - current_scale) < RESOLUTION_SCALE_STEP * 0.5f) return false;
+
+	current_scale = next;
+	average_ms = 0.0;
+	settled_frames = 0;
+	return true;
+}
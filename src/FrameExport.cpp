@@ -0,0 +1,467 @@
+#include "FrameExport.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define FRAME_EXPORT_X86 1
+#include <immintrin.h>
+#endif
+
+
+#define EXPORT_MAX_WORKERS 4
+#define EXPORT_WRITE_BUFFER (4 << 20)
+
+
+// BT.709 limited range, 8.8 fixed point - luma rows sum to 220, chroma rows to 0
+static inline uint8_t lumaBT709(int r, int g, int b)
+{
+	return (uint8_t)(((47 * r + 157 * g + 16 * b + 128) >> 8) + 16);
+}
+
+static inline uint8_t cbBT709(int r, int g, int b)
+{
+	return (uint8_t)(((-26 * r - 86 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static inline uint8_t crBT709(int r, int g, int b)
+{
+	return (uint8_t)(((112 * r - 102 * g - 10 * b + 128) >> 8) + 128);
+}
+
+
+// Scalar path - handles any width from column x onwards
+static void convertScalar(const uint8_t* row0, const uint8_t* row1, uint32_t x, uint32_t width, uint32_t red_shift,
+	uint8_t* luma0, uint8_t* luma1, uint8_t* cb, uint8_t* cr)
+{
+	const uint32_t r_index = red_shift / 8;
+	const uint32_t b_index = 2 - r_index;
+
+	for (; x < width; x += 2)
+	{
+		// Odd widths pair the last column with itself
+		uint32_t x1 = std::min(x + 1, width - 1);
+		const uint8_t* p[4] = { row0 + x * 4, row0 + x1 * 4, row1 + x * 4, row1 + x1 * 4 };
+
+		luma0[x] = lumaBT709(p[0][r_index], p[0][1], p[0][b_index]);
+		luma1[x] = lumaBT709(p[2][r_index], p[2][1], p[2][b_index]);
+		if (x1 != x)
+		{
+			luma0[x1] = lumaBT709(p[1][r_index], p[1][1], p[1][b_index]);
+			luma1[x1] = lumaBT709(p[3][r_index], p[3][1], p[3][b_index]);
+		}
+
+		int r = (p[0][r_index] + p[1][r_index] + p[2][r_index] + p[3][r_index] + 2) >> 2;
+		int g = (p[0][1] + p[1][1] + p[2][1] + p[3][1] + 2) >> 2;
+		int b = (p[0][b_index] + p[1][b_index] + p[2][b_index] + p[3][b_index] + 2) >> 2;
+		cb[x / 2] = cbBT709(r, g, b);
+		cr[x / 2] = crBT709(r, g, b);
+	}
+}
+
+
+#ifdef FRAME_EXPORT_X86
+
+// 8 pixels -> 16-bit R, G, B lanes
+__attribute__((target("sse2")))
+static inline void unpack8SSE2(const uint8_t* pixels, __m128i red_shift, __m128i blue_shift, __m128i& r, __m128i& g, __m128i& b)
+{
+	const __m128i mask = _mm_set1_epi32(0xFF);
+	__m128i lo = _mm_loadu_si128((const __m128i*)pixels);
+	__m128i hi = _mm_loadu_si128((const __m128i*)(pixels + 16));
+
+	r = _mm_packs_epi32(_mm_and_si128(_mm_srl_epi32(lo, red_shift), mask), _mm_and_si128(_mm_srl_epi32(hi, red_shift), mask));
+	g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 8), mask), _mm_and_si128(_mm_srli_epi32(hi, 8), mask));
+	b = _mm_packs_epi32(_mm_and_si128(_mm_srl_epi32(lo, blue_shift), mask), _mm_and_si128(_mm_srl_epi32(hi, blue_shift), mask));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i luma8SSE2(__m128i r, __m128i g, __m128i b)
+{
+	// Max weighted sum is 56100, fits unsigned 16-bit
+	__m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(47)), _mm_mullo_epi16(g, _mm_set1_epi16(157))),
+		_mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(16)), _mm_set1_epi16(128)));
+	return _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+}
+
+// Sum horizontal pairs of two 8-lane vectors -> 8 lanes
+__attribute__((target("sse2")))
+static inline __m128i pairSumSSE2(__m128i lo, __m128i hi)
+{
+	const __m128i ones = _mm_set1_epi16(1);
+	return _mm_packs_epi32(_mm_madd_epi16(lo, ones), _mm_madd_epi16(hi, ones));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i chromaSSE2(__m128i r, __m128i g, __m128i b, int cr_r, int cr_g, int cr_b)
+{
+	// Signed weighted sum stays within +-28560
+	__m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr_r)), _mm_mullo_epi16(g, _mm_set1_epi16(cr_g))),
+		_mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(cr_b)), _mm_set1_epi16(128)));
+	return _mm_add_epi16(_mm_srai_epi16(sum, 8), _mm_set1_epi16(128));
+}
+
+__attribute__((target("sse2")))
+static uint32_t convertSSE2(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint32_t red_shift,
+	uint8_t* luma0, uint8_t* luma1, uint8_t* cb, uint8_t* cr)
+{
+	const __m128i rs = _mm_cvtsi32_si128((int)red_shift);
+	const __m128i bs = _mm_cvtsi32_si128((int)(16 - red_shift));
+	const __m128i two = _mm_set1_epi16(2);
+
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i r[4], g[4], b[4];
+		unpack8SSE2(row0 + x * 4, rs, bs, r[0], g[0], b[0]);
+		unpack8SSE2(row0 + x * 4 + 32, rs, bs, r[1], g[1], b[1]);
+		unpack8SSE2(row1 + x * 4, rs, bs, r[2], g[2], b[2]);
+		unpack8SSE2(row1 + x * 4 + 32, rs, bs, r[3], g[3], b[3]);
+
+		_mm_storeu_si128((__m128i*)(luma0 + x), _mm_packus_epi16(luma8SSE2(r[0], g[0], b[0]), luma8SSE2(r[1], g[1], b[1])));
+		_mm_storeu_si128((__m128i*)(luma1 + x), _mm_packus_epi16(luma8SSE2(r[2], g[2], b[2]), luma8SSE2(r[3], g[3], b[3])));
+
+		// 2x2 box average
+		__m128i ra = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(pairSumSSE2(r[0], r[1]), pairSumSSE2(r[2], r[3])), two), 2);
+		__m128i ga = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(pairSumSSE2(g[0], g[1]), pairSumSSE2(g[2], g[3])), two), 2);
+		__m128i ba = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(pairSumSSE2(b[0], b[1]), pairSumSSE2(b[2], b[3])), two), 2);
+
+		__m128i zero = _mm_setzero_si128();
+		_mm_storel_epi64((__m128i*)(cb + x / 2), _mm_packus_epi16(chromaSSE2(ra, ga, ba, -26, -86, 112), zero));
+		_mm_storel_epi64((__m128i*)(cr + x / 2), _mm_packus_epi16(chromaSSE2(ra, ga, ba, 112, -102, -10), zero));
+	}
+	return x;
+}
+
+
+// AVX2 packs work per 128-bit lane, the permute restores pixel order
+#define AVX2_ORDER(v) _mm256_permute4x64_epi64((v), _MM_SHUFFLE(3, 1, 2, 0))
+
+__attribute__((target("avx2")))
+static inline void unpack16AVX2(const uint8_t* pixels, __m128i red_shift, __m128i blue_shift, __m256i& r, __m256i& g, __m256i& b)
+{
+	const __m256i mask = _mm256_set1_epi32(0xFF);
+	__m256i lo = _mm256_loadu_si256((const __m256i*)pixels);
+	__m256i hi = _mm256_loadu_si256((const __m256i*)(pixels + 32));
+
+	r = AVX2_ORDER(_mm256_packs_epi32(_mm256_and_si256(_mm256_srl_epi32(lo, red_shift), mask), _mm256_and_si256(_mm256_srl_epi32(hi, red_shift), mask)));
+	g = AVX2_ORDER(_mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(lo, 8), mask), _mm256_and_si256(_mm256_srli_epi32(hi, 8), mask)));
+	b = AVX2_ORDER(_mm256_packs_epi32(_mm256_and_si256(_mm256_srl_epi32(lo, blue_shift), mask), _mm256_and_si256(_mm256_srl_epi32(hi, blue_shift), mask)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i luma16AVX2(__m256i r, __m256i g, __m256i b)
+{
+	__m256i sum = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(47)), _mm256_mullo_epi16(g, _mm256_set1_epi16(157))),
+		_mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(16)), _mm256_set1_epi16(128)));
+	return _mm256_add_epi16(_mm256_srli_epi16(sum, 8), _mm256_set1_epi16(16));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i pairSumAVX2(__m256i lo, __m256i hi)
+{
+	const __m256i ones = _mm256_set1_epi16(1);
+	return AVX2_ORDER(_mm256_packs_epi32(_mm256_madd_epi16(lo, ones), _mm256_madd_epi16(hi, ones)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i chromaAVX2(__m256i r, __m256i g, __m256i b, int cr_r, int cr_g, int cr_b)
+{
+	__m256i sum = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(cr_r)), _mm256_mullo_epi16(g, _mm256_set1_epi16(cr_g))),
+		_mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(cr_b)), _mm256_set1_epi16(128)));
+	return _mm256_add_epi16(_mm256_srai_epi16(sum, 8), _mm256_set1_epi16(128));
+}
+
+__attribute__((target("avx2")))
+static uint32_t convertAVX2(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint32_t red_shift,
+	uint8_t* luma0, uint8_t* luma1, uint8_t* cb, uint8_t* cr)
+{
+	const __m128i rs = _mm_cvtsi32_si128((int)red_shift);
+	const __m128i bs = _mm_cvtsi32_si128((int)(16 - red_shift));
+	const __m256i two = _mm256_set1_epi16(2);
+
+	uint32_t x = 0;
+	for (; x + 32 <= width; x += 32)
+	{
+		__m256i r[4], g[4], b[4];
+		unpack16AVX2(row0 + x * 4, rs, bs, r[0], g[0], b[0]);
+		unpack16AVX2(row0 + x * 4 + 64, rs, bs, r[1], g[1], b[1]);
+		unpack16AVX2(row1 + x * 4, rs, bs, r[2], g[2], b[2]);
+		unpack16AVX2(row1 + x * 4 + 64, rs, bs, r[3], g[3], b[3]);
+
+		_mm256_storeu_si256((__m256i*)(luma0 + x), AVX2_ORDER(_mm256_packus_epi16(luma16AVX2(r[0], g[0], b[0]), luma16AVX2(r[1], g[1], b[1]))));
+		_mm256_storeu_si256((__m256i*)(luma1 + x), AVX2_ORDER(_mm256_packus_epi16(luma16AVX2(r[2], g[2], b[2]), luma16AVX2(r[3], g[3], b[3]))));
+
+		__m256i ra = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(pairSumAVX2(r[0], r[1]), pairSumAVX2(r[2], r[3])), two), 2);
+		__m256i ga = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(pairSumAVX2(g[0], g[1]), pairSumAVX2(g[2], g[3])), two), 2);
+		__m256i ba = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(pairSumAVX2(b[0], b[1]), pairSumAVX2(b[2], b[3])), two), 2);
+
+		// 16 chroma samples each, pack against zero and keep the low 128 bits in order
+		__m256i zero = _mm256_setzero_si256();
+		__m256i cb16 = AVX2_ORDER(_mm256_packus_epi16(chromaAVX2(ra, ga, ba, -26, -86, 112), zero));
+		__m256i cr16 = AVX2_ORDER(_mm256_packus_epi16(chromaAVX2(ra, ga, ba, 112, -102, -10), zero));
+		_mm_storeu_si128((__m128i*)(cb + x / 2), _mm256_castsi256_si128(cb16));
+		_mm_storeu_si128((__m128i*)(cr + x / 2), _mm256_castsi256_si128(cr16));
+	}
+	return x;
+}
+
+#endif
+
+
+void convertRowPairI420(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint32_t red_shift,
+	uint8_t* luma0, uint8_t* luma1, uint8_t* cb, uint8_t* cr)
+{
+	uint32_t x = 0;
+
+#ifdef FRAME_EXPORT_X86
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	static const bool has_sse2 = __builtin_cpu_supports("sse2");
+	if (has_avx2) x = convertAVX2(row0, row1, width, red_shift, luma0, luma1, cb, cr);
+	if (has_sse2) x += convertSSE2(row0 + x * 4, row1 + x * 4, width - x, red_shift, luma0 + x, luma1 + x, cb + x / 2, cr + x / 2);
+#endif
+
+	convertScalar(row0, row1, x, width, red_shift, luma0, luma1, cb, cr);
+}
+
+
+// Constructor & Deconstructors
+FrameExporter::FrameExporter()
+{
+}
+
+FrameExporter::~FrameExporter()
+{
+	finish();
+}
+
+
+bool FrameExporter::open(const std::string& path, ExportFormat export_format, uint32_t frames_per_second)
+{
+	format = export_format;
+	fps = frames_per_second;
+
+	if (path == "-")
+	{
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		output = stdout;
+		owns_output = false;
+	}
+	else
+	{
+		output = std::fopen(path.c_str(), "wb");
+		owns_output = true;
+	}
+
+	if (output == nullptr)
+	{
+		std::cout << "\n[!] Export Error - Unable to open " << path << "\n";
+		return false;
+	}
+
+	// Frames are written whole, a large buffer keeps syscalls sequential and few
+	std::setvbuf(output, nullptr, _IOFBF, EXPORT_WRITE_BUFFER);
+
+	// Leave one core for the render thread
+	uint32_t worker_count = std::max(1u, std::min((uint32_t)EXPORT_MAX_WORKERS, std::thread::hardware_concurrency() - 1));
+	packets.resize(worker_count + 2);
+
+	stopping = false;
+	for (uint32_t i = 0; i < worker_count; i++)
+	{
+		workers.emplace_back(&FrameExporter::workerLoop, this);
+	}
+	writer = std::thread(&FrameExporter::writerLoop, this);
+	return true;
+}
+
+
+void FrameExporter::submit(ReadbackRing& ring, const ReadbackRing::Frame& frame)
+{
+	switch (frame.format)
+	{
+	case VK_FORMAT_B8G8R8A8_SRGB:
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_R8G8B8A8_UNORM:
+		break;
+
+	default:
+		throw std::runtime_error("[!] Export Error - Unsupported swap chain format for export.");
+	}
+
+	// The worker reads straight from the mapped slot and releases it when done
+	ring.hold(frame.slot);
+
+	// Stream dimensions come from the first frame - fixed before any worker can read them, the queue lock publishes them
+	std::lock_guard<std::mutex> lock(mutex);
+	if (width == 0)
+	{
+		width = frame.extent.width;
+		height = frame.extent.height;
+	}
+	jobs.push_back({ &ring, frame, next_sequence++ });
+	job_ready.notify_one();
+}
+
+
+void FrameExporter::waitForRelease()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	slot_released.wait_for(lock, std::chrono::milliseconds(50));
+}
+
+
+void FrameExporter::finish()
+{
+	if (output == nullptr) return;
+
+	// Let queued jobs drain before the threads exit
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		slot_released.wait(lock, [this] { return write_sequence == next_sequence; });
+		stopping = true;
+	}
+	job_ready.notify_all();
+	packet_ready.notify_all();
+
+	for (auto& worker : workers) worker.join();
+	workers.clear();
+	writer.join();
+
+	std::fflush(output);
+	if (owns_output) std::fclose(output);
+	output = nullptr;
+
+	std::cerr << "\n[Export] " << frames_written << " frames written\n";
+}
+
+
+void FrameExporter::workerLoop()
+{
+	for (;;)
+	{
+		Job job;
+		Packet* packet;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			job_ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (jobs.empty()) return;
+
+			job = jobs.front();
+			jobs.pop_front();
+
+			// Wait until the writer has emptied this packet's previous occupant
+			packet = &packets[job.sequence % packets.size()];
+			slot_released.wait(lock, [&] { return job.sequence < write_sequence + packets.size(); });
+		}
+
+		convert(job.frame, *packet);
+		job.ring->release(job.frame.slot);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			packet->sequence = job.sequence;
+			packet->ready = true;
+		}
+		packet_ready.notify_all();
+		slot_released.notify_all();
+	}
+}
+
+
+void FrameExporter::writerLoop()
+{
+	for (;;)
+	{
+		Packet* packet;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			packet_ready.wait(lock, [this] {
+				Packet& next = packets[write_sequence % packets.size()];
+				return (next.ready && next.sequence == write_sequence) || (stopping && write_sequence == next_sequence);
+			});
+			if (stopping && write_sequence == next_sequence) return;
+
+			packet = &packets[write_sequence % packets.size()];
+		}
+
+		bool has_data = !packet->data.empty();
+		if (has_data)
+		{
+			if (!header_written) writeHeader(width, height);
+			std::fwrite(packet->data.data(), 1, packet->data.size(), output);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			packet->ready = false;
+			write_sequence++;
+			if (has_data) frames_written++;
+		}
+		slot_released.notify_all();
+	}
+}
+
+
+void FrameExporter::convert(const ReadbackRing::Frame& frame, Packet& packet)
+{
+	const uint32_t w = frame.extent.width;
+	const uint32_t h = frame.extent.height;
+	const uint32_t chroma_w = (w + 1) / 2;
+	const uint32_t chroma_h = (h + 1) / 2;
+	const uint32_t red_shift = (frame.format == VK_FORMAT_B8G8R8A8_SRGB || frame.format == VK_FORMAT_B8G8R8A8_UNORM) ? 16 : 0;
+
+	// Streams cannot change size - frames after a window resize are dropped
+	if (w != width || h != height)
+	{
+		packet.data.clear();
+		return;
+	}
+
+	// Y4M frames carry their own marker so the packet is one contiguous write
+	static const char marker[] = "FRAME\n";
+	size_t prefix = (format == ExportFormat::Y4M) ? sizeof(marker) - 1 : 0;
+	packet.data.resize(prefix + (size_t)w * h + 2 * (size_t)chroma_w * chroma_h);
+	std::memcpy(packet.data.data(), marker, prefix);
+
+	uint8_t* luma = packet.data.data() + prefix;
+	uint8_t* cb = luma + (size_t)w * h;
+	uint8_t* cr = cb + (size_t)chroma_w * chroma_h;
+
+	for (uint32_t y = 0; y < h; y += 2)
+	{
+		// Odd heights reuse the last row
+		uint32_t y1 = std::min(y + 1, h - 1);
+		const uint8_t* row0 = frame.pixels + (size_t)y * w * 4;
+		const uint8_t* row1 = frame.pixels + (size_t)y1 * w * 4;
+		uint8_t* luma1 = (y1 != y) ? luma + (size_t)y1 * w : luma + (size_t)y * w;
+
+		convertRowPairI420(row0, row1, w, red_shift, luma + (size_t)y * w, luma1,
+			cb + (size_t)(y / 2) * chroma_w, cr + (size_t)(y / 2) * chroma_w);
+	}
+}
+
+
+void FrameExporter::writeHeader(uint32_t frame_width, uint32_t frame_height)
+{
+	header_written = true;
+	if (format != ExportFormat::Y4M)
+	{
+		std::cerr << "\n[Export] raw I420 " << frame_width << "x" << frame_height << " @ " << fps
+			<< " - read with: -f rawvideo -pix_fmt yuv420p -s " << frame_width << "x" << frame_height << "\n";
+		return;
+	}
+
+	std::fprintf(output, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n", frame_width, frame_height, fps);
+}
@@ -0,0 +1,140 @@
+#include "FrameScheduler.h"
+#include "HostAllocator.h"
+
+#include <stdexcept>
+
+
+void FrameScheduler::create(VkDevice dev)
+{
+	device = dev;
+
+	VkSemaphoreTypeCreateInfo type_info{};
+	type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	type_info.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphore_info{};
+	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphore_info.pNext = &type_info;
+
+	for (uint32_t i = 0; i < (uint32_t)QueueKind::Count; i++)
+	{
+		values[i] = 0;
+		if (vkCreateSemaphore(device, &semaphore_info, hostAllocator(), &timelines[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[!] Scheduler Error - Failed to create timeline semaphore.");
+		}
+	}
+}
+
+
+void FrameScheduler::destroy()
+{
+	if (device == VK_NULL_HANDLE) return;
+
+	for (auto& timeline : timelines)
+	{
+		vkDestroySemaphore(device, timeline, hostAllocator());
+		timeline = VK_NULL_HANDLE;
+	}
+	device = VK_NULL_HANDLE;
+}
+
+
+FrameScheduler::WaitPoint FrameScheduler::after(QueueKind queue, uint64_t value, VkPipelineStageFlags stages) const
+{
+	return { timelines[index(queue)], value, stages };
+}
+
+
+FrameScheduler::WaitPoint FrameScheduler::binary(VkSemaphore semaphore, VkPipelineStageFlags stages)
+{
+	return { semaphore, 0, stages };
+}
+
+
+uint64_t FrameScheduler::submit(VkQueue queue, QueueKind kind, const VkCommandBuffer* command_buffers, uint32_t command_buffer_count,
+	const std::vector<WaitPoint>& waits, VkSemaphore binary_signal)
+{
+	// Split wait points into the parallel arrays VkSubmitInfo expects
+	std::vector<VkSemaphore> wait_semaphores;
+	std::vector<uint64_t> wait_values;
+	std::vector<VkPipelineStageFlags> wait_stages;
+	for (const auto& point : waits)
+	{
+		wait_semaphores.push_back(point.semaphore);
+		wait_values.push_back(point.value);
+		wait_stages.push_back(point.stages);
+	}
+
+	uint64_t value = ++values[index(kind)];
+	VkSemaphore signal_semaphores[] = { timelines[index(kind)], binary_signal };
+	uint64_t signal_values[] = { value, 0 };
+	uint32_t signal_count = binary_signal != VK_NULL_HANDLE ? 2 : 1;
+
+	VkTimelineSemaphoreSubmitInfo timeline_info{};
+	timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timeline_info.waitSemaphoreValueCount = static_cast<uint32_t>(wait_values.size());
+	timeline_info.pWaitSemaphoreValues = wait_values.data();
+	timeline_info.signalSemaphoreValueCount = signal_count;
+	timeline_info.pSignalSemaphoreValues = signal_values;
+
+	VkSubmitInfo submit_info{};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.pNext = &timeline_info;
+	submit_info.waitSemaphoreCount = static_cast<uint32_t>(wait_semaphores.size());
+	submit_info.pWaitSemaphores = wait_semaphores.data();
+	submit_info.pWaitDstStageMask = wait_stages.data();
+	submit_info.commandBufferCount = command_buffer_count;
+	submit_info.pCommandBuffers = command_buffers;
+	submit_info.signalSemaphoreCount = signal_count;
+	submit_info.pSignalSemaphores = signal_semaphores;
+
+	if (vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+	{
+		values[index(kind)]--;
+		throw std::runtime_error("[!] Scheduler Error - Failed to submit to queue.");
+	}
+	return value;
+}
+
+
+uint64_t FrameScheduler::completed(QueueKind queue) const
+{
+	uint64_t value = 0;
+	vkGetSemaphoreCounterValue(device, timelines[index(queue)], &value);
+	return value;
+}
+
+
+void FrameScheduler::wait(QueueKind queue, uint64_t value) const
+{
+	if (value == 0) return;
+
+	VkSemaphoreWaitInfo wait_info{};
+	wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	wait_info.semaphoreCount = 1;
+	wait_info.pSemaphores = &timelines[index(queue)];
+	wait_info.pValues = &value;
+
+	if (vkWaitSemaphores(device, &wait_info, UINT64_MAX) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Scheduler Error - Failed waiting on timeline semaphore.");
+	}
+}
+
+
+void FrameScheduler::waitIdle() const
+{
+	// Every timeline at once - unused ones wait on value 0, which is always reached
+	VkSemaphoreWaitInfo wait_info{};
+	wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	wait_info.semaphoreCount = (uint32_t)QueueKind::Count;
+	wait_info.pSemaphores = timelines;
+	wait_info.pValues = values;
+
+	if (vkWaitSemaphores(device, &wait_info, UINT64_MAX) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Scheduler Error - Failed waiting on timeline semaphores.");
+	}
+}
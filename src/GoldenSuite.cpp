@@ -0,0 +1,133 @@
+#include "GoldenSuite.h"
+
+
+#define GOLDEN_READBACK_SLOTS 3
+
+
+GoldenSuite::GoldenSuite(Renderer& r, const GoldenOptions& o) : renderer(r), options(o)
+{
+	if (options.output_dir.empty()) options.output_dir = options.reference_dir;
+
+	// Scene script - extend alongside renderer features
+	scenes = {
+		{ "triangle_black", { {0.0f, 0.0f, 0.0f, 1.0f} }, 3 },
+		{ "triangle_grey",  { {0.5f, 0.5f, 0.5f, 1.0f} }, 3 },
+		{ "triangle_blue",  { {0.1f, 0.2f, 0.6f, 1.0f} }, 3 },
+	};
+}
+
+
+int GoldenSuite::run()
+{
+	renderer.setHeadless(options.width, options.height);
+	renderer.initVulkan();
+	renderer.createReadback(GOLDEN_READBACK_SLOTS);
+
+	for (uint64_t i = 0; i < scenes.size(); i++)
+	{
+		renderer.clear_color = scenes[i].clear_color;
+
+		for (uint32_t f = 0; f < scenes[i].frames; f++)
+		{
+			// Capture the final frame of the scene, comparing earlier captures meanwhile
+			if (f + 1 == scenes[i].frames)
+			{
+				while (!renderer.requestReadback(i))
+				{
+					// Every slot in flight - wait for the oldest rather than skip a scene
+					renderer.scheduler.wait(QueueKind::Graphics, renderer.scheduler.submitted(QueueKind::Graphics));
+					renderer.completed_frame = renderer.frame_number;
+					collect();
+				}
+			}
+			renderer.drawFrame();
+			collect();
+		}
+	}
+
+	// Drain outstanding readbacks
+	vkDeviceWaitIdle(renderer.device);
+	renderer.completed_frame = renderer.frame_number;
+	collect();
+
+	renderer.deInitVulkan();
+
+	// Transform kernels - a SIMD path drifting from the scalar one moves every node, count it like a scene
+	if (SceneGraph::checkKernels())
+	{
+		std::cout << "[Golden] scene kernels: ok\n";
+		passed++;
+	}
+	else
+	{
+		std::cout << "[Golden] scene kernels: SIMD and scalar transforms differ\n";
+		failed++;
+	}
+
+	std::cout << "\n[Golden] " << passed << " passed, " << failed << " failed" << (options.update ? " (references updated)" : "") << "\n";
+	return (int)failed;
+}
+
+
+void GoldenSuite::collect()
+{
+	renderer.readback.collect(renderer.completed_frame, [this](const ReadbackRing::Frame& frame) { check(frame); });
+}
+
+
+void GoldenSuite::check(const ReadbackRing::Frame& frame)
+{
+	const Scene& scene = scenes[frame.tag];
+	std::string reference_path = options.reference_dir + "/" + scene.name + ".ppm";
+
+	// Update mode - the readback becomes the new reference
+	if (options.update)
+	{
+		if (writePPM(reference_path, frame.extent.width, frame.extent.height, frame.pixels)) passed++;
+		else
+		{
+			std::cout << "[Golden] " << scene.name << ": failed to write " << reference_path << "\n";
+			failed++;
+		}
+		return;
+	}
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector <uint8_t> expected;
+	if (!readPPM(reference_path, width, height, expected))
+	{
+		std::cout << "[Golden] " << scene.name << ": FAIL - missing reference " << reference_path << "\n";
+		failed++;
+		return;
+	}
+
+	if (width != frame.extent.width || height != frame.extent.height)
+	{
+		std::cout << "[Golden] " << scene.name << ": FAIL - reference is " << width << "x" << height
+			<< ", rendered " << frame.extent.width << "x" << frame.extent.height << "\n";
+		failed++;
+		return;
+	}
+
+	size_t pixel_count = (size_t)width * height;
+	heatmap.resize(pixel_count * 4);
+	ImageDiffResult result = diffImages(frame.pixels, expected.data(), pixel_count, options.tolerance, heatmap.data());
+
+	double ratio = (double)result.mismatched / (double)pixel_count;
+	if (ratio <= options.max_mismatch_ratio)
+	{
+		std::cout << "[Golden] " << scene.name << ": pass (max delta " << result.max_delta << ")\n";
+		passed++;
+		return;
+	}
+
+	// Keep the actual frame and heatmap next to the reference for inspection
+	std::string base = options.output_dir + "/" + scene.name;
+	writePPM(base + ".actual.ppm", width, height, frame.pixels);
+	writePPM(base + ".diff.ppm", width, height, heatmap.data());
+
+	std::cout << "[Golden] " << scene.name << ": FAIL - " << result.mismatched << " pixels over tolerance (max delta "
+		<< result.max_delta << "), see " << base << ".diff.ppm\n";
+	failed++;
+}
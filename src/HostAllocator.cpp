@@ -0,0 +1,344 @@
+#include "HostAllocator.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <iomanip>
+#include <thread>
+#include <algorithm>
+
+
+#define HOST_MIN_BLOCK 16					// Smallest size class, also the header size and base alignment
+
+enum : uint8_t
+{
+	SOURCE_HEAP = 0xFE,						// Too large for any class
+	SOURCE_ARENA = 0xFF						// Command scope arena
+};
+
+static const char* scope_names[HOST_SCOPE_COUNT] = { "command", "object", "cache", "device", "instance" };
+
+
+// Per-thread command arena - only the owning thread allocates, frees may arrive from anywhere
+//  - The first 16 bytes of memory point back at the arena, arena headers store their offset from there
+struct CommandArena
+{
+	std::atomic<uint32_t> outstanding{ 0 };
+	size_t offset = 0;
+	uint8_t* memory = nullptr;
+
+	~CommandArena()
+	{
+		// Command scope allocations never outlive their call, anything left means the thread died mid-call
+		if (outstanding.load() == 0) std::free(memory);
+	}
+};
+
+static thread_local CommandArena command_arena;
+
+
+static inline size_t alignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Block size that fits the header, alignment padding and payload
+static inline size_t blockSize(size_t size, size_t alignment)
+{
+	return HOST_MIN_BLOCK + size + (alignment > HOST_MIN_BLOCK ? alignment - HOST_MIN_BLOCK : 0);
+}
+
+// Payload position inside a 16-byte aligned block, header immediately before it
+static inline uint8_t* placePayload(uint8_t* block, size_t alignment)
+{
+	return reinterpret_cast<uint8_t*>(alignUp(reinterpret_cast<uintptr_t>(block) + HOST_MIN_BLOCK, std::max<size_t>(alignment, HOST_MIN_BLOCK)));
+}
+
+
+HostAllocator& HostAllocator::instance()
+{
+	static HostAllocator allocator;
+	return allocator;
+}
+
+
+HostAllocator::HostAllocator()
+{
+	static_assert(sizeof(Header) == HOST_MIN_BLOCK, "Header must fill the minimum alignment");
+
+	const char* setting = std::getenv("RENDERER_HOST_ALLOCATOR");
+	if (setting != nullptr && std::string(setting) == "0") enabled = false;
+
+	vk_callbacks.pUserData = this;
+	vk_callbacks.pfnAllocation = onAllocation;
+	vk_callbacks.pfnReallocation = onReallocation;
+	vk_callbacks.pfnFree = onFree;
+	vk_callbacks.pfnInternalAllocation = onInternalAllocation;
+	vk_callbacks.pfnInternalFree = onInternalFree;
+}
+
+
+HostAllocator::~HostAllocator()
+{
+	while (chunks != nullptr)
+	{
+		void* next = *static_cast<void**>(chunks);
+		std::free(chunks);
+		chunks = next;
+	}
+}
+
+
+void* HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	if (size == 0) return nullptr;
+
+	const uint8_t scope_index = static_cast<uint8_t>(std::min<uint32_t>(scope, HOST_SCOPE_COUNT - 1));
+	const size_t needed = blockSize(size, alignment);
+	uint8_t* block = nullptr;
+	size_t payload_start = 0;
+	uint8_t source = SOURCE_HEAP;
+
+	// Command scope - bump the thread's arena, rewound once everything in it is freed
+	if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND)
+	{
+		CommandArena& arena = command_arena;
+		if (arena.memory == nullptr)
+		{
+			arena.memory = static_cast<uint8_t*>(std::malloc(HOST_ARENA_SIZE));
+			if (arena.memory != nullptr) *reinterpret_cast<CommandArena**>(arena.memory) = &arena;
+		}
+		if (arena.outstanding.load(std::memory_order_acquire) == 0) arena.offset = HOST_MIN_BLOCK;
+
+		size_t start = alignUp(arena.offset, HOST_MIN_BLOCK);
+		if (arena.memory != nullptr && start + needed <= HOST_ARENA_SIZE)
+		{
+			block = arena.memory;										// Header offset is taken from the arena start
+			payload_start = start;
+			arena.offset = start + needed;
+			arena.outstanding.fetch_add(1, std::memory_order_relaxed);
+			source = SOURCE_ARENA;
+			counters[scope_index].arena.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	// Small - pop the size class free list
+	if (block == nullptr && needed <= (size_t)HOST_MIN_BLOCK << (HOST_POOL_CLASSES - 1))
+	{
+		uint32_t size_class = 0;
+		while (((size_t)HOST_MIN_BLOCK << size_class) < needed) size_class++;
+
+		SizeClass& pool = classes[size_class];
+		while (pool.lock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+		if (pool.free_list == nullptr)
+		{
+			pool.lock.clear(std::memory_order_release);
+			refill(size_class);
+			while (pool.lock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+		}
+		FreeBlock* taken = pool.free_list;
+		if (taken != nullptr) pool.free_list = taken->next;
+		pool.lock.clear(std::memory_order_release);
+
+		if (taken != nullptr)
+		{
+			block = reinterpret_cast<uint8_t*>(taken);
+			source = static_cast<uint8_t>(size_class);
+			counters[scope_index].pooled.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	// Large - straight to the heap, malloc guarantees the 16 byte base alignment on 64-bit targets
+	if (block == nullptr)
+	{
+		block = static_cast<uint8_t*>(std::malloc(needed));
+		if (block == nullptr) return nullptr;
+		source = SOURCE_HEAP;
+	}
+
+	uint8_t* payload = placePayload(block + payload_start, alignment);
+	Header* header = reinterpret_cast<Header*>(payload) - 1;
+	header->offset = static_cast<uint32_t>(payload - block);
+	header->source = source;
+	header->scope = scope_index;
+	header->reserved = 0;
+	header->size = size;
+
+	counters[scope_index].allocations.fetch_add(1, std::memory_order_relaxed);
+	track(scope_index, (int64_t)size, 1);
+	return payload;
+}
+
+
+void* HostAllocator::reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	if (original == nullptr) return allocate(size, alignment, scope);
+	if (size == 0)
+	{
+		release(original);
+		return nullptr;
+	}
+
+	const Header* header = static_cast<const Header*>(original) - 1;
+	void* moved = allocate(size, alignment, scope);
+	if (moved == nullptr) return nullptr;				// Original stays valid, as the spec requires
+
+	std::memcpy(moved, original, std::min<size_t>(size, header->size));
+	counters[header->scope].reallocations.fetch_add(1, std::memory_order_relaxed);
+	release(original);
+	return moved;
+}
+
+
+void HostAllocator::release(void* memory)
+{
+	if (memory == nullptr) return;
+
+	Header* header = static_cast<Header*>(memory) - 1;
+	uint8_t* block = static_cast<uint8_t*>(memory) - header->offset;
+	counters[header->scope].frees.fetch_add(1, std::memory_order_relaxed);
+	track(header->scope, -(int64_t)header->size, -1);
+
+	if (header->source == SOURCE_HEAP)
+	{
+		std::free(block);
+	}
+	else if (header->source == SOURCE_ARENA)
+	{
+		// The owner rewinds on its next allocation once this reaches zero
+		CommandArena* arena = *reinterpret_cast<CommandArena**>(block);
+		arena->outstanding.fetch_sub(1, std::memory_order_release);
+	}
+	else
+	{
+		SizeClass& pool = classes[header->source];
+		FreeBlock* freed = reinterpret_cast<FreeBlock*>(block);
+		while (pool.lock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+		freed->next = pool.free_list;
+		pool.free_list = freed;
+		pool.lock.clear(std::memory_order_release);
+	}
+}
+
+
+// Carve a fresh chunk into blocks of one class
+void HostAllocator::refill(uint32_t size_class)
+{
+	const size_t block_size = (size_t)HOST_MIN_BLOCK << size_class;
+	uint8_t* chunk = static_cast<uint8_t*>(std::malloc(HOST_POOL_CHUNK));
+	if (chunk == nullptr) return;
+
+	{
+		std::lock_guard<std::mutex> lock(chunk_mutex);
+		*reinterpret_cast<void**>(chunk) = chunks;
+		chunks = chunk;
+	}
+
+	// First block holds the chunk link
+	FreeBlock* head = nullptr;
+	for (size_t offset = HOST_POOL_CHUNK - block_size; offset >= block_size; offset -= block_size)
+	{
+		FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + offset);
+		block->next = head;
+		head = block;
+	}
+
+	FreeBlock* tail = head;
+	while (tail->next != nullptr) tail = tail->next;
+
+	SizeClass& pool = classes[size_class];
+	while (pool.lock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+	tail->next = pool.free_list;
+	pool.free_list = head;
+	pool.lock.clear(std::memory_order_release);
+}
+
+
+void HostAllocator::track(uint8_t scope, int64_t bytes, int64_t count)
+{
+	Counters& counter = counters[scope];
+	uint64_t live_bytes = counter.bytes.fetch_add((uint64_t)bytes, std::memory_order_relaxed) + (uint64_t)bytes;
+	uint64_t live_count = counter.count.fetch_add((uint64_t)count, std::memory_order_relaxed) + (uint64_t)count;
+	if (count < 0) return;
+
+	uint64_t peak = counter.peak_bytes.load(std::memory_order_relaxed);
+	while (live_bytes > peak && !counter.peak_bytes.compare_exchange_weak(peak, live_bytes, std::memory_order_relaxed)) {}
+	peak = counter.peak_count.load(std::memory_order_relaxed);
+	while (live_count > peak && !counter.peak_count.compare_exchange_weak(peak, live_count, std::memory_order_relaxed)) {}
+}
+
+
+const char* HostAllocator::scopeName(VkSystemAllocationScope scope)
+{
+	return scope_names[std::min<uint32_t>(scope, HOST_SCOPE_COUNT - 1)];
+}
+
+
+HostAllocator::ScopeStats HostAllocator::stats(VkSystemAllocationScope scope) const
+{
+	const Counters& counter = counters[std::min<uint32_t>(scope, HOST_SCOPE_COUNT - 1)];
+	ScopeStats result;
+	result.bytes = counter.bytes.load(std::memory_order_relaxed);
+	result.count = counter.count.load(std::memory_order_relaxed);
+	result.peak_bytes = counter.peak_bytes.load(std::memory_order_relaxed);
+	result.peak_count = counter.peak_count.load(std::memory_order_relaxed);
+	result.allocations = counter.allocations.load(std::memory_order_relaxed);
+	result.reallocations = counter.reallocations.load(std::memory_order_relaxed);
+	result.frees = counter.frees.load(std::memory_order_relaxed);
+	result.pooled = counter.pooled.load(std::memory_order_relaxed);
+	result.arena = counter.arena.load(std::memory_order_relaxed);
+	result.internal_bytes = counter.internal_bytes.load(std::memory_order_relaxed);
+	return result;
+}
+
+
+void HostAllocator::report(std::ostream& out) const
+{
+	if (!enabled)
+	{
+		out << "[Host Memory] Driver allocations untracked (RENDERER_HOST_ALLOCATOR=0)\n";
+		return;
+	}
+
+	out << "[Host Memory] scope      live B   live n   peak B   peak n    allocs  reallocs  pooled  arena  internal B\n";
+	for (uint32_t scope = 0; scope < HOST_SCOPE_COUNT; scope++)
+	{
+		ScopeStats s = stats(static_cast<VkSystemAllocationScope>(scope));
+		out << "[Host Memory] " << std::left << std::setw(8) << scope_names[scope] << std::right
+			<< std::setw(10) << s.bytes << std::setw(9) << s.count
+			<< std::setw(9) << s.peak_bytes << std::setw(9) << s.peak_count
+			<< std::setw(10) << s.allocations << std::setw(10) << s.reallocations
+			<< std::setw(8) << s.pooled << std::setw(7) << s.arena
+			<< std::setw(12) << s.internal_bytes << "\n";
+	}
+}
+
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::onAllocation(void* user, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	return static_cast<HostAllocator*>(user)->allocate(size, alignment, scope);
+}
+
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::onReallocation(void* user, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	return static_cast<HostAllocator*>(user)->reallocate(original, size, alignment, scope);
+}
+
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::onFree(void* user, void* memory)
+{
+	static_cast<HostAllocator*>(user)->release(memory);
+}
+
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::onInternalAllocation(void* user, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+{
+	static_cast<HostAllocator*>(user)->counters[std::min<uint32_t>(scope, HOST_SCOPE_COUNT - 1)].internal_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::onInternalFree(void* user, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+{
+	static_cast<HostAllocator*>(user)->counters[std::min<uint32_t>(scope, HOST_SCOPE_COUNT - 1)].internal_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
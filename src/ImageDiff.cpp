@@ -0,0 +1,206 @@
+#include "ImageDiff.h"
+
+#include <fstream>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define IMAGE_DIFF_X86 1
+#include <immintrin.h>
+#endif
+
+
+
+// Scalar path - also handles the tail of the SIMD loops
+static void diffScalar(const uint8_t* actual, const uint8_t* expected, size_t begin, size_t end, uint8_t tolerance, uint8_t* heatmap, ImageDiffResult& result)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		const uint8_t* a = actual + i * 4;
+		const uint8_t* e = expected + i * 4;
+
+		uint32_t delta = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			uint32_t d = (a[c] > e[c]) ? a[c] - e[c] : e[c] - a[c];
+			delta = std::max(delta, d);
+		}
+
+		if (delta > tolerance) result.mismatched++;
+		result.max_delta = std::max(result.max_delta, delta);
+
+		if (heatmap != nullptr)
+		{
+			// Dimmed reference for context, red channel carries the scaled error
+			uint8_t* h = heatmap + i * 4;
+			h[0] = e[0] >> 2;
+			h[1] = e[1] >> 2;
+			h[2] = (uint8_t)std::min(255u, (uint32_t)(e[2] >> 2) + std::min(255u, delta * 4));
+			h[3] = 255;
+		}
+	}
+}
+
+
+#ifdef IMAGE_DIFF_X86
+
+__attribute__((target("sse2")))
+static void diffSSE2(const uint8_t* actual, const uint8_t* expected, size_t count, uint8_t tolerance, uint8_t* heatmap, ImageDiffResult& result)
+{
+	const __m128i byte_mask = _mm_set1_epi32(0xFF);
+	const __m128i dim_mask = _mm_set1_epi8(0x3F);
+	const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+	const __m128i limit = _mm_set1_epi32(tolerance);
+	__m128i max_delta = _mm_setzero_si128();
+	uint64_t mismatched = 0;
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(actual + i * 4));
+		__m128i e = _mm_loadu_si128((const __m128i*)(expected + i * 4));
+
+		// |a - e| per byte, then max of B,G,R into the low byte of each pixel
+		__m128i d = _mm_or_si128(_mm_subs_epu8(a, e), _mm_subs_epu8(e, a));
+		__m128i m = _mm_max_epu8(d, _mm_srli_epi32(d, 8));
+		m = _mm_and_si128(_mm_max_epu8(m, _mm_srli_epi32(d, 16)), byte_mask);
+
+		__m128i over = _mm_cmpgt_epi32(m, limit);
+		mismatched += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(over)));
+		max_delta = _mm_max_epu8(max_delta, m);
+
+		if (heatmap != nullptr)
+		{
+			__m128i dim = _mm_and_si128(_mm_srli_epi16(e, 2), dim_mask);
+			__m128i red = _mm_slli_epi32(m, 16);
+			red = _mm_adds_epu8(red, red);
+			red = _mm_adds_epu8(red, red);
+			__m128i heat = _mm_or_si128(_mm_adds_epu8(dim, red), alpha);
+			_mm_storeu_si128((__m128i*)(heatmap + i * 4), heat);
+		}
+	}
+
+	alignas(16) uint8_t lanes[16];
+	_mm_store_si128((__m128i*)lanes, max_delta);
+	for (int l = 0; l < 16; l += 4) result.max_delta = std::max<uint32_t>(result.max_delta, lanes[l]);
+	result.mismatched += mismatched;
+
+	diffScalar(actual, expected, i, count, tolerance, heatmap, result);
+}
+
+
+__attribute__((target("avx2")))
+static void diffAVX2(const uint8_t* actual, const uint8_t* expected, size_t count, uint8_t tolerance, uint8_t* heatmap, ImageDiffResult& result)
+{
+	const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+	const __m256i dim_mask = _mm256_set1_epi8(0x3F);
+	const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+	const __m256i limit = _mm256_set1_epi32(tolerance);
+	__m256i max_delta = _mm256_setzero_si256();
+	uint64_t mismatched = 0;
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i*)(actual + i * 4));
+		__m256i e = _mm256_loadu_si256((const __m256i*)(expected + i * 4));
+
+		__m256i d = _mm256_or_si256(_mm256_subs_epu8(a, e), _mm256_subs_epu8(e, a));
+		__m256i m = _mm256_max_epu8(d, _mm256_srli_epi32(d, 8));
+		m = _mm256_and_si256(_mm256_max_epu8(m, _mm256_srli_epi32(d, 16)), byte_mask);
+
+		__m256i over = _mm256_cmpgt_epi32(m, limit);
+		mismatched += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(over)));
+		max_delta = _mm256_max_epu8(max_delta, m);
+
+		if (heatmap != nullptr)
+		{
+			__m256i dim = _mm256_and_si256(_mm256_srli_epi16(e, 2), dim_mask);
+			__m256i red = _mm256_slli_epi32(m, 16);
+			red = _mm256_adds_epu8(red, red);
+			red = _mm256_adds_epu8(red, red);
+			__m256i heat = _mm256_or_si256(_mm256_adds_epu8(dim, red), alpha);
+			_mm256_storeu_si256((__m256i*)(heatmap + i * 4), heat);
+		}
+	}
+
+	alignas(32) uint8_t lanes[32];
+	_mm256_store_si256((__m256i*)lanes, max_delta);
+	for (int l = 0; l < 32; l += 4) result.max_delta = std::max<uint32_t>(result.max_delta, lanes[l]);
+	result.mismatched += mismatched;
+
+	diffScalar(actual, expected, i, count, tolerance, heatmap, result);
+}
+
+#endif
+
+
+ImageDiffResult diffImages(const uint8_t* actual, const uint8_t* expected, size_t pixel_count, uint8_t tolerance, uint8_t* heatmap)
+{
+	ImageDiffResult result;
+
+#ifdef IMAGE_DIFF_X86
+	// Pick the widest kernel the CPU supports
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	static const bool has_sse2 = __builtin_cpu_supports("sse2");
+	if (has_avx2)
+	{
+		diffAVX2(actual, expected, pixel_count, tolerance, heatmap, result);
+		return result;
+	}
+	if (has_sse2)
+	{
+		diffSSE2(actual, expected, pixel_count, tolerance, heatmap, result);
+		return result;
+	}
+#endif
+
+	diffScalar(actual, expected, 0, pixel_count, tolerance, heatmap, result);
+	return result;
+}
+
+
+bool readPPM(const std::string& path, uint32_t& width, uint32_t& height, std::vector<uint8_t>& bgra)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return false;
+
+	// Header - magic, width, height, max value, single whitespace byte
+	std::string magic;
+	uint32_t max_value = 0;
+	file >> magic >> width >> height >> max_value;
+	file.get();
+	if (!file || magic != "P6" || max_value != 255) return false;
+
+	std::vector<uint8_t> rgb((size_t)width * height * 3);
+	file.read(reinterpret_cast<char*>(rgb.data()), rgb.size());
+	if (!file) return false;
+
+	bgra.resize((size_t)width * height * 4);
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		bgra[i * 4 + 0] = rgb[i * 3 + 2];
+		bgra[i * 4 + 1] = rgb[i * 3 + 1];
+		bgra[i * 4 + 2] = rgb[i * 3 + 0];
+		bgra[i * 4 + 3] = 255;
+	}
+	return true;
+}
+
+
+bool writePPM(const std::string& path, uint32_t width, uint32_t height, const uint8_t* bgra)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) return false;
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+
+	std::vector<uint8_t> rgb((size_t)width * height * 3);
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		rgb[i * 3 + 0] = bgra[i * 4 + 2];
+		rgb[i * 3 + 1] = bgra[i * 4 + 1];
+		rgb[i * 3 + 2] = bgra[i * 4 + 0];
+	}
+	file.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+	return (bool)file;
+}
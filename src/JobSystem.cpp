@@ -0,0 +1,302 @@
+#include "JobSystem.h"
+
+#include <stdexcept>
+
+
+// Worker identity of the current thread - -1 outside any pool
+static thread_local const JobSystem* current_pool = nullptr;
+static thread_local int32_t current_worker = -1;
+
+
+void FrameArena::create(size_t bytes)
+{
+	memory.reset(new uint8_t[bytes]);
+	size = bytes;
+	offset.store(0, std::memory_order_relaxed);
+	high_water = 0;
+}
+
+
+void FrameArena::destroy()
+{
+	memory.reset();
+	size = 0;
+	offset.store(0, std::memory_order_relaxed);
+}
+
+
+void* FrameArena::allocate(size_t bytes, size_t alignment)
+{
+	// Reserve the worst case padding so the bump stays a single atomic add
+	size_t start = offset.fetch_add(bytes + alignment - 1, std::memory_order_relaxed);
+	size_t aligned = (reinterpret_cast<uintptr_t>(memory.get()) + start + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	aligned -= reinterpret_cast<uintptr_t>(memory.get());
+
+	if (aligned + bytes > size)
+	{
+		throw std::runtime_error("[!] Arena Error - Frame arena exhausted, raise its size.");
+	}
+	return memory.get() + aligned;
+}
+
+
+void FrameArena::reset()
+{
+	high_water = std::max(high_water, used());
+	offset.store(0, std::memory_order_relaxed);
+}
+
+
+bool JobSystem::WorkDeque::push(JobTask* task)
+{
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	if (b - t >= JOB_DEQUE_SIZE) return false;
+
+	slots[b & (JOB_DEQUE_SIZE - 1)].store(task, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+	return true;
+}
+
+
+JobTask* JobSystem::WorkDeque::pop()
+{
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+
+	if (t > b)
+	{
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	JobTask* task = slots[b & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+	if (t == b)
+	{
+		// Last task - race thieves for it
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) task = nullptr;
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return task;
+}
+
+
+JobTask* JobSystem::WorkDeque::steal()
+{
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+	if (t >= b) return nullptr;
+
+	JobTask* task = slots[t & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+	return task;
+}
+
+
+void JobSystem::start(uint32_t worker_count)
+{
+	if (running.load()) return;
+
+	uint32_t count = worker_count;
+	if (count == 0)
+	{
+		uint32_t hardware = std::max(1u, std::thread::hardware_concurrency());
+		count = hardware - 1;
+	}
+	count = std::min(count, (uint32_t)JOB_MAX_WORKERS);
+
+	deques.reset(new WorkDeque[std::max(count, 1u)]);
+	worker_count = count;
+	running.store(true);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+
+void JobSystem::stop()
+{
+	if (!running.exchange(false)) return;
+
+	wake(true);
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+	worker_count = 0;
+	deques.reset();
+}
+
+
+void JobSystem::submit(JobTask* task)
+{
+	// Stopped pool, or one with no workers to hand the task to - run it here
+	if (!running.load(std::memory_order_relaxed) || worker_count == 0)
+	{
+		execute(task);
+		return;
+	}
+
+	if (current_pool == this && current_worker >= 0)
+	{
+		if (!deques[current_worker].push(task)) execute(task);
+		else wake(false);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(inject_mutex);
+		if (inject_tail - inject_head < JOB_INJECT_SIZE)
+		{
+			inject[inject_tail++ & (JOB_INJECT_SIZE - 1)] = task;
+			task = nullptr;
+		}
+	}
+
+	// Full injection queue - the submitter does the work itself
+	if (task != nullptr) execute(task);
+	else wake(false);
+}
+
+
+void JobSystem::execute(JobTask* task)
+{
+	task->function(task->data);
+	if (task->signal != nullptr) release(*task->signal);
+}
+
+
+// Finished one task of the counter - the last one publishes its continuations
+//  - The decrement happens under the lock so a waiter that saw zero can tell when the counter is no longer touched
+void JobSystem::release(JobCounter& counter)
+{
+	while (counter.lock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+	JobTask* ready = nullptr;
+	if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		ready = counter.continuations;
+		counter.continuations = nullptr;
+	}
+	counter.lock.clear(std::memory_order_release);
+
+	while (ready != nullptr)
+	{
+		JobTask* next = ready->next;
+		ready->next = nullptr;
+		submit(ready);
+		ready = next;
+	}
+}
+
+
+JobTask* JobSystem::popInjected()
+{
+	std::lock_guard<std::mutex> lock(inject_mutex);
+	if (inject_head == inject_tail) return nullptr;
+	return inject[inject_head++ & (JOB_INJECT_SIZE - 1)];
+}
+
+
+// Own deque first (newest, cache warm), then the injection queue, then the oldest task of another worker
+JobTask* JobSystem::findTask(int32_t self)
+{
+	if (self >= 0)
+	{
+		if (JobTask* task = deques[self].pop()) return task;
+	}
+	if (JobTask* task = popInjected()) return task;
+
+	uint32_t count = workerCount();
+	uint32_t first = self >= 0 ? (uint32_t)self + 1 : 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t victim = (first + i) % count;
+		if ((int32_t)victim == self) continue;
+		if (JobTask* task = deques[victim].steal())
+		{
+			steals.fetch_add(1, std::memory_order_relaxed);
+			return task;
+		}
+	}
+	return nullptr;
+}
+
+
+void JobSystem::wait(JobCounter& counter)
+{
+	int32_t self = (current_pool == this) ? current_worker : -1;
+	while (!counter.done())
+	{
+		JobTask* task = running.load(std::memory_order_relaxed) ? findTask(self) : nullptr;
+		if (task != nullptr) execute(task);
+		else std::this_thread::yield();
+	}
+
+	// The last release may still hold the lock - the counter can go out of scope once it is free
+	while (counter.lock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+	counter.lock.clear(std::memory_order_release);
+}
+
+
+void JobSystem::wake(bool all)
+{
+	if (sleepers.load(std::memory_order_seq_cst) == 0 && !all) return;
+
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		epoch++;
+	}
+	if (all) sleep_cv.notify_all();
+	else sleep_cv.notify_one();
+}
+
+
+void JobSystem::workerLoop(uint32_t index)
+{
+	current_pool = this;
+	current_worker = (int32_t)index;
+
+	uint32_t idle_rounds = 0;
+	while (running.load(std::memory_order_relaxed))
+	{
+		if (JobTask* task = findTask((int32_t)index))
+		{
+			execute(task);
+			idle_rounds = 0;
+			continue;
+		}
+
+		if (++idle_rounds < JOB_SPIN_ROUNDS)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// Sleep until new work is published - re-check after registering so a push in between is not missed
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		uint64_t seen = epoch;
+		sleepers.fetch_add(1, std::memory_order_seq_cst);
+		lock.unlock();
+
+		JobTask* task = findTask((int32_t)index);
+		lock.lock();
+		if (task == nullptr)
+		{
+			sleep_cv.wait(lock, [&]() { return epoch != seen || !running.load(std::memory_order_relaxed); });
+		}
+		sleepers.fetch_sub(1, std::memory_order_seq_cst);
+		lock.unlock();
+
+		if (task != nullptr) execute(task);
+		idle_rounds = 0;
+	}
+
+	current_pool = nullptr;
+	current_worker = -1;
+}
@@ -0,0 +1,252 @@
+#include "Metrics.h"
+
+#include <stdexcept>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET NativeSocket;
+#define METRICS_INVALID_SOCKET INVALID_SOCKET
+#define closeSocket closesocket
+#define pollSockets WSAPoll
+#define METRICS_SEND_FLAGS 0
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+typedef int NativeSocket;
+#define METRICS_INVALID_SOCKET (-1)
+#define closeSocket close
+#define pollSockets poll
+#define METRICS_SEND_FLAGS MSG_NOSIGNAL				// A scraper hanging up must not kill the renderer
+#endif
+
+
+// Frame times around 60 / 120 / 144 Hz land in separate buckets
+const double MetricsHistogram::BOUNDS[METRICS_BUCKET_COUNT] = { 0.001, 0.002, 0.004, 0.007, 0.0085, 0.0175, 0.034, 0.05, 0.1, 0.25 };
+
+
+void MetricsHistogram::observe(double seconds)
+{
+	uint32_t index = 0;
+	while (index < METRICS_BUCKET_COUNT && seconds > BOUNDS[index]) index++;
+
+	buckets[index].fetch_add(1, std::memory_order_relaxed);
+	samples.fetch_add(1, std::memory_order_relaxed);
+	sum_ns.fetch_add(seconds > 0.0 ? (uint64_t)(seconds * 1e9) : 0, std::memory_order_relaxed);
+}
+
+
+void MetricsWriter::declare(const char* name, const char* help, const char* type)
+{
+	out += "# HELP ";
+	out += name;
+	out += " ";
+	out += help;
+	out += "\n# TYPE ";
+	out += name;
+	out += " ";
+	out += type;
+	out += "\n";
+}
+
+
+void MetricsWriter::sample(const char* name, double value, const char* labels)
+{
+	char line[256];
+	if (labels != nullptr) std::snprintf(line, sizeof(line), "%s{%s} %.15g\n", name, labels, value);
+	else std::snprintf(line, sizeof(line), "%s %.15g\n", name, value);
+	out += line;
+}
+
+
+void MetricsWriter::counter(const char* name, const char* help, double value, const char* labels)
+{
+	declare(name, help, "counter");
+	sample(name, value, labels);
+}
+
+
+void MetricsWriter::gauge(const char* name, const char* help, double value, const char* labels)
+{
+	declare(name, help, "gauge");
+	sample(name, value, labels);
+}
+
+
+void MetricsWriter::histogram(const char* name, const char* help, const MetricsHistogram& histogram)
+{
+	declare(name, help, "histogram");
+
+	std::string bucket_name = std::string(name) + "_bucket";
+	char labels[32];
+	uint64_t cumulative = 0;
+	for (uint32_t i = 0; i < METRICS_BUCKET_COUNT; i++)
+	{
+		cumulative += histogram.bucket(i);
+		std::snprintf(labels, sizeof(labels), "le=\"%g\"", MetricsHistogram::BOUNDS[i]);
+		sample(bucket_name.c_str(), (double)cumulative, labels);
+	}
+
+	// +Inf must equal _count, so both come from the same pass over the buckets
+	cumulative += histogram.bucket(METRICS_BUCKET_COUNT);
+	sample(bucket_name.c_str(), (double)cumulative, "le=\"+Inf\"");
+	sample((std::string(name) + "_sum").c_str(), histogram.sum(), nullptr);
+	sample((std::string(name) + "_count").c_str(), (double)cumulative, nullptr);
+}
+
+
+void MetricsServer::start(const std::string& endpoint, std::function<void(std::string&)> snapshot)
+{
+	if (running.load()) return;
+
+	// Digits only - loopback TCP port, anything else is a socket path
+	bool is_port = !endpoint.empty() && endpoint.find_first_not_of("0123456789") == std::string::npos;
+
+#ifdef _WIN32
+	WSADATA wsa_data;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+	{
+		throw std::runtime_error("[!] Metrics Error - Winsock unavailable.");
+	}
+	if (!is_port)
+	{
+		WSACleanup();
+		throw std::runtime_error("[!] Metrics Error - Unix sockets are not supported here, use a port number.");
+	}
+#endif
+
+	NativeSocket listener = METRICS_INVALID_SOCKET;
+	int bound = -1;
+	if (is_port)
+	{
+		listener = socket(AF_INET, SOCK_STREAM, 0);
+		if (listener != METRICS_INVALID_SOCKET)
+		{
+			int reuse = 1;
+			setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+			sockaddr_in address{};
+			address.sin_family = AF_INET;
+			address.sin_port = htons((uint16_t)std::atoi(endpoint.c_str()));
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);			// Never reachable off the machine
+			bound = bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+		}
+	}
+#ifndef _WIN32
+	else
+	{
+		sockaddr_un address{};
+		if (endpoint.size() >= sizeof(address.sun_path))
+		{
+			throw std::runtime_error("[!] Metrics Error - Socket path too long: " + endpoint);
+		}
+
+		listener = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listener != METRICS_INVALID_SOCKET)
+		{
+			// A stale socket from a crashed run would fail the bind
+			unlink(endpoint.c_str());
+			address.sun_family = AF_UNIX;
+			std::memcpy(address.sun_path, endpoint.c_str(), endpoint.size() + 1);
+			bound = bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+			socket_path = endpoint;
+		}
+	}
+#endif
+
+	if (listener == METRICS_INVALID_SOCKET || bound != 0 || listen(listener, 4) != 0)
+	{
+		if (listener != METRICS_INVALID_SOCKET) closeSocket(listener);
+		socket_path.clear();
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		throw std::runtime_error("[!] Metrics Error - Unable to listen on " + endpoint);
+	}
+
+	listen_socket = (intptr_t)listener;
+	write_snapshot = snapshot;
+	running.store(true);
+	server_thread = std::thread(&MetricsServer::serveLoop, this);
+}
+
+
+void MetricsServer::stop()
+{
+	if (!running.exchange(false)) return;
+
+	server_thread.join();
+	closeSocket((NativeSocket)listen_socket);
+	listen_socket = -1;
+
+#ifdef _WIN32
+	WSACleanup();
+#else
+	if (!socket_path.empty()) unlink(socket_path.c_str());
+#endif
+	socket_path.clear();
+}
+
+
+// Accept with a timeout so stop() is noticed without closing the socket under the thread
+void MetricsServer::serveLoop()
+{
+	while (running.load(std::memory_order_relaxed))
+	{
+		pollfd listener{};
+		listener.fd = (NativeSocket)listen_socket;
+		listener.events = POLLIN;
+		if (pollSockets(&listener, 1, METRICS_POLL_MS) <= 0 || !(listener.revents & POLLIN)) continue;
+
+		NativeSocket client = accept((NativeSocket)listen_socket, nullptr, nullptr);
+		if (client == METRICS_INVALID_SOCKET) continue;
+
+		respond((intptr_t)client);
+		closeSocket(client);
+	}
+}
+
+
+void MetricsServer::respond(intptr_t client)
+{
+	// Drain whatever request arrives in time - the path is ignored, every request gets the metrics
+	pollfd request{};
+	request.fd = (NativeSocket)client;
+	request.events = POLLIN;
+	char discard[1024];
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(METRICS_REQUEST_MS);
+	while (std::chrono::steady_clock::now() < deadline)
+	{
+		int remaining = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		if (pollSockets(&request, 1, std::max(remaining, 0)) <= 0) break;
+		int received = (int)recv((NativeSocket)client, discard, sizeof(discard), 0);
+		if (received <= 0) break;
+
+		// End of the request headers
+		std::string chunk(discard, received);
+		if (chunk.find("\r\n\r\n") != std::string::npos || chunk.find("\n\n") != std::string::npos) break;
+	}
+
+	std::string body;
+	body.reserve(8192);
+	write_snapshot(body);
+	scrapes.fetch_add(1, std::memory_order_relaxed);
+
+	std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+	size_t sent = 0;
+	while (sent < response.size())
+	{
+		int written = (int)send((NativeSocket)client, response.data() + sent, (int)(response.size() - sent), METRICS_SEND_FLAGS);
+		if (written <= 0) break;
+		sent += (size_t)written;
+	}
+}
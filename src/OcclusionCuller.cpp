@@ -0,0 +1,388 @@
+#include "OcclusionCuller.h"
+#include "HostAllocator.h"
+#include "VulkanHelpers.h"
+#include "ShaderVariants.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+
+void OcclusionCuller::create(VkDevice dev, VkPhysicalDevice physical)
+{
+	device = dev;
+	physical_device = physical;
+
+	// Depth must be both an attachment and sampled by the reduction
+	VkFormatProperties depth_properties;
+	vkGetPhysicalDeviceFormatProperties(physical_device, DEPTH_FORMAT, &depth_properties);
+	VkFormatFeatureFlags depth_features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+	if ((depth_properties.optimalTilingFeatures & depth_features) != depth_features)
+	{
+		throw std::runtime_error("[!] Occlusion Error - Depth format cannot be sampled on this device.");
+	}
+
+	// Texels are fetched, never filtered
+	VkSamplerCreateInfo sampler_create_info{};
+	sampler_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	sampler_create_info.magFilter = VK_FILTER_NEAREST;
+	sampler_create_info.minFilter = VK_FILTER_NEAREST;
+	sampler_create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.maxLod = (float)OCCLUSION_MAX_LEVELS;
+
+	if (vkCreateSampler(device, &sampler_create_info, hostAllocator(), &sampler) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Occlusion Error - Failed to create pyramid sampler.");
+	}
+}
+
+
+void OcclusionCuller::createPipelines(VkDescriptorSetLayout instance_layout, VkShaderModule select_shader, VkShaderModule reduce_shader, VkShaderModule test_shader)
+{
+	// Set 1 - sampled source (depth or a pyramid level), storage destination level
+	VkDescriptorSetLayoutBinding bindings[2]{};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo set_layout_create_info{};
+	set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	set_layout_create_info.bindingCount = 2;
+	set_layout_create_info.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(device, &set_layout_create_info, hostAllocator(), &pyramid_layout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Occlusion Error - Failed to create pyramid set layout.");
+	}
+
+	// Set 0 is the instance set, so the lists and counts are shared with the draws
+	VkDescriptorSetLayout set_layouts[2] = { instance_layout, pyramid_layout };
+	VkPushConstantRange push_range{};
+	push_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	push_range.offset = 0;
+	push_range.size = sizeof(PushConstants);
+
+	VkPipelineLayoutCreateInfo layout_create_info{};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layout_create_info.setLayoutCount = 2;
+	layout_create_info.pSetLayouts = set_layouts;
+	layout_create_info.pushConstantRangeCount = 1;
+	layout_create_info.pPushConstantRanges = &push_range;
+
+	if (vkCreatePipelineLayout(device, &layout_create_info, hostAllocator(), &layout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Occlusion Error - Failed to create pipeline layout.");
+	}
+
+	// Workgroup sizes are specialized from the same constants the dispatches divide by
+	SpecializationConstants group;
+	group.set(0, (uint32_t)OCCLUSION_GROUP_SIZE);
+	SpecializationConstants tile;
+	tile.set(0, (uint32_t)OCCLUSION_TILE_SIZE).set(1, (uint32_t)OCCLUSION_TILE_SIZE);
+
+	select_pipeline = createPipeline(select_shader, group.info());
+	reduce_pipeline = createPipeline(reduce_shader, tile.info());
+	test_pipeline = createPipeline(test_shader, group.info());
+}
+
+
+void OcclusionCuller::destroy()
+{
+	vkDestroySampler(device, sampler, hostAllocator());
+	vkDestroyPipeline(device, select_pipeline, hostAllocator());
+	vkDestroyPipeline(device, reduce_pipeline, hostAllocator());
+	vkDestroyPipeline(device, test_pipeline, hostAllocator());
+	vkDestroyPipelineLayout(device, layout, hostAllocator());
+	vkDestroyDescriptorSetLayout(device, pyramid_layout, hostAllocator());
+	sampler = VK_NULL_HANDLE;
+	select_pipeline = reduce_pipeline = test_pipeline = VK_NULL_HANDLE;
+	layout = VK_NULL_HANDLE;
+	pyramid_layout = VK_NULL_HANDLE;
+}
+
+
+void OcclusionCuller::createTarget(OcclusionTarget& target, VkExtent2D extent, bool pyramid)
+{
+	target.extent = extent;
+	createImage(DEPTH_FORMAT, extent, 1, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, target.depth_image, target.depth_memory);
+	target.depth_view = createView(target.depth_image, DEPTH_FORMAT, VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1);
+	if (!pyramid) return;
+
+	// Half resolution, down to a single texel
+	target.pyramid_extent = { std::max(1u, extent.width / 2), std::max(1u, extent.height / 2) };
+	target.levels = 1;
+	while (target.levels < OCCLUSION_MAX_LEVELS && (std::max(target.pyramid_extent.width, target.pyramid_extent.height) >> target.levels) > 0) target.levels++;
+
+	createImage(PYRAMID_FORMAT, target.pyramid_extent, target.levels, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, target.pyramid_image, target.pyramid_memory);
+	target.pyramid_view = createView(target.pyramid_image, PYRAMID_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, target.levels);
+	target.level_views.resize(target.levels);
+	for (uint32_t i = 0; i < target.levels; i++)
+	{
+		target.level_views[i] = createView(target.pyramid_image, PYRAMID_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, i, 1);
+	}
+
+	// One set per reduction step plus the test set
+	const uint32_t set_count = target.levels + 1;
+	VkDescriptorPoolSize pool_sizes[2]{};
+	pool_sizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pool_sizes[0].descriptorCount = set_count;
+	pool_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	pool_sizes[1].descriptorCount = set_count;
+
+	VkDescriptorPoolCreateInfo pool_create_info{};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets = set_count;
+	pool_create_info.poolSizeCount = 2;
+	pool_create_info.pPoolSizes = pool_sizes;
+
+	if (vkCreateDescriptorPool(device, &pool_create_info, hostAllocator(), &target.pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Occlusion Error - Failed to create pyramid descriptor pool.");
+	}
+
+	std::vector<VkDescriptorSetLayout> set_layouts(set_count, pyramid_layout);
+	std::vector<VkDescriptorSet> sets(set_count);
+	VkDescriptorSetAllocateInfo set_alloc_info{};
+	set_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	set_alloc_info.descriptorPool = target.pool;
+	set_alloc_info.descriptorSetCount = set_count;
+	set_alloc_info.pSetLayouts = set_layouts.data();
+
+	if (vkAllocateDescriptorSets(device, &set_alloc_info, sets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Occlusion Error - Failed to allocate pyramid descriptor sets.");
+	}
+	target.reduce_sets.assign(sets.begin(), sets.begin() + target.levels);
+	target.test_set = sets[target.levels];
+
+	// Level i reads depth or level i - 1 - the test reads every level and never touches its storage binding
+	std::vector<VkDescriptorImageInfo> image_infos(set_count * 2);
+	std::vector<VkWriteDescriptorSet> writes(set_count * 2);
+	for (uint32_t s = 0; s < set_count; s++)
+	{
+		VkDescriptorImageInfo& source = image_infos[s * 2];
+		VkDescriptorImageInfo& destination = image_infos[s * 2 + 1];
+		if (s == target.levels) source = { sampler, target.pyramid_view, VK_IMAGE_LAYOUT_GENERAL };
+		else if (s == 0) source = { sampler, target.depth_view, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+		else source = { sampler, target.level_views[s - 1], VK_IMAGE_LAYOUT_GENERAL };
+		destination = { VK_NULL_HANDLE, target.level_views[std::min(s, target.levels - 1)], VK_IMAGE_LAYOUT_GENERAL };
+
+		for (uint32_t b = 0; b < 2; b++)
+		{
+			VkWriteDescriptorSet& write = writes[s * 2 + b];
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = sets[s];
+			write.dstBinding = b;
+			write.descriptorCount = 1;
+			write.descriptorType = b == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			write.pImageInfo = &image_infos[s * 2 + b];
+		}
+	}
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+
+void OcclusionCuller::retireTarget(OcclusionTarget& target, DeletionQueue& retired, uint64_t frame)
+{
+	for (VkImageView view : target.level_views)
+	{
+		retired.retire(DeletionQueue::IMAGE_VIEW, view, frame);
+	}
+	retired.retire(DeletionQueue::DESCRIPTOR_POOL, target.pool, frame);
+	retired.retire(DeletionQueue::IMAGE_VIEW, target.pyramid_view, frame);
+	retired.retire(DeletionQueue::IMAGE, target.pyramid_image, frame);
+	retired.retire(DeletionQueue::MEMORY, target.pyramid_memory, frame);
+	retired.retire(DeletionQueue::IMAGE_VIEW, target.depth_view, frame);
+	retired.retire(DeletionQueue::IMAGE, target.depth_image, frame);
+	retired.retire(DeletionQueue::MEMORY, target.depth_memory, frame);
+	target = OcclusionTarget{};
+}
+
+
+void OcclusionCuller::destroyTarget(OcclusionTarget& target)
+{
+	for (VkImageView view : target.level_views)
+	{
+		vkDestroyImageView(device, view, hostAllocator());
+	}
+	vkDestroyDescriptorPool(device, target.pool, hostAllocator());
+	vkDestroyImageView(device, target.pyramid_view, hostAllocator());
+	vkDestroyImage(device, target.pyramid_image, hostAllocator());
+	vkFreeMemory(device, target.pyramid_memory, hostAllocator());
+	vkDestroyImageView(device, target.depth_view, hostAllocator());
+	vkDestroyImage(device, target.depth_image, hostAllocator());
+	vkFreeMemory(device, target.depth_memory, hostAllocator());
+	target = OcclusionTarget{};
+}
+
+
+// Phase 1 list - last frame's visible instances that survived this frame's frustum cull
+void OcclusionCuller::recordSelect(VkCommandBuffer command_buffer, VkDescriptorSet instance_set, VkBuffer phase_buffer, uint32_t vertex_count, uint32_t capacity)
+{
+	// Earlier readers of the lists and counts - the previous window in this submit - finish before the reset
+	VkMemoryBarrier reset{};
+	reset.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	reset.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	reset.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &reset, 0, nullptr, 0, nullptr);
+
+	// Both phase draws start empty, the shaders count instances in
+	VkDrawIndirectCommand draws[2] = { { vertex_count, 0, 0, 0 }, { vertex_count, 0, 0, 0 } };
+	vkCmdUpdateBuffer(command_buffer, phase_buffer, 0, sizeof(draws), draws);
+
+	VkMemoryBarrier counted{};
+	counted.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	counted.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	counted.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &counted, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, select_pipeline);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &instance_set, 0, nullptr);
+	PushConstants push = { 0, capacity, { 1.0f, 1.0f } };
+	vkCmdPushConstants(command_buffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+	vkCmdDispatch(command_buffer, (capacity + OCCLUSION_GROUP_SIZE - 1) / OCCLUSION_GROUP_SIZE, 1, 1);
+
+	VkMemoryBarrier listed{};
+	listed.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	listed.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	listed.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &listed, 0, nullptr, 0, nullptr);
+}
+
+
+// Farthest depth per texel, level by level - phase 1's render pass leaves depth read-only for this
+void OcclusionCuller::recordPyramid(VkCommandBuffer command_buffer, OcclusionTarget& target)
+{
+	// Every level is rewritten, last frame's contents are discarded
+	VkImageMemoryBarrier discard{};
+	discard.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	discard.srcAccessMask = 0;
+	discard.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	discard.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	discard.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	discard.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	discard.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	discard.image = target.pyramid_image;
+	discard.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, target.levels, 0, 1 };
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &discard);
+
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, reduce_pipeline);
+	for (uint32_t level = 0; level < target.levels; level++)
+	{
+		uint32_t width = std::max(1u, target.pyramid_extent.width >> level);
+		uint32_t height = std::max(1u, target.pyramid_extent.height >> level);
+
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 1, 1, &target.reduce_sets[level], 0, nullptr);
+		vkCmdDispatch(command_buffer, (width + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE, (height + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE, 1);
+
+		// The next level, or the test, reads this one
+		VkImageMemoryBarrier reduced = discard;
+		reduced.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		reduced.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		reduced.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		reduced.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &reduced);
+	}
+}
+
+
+// Phase 2 list and next frame's visibility - every frustum survivor against the pyramid
+void OcclusionCuller::recordTest(VkCommandBuffer command_buffer, VkDescriptorSet instance_set, OcclusionTarget& target, VkExtent2D render_extent, uint32_t capacity)
+{
+	VkDescriptorSet sets[2] = { instance_set, target.test_set };
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, test_pipeline);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 2, sets, 0, nullptr);
+	PushConstants push = { target.levels, capacity, { (float)render_extent.width / (float)target.extent.width, (float)render_extent.height / (float)target.extent.height } };
+	vkCmdPushConstants(command_buffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+	vkCmdDispatch(command_buffer, (capacity + OCCLUSION_GROUP_SIZE - 1) / OCCLUSION_GROUP_SIZE, 1, 1);
+
+	VkMemoryBarrier listed{};
+	listed.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	listed.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	listed.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		0, 1, &listed, 0, nullptr, 0, nullptr);
+}
+
+
+void OcclusionCuller::createImage(VkFormat format, VkExtent2D extent, uint32_t levels, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& memory)
+{
+	VkImageCreateInfo image_create_info{};
+	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.imageType = VK_IMAGE_TYPE_2D;
+	image_create_info.format = format;
+	image_create_info.extent = { extent.width, extent.height, 1 };
+	image_create_info.mipLevels = levels;
+	image_create_info.arrayLayers = 1;
+	image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.usage = usage;
+	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(device, &image_create_info, hostAllocator(), &image) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Occlusion Error - Failed to create image.");
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(device, image, &requirements);
+
+	VkMemoryAllocateInfo alloc_info{};
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = requirements.size;
+	alloc_info.memoryTypeIndex = findMemoryType(physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (alloc_info.memoryTypeIndex == UINT32_MAX || vkAllocateMemory(device, &alloc_info, hostAllocator(), &memory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Occlusion Error - Failed to allocate image memory.");
+	}
+	vkBindImageMemory(device, image, memory, 0);
+}
+
+
+VkImageView OcclusionCuller::createView(VkImage image, VkFormat format, VkImageAspectFlags aspect, uint32_t base_level, uint32_t level_count)
+{
+	VkImageViewCreateInfo view_create_info{};
+	view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_create_info.image = image;
+	view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_create_info.format = format;
+	view_create_info.subresourceRange = { aspect, base_level, level_count, 0, 1 };
+
+	VkImageView view = VK_NULL_HANDLE;
+	if (vkCreateImageView(device, &view_create_info, hostAllocator(), &view) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Occlusion Error - Failed to create image view.");
+	}
+	return view;
+}
+
+
+VkPipeline OcclusionCuller::createPipeline(VkShaderModule shader, const VkSpecializationInfo* specialization)
+{
+	VkComputePipelineCreateInfo pipeline_create_info{};
+	pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipeline_create_info.stage.module = shader;
+	pipeline_create_info.stage.pName = "main";
+	pipeline_create_info.stage.pSpecializationInfo = specialization;
+	pipeline_create_info.layout = layout;
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_create_info, hostAllocator(), &pipeline) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Occlusion Error - Failed to create compute pipeline.");
+	}
+	return pipeline;
+}
@@ -0,0 +1,66 @@
+#include "PostChain.h"
+
+
+void PostChain::setEnabled(PostEffect effect, bool enabled)
+{
+	uint32_t bit = 1u << (uint32_t)effect;
+	uint32_t previous = enabled ? mask.fetch_or(bit) : mask.fetch_and(~bit);
+	if ((previous & bit) != (enabled ? bit : 0u)) dirty.store(true, std::memory_order_release);
+}
+
+
+void PostChain::toggle(PostEffect effect)
+{
+	mask.fetch_xor(1u << (uint32_t)effect);
+	dirty.store(true, std::memory_order_release);
+}
+
+
+bool PostChain::isEnabled(PostEffect effect) const
+{
+	return (mask.load(std::memory_order_acquire) >> (uint32_t)effect) & 1u;
+}
+
+
+bool PostChain::consumeDirty()
+{
+	return dirty.exchange(false, std::memory_order_acq_rel);
+}
+
+
+std::vector <PostEffect> PostChain::activeEffects() const
+{
+	std::vector <PostEffect> effects;
+	uint32_t current = mask.load(std::memory_order_acquire);
+	for (uint32_t i = 0; i < (uint32_t)PostEffect::Count; i++)
+	{
+		if (current & (1u << i)) effects.push_back((PostEffect)i);
+	}
+	return effects;
+}
+
+
+const char* PostChain::name(PostEffect effect)
+{
+	switch (effect)
+	{
+	case PostEffect::Tonemap:	return "tonemap";
+	case PostEffect::Grade:		return "grade";
+	case PostEffect::Vignette:	return "vignette";
+	default:					return "unknown";
+	}
+}
+
+
+bool PostChain::parse(const std::string& value, PostEffect& effect)
+{
+	for (uint32_t i = 0; i < (uint32_t)PostEffect::Count; i++)
+	{
+		if (value == name((PostEffect)i))
+		{
+			effect = (PostEffect)i;
+			return true;
+		}
+	}
+	return false;
+}
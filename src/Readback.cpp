@@ -0,0 +1,202 @@
+#include "Readback.h"
+#include "HostAllocator.h"
+#include "VulkanHelpers.h"
+
+#include <stdexcept>
+
+
+void ReadbackRing::create(VkDevice dev, VkPhysicalDevice physical_device, uint32_t slot_count, VkDeviceSize size)
+{
+	device = dev;
+	slot_size = size;
+	slots.resize(slot_count);
+	states.reset(new std::atomic<uint8_t>[slot_count]);
+	for (uint32_t i = 0; i < slot_count; i++)
+	{
+		states[i].store(SLOT_FREE, std::memory_order_relaxed);
+	}
+
+	for (auto& slot : slots)
+	{
+		// Transfer destination buffer
+		VkBufferCreateInfo buffer_create_info{};
+		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_create_info.size = slot_size;
+		buffer_create_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(device, &buffer_create_info, hostAllocator(), &slot.buffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[!] Readback Error - Failed to create readback buffer.");
+		}
+
+		VkMemoryRequirements requirements;
+		vkGetBufferMemoryRequirements(device, slot.buffer, &requirements);
+
+		// Prefer cached memory for fast CPU reads, fall back to coherent
+		uint32_t memory_type = findMemoryType(physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+		coherent = false;
+		if (memory_type == UINT32_MAX)
+		{
+			memory_type = findMemoryType(physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			coherent = true;
+		}
+		if (memory_type == UINT32_MAX)
+		{
+			throw std::runtime_error("[!] Readback Error - No host visible memory type.");
+		}
+
+		VkMemoryAllocateInfo alloc_info{};
+		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		alloc_info.allocationSize = requirements.size;
+		alloc_info.memoryTypeIndex = memory_type;
+
+		if (vkAllocateMemory(device, &alloc_info, hostAllocator(), &slot.memory) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[!] Readback Error - Failed to allocate readback memory.");
+		}
+		vkBindBufferMemory(device, slot.buffer, slot.memory, 0);
+
+		// Map once for the lifetime of the ring
+		void* mapped = nullptr;
+		if (vkMapMemory(device, slot.memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[!] Readback Error - Failed to map readback memory.");
+		}
+		slot.mapped = static_cast<uint8_t*>(mapped);
+	}
+}
+
+
+void ReadbackRing::destroy()
+{
+	for (auto& slot : slots)
+	{
+		if (slot.memory != VK_NULL_HANDLE) vkUnmapMemory(device, slot.memory);
+		vkDestroyBuffer(device, slot.buffer, hostAllocator());
+		vkFreeMemory(device, slot.memory, hostAllocator());
+	}
+	slots.clear();
+}
+
+
+int32_t ReadbackRing::acquire(uint64_t frame, uint64_t tag)
+{
+	// Round robin keeps slot reuse as far apart as possible
+	for (uint32_t n = 0; n < slots.size(); n++)
+	{
+		uint32_t index = (next_slot + n) % slots.size();
+		if (states[index].load(std::memory_order_acquire) == SLOT_FREE)
+		{
+			states[index].store(SLOT_PENDING, std::memory_order_relaxed);
+			slots[index].frame = frame;
+			slots[index].tag = tag;
+			next_slot = (index + 1) % slots.size();
+			return (int32_t)index;
+		}
+	}
+
+	skipped++;
+	return -1;
+}
+
+
+void ReadbackRing::recordCopy(VkCommandBuffer command_buffer, uint32_t slot_index, VkImage image, VkImageLayout layout, VkFormat format, VkExtent2D extent)
+{
+	Slot& slot = slots[slot_index];
+	if ((VkDeviceSize)extent.width * extent.height * 4 > slot_size)
+	{
+		throw std::runtime_error("[!] Readback Error - Image does not fit in readback slot.");
+	}
+	slot.extent = extent;
+	slot.format = format;
+
+	// Move image into transfer source layout when the render pass left it elsewhere
+	VkImageMemoryBarrier to_transfer{};
+	to_transfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	to_transfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	to_transfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	to_transfer.oldLayout = layout;
+	to_transfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	to_transfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	to_transfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	to_transfer.image = image;
+	to_transfer.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &to_transfer);
+
+	// Copy whole image into the slot
+	VkBufferImageCopy region{};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { extent.width, extent.height, 1 };
+
+	vkCmdCopyImageToBuffer(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+	// Make the copy visible to host reads
+	VkBufferMemoryBarrier to_host{};
+	to_host.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	to_host.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	to_host.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	to_host.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	to_host.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	to_host.buffer = slot.buffer;
+	to_host.offset = 0;
+	to_host.size = VK_WHOLE_SIZE;
+
+	// Restore the layout the presentation engine expects
+	VkImageMemoryBarrier restore{};
+	restore.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	restore.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	restore.dstAccessMask = 0;
+	restore.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	restore.newLayout = layout;
+	restore.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	restore.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	restore.image = image;
+	restore.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	uint32_t image_barrier_count = (layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) ? 0 : 1;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		0, 0, nullptr, 1, &to_host, image_barrier_count, &restore);
+}
+
+
+void ReadbackRing::hold(uint32_t slot)
+{
+	states[slot].store(SLOT_HELD, std::memory_order_release);
+}
+
+
+void ReadbackRing::release(uint32_t slot)
+{
+	states[slot].store(SLOT_FREE, std::memory_order_release);
+}
+
+
+uint32_t ReadbackRing::pendingCount() const
+{
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < slots.size(); i++)
+	{
+		if (states[i].load(std::memory_order_acquire) != SLOT_FREE) count++;
+	}
+	return count;
+}
+
+
+void ReadbackRing::invalidate(Slot& slot)
+{
+	if (coherent) return;
+
+	VkMappedMemoryRange range{};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = slot.memory;
+	range.offset = 0;
+	range.size = VK_WHOLE_SIZE;
+	vkInvalidateMappedMemoryRanges(device, 1, &range);
+}
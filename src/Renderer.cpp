@@ -1,9 +1,51 @@
 #include "Renderer.h"
 
 
+// Base triangle - UVs are the barycentric corner colors, see shader_base.vert
+static const Vertex TRIANGLE_VERTICES[3] = {
+	{ { 0.0f, -0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f } },
+	{ { 0.5f, 0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f } },
+	{ { -0.5f, 0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } }
+};
+
+
+
 // Constructor & Deconstructors
 Renderer::Renderer()
 {
+	// Validation tier can be chosen at runtime without rebuilding
+	const char* tier = std::getenv("RENDERER_VALIDATION");
+	if (tier != nullptr)
+	{
+		std::string value(tier);
+		if (value == "off" || value == "0") setValidationTier(ValidationTier::Off);
+		else if (value == "errors") setValidationTier(ValidationTier::ErrorsOnly);
+		else if (value == "full") setValidationTier(ValidationTier::Full);
+		else std::cout << "\n[!] Unknown RENDERER_VALIDATION value '" << value << "', using defaults.\n";
+	}
+
+	// Async compute can be switched off to measure the overlap
+	const char* async = std::getenv("RENDERER_ASYNC_COMPUTE");
+	if (async != nullptr) setAsyncCompute(std::string(async) != "0");
+
+	// Occlusion culling can be switched off to compare against frustum culling alone
+	const char* occlusion_env = std::getenv("RENDERER_OCCLUSION");
+	if (occlusion_env != nullptr) setOcclusionCulling(std::string(occlusion_env) != "0");
+
+	// GPU frame budget in milliseconds - enables dynamic resolution
+	const char* budget = std::getenv("RENDERER_FRAME_BUDGET_MS");
+	if (budget != nullptr) setFrameBudget(std::atof(budget));
+
+	// Metrics endpoint for production runs, where no debugger can attach
+	const char* endpoint = std::getenv("RENDERER_METRICS");
+	if (endpoint != nullptr) setMetricsEndpoint(endpoint);
+
+	// Main window - always present, extra viewports are added with addWindow()
+	RenderWindow main_window;
+	main_window.title = "Vulkan Renderer";
+	main_window.width = WINDOW_WIDTH;
+	main_window.height = WINDOW_HEIGHT;
+	windows.push_back(main_window);
 	//initVulkan();
 }
 
@@ -13,784 +55,2808 @@ Renderer::~Renderer()
 }
 
 
-// Initializers & Deinitializers
-void Renderer::initVulkan()
+void Renderer::setValidationTier(ValidationTier tier)
 {
-	createWindow();
-	createInstance();
-	createDebugMessenger();
-	createSurface();
-	createPhysicalDevice();
-	createLogicalDevice();
-	createSwapChain();
-	createImageViews();
-	createRenderPass();
-	createGraphicsPipeline();
-	createFrameBuffers();
-	createCommandPool();
-	createCommandBuffer();
-	createSyncObjects();
+	validation_tier = tier;
+	enableValidationLayers = (tier != ValidationTier::Off);
 }
 
 
-void Renderer::deInitVulkan()
+void Renderer::setHeadless(uint32_t width, uint32_t height)
 {
-	// Destroy Sync objects
-	vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
-	vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
-	vkDestroyFence(device, inFlightFence, nullptr);
-
-	// Destroy Command Pool
-	vkDestroyCommandPool(device, commandPool, nullptr);
+	headless = true;
 
-	// Destroy Frame Buffers
-	for (auto framebuffer : swapChainFrameBuffers) {
-		vkDestroyFramebuffer(device, framebuffer, nullptr);
-	}
+	// A single offscreen target replaces every window
+	windows.resize(1);
+	windows[0].width = width;
+	windows[0].height = height;
 
-	// Destroy Graphics pipeline
-	vkDestroyPipeline(device, graphicsPipeline, nullptr);
+	// No presentation, so no swap chain extension either
+	deviceExtensions.clear();
+}
 
-	// Destroy Pipeline layout
-	vkDestroyPipelineLayout(device, pipelineLayout, nullptr); 
 
-	// Destroy the Render Pass
-	vkDestroyRenderPass(device, render_pass, nullptr);
+void Renderer::setAsyncCompute(bool enabled)
+{
+	async_compute = enabled;
+}
 
-	// Destroy Image Views
-	for (auto imageView : swapChainImageViews) 
-	{
-		vkDestroyImageView(device, imageView, nullptr);
-	}
 
-	// Destroy Swap Chain
-	vkDestroySwapchainKHR(device, swap_chain, nullptr);
+void Renderer::addComputePass(const AsyncCompute::Pass& pass)
+{
+	compute.addPass(pass);
+}
 
-	// Destroy device
-	vkDestroyDevice(device, nullptr);
-	device = VK_NULL_HANDLE;
 
-	// Destroy Debugger Report
-	if (enableValidationLayers)
+void Renderer::addWindow(const std::string& title, uint32_t width, uint32_t height)
+{
+	if (device != VK_NULL_HANDLE)
 	{
-		destroyDebugMessengerEXT(instance, debug_messenger, nullptr);
-		debug_report = VK_NULL_HANDLE;
+		throw std::runtime_error("[!] Window Error - Windows must be added before initVulkan().");
+		std::exit(-1);
 	}
 
-	// Destroy Surface
-	vkDestroySurfaceKHR(instance, surface, nullptr);
+	RenderWindow target;
+	target.title = title;
+	target.width = width;
+	target.height = height;
+	target.view = static_cast<uint32_t>(windows.size());
+	windows.push_back(target);
+}
 
-	// Destroy Instance
-	vkDestroyInstance(instance, nullptr);
-	instance = nullptr;
 
-	// Destroy SDL Window and Quit SDL
-	SDL_DestroyWindow(window);
-	void SDL_Quit(void);
+void Renderer::setPostEffect(PostEffect effect, bool enabled)
+{
+	post_chain.setEnabled(effect, enabled);
 }
 
 
-void Renderer::eventHandler()
+void Renderer::setScene(SceneGraph* scene_graph)
 {
-	bool run = true;
-	while (run)
-	{
-		// Get SDL Events
-		if (SDL_PollEvent(&event))
-		{
-			// Event Categories
-			switch (event.type)
-			{
-				case SDL_QUIT:
-					run = false;
+	scene = scene_graph;
+}
 
-				default:
-					break;
-			}
-		}
-		// Draw Frame
-		void drawFrame();
-	}
-	vkDeviceWaitIdle(device);
+
+void Renderer::setCamera(const Mat4& view_projection)
+{
+	camera = view_projection;
+	camera_view = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+	camera_projection = view_projection;
 }
 
 
-// SDL Window Initializaiton and Creation
-void Renderer::createWindow()
+void Renderer::setCamera(const Mat4& view, const Mat4& projection)
 {
-	// Initialize SDL 
-	SDL_Init(SDL_INIT_VIDEO);
-	window = SDL_CreateWindow("Vulkan Renderer", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_VULKAN);
+	camera = multiplyMatrix(projection, view);
+	camera_view = view;
+	camera_projection = projection;
+}
+
 
-	if (window == nullptr)
+void Renderer::setLights(const Light* light_list, uint32_t count)
+{
+	if (count > CLUSTER_MAX_LIGHTS)
 	{
-		throw std::runtime_error("\n[!] SDL Error: Unable to initilaize SDL window.\n");
+		throw std::runtime_error("[!] Lighting Error - " + std::to_string(count) + " lights, at most " + std::to_string(CLUSTER_MAX_LIGHTS) + " are binned.");
 		std::exit(-1);
 	}
+	lights.assign(light_list, light_list + count);
+	lights_dirty = true;
 }
 
 
-// Create a Vulkan Instance
-void Renderer::createInstance()
+void Renderer::setAmbientLight(float r, float g, float b)
 {
-	// Get all Instance Layers
-	uint32_t layer_count = 0;
-	vkEnumerateInstanceLayerProperties(&layer_count, nullptr);
-	std::vector<VkLayerProperties> layer_properties(layer_count);
-	vkEnumerateInstanceLayerProperties(&layer_count, layer_properties.data());
+	ambient_light[0] = r;
+	ambient_light[1] = g;
+	ambient_light[2] = b;
+	lights_dirty = true;
+}
 
 
-	// Check to ensure Support for Validation Layers
-	if (enableValidationLayers && !checkValidationLayers())
+void Renderer::setOcclusionCulling(bool enabled)
+{
+	if (device != VK_NULL_HANDLE)
 	{
-		throw std::runtime_error("\n[!] Validation Error: layers Requested but NOT Found.");
+		throw std::runtime_error("[!] Occlusion Error - Occlusion culling must be chosen before initVulkan().");
 		std::exit(-1);
 	}
+	occlusion_culling = enabled;
+}
 
-	// Set Application Info
-	VkApplicationInfo application {};
-	application.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-	application.pApplicationName = "Vulkan Renderer Prototype";
-	application.apiVersion = VK_API_VERSION_1_0;
-	application.applicationVersion = VK_MAKE_VERSION(0, 1, 0);
-	application.pEngineName = "No Engine";
-
-	// Instantiate Vulkan from Application Info and SDL Extensions
-	VkInstanceCreateInfo create_info {};
-	create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-	create_info.pApplicationInfo = &application;
-	checkSDLExtensions();
-	create_info.enabledExtensionCount = static_cast<uint32_t>(SDL_extensions.size());
-	create_info.ppEnabledExtensionNames = SDL_extensions.data();
 
-	// Validate Instance Layers
-	VkDebugUtilsMessengerCreateInfoEXT debug_create_info{};
-	if (enableValidationLayers)
-	{
-		create_info.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-		create_info.ppEnabledLayerNames = validationLayers.data();
+void Renderer::setDebugBounds(bool enabled)
+{
+	debug_bounds = enabled;
+}
 
-		insertDebugInfo(debug_create_info);
-		create_info.pNext = (VkDebugUtilsMessengerCreateInfoEXT*) &debug_create_info;
-	}
-	else 
-	{
-		create_info.enabledLayerCount = 0;
-		create_info.pNext = nullptr;
-	}
 
-	// Instance Error Handling
-	if (errorHandler(vkCreateInstance(&create_info, nullptr, &instance)) != VK_SUCCESS)
+void Renderer::setVertexLayout(VertexLayout layout)
+{
+	if (device != VK_NULL_HANDLE)
 	{
-		throw std::runtime_error("[!] Failed to Create a Vulkan Instance.");
+		throw std::runtime_error("[!] Mesh Error - Vertex layout must be chosen before initVulkan().");
 		std::exit(-1);
 	}
+	vertex_layout = layout;
 }
 
 
-// Check for Validation Layers Support in Instance
-bool Renderer::checkValidationLayers()
+void Renderer::setFrameBudget(double milliseconds)
 {
-	// Get Instance Layer Property Enums for iteration
-	uint32_t layerCount;
-	vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
-	std::vector <VkLayerProperties> availableLayers(layerCount);
-	vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+	frame_budget_ms = std::max(milliseconds, 0.0);
+}
 
-	bool layerFound = false;
 
-	// Check Validation Layers
-	for (const char* layerName : validationLayers)
-	{
-		layerFound = false;
-		// Iterate and Check through Layer Layers
-		for (const auto& layerProperties : availableLayers)
-		{
-			if (strcmp(layerName, layerProperties.layerName) == 0)
-			{
-				layerFound = true;
-				break;
-			}
-		}
-		if (!layerFound)
-		{
-			std::cout << "\n[!] " << layerName << " Validation Layer NOT Found\n";
-			return false;
-		}
-	}
-	return true;
+void Renderer::setUpscaleSharpness(float sharpness)
+{
+	upscale_sharpness = std::max(sharpness, 0.0f);
 }
 
 
-// Connect SDL Extensions to Vulkan Application
-void Renderer::checkSDLExtensions()
+void Renderer::addTexture(const std::string& path)
 {
-	// Get SDL Extensions required to make Surface in Vulkan
-	uint32_t extension_count = 0;
-	SDL_Vulkan_GetInstanceExtensions(window, &extension_count, nullptr);
-	SDL_extensions.resize(extension_count);
-	SDL_Vulkan_GetInstanceExtensions(window, &extension_count, SDL_extensions.data());
-
-	if (enableValidationLayers)
+	if (device != VK_NULL_HANDLE)
 	{
-		SDL_extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+		throw std::runtime_error("[!] Texture Error - Textures must be added before initVulkan().");
+		std::exit(-1);
 	}
+	texture_paths.push_back(path);
 }
 
 
-// Initialize Debug Messenger Extension
-VkResult Renderer::createDebugMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger)
+// Picking uses the bounds culled last frame - scene nodes added since are not hit
+bool Renderer::pick(const Ray& ray, NodeId& node)
 {
-	auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
-	if (func != nullptr)
-	{
-		return func(instance, pCreateInfo, pAllocator, pDebugMessenger);
-	}
-	else
-	{
-		return VK_ERROR_EXTENSION_NOT_PRESENT;
-	};
+	uint32_t instance = 0;
+	float t = 0.0f;
+	if (scene == nullptr || bvh.objectCount() != scene->size() || !bvh.raycast(ray, instance, t)) return false;
+
+	node = scene->nodeAt(instance);
+	return true;
 }
 
 
-// Destroy Debug Messenger Extension
-void Renderer::destroyDebugMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator)
+void Renderer::setPreferredDevice(const std::string& name)
 {
-	auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
-	if (func != nullptr) {
-		func(instance, debugMessenger, pAllocator);
-	}
+	preferred_device = name;
 }
 
 
-// Vulkan Debug Callback Function
-static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData)
+void Renderer::setExporter(FrameExporter* frame_exporter)
 {
-	std::cerr << "\nDebug Callback - Validation layer: " << pCallbackData->pMessage << std::endl;
-	return VK_FALSE;
+	exporter = frame_exporter;
 }
 
 
-// Initialize Debugger
-void Renderer::createDebugMessenger()
+void Renderer::setAssetPack(const std::string& path)
 {
-	if (!enableValidationLayers) return;
-	
-	VkDebugUtilsMessengerCreateInfoEXT create_info{};
-	insertDebugInfo(create_info);
-	create_info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-	create_info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-	create_info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-	create_info.pfnUserCallback = debugCallback;  
+	if (device != VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("[!] Asset Error - The asset pack must be set before initVulkan().");
+		std::exit(-1);
+	}
+	asset_pack_path = path;
+}
+
 
-	if (createDebugMessengerEXT(instance, &create_info, nullptr, &debug_messenger) != VK_SUCCESS)
+void Renderer::setCapture(const std::string& path, uint32_t frame_count)
+{
+	if (device != VK_NULL_HANDLE)
 	{
-		throw std::runtime_error("[!] Failed to setup Debug messenger.");
+		throw std::runtime_error("[!] Trace Error - Capture must be set up before initVulkan().");
 		std::exit(-1);
 	}
+	capture_path = path;
+	capture_frames = std::max(frame_count, 1u);
+}
+
 
+void Renderer::setMetricsEndpoint(const std::string& endpoint)
+{
+	metrics_endpoint = endpoint;
 }
 
-// Create and Initialize Debug Messenger
-void Renderer::insertDebugInfo(VkDebugUtilsMessengerCreateInfoEXT& info)
+
+// Offline rendering - no events, frames are drawn back to back
+void Renderer::runOffline(uint32_t frame_count)
 {
-	info = {};
-	info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-	info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-	info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-	info.pfnUserCallback = debugCallback;
+	for (uint32_t i = 0; i < frame_count; i++)
+	{
+		drawFrame();
+	}
+
+	vkDeviceWaitIdle(device);
+	if (exporter != nullptr) finishExport();
 }
 
 
-// Setup physical device & queue families for initialization
-void Renderer::createPhysicalDevice()
+// Re-issues a captured trace as fast as the device allows - with more than one loop the first warms up and is not reported
+//  - CPU time is drawFrame() after the previous frame has landed, GPU time comes from the timestamps around each submit
+void Renderer::runReplay(const std::string& path, uint32_t loops)
 {
-	// Get Physical Device - GPU
-	uint32_t gpu_count = 0;
-	vkEnumeratePhysicalDevices(instance, &gpu_count, nullptr);
-	std::vector<VkPhysicalDevice> physical_devices(gpu_count);
-	vkEnumeratePhysicalDevices(instance, &gpu_count, physical_devices.data());
-	
-	// Physical Device Not Found Error
-	if (gpu_count == 0)
+	TraceReader trace;
+	trace.open(path);
+	const TraceConfig& config = trace.config();
+	const uint32_t frame_count = trace.frameCount();
+	loops = std::max(loops, 1u);
+
+	// Everything that shapes resource creation comes from the trace, over the command line and environment
+	setHeadless(config.width, config.height);
+	occlusion_culling = config.occlusion_culling != 0;
+	vertex_layout = (VertexLayout)config.vertex_layout;
+	async_compute = config.async_compute != 0;
+	debug_bounds = config.debug_bounds != 0;
+	frame_budget_ms = config.frame_budget_ms;
+	upscale_sharpness = config.upscale_sharpness;
+	texture_paths = trace.texturePaths();
+	capture_path.clear();
+	scene = &replay_scene;
+	replaying = true;
+
+	// First frame's state goes in before init, so the render pass is baked with the traced effects
+	for (uint32_t effect = 0; effect < (uint32_t)PostEffect::Count; effect++)
 	{
-		throw std::runtime_error("[!] Vulkan Error: Failed to find a supporting GPU.");
-		std::exit(-1);
+		post_chain.setEnabled((PostEffect)effect, false);
+	}
+	replayFrame(trace.frame(0));
+	initVulkan();
+
+	std::vector <double> cpu_total(frame_count, 0.0), gpu_total(frame_count, 0.0);
+	std::vector <double> cpu_best(frame_count, 1e30), gpu_best(frame_count, 1e30);
+	std::vector <uint32_t> gpu_samples(frame_count, 0);
+	uint32_t diverged = 0;
+	uint32_t previous = 0;
+	bool previous_measured = false;
+	auto recordGpu = [&](uint32_t frame, double milliseconds)
+	{
+		gpu_total[frame] += milliseconds;
+		gpu_best[frame] = std::min(gpu_best[frame], milliseconds);
+		gpu_samples[frame]++;
 	};
 
-	// Check for a Supporting Device
-	for (const auto& device : physical_devices)
+	auto replay_start = std::chrono::steady_clock::now();
+	for (uint32_t loop = 0; loop < loops; loop++)
 	{
-		bool isSuitable = false;
-		validatePhysicalDevice(isSuitable, device);
-		if (isSuitable)
+		const bool measured = (loop > 0 || loops == 1);
+		if (loop == 1) replay_start = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < frame_count; i++)
 		{
-			physical_device = device;
-			break;
+			const std::vector <TraceReader::Command>& commands = trace.frame(i);
+			replayFrame(commands);
+
+			// drawFrame() would wait for the previous submit first, that time belongs to the GPU
+			scheduler.wait(QueueKind::Graphics, scheduler.submitted(QueueKind::Graphics));
+			auto start = std::chrono::steady_clock::now();
+			drawFrame();
+			double cpu_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			// The previous frame's timestamps were read at the start of this one
+			if (previous_measured && last_gpu_ms >= 0.0) recordGpu(previous, last_gpu_ms);
+			if (measured)
+			{
+				cpu_total[i] += cpu_ms;
+				cpu_best[i] = std::min(cpu_best[i], cpu_ms);
+			}
+			previous = i;
+			previous_measured = measured;
+
+			// A different submit means the replay measures other work than was captured
+			const TraceSubmit& submit = trace.submit(i);
+			uint32_t command_buffers = static_cast<uint32_t>(frame_command_buffers.size()) - (gpu_timer.supported() ? 2u : 0u);
+			if (loop == 0 && command_buffers != submit.command_buffers) diverged++;
 		}
 	}
-
-	// Device Validation Error
-	if (physical_device == VK_NULL_HANDLE) 
+	vkDeviceWaitIdle(device);
+	double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - replay_start).count();
+	double gpu_ms = 0.0;
+	if (previous_measured && gpu_timer.read(gpu_ms)) recordGpu(previous, gpu_ms);
+
+	// Per-frame report, averaged over the measured loops
+	const uint32_t measured_loops = loops > 1 ? loops - 1 : 1;
+	double cpu_sum = 0.0, gpu_sum = 0.0;
+	uint32_t gpu_frames = 0;
+	char line[160];
+	std::cout << "\n[Replay] " << path << ": " << frame_count << " frames at " << config.width << "x" << config.height << ", " << loops
+		<< (loops > 1 ? " loops, the first one warm-up\n" : " loop\n");
+	for (uint32_t i = 0; i < frame_count; i++)
 	{
-		throw std::runtime_error("failed to find a suitable GPU!");
-		std::exit(-1);
+		double cpu_ms = cpu_total[i] / measured_loops;
+		cpu_sum += cpu_ms;
+		if (gpu_samples[i] == 0)
+		{
+			std::snprintf(line, sizeof(line), "[Replay] frame %5u: cpu %8.3f ms (min %8.3f), gpu n/a\n", i, cpu_ms, cpu_best[i]);
+		}
+		else
+		{
+			double frame_gpu_ms = gpu_total[i] / gpu_samples[i];
+			gpu_sum += frame_gpu_ms;
+			gpu_frames++;
+			std::snprintf(line, sizeof(line), "[Replay] frame %5u: cpu %8.3f ms (min %8.3f), gpu %8.3f ms (min %8.3f)\n", i, cpu_ms, cpu_best[i], frame_gpu_ms, gpu_best[i]);
+		}
+		std::cout << line;
 	}
+	std::snprintf(line, sizeof(line), "[Replay] mean: cpu %.3f ms, gpu %.3f ms, %.1f frames per second\n",
+		cpu_sum / frame_count, gpu_frames != 0 ? gpu_sum / gpu_frames : 0.0, 1000.0 * measured_loops * frame_count / std::max(wall_ms, 1e-6));
+	std::cout << line;
+	if (diverged != 0) std::cout << "[!] " << diverged << " replayed frames submitted a different number of command buffers than captured.\n";
 
+	deInitVulkan();
 }
 
 
-Renderer::QueueFamilyIndices Renderer::queryQueueFamilies(VkPhysicalDevice device)
+// Render thread, after prepareInstances() - state records are only written when they changed
+void Renderer::captureFrame()
 {
-	QueueFamilyIndices indices;
-
-	// Initialize Queue Family
-	uint32_t family_count = 0;
-	std::vector<VkQueueFamilyProperties> queue_families;
-	vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, nullptr);
-	queue_families.resize(family_count);
-	vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, queue_families.data());
+	// Effects as baked into this frame's render pass
+	uint32_t effect_mask = 0;
+	for (PostEffect effect : post_effects)
+	{
+		effect_mask |= 1u << (uint32_t)effect;
+	}
+	capture.writeState(TraceOp::Effects, &effect_mask, sizeof(effect_mask));
+	capture.writeState(TraceOp::PostParams, &post_chain.params, sizeof(PostParams));
+	capture.writeState(TraceOp::ClearColor, &clear_color, sizeof(clear_color));
+	TraceCamera traced_camera = { camera_view, camera_projection };
+	capture.writeState(TraceOp::Camera, &traced_camera, sizeof(traced_camera));
+
+	// Lights are rarely touched and can be large, so they are written when changed rather than compared every frame
+	if (lights_dirty)
+	{
+		capture.write(TraceOp::Lights, ambient_light, sizeof(ambient_light), lights.data(), static_cast<uint32_t>(lights.size() * sizeof(Light)));
+	}
 
-	// Find a Supporting Queue Family
-	bool found = false;
-	for (uint32_t i = 0; i < family_count; i++)
+	// World matrices this frame uploads - every one after a rebuild, the changed range otherwise
+	if (scene == nullptr) return;
+	const uint32_t count = static_cast<uint32_t>(scene->size());
+	TraceInstances traced = { count, 0, 0, 0 };
+	if (count == 0 || rebuild_instances) traced.end = count;
+	else
 	{
-		if (queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
-		{
-			queue_family_index = i;
-			indices.graphicsFamily = i;
-		}
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		traced.begin = scene->changedBegin();
+		traced.end = scene->changedEnd();
+		if (traced.begin == traced.end) return;
+	}
+	capture.write(TraceOp::Instances, &traced, sizeof(traced), scene->worldMatrices() + traced.begin, (traced.end - traced.begin) * (uint32_t)sizeof(Mat4));
+}
 
-		if (presentSupport)
+
+// Stands in for simulation - the traced matrices land in a flat scene, so upload and culling see the captured ranges
+void Renderer::replayFrame(const std::vector <TraceReader::Command>& commands)
+{
+	replay_scene.resetChanged();
+	for (const TraceReader::Command& command : commands)
+	{
+		switch (command.op)
 		{
-			indices.presentFamily = i;
-			present_family_index = i;
+		case TraceOp::Effects:
+		{
+			uint32_t effect_mask = 0;
+			std::memcpy(&effect_mask, command.data, sizeof(effect_mask));
+			for (uint32_t effect = 0; effect < (uint32_t)PostEffect::Count; effect++)
+			{
+				post_chain.setEnabled((PostEffect)effect, (effect_mask >> effect) & 1u);
+			}
+			break;
 		}
-
-		if (indices.hasEntry()) 
+		case TraceOp::PostParams: std::memcpy(&post_chain.params, command.data, sizeof(PostParams)); break;
+		case TraceOp::ClearColor: std::memcpy(&clear_color, command.data, sizeof(clear_color)); break;
+		case TraceOp::Camera:
 		{
-			found = true;
+			TraceCamera traced;
+			std::memcpy(&traced, command.data, sizeof(traced));
+			setCamera(traced.view, traced.projection);
+			break;
+		}
+		case TraceOp::Lights:
+		{
+			// TraceReader::open() checked the size is the ambient color and whole lights
+			float ambient[3];
+			std::memcpy(ambient, command.data, sizeof(ambient));
+			setAmbientLight(ambient[0], ambient[1], ambient[2]);
+			lights.resize((command.size - sizeof(ambient)) / sizeof(Light));
+			if (!lights.empty()) std::memcpy(lights.data(), command.data + sizeof(ambient), lights.size() * sizeof(Light));
+			break;
+		}
+		case TraceOp::Instances:
+		{
+			TraceInstances traced;
+			std::memcpy(&traced, command.data, sizeof(traced));
+			if (replay_scene.size() != traced.count)
+			{
+				replay_scene.clear();
+				replay_scene.reserve(traced.count);
+				for (uint32_t i = 0; i < traced.count; i++)
+				{
+					replay_scene.addNode();
+				}
+			}
+			replay_scene.setWorld(traced.begin, traced.end, reinterpret_cast<const Mat4*>(command.data + sizeof(traced)));
+			break;
+		}
+		default:
 			break;
 		}
 	}
-
-	// Error Handling for Queue Family
-	if (!found)
-	{
-		throw std::runtime_error("[!] Vulkan Error: Queue family for supporting graphics not found.");
-		std::exit(-1);
-	}
-
-	return indices;
 }
 
 
-// Check for all Device Extensions
-bool Renderer::checkDeviceExtensions(VkPhysicalDevice dev)
+// Initializers & Deinitializers
+void Renderer::initVulkan()
 {
-	// Lookup the available device extensions
-	uint32_t extension_count;
-	vkEnumerateDeviceExtensionProperties(dev, nullptr, &extension_count, nullptr);
-	std::vector<VkExtensionProperties> device_extensions(extension_count);
-	vkEnumerateDeviceExtensionProperties(dev, nullptr, &extension_count, device_extensions.data());
+	if (!headless) createWindow();
+	createInstance();
+	createDebugMessenger();
+	if (!headless) createSurface();
+	createPhysicalDevice();
+	createLogicalDevice();
+	for (auto& target : windows)
+	{
+		if (headless) createOffscreenTarget(target);
+		else createSwapChain(target);
+		createImageViews(target);
+	}
 
-	// Check against required extensions
-	std::set <std::string> required_extensions(deviceExtensions.begin(), deviceExtensions.end());
-	for (const auto& extension : device_extensions)
+	// Asset pack is mapped before the first shader or mesh is needed
+	if (!asset_pack_path.empty())
 	{
-		required_extensions.erase(extension.extensionName);
+		assets.open(asset_pack_path);
+		std::cout << "\n[Assets] " << asset_pack_path << ": " << assets.entryCount() << " assets, " << (assets.size() >> 10) << " KiB mapped\n";
 	}
 
-	return required_extensions.empty();
-}
+	// Post chain is baked into the render pass
+	post_effects = post_chain.activeEffects();
+	post_chain.consumeDirty();
 
+	// Instance set layout outlives pipeline rebuilds
+	instances.create(device, physical_device, static_cast<uint32_t>(windows.size()));
+	createMesh();
 
-// Validate Physical Device Properties - Queue families & Extensions
-void Renderer::validatePhysicalDevice(bool& suitable, VkPhysicalDevice device)
-{
-	QueueFamilyIndices indices = queryQueueFamilies(device);
+	// Lighting set is part of the base pipeline layout, the assignment runs whether or not the culler does
+	lighting.create(device, physical_device);
+	auto shaderAssignModule = loadShaderModule(SHADER_CLUSTER_ASSIGN_FILE_DIR);
+	lighting.createPipeline(shaderAssignModule);
+	vkDestroyShaderModule(device, shaderAssignModule, hostAllocator());
 
-	bool extensionsSupported = checkDeviceExtensions(device);
+	// Depth targets need the culler even when occlusion culling is off
+	occlusion.create(device, physical_device);
+	if (occlusion_culling) createOcclusionPipelines();
 
-	bool supported_swap_chain = false;
-	if (extensionsSupported) {
-		SwapChainProperties swapChainSupport = querySwapChainProp(device);
-		supported_swap_chain = !swapChainSupport.surfaceFormats.empty() && !swapChainSupport.presentModes.empty();
-	}
+	// Dynamic resolution changes what the render pass writes, so it is decided before it is built
+	dynamic_resolution = frame_budget_ms > 0.0;
+	resolution.setBudget(frame_budget_ms);
 
-	suitable = (indices.hasEntry() && extensionsSupported && supported_swap_chain);
-}
+	// Frame task workers and their per-slot arenas
+	jobs.start();
+	for (auto& arena : frame_arenas)
+	{
+		arena.create(FRAME_ARENA_SIZE);
+	}
 
-// Initialize Vulkan Device
-void Renderer::createLogicalDevice()
-{
-	QueueFamilyIndices indices = queryQueueFamilies(physical_device);
-	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
-	float queue_priority[]{ 1.0f };
+	createRenderPass();
+	createOcclusionPass();
+	createGraphicsPipeline();
+	createPostPipelines();
+	if (dynamic_resolution) createUpscalePipeline();
 
-	// Iterate through all Queue Families for GPU
-	for (uint32_t queueFamily : uniqueQueueFamilies) {
-		VkDeviceQueueCreateInfo create_info{};
-		create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		create_info.queueFamilyIndex = queueFamily;
-		create_info.queueCount = 1;
-		create_info.pQueuePriorities = queue_priority;
-		queueCreateInfos.push_back(create_info);
+	// Debug lines load the finished image - every path leaves it presentable, or ready for the readback copy
+	DebugDraw::instance().create(device, physical_device, windows[0].image_format, headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	createDebugPipeline();
+	for (auto& target : windows)
+	{
+		occlusion.createTarget(target.occlusion, target.extent, occlusion_culling);
+		createScaledTarget(target);
+		createPostTargets(target);
+		createFrameBuffers(target);
+		createDebugFrameBuffers(target);
 	}
+	createCommandPool();
+	createCommandBuffer();
+	createSyncObjects();
 
-	// Specify device's features used with physical device - [!] Fill feature support in later when renderer advances 
-	VkPhysicalDeviceFeatures device_features{};
-
+	// Without timestamps the scale stays at 1 and the upscale pass is a plain copy
+	if (dynamic_resolution || replaying)
+	{
+		gpu_timer.create(device, physical_device, queue_family_index, commandPool);
+		if (!gpu_timer.supported() && dynamic_resolution) std::cout << "\n[!] Graphics queue has no timestamps, dynamic resolution stays at native scale.\n";
+		if (!gpu_timer.supported() && replaying) std::cout << "\n[!] Graphics queue has no timestamps, replay reports CPU time only.\n";
+	}
 
-	// Create Device Info - Logical Device
-	VkDeviceCreateInfo device_create_info{};
-	device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	device_create_info.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
-	device_create_info.pQueueCreateInfos = queueCreateInfos.data();
-	device_create_info.pEnabledFeatures = &device_features;
-	device_create_info.enabledExtensionCount = static_cast<uint32_t> (deviceExtensions.size());		// [!] Fill in logical extensions later
-	device_create_info.ppEnabledExtensionNames = deviceExtensions.data();		// [!] Fill in logical extensions later
-	
-	// Validation Layer Support for Logical Device
-	if (enableValidationLayers)
+	// Textures upload on the graphics queue before the first frame
+	for (const std::string& path : texture_paths)
 	{
-		device_create_info.enabledLayerCount = static_cast<uint32_t> (validationLayers.size());
-		device_create_info.ppEnabledLayerNames = validationLayers.data();
+		loadTexture(path);
 	}
-	else
+	if (!textures.empty())
 	{
-		device_create_info.enabledLayerCount = 0;
+		uint64_t bytes = metrics.texture_bytes.load(std::memory_order_relaxed);
+		uint64_t rgba_bytes = metrics.texture_rgba_bytes.load(std::memory_order_relaxed);
+		std::cout << "\n[Texture] " << textures.size() << " textures: " << (bytes >> 10) << " KiB on the device, " << (rgba_bytes >> 10)
+			<< " KiB as RGBA8, " << ((rgba_bytes - std::min(bytes, rgba_bytes)) >> 10) << " KiB saved\n";
 	}
 
-	// Logical device error handling
-	if (errorHandler(vkCreateDevice(physical_device, &device_create_info, nullptr, &device)) != VK_SUCCESS)
+	// Load profile - compare a run with --asset-pack against one without
+	std::cout << "\n[Assets] " << asset_loads << " loads in " << asset_load_seconds * 1000.0 << " ms, " << asset_loads_packed << " from the pack\n";
+
+	// Export pipelines its copies over several frames
+	if (exporter != nullptr) createReadback(EXPORT_READBACK_SLOTS);
+
+	// Trace starts with everything replay needs before its first frame
+	if (!capture_path.empty())
 	{
-		throw std::runtime_error("\n[!] Failed to Create Vulkan Logical Device");
-		std::exit(-1);
+		if (!capture.open(capture_path, capture_frames))
+		{
+			throw std::runtime_error("[!] Trace Error - Failed to open " + capture_path + ".");
+			std::exit(-1);
+		}
+		TraceConfig config{};
+		config.width = windows[0].extent.width;
+		config.height = windows[0].extent.height;
+		config.occlusion_culling = occlusion_culling ? 1 : 0;
+		config.vertex_layout = (uint32_t)vertex_layout;
+		config.async_compute = async_compute ? 1 : 0;
+		config.debug_bounds = debug_bounds ? 1 : 0;
+		config.frame_budget_ms = (float)frame_budget_ms;
+		config.upscale_sharpness = upscale_sharpness;
+		capture.write(TraceOp::Config, &config, sizeof(config));
+		for (const std::string& path : texture_paths)
+		{
+			capture.write(TraceOp::Texture, path.data(), static_cast<uint32_t>(path.size()));
+		}
+		std::cout << "\n[Trace] Capturing " << capture_frames << " frames to " << capture_path << "\n";
 	}
 
-	// Get Logical Device Queue Handles
-	vkGetDeviceQueue(device, queue_family_index, 0, &graphics_queue);
-	vkGetDeviceQueue(device, present_family_index, 0, &present_queue);
-
+	// Scrapes only read atomics, so the server can start once everything it queries exists
+	if (!metrics_endpoint.empty())
+	{
+		metrics_server.start(metrics_endpoint, [this](std::string& out) { writeMetrics(out); });
+		std::cout << "\n[Metrics] Serving on " << metrics_endpoint << "\n";
+	}
 }
 
 
-// Initialize Window Surface
-void Renderer::createSurface()
+void Renderer::deInitVulkan()
 {
-	if (SDL_Vulkan_CreateSurface(window, instance, &surface) != SDL_TRUE)
+	// No scrape may query the device while it is torn down
+	metrics_server.stop();
+
+	// A capture cut short keeps its complete frames
+	capture.close();
+
+	// Stop frame task workers - nothing is queued between frames
+	jobs.stop();
+	for (auto& arena : frame_arenas)
 	{
-		throw std::runtime_error("[!] Failed to create vulkan surface window.");
-		std::exit(-1);
+		arena.destroy();
 	}
-}
 
+	// Destroy Retired resources - device is idle
+	deletion_queue.flushAll();
 
-// Retrieve Swap Chain Property Info
-Renderer::SwapChainProperties Renderer::querySwapChainProp(VkPhysicalDevice device)
-{
-	SwapChainProperties properties{};
-	uint32_t format_count;
-	uint32_t mode_count;
+	// Destroy Readback buffers
+	readback.destroy();
 
-	// Get Surface Capabilities
-	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &properties.extentCapabilities);
+	// Destroy Scene instance buffers and set layout, then the light lists
+	instances.destroy();
+	lighting.destroy();
+	vkDestroyBuffer(device, mesh_buffer, hostAllocator());
+	vkFreeMemory(device, mesh_memory, hostAllocator());
 
-	// Get Surface Formats
-	vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &format_count, nullptr);
-	properties.surfaceFormats.resize(format_count);
-	vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &format_count, properties.surfaceFormats.data());
+	// Unmap the asset pack - post chain rebuilds read shaders from it until now
+	assets.close();
 
-	// Get Presentation Mode
-	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &mode_count, nullptr);
-	properties.presentModes.resize(mode_count);
-	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &mode_count, properties.presentModes.data());
+	// Destroy Textures
+	for (Texture& texture : textures)
+	{
+		vkDestroyImageView(device, texture.view, hostAllocator());
+		vkDestroyImage(device, texture.image, hostAllocator());
+		vkFreeMemory(device, texture.memory, hostAllocator());
+	}
+	textures.clear();
 
-	return properties;
-}
+	// Destroy Depth targets, pyramids and occlusion pipelines
+	for (auto& target : windows)
+	{
+		occlusion.destroyTarget(target.occlusion);
+	}
+	occlusion.destroy();
 
+	// Destroy Sync objects
+	vkDestroySemaphore(device, renderFinishedSemaphore, hostAllocator());
+	scheduler.destroy();
 
-void Renderer::setSwapChainProp(SwapChainProperties& availableProperties)
-{
-	// Set Surface Format
-	for (const auto& availableFormat : availableProperties.surfaceFormats) {
-		if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
-			availableProperties.format = availableFormat;
-			break;
+	// Destroy Command Pools
+	gpu_timer.destroy();
+	vkDestroyCommandPool(device, commandPool, hostAllocator());
+	compute.destroy();
+
+	// Destroy Frame Buffers
+	for (auto& target : windows)
+	{
+		for (auto framebuffer : target.frame_buffers) {
+			vkDestroyFramebuffer(device, framebuffer, hostAllocator());
 		}
-		else
-		{
-			availableProperties.format = availableProperties.surfaceFormats[0];
+		for (auto framebuffer : target.occlusion_frame_buffers) {
+			vkDestroyFramebuffer(device, framebuffer, hostAllocator());
 		}
-	}
-
-	// Set Presentation Mode
-	for (const auto& availablePresentMode : availableProperties.presentModes) {
-		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-			availableProperties.mode = availablePresentMode;
-			break;
+		for (auto framebuffer : target.upscale_frame_buffers) {
+			vkDestroyFramebuffer(device, framebuffer, hostAllocator());
 		}
-		else
-		{
-			availableProperties.mode = VK_PRESENT_MODE_FIFO_KHR;
+		for (auto framebuffer : target.debug_frame_buffers) {
+			vkDestroyFramebuffer(device, framebuffer, hostAllocator());
 		}
 	}
 
-	// Set Resolution Extent Capabilities
-	if (availableProperties.extentCapabilities.currentExtent.width != UINT32_MAX) 
+	// Destroy Debug draw ring and pipeline - later appends are ignored
+	DebugDraw::instance().destroy();
+
+	// Destroy Scaled targets and the upscale pipeline
+	for (auto& target : windows)
 	{
-		availableProperties.extent = availableProperties.extentCapabilities.currentExtent;
+		vkDestroyImageView(device, target.scaled_view, hostAllocator());
+		vkDestroyImage(device, target.scaled_image, hostAllocator());
+		vkFreeMemory(device, target.scaled_memory, hostAllocator());
+		vkDestroyDescriptorPool(device, target.upscale_pool, hostAllocator());
 	}
-	else 
+	vkDestroyPipeline(device, upscale_pipeline, hostAllocator());
+	vkDestroyPipelineLayout(device, upscale_layout, hostAllocator());
+	vkDestroyDescriptorSetLayout(device, upscale_set_layout, hostAllocator());
+	vkDestroySampler(device, upscale_sampler, hostAllocator());
+	vkDestroyRenderPass(device, upscale_pass, hostAllocator());
+
+	// Destroy Post targets and pipelines
+	for (auto& target : windows)
 	{
-		int width, height;
-		SDL_Vulkan_GetDrawableSize(window, &width, &height);
-
-
-		VkExtent2D actualExtent = {
-			static_cast<uint32_t>(width),
-			static_cast<uint32_t>(height)
-		};
-
-		availableProperties.extent = actualExtent;
-		throw std::runtime_error("[!] Resolution Error: Swap Chain Extent is set past the maximum!");
-		std::exit(-1);
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			vkDestroyImageView(device, target.post_views[i], hostAllocator());
+			vkDestroyImage(device, target.post_images[i], hostAllocator());
+			vkFreeMemory(device, target.post_memory[i], hostAllocator());
+		}
+		vkDestroyDescriptorPool(device, target.post_pool, hostAllocator());
+	}
+	for (auto pipeline : post_pipelines)
+	{
+		vkDestroyPipeline(device, pipeline, hostAllocator());
 	}
+	vkDestroyPipelineLayout(device, post_layout, hostAllocator());
+	vkDestroyDescriptorSetLayout(device, post_set_layout, hostAllocator());
 
-}
+	// Destroy Graphics pipeline
+	vkDestroyPipeline(device, graphicsPipeline, hostAllocator());
+	vkDestroyPipeline(device, occlusion_pipeline, hostAllocator());
 
+	// Destroy Pipeline layout
+	vkDestroyPipelineLayout(device, pipelineLayout, hostAllocator()); 
 
-void Renderer::createSwapChain()
-{
-	// Query Physical Device's Swap Chain Properties
-	SwapChainProperties swapChainProperties = querySwapChainProp(physical_device);
+	// Destroy the Render Pass
+	vkDestroyRenderPass(device, render_pass, hostAllocator());
+	vkDestroyRenderPass(device, occlusion_pass, hostAllocator());
 
-	// Set Swap Chain Properties with available criteria
-	setSwapChainProp(swapChainProperties);
+	for (auto& target : windows)
+	{
+		// Destroy Image Views
+		for (auto imageView : target.image_views) 
+		{
+			vkDestroyImageView(device, imageView, hostAllocator());
+		}
 
-	uint32_t image_count = swapChainProperties.extentCapabilities.minImageCount + 1;
+		vkDestroySemaphore(device, target.image_available, hostAllocator());
 
-	if (swapChainProperties.extentCapabilities.maxImageCount > 0 && image_count > swapChainProperties.extentCapabilities.maxImageCount)
-	{
-		image_count = swapChainProperties.extentCapabilities.maxImageCount;
+		// Destroy Swap Chain or its headless stand-in
+		if (headless)
+		{
+			vkDestroyImage(device, offscreen_image, hostAllocator());
+			vkFreeMemory(device, offscreen_memory, hostAllocator());
+		}
+		else
+		{
+			vkDestroySwapchainKHR(device, target.swap_chain, hostAllocator());
+		}
 	}
 
-	// Create Swap Chain Info
-	VkSwapchainCreateInfoKHR createInfo{};
-	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-	createInfo.surface = surface;
-	createInfo.minImageCount = image_count;
-	createInfo.imageFormat = swapChainProperties.format.format;
-	createInfo.imageColorSpace = swapChainProperties.format.colorSpace;
-	createInfo.imageExtent = swapChainProperties.extent;
-	createInfo.imageArrayLayers = 1;
-	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-
-	// Get Queue Family Index for Swap Chain
-	QueueFamilyIndices indices = queryQueueFamilies(physical_device);
-	uint32_t queueFamilyIndices[] = { indices.graphicsFamily, indices.presentFamily };
+	// Destroy device
+	vkDestroyDevice(device, hostAllocator());
+	device = VK_NULL_HANDLE;
 
-	// Graphics and Present Family Error Checking
-	if (indices.graphicsFamily != indices.presentFamily)
+	// Destroy Debugger Report
+	if (enableValidationLayers)
 	{
-		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-		createInfo.queueFamilyIndexCount = 2;							// [!] Might need to change later
-		createInfo.pQueueFamilyIndices = queueFamilyIndices;
+		destroyDebugMessengerEXT(instance, debug_messenger, hostAllocator());
+		debug_report = VK_NULL_HANDLE;
 	}
-	else
+
+	// Destroy Surfaces
+	if (!headless)
 	{
-		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		createInfo.queueFamilyIndexCount = 0;
-		createInfo.pQueueFamilyIndices = nullptr; 
+		// SDL creates surfaces without callbacks, so they are destroyed without them
+		for (auto& target : windows)
+		{
+			vkDestroySurfaceKHR(instance, target.surface, nullptr);
+		}
 	}
 
-	// Set Swap Chain Property Info
-	createInfo.preTransform = swapChainProperties.extentCapabilities.currentTransform;
-	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-	createInfo.presentMode = swapChainProperties.mode;
-	createInfo.clipped = VK_TRUE;
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	// Destroy Instance
+	vkDestroyInstance(instance, hostAllocator());
+	instance = nullptr;
 
-	// Swap Chain Creation Error Handling
-	if (errorHandler(vkCreateSwapchainKHR(device, &createInfo, nullptr, &swap_chain)) != VK_SUCCESS)
+	// Host allocations the driver made, by scope
+	if (debug_mode)
 	{
-		throw std::runtime_error("[!] Swap Chain Error - Failed to create Swap Chain.");
-		std::exit(-1);
+		HostAllocator::instance().report(std::cout);
 	}
 
-	// Retrieve Swap Chain Images
-	vkGetSwapchainImagesKHR(device, swap_chain, &image_count, nullptr);
-	swapChainImages.resize(image_count);
-	vkGetSwapchainImagesKHR(device, swap_chain, &image_count, swapChainImages.data());
+	// Flush remaining validation messages
+	debug_log.stop();
 
-	swap_chain_image_format = swapChainProperties.format.format;
-	swap_chain_extent = swapChainProperties.extent;
+	// Destroy SDL Windows and Quit SDL
+	if (!headless)
+	{
+		for (auto& target : windows)
+		{
+			SDL_DestroyWindow(target.window);
+		}
+	}
+	void SDL_Quit(void);
+}
+
+
+void Renderer::eventHandler()
+{
+	running.store(true, std::memory_order_release);
+	render_thread = std::thread(&Renderer::renderLoop, this);
+
+	while (running.load(std::memory_order_acquire))
+	{
+		// Block briefly for the first event, then drain everything pending this tick
+		if (!SDL_WaitEventTimeout(&event, 4)) continue;
+		do
+		{
+			// Event Categories
+			switch (event.type)
+			{
+				case SDL_QUIT:
+					running.store(false, std::memory_order_release);
+					break;
+
+				// SDL only sends SDL_QUIT once every window is closed
+				case SDL_WINDOWEVENT:
+					if (event.window.event == SDL_WINDOWEVENT_CLOSE)
+					{
+						if (event.window.windowID == windows[0].id) running.store(false, std::memory_order_release);
+						else SDL_HideWindow(SDL_GetWindowFromID(event.window.windowID));
+					}
+					break;
+
+				default:
+					break;
+			}
+
+			// Forward to the render thread - never wait on it
+			if (!event_queue.push(event))
+			{
+				dropped_events++;
+			}
+		} while (SDL_PollEvent(&event));
+	}
+
+	render_thread.join();
+	vkDeviceWaitIdle(device);
+	if (exporter != nullptr) finishExport();
+
+	if (render_error)
+	{
+		std::rethrow_exception(render_error);
+	}
+
+	if (dropped_events != 0)
+	{
+		std::cout << "\n[!] Render thread event queue overflowed, " << dropped_events << " events dropped\n";
+	}
+}
+
+
+// Render thread - owns all per-frame Vulkan work
+void Renderer::renderLoop()
+{
+	try
+	{
+		while (running.load(std::memory_order_acquire))
+		{
+			processRenderEvents();
+
+			// Nothing to present to while every window is minimized
+			bool all_minimized = std::all_of(windows.begin(), windows.end(), [](const RenderWindow& target) { return target.minimized; });
+			if (all_minimized)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				continue;
+			}
+
+			// Draw Frame
+			drawFrame();
+		}
+	}
+	catch (...)
+	{
+		// Hand the failure to the main thread and stop the event loop
+		render_error = std::current_exception();
+		running.store(false, std::memory_order_release);
+	}
+}
+
+
+void Renderer::processRenderEvents()
+{
+	SDL_Event render_event;
+	while (event_queue.pop(render_event))
+	{
+		// F1-F3 toggle the post effects
+		if (render_event.type == SDL_KEYDOWN && !render_event.key.repeat)
+		{
+			switch (render_event.key.keysym.sym)
+			{
+				case SDLK_F1:
+					post_chain.toggle(PostEffect::Tonemap);
+					break;
+
+				case SDLK_F2:
+					post_chain.toggle(PostEffect::Grade);
+					break;
+
+				case SDLK_F3:
+					post_chain.toggle(PostEffect::Vignette);
+					break;
+
+				default:
+					break;
+			}
+			continue;
+		}
+
+		if (render_event.type != SDL_WINDOWEVENT) continue;
+
+		RenderWindow* target = findWindow(render_event.window.windowID);
+		if (target == nullptr) continue;
+
+		switch (render_event.window.event)
+		{
+			case SDL_WINDOWEVENT_MINIMIZED:
+			case SDL_WINDOWEVENT_HIDDEN:
+				target->minimized = true;
+				break;
+
+			case SDL_WINDOWEVENT_RESTORED:
+			case SDL_WINDOWEVENT_SHOWN:
+				target->minimized = false;
+				break;
+
+			case SDL_WINDOWEVENT_SIZE_CHANGED:
+				target->resized = true;
+				break;
+
+			default:
+				break;
+		}
+	}
+}
+
+
+// SDL Window Initializaiton and Creation
+void Renderer::createWindow()
+{
+	// Initialize SDL 
+	SDL_Init(SDL_INIT_VIDEO);
+
+	for (auto& target : windows)
+	{
+		target.window = SDL_CreateWindow(target.title.c_str(), SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_CENTERED, target.width, target.height, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
+
+		if (target.window == nullptr)
+		{
+			throw std::runtime_error("\n[!] SDL Error: Unable to initilaize SDL window.\n");
+			std::exit(-1);
+		}
+		target.id = SDL_GetWindowID(target.window);
+	}
+}
+
+
+RenderWindow* Renderer::findWindow(uint32_t id)
+{
+	for (auto& target : windows)
+	{
+		if (target.id == id) return &target;
+	}
+	return nullptr;
+}
+
+
+// Create a Vulkan Instance
+void Renderer::createInstance()
+{
+	// Get all Instance Layers
+	uint32_t layer_count = 0;
+	vkEnumerateInstanceLayerProperties(&layer_count, nullptr);
+	std::vector<VkLayerProperties> layer_properties(layer_count);
+	vkEnumerateInstanceLayerProperties(&layer_count, layer_properties.data());
+
+
+	// Check to ensure Support for Validation Layers
+	if (enableValidationLayers && !checkValidationLayers())
+	{
+		throw std::runtime_error("\n[!] Validation Error: layers Requested but NOT Found.");
+		std::exit(-1);
+	}
+
+	// Set Application Info
+	VkApplicationInfo application {};
+	application.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	application.pApplicationName = "Vulkan Renderer Prototype";
+	application.apiVersion = VK_API_VERSION_1_2;						// Timeline semaphores are core in 1.2
+	application.applicationVersion = VK_MAKE_VERSION(0, 1, 0);
+	application.pEngineName = "No Engine";
+
+	// Instantiate Vulkan from Application Info and SDL Extensions
+	VkInstanceCreateInfo create_info {};
+	create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	create_info.pApplicationInfo = &application;
+	checkSDLExtensions();
+	create_info.enabledExtensionCount = static_cast<uint32_t>(SDL_extensions.size());
+	create_info.ppEnabledExtensionNames = SDL_extensions.data();
+
+	// Validate Instance Layers
+	VkDebugUtilsMessengerCreateInfoEXT debug_create_info{};
+	VkValidationFeaturesEXT validation_features{};
+	VkValidationFeatureEnableEXT enabled_features[] = { VK_VALIDATION_FEATURE_ENABLE_GPU_ASSISTED_EXT, VK_VALIDATION_FEATURE_ENABLE_GPU_ASSISTED_RESERVE_BINDING_SLOT_EXT };
+	if (enableValidationLayers)
+	{
+		create_info.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+		create_info.ppEnabledLayerNames = validationLayers.data();
+
+		// Messages are drained off-thread, start before the instance can report anything
+		debug_log.start();
+		insertDebugInfo(debug_create_info);
+		create_info.pNext = (VkDebugUtilsMessengerCreateInfoEXT*) &debug_create_info;
+
+		// Full tier - GPU-assisted validation
+		if (validation_tier == ValidationTier::Full)
+		{
+			validation_features.sType = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT;
+			validation_features.enabledValidationFeatureCount = 2;
+			validation_features.pEnabledValidationFeatures = enabled_features;
+			validation_features.pNext = &debug_create_info;
+			create_info.pNext = &validation_features;
+		}
+	}
+	else 
+	{
+		create_info.enabledLayerCount = 0;
+		create_info.pNext = nullptr;
+	}
+
+	// Instance Error Handling
+	if (errorHandler(vkCreateInstance(&create_info, hostAllocator(), &instance)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to Create a Vulkan Instance.");
+		std::exit(-1);
+	}
+}
+
+
+// Check for Validation Layers Support in Instance
+bool Renderer::checkValidationLayers()
+{
+	// Get Instance Layer Property Enums for iteration
+	uint32_t layerCount;
+	vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+	std::vector <VkLayerProperties> availableLayers(layerCount);
+	vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+
+	bool layerFound = false;
+
+	// Check Validation Layers
+	for (const char* layerName : validationLayers)
+	{
+		layerFound = false;
+		// Iterate and Check through Layer Layers
+		for (const auto& layerProperties : availableLayers)
+		{
+			if (strcmp(layerName, layerProperties.layerName) == 0)
+			{
+				layerFound = true;
+				break;
+			}
+		}
+		if (!layerFound)
+		{
+			std::cout << "\n[!] " << layerName << " Validation Layer NOT Found\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// Connect SDL Extensions to Vulkan Application
+void Renderer::checkSDLExtensions()
+{
+	// Get SDL Extensions required to make Surface in Vulkan - headless needs no surface
+	if (!headless)
+	{
+		uint32_t extension_count = 0;
+		SDL_Vulkan_GetInstanceExtensions(windows[0].window, &extension_count, nullptr);
+		SDL_extensions.resize(extension_count);
+		SDL_Vulkan_GetInstanceExtensions(windows[0].window, &extension_count, SDL_extensions.data());
+	}
+
+	if (enableValidationLayers)
+	{
+		SDL_extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+	}
+
+	if (validation_tier == ValidationTier::Full)
+	{
+		SDL_extensions.push_back(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+	}
+}
+
+
+// Initialize Debug Messenger Extension
+VkResult Renderer::createDebugMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger)
+{
+	auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
+	if (func != nullptr)
+	{
+		return func(instance, pCreateInfo, pAllocator, pDebugMessenger);
+	}
+	else
+	{
+		return VK_ERROR_EXTENSION_NOT_PRESENT;
+	};
+}
+
+
+// Destroy Debug Messenger Extension
+void Renderer::destroyDebugMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator)
+{
+	auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
+	if (func != nullptr) {
+		func(instance, debugMessenger, pAllocator);
+	}
+}
+
+
+// Vulkan Debug Callback Function - hands the message to the async log, never blocks
+static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData)
+{
+	static_cast<DebugLog*>(pUserData)->push(messageSeverity, messageType, pCallbackData);
+	return VK_FALSE;
+}
+
+
+// Initialize Debugger
+void Renderer::createDebugMessenger()
+{
+	if (!enableValidationLayers) return;
+	
+	VkDebugUtilsMessengerCreateInfoEXT create_info{};
+	insertDebugInfo(create_info);
+
+	if (createDebugMessengerEXT(instance, &create_info, hostAllocator(), &debug_messenger) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to setup Debug messenger.");
+		std::exit(-1);
+	}
+
+}
+
+// Create and Initialize Debug Messenger
+void Renderer::insertDebugInfo(VkDebugUtilsMessengerCreateInfoEXT& info)
+{
+	info = {};
+	info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+	info.pfnUserCallback = debugCallback;
+	info.pUserData = &debug_log;
+
+	// Severities subscribed depend on the validation tier
+	if (validation_tier == ValidationTier::Full)
+	{
+		info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+		info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+	}
+	else
+	{
+		info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+		info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
+	}
+}
+
+
+// Setup physical device & queue families for initialization
+void Renderer::createPhysicalDevice()
+{
+	// Get Physical Device - GPU
+	uint32_t gpu_count = 0;
+	vkEnumeratePhysicalDevices(instance, &gpu_count, nullptr);
+	std::vector<VkPhysicalDevice> physical_devices(gpu_count);
+	vkEnumeratePhysicalDevices(instance, &gpu_count, physical_devices.data());
+	
+	// Physical Device Not Found Error
+	if (gpu_count == 0)
+	{
+		throw std::runtime_error("[!] Vulkan Error: Failed to find a supporting GPU.");
+		std::exit(-1);
+	};
+
+	// Check for a Supporting Device
+	for (const auto& device : physical_devices)
+	{
+		// Optional name filter, e.g. "llvmpipe" to force lavapipe for golden images
+		if (!preferred_device.empty())
+		{
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(device, &properties);
+			if (std::string(properties.deviceName).find(preferred_device) == std::string::npos) continue;
+		}
+
+		bool isSuitable = false;
+		validatePhysicalDevice(isSuitable, device);
+		if (isSuitable)
+		{
+			physical_device = device;
+			break;
+		}
+	}
+
+	// Device Validation Error
+	if (physical_device == VK_NULL_HANDLE) 
+	{
+		throw std::runtime_error("failed to find a suitable GPU!");
+		std::exit(-1);
+	}
+
+}
+
+
+Renderer::QueueFamilyIndices Renderer::queryQueueFamilies(VkPhysicalDevice device)
+{
+	QueueFamilyIndices indices;
+
+	// Initialize Queue Family
+	uint32_t family_count = 0;
+	std::vector<VkQueueFamilyProperties> queue_families;
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, nullptr);
+	queue_families.resize(family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, queue_families.data());
+
+	// Find a Supporting Queue Family
+	bool found = false;
+	for (uint32_t i = 0; i < family_count; i++)
+	{
+		if (queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		{
+			queue_family_index = i;
+			indices.graphicsFamily = i;
+		}
+		// Headless never presents, the graphics queue stands in
+		VkBool32 presentSupport = false;
+		if (headless) presentSupport = (queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) ? VK_TRUE : VK_FALSE;
+		else
+		{
+			// One present call covers every window, so one family must support all surfaces
+			presentSupport = VK_TRUE;
+			for (const auto& target : windows)
+			{
+				VkBool32 surfaceSupport = VK_FALSE;
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, target.surface, &surfaceSupport);
+				if (!surfaceSupport) presentSupport = VK_FALSE;
+			}
+		}
+
+		if (presentSupport)
+		{
+			indices.presentFamily = i;
+			present_family_index = i;
+		}
+
+		if (indices.hasEntry()) 
+		{
+			found = true;
+			break;
+		}
+	}
+
+	// Error Handling for Queue Family
+	if (!found)
+	{
+		throw std::runtime_error("[!] Vulkan Error: Queue family for supporting graphics not found.");
+		std::exit(-1);
+	}
+
+	// Dedicated compute family - runs alongside graphics instead of behind it
+	for (uint32_t i = 0; i < family_count; i++)
+	{
+		if ((queue_families[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			indices.computeFamily = i;
+			break;
+		}
+	}
+
+	return indices;
+}
+
+
+// Check for all Device Extensions
+bool Renderer::checkDeviceExtensions(VkPhysicalDevice dev)
+{
+	// Lookup the available device extensions
+	uint32_t extension_count;
+	vkEnumerateDeviceExtensionProperties(dev, nullptr, &extension_count, nullptr);
+	std::vector<VkExtensionProperties> device_extensions(extension_count);
+	vkEnumerateDeviceExtensionProperties(dev, nullptr, &extension_count, device_extensions.data());
+
+	// Check against required extensions
+	std::set <std::string> required_extensions(deviceExtensions.begin(), deviceExtensions.end());
+	for (const auto& extension : device_extensions)
+	{
+		required_extensions.erase(extension.extensionName);
+	}
+
+	return required_extensions.empty();
+}
+
+
+// Validate Physical Device Properties - Queue families & Extensions
+void Renderer::validatePhysicalDevice(bool& suitable, VkPhysicalDevice device)
+{
+	QueueFamilyIndices indices = queryQueueFamilies(device);
+
+	bool extensionsSupported = checkDeviceExtensions(device);
+
+	bool supported_swap_chain = true;
+	if (extensionsSupported && !headless) {
+		for (const auto& target : windows)
+		{
+			SwapChainProperties swapChainSupport = querySwapChainProp(device, target.surface);
+			if (swapChainSupport.surfaceFormats.empty() || swapChainSupport.presentModes.empty()) supported_swap_chain = false;
+		}
+	}
+
+	// Frame scheduling runs on timeline semaphores
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device, &properties);
+
+	VkPhysicalDeviceVulkan12Features features12{};
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &features12;
+	bool supported_timeline = properties.apiVersion >= VK_API_VERSION_1_2;
+	if (supported_timeline)
+	{
+		vkGetPhysicalDeviceFeatures2(device, &features);
+		supported_timeline = features12.timelineSemaphore == VK_TRUE;
+	}
+
+	suitable = (indices.hasEntry() && extensionsSupported && supported_swap_chain && supported_timeline);
+}
+
+// Initialize Vulkan Device
+void Renderer::createLogicalDevice()
+{
+	QueueFamilyIndices indices = queryQueueFamilies(physical_device);
+	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+	bool use_async_compute = async_compute && indices.computeFamily != (uint32_t)-1;
+	if (use_async_compute) uniqueQueueFamilies.insert(indices.computeFamily);
+	float queue_priority[]{ 1.0f };
+
+	// Iterate through all Queue Families for GPU
+	for (uint32_t queueFamily : uniqueQueueFamilies) {
+		VkDeviceQueueCreateInfo create_info{};
+		create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		create_info.queueFamilyIndex = queueFamily;
+		create_info.queueCount = 1;
+		create_info.pQueuePriorities = queue_priority;
+		queueCreateInfos.push_back(create_info);
+	}
+
+	// Specify device's features used with physical device - [!] Fill feature support in later when renderer advances 
+	VkPhysicalDeviceFeatures device_features{};
+
+	// GPU-assisted validation instruments shaders with storage writes
+	if (validation_tier == ValidationTier::Full)
+	{
+		VkPhysicalDeviceFeatures supported_features{};
+		vkGetPhysicalDeviceFeatures(physical_device, &supported_features);
+		device_features.fragmentStoresAndAtomics = supported_features.fragmentStoresAndAtomics;
+		device_features.vertexPipelineStoresAndAtomics = supported_features.vertexPipelineStoresAndAtomics;
+	}
+
+
+	// Heap budgets for the metrics endpoint, when the driver reports them
+	uint32_t extension_count = 0;
+	vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, nullptr);
+	std::vector<VkExtensionProperties> available_extensions(extension_count);
+	vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, available_extensions.data());
+	for (const auto& extension : available_extensions)
+	{
+		if (std::strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) memory_budget = true;
+	}
+	if (memory_budget) deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+	// Vulkan 1.2 features - timeline semaphores for the frame scheduler
+	VkPhysicalDeviceVulkan12Features features12{};
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	features12.timelineSemaphore = VK_TRUE;
+
+	// Create Device Info - Logical Device
+	VkDeviceCreateInfo device_create_info{};
+	device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	device_create_info.pNext = &features12;
+	device_create_info.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+	device_create_info.pQueueCreateInfos = queueCreateInfos.data();
+	device_create_info.pEnabledFeatures = &device_features;
+	device_create_info.enabledExtensionCount = static_cast<uint32_t> (deviceExtensions.size());		// [!] Fill in logical extensions later
+	device_create_info.ppEnabledExtensionNames = deviceExtensions.data();		// [!] Fill in logical extensions later
+	
+	// Validation Layer Support for Logical Device
+	if (enableValidationLayers)
+	{
+		device_create_info.enabledLayerCount = static_cast<uint32_t> (validationLayers.size());
+		device_create_info.ppEnabledLayerNames = validationLayers.data();
+	}
+	else
+	{
+		device_create_info.enabledLayerCount = 0;
+	}
+
+	// Logical device error handling
+	if (errorHandler(vkCreateDevice(physical_device, &device_create_info, hostAllocator(), &device)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("\n[!] Failed to Create Vulkan Logical Device");
+		std::exit(-1);
+	}
+	deletion_queue.init(device);
+
+	// Get Logical Device Queue Handles
+	vkGetDeviceQueue(device, queue_family_index, 0, &graphics_queue);
+	vkGetDeviceQueue(device, present_family_index, 0, &present_queue);
+
+	// Compute falls back to inline recording on the graphics queue
+	compute.create(device, indices.computeFamily, queue_family_index, use_async_compute);
+	std::cout << "\n[Compute] " << (use_async_compute ? "async on queue family " + std::to_string(indices.computeFamily) : std::string("inline on the graphics queue")) << "\n";
+
+}
+
+
+// Initialize Window Surface
+void Renderer::createSurface()
+{
+	for (auto& target : windows)
+	{
+		if (SDL_Vulkan_CreateSurface(target.window, instance, &target.surface) != SDL_TRUE)
+		{
+			throw std::runtime_error("[!] Failed to create vulkan surface window.");
+			std::exit(-1);
+		}
+	}
+}
+
+
+// Retrieve Swap Chain Property Info
+Renderer::SwapChainProperties Renderer::querySwapChainProp(VkPhysicalDevice device, VkSurfaceKHR surface)
+{
+	SwapChainProperties properties{};
+	uint32_t format_count;
+	uint32_t mode_count;
+
+	// Get Surface Capabilities
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &properties.extentCapabilities);
+
+	// Get Surface Formats
+	vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &format_count, nullptr);
+	properties.surfaceFormats.resize(format_count);
+	vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &format_count, properties.surfaceFormats.data());
+
+	// Get Presentation Mode
+	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &mode_count, nullptr);
+	properties.presentModes.resize(mode_count);
+	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &mode_count, properties.presentModes.data());
+
+	return properties;
+}
+
+
+void Renderer::setSwapChainProp(SwapChainProperties& availableProperties, RenderWindow& target)
+{
+	// Set Surface Format
+	for (const auto& availableFormat : availableProperties.surfaceFormats) {
+		if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+			availableProperties.format = availableFormat;
+			break;
+		}
+		else
+		{
+			availableProperties.format = availableProperties.surfaceFormats[0];
+		}
+	}
+
+	// Set Presentation Mode
+	for (const auto& availablePresentMode : availableProperties.presentModes) {
+		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+			availableProperties.mode = availablePresentMode;
+			break;
+		}
+		else
+		{
+			availableProperties.mode = VK_PRESENT_MODE_FIFO_KHR;
+		}
+	}
+
+	// Set Resolution Extent Capabilities
+	if (availableProperties.extentCapabilities.currentExtent.width != UINT32_MAX) 
+	{
+		availableProperties.extent = availableProperties.extentCapabilities.currentExtent;
+	}
+	else 
+	{
+		int width, height;
+		SDL_Vulkan_GetDrawableSize(target.window, &width, &height);
+
+
+		VkExtent2D actualExtent = {
+			static_cast<uint32_t>(width),
+			static_cast<uint32_t>(height)
+		};
+
+		availableProperties.extent = actualExtent;
+		throw std::runtime_error("[!] Resolution Error: Swap Chain Extent is set past the maximum!");
+		std::exit(-1);
+	}
+
+}
+
+
+void Renderer::createSwapChain(RenderWindow& target)
+{
+	// Query Physical Device's Swap Chain Properties
+	SwapChainProperties swapChainProperties = querySwapChainProp(physical_device, target.surface);
+
+	// Set Swap Chain Properties with available criteria
+	setSwapChainProp(swapChainProperties, target);
+
+	// Windows share one render pass, so they must share a format
+	if (&target != &windows[0] && swapChainProperties.format.format != windows[0].image_format)
+	{
+		throw std::runtime_error("[!] Swap Chain Error - Window surface format differs from the main window.");
+		std::exit(-1);
+	}
+
+	uint32_t image_count = swapChainProperties.extentCapabilities.minImageCount + 1;
+
+	if (swapChainProperties.extentCapabilities.maxImageCount > 0 && image_count > swapChainProperties.extentCapabilities.maxImageCount)
+	{
+		image_count = swapChainProperties.extentCapabilities.maxImageCount;
+	}
+
+	// Create Swap Chain Info
+	VkSwapchainCreateInfoKHR createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	createInfo.surface = target.surface;
+	createInfo.minImageCount = image_count;
+	createInfo.imageFormat = swapChainProperties.format.format;
+	createInfo.imageColorSpace = swapChainProperties.format.colorSpace;
+	createInfo.imageExtent = swapChainProperties.extent;
+	createInfo.imageArrayLayers = 1;
+	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+	// Frame export copies straight out of the main window's swap chain images
+	if (exporter != nullptr && &target == &windows[0])
+	{
+		if (!(swapChainProperties.extentCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT))
+		{
+			throw std::runtime_error("[!] Swap Chain Error - Surface does not support transfer source usage needed for export.");
+			std::exit(-1);
+		}
+		createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	}
+
+	// Get Queue Family Index for Swap Chain
+	QueueFamilyIndices indices = queryQueueFamilies(physical_device);
+	uint32_t queueFamilyIndices[] = { indices.graphicsFamily, indices.presentFamily };
+
+	// Graphics and Present Family Error Checking
+	if (indices.graphicsFamily != indices.presentFamily)
+	{
+		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		createInfo.queueFamilyIndexCount = 2;							// [!] Might need to change later
+		createInfo.pQueueFamilyIndices = queueFamilyIndices;
+	}
+	else
+	{
+		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		createInfo.queueFamilyIndexCount = 0;
+		createInfo.pQueueFamilyIndices = nullptr; 
+	}
+
+	// Set Swap Chain Property Info
+	createInfo.preTransform = swapChainProperties.extentCapabilities.currentTransform;
+	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	createInfo.presentMode = swapChainProperties.mode;
+	createInfo.clipped = VK_TRUE;
+	createInfo.oldSwapchain = target.swap_chain;			// VK_NULL_HANDLE on first creation
+
+	// Swap Chain Creation Error Handling
+	if (errorHandler(vkCreateSwapchainKHR(device, &createInfo, hostAllocator(), &target.swap_chain)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Swap Chain Error - Failed to create Swap Chain.");
+		std::exit(-1);
+	}
+
+	// Retrieve Swap Chain Images
+	vkGetSwapchainImagesKHR(device, target.swap_chain, &image_count, nullptr);
+	target.images.resize(image_count);
+	vkGetSwapchainImagesKHR(device, target.swap_chain, &image_count, target.images.data());
+
+	target.image_format = swapChainProperties.format.format;
+	target.extent = swapChainProperties.extent;
+}
+
+
+void Renderer::createImageViews(RenderWindow& target)
+{
+	target.image_views.resize(target.images.size());
+
+	for (size_t i = 0; i < target.images.size(); i++) 
+	{
+		VkImageViewCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		createInfo.image = target.images[i];
+		createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		createInfo.format = target.image_format;
+		createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		createInfo.subresourceRange.baseMipLevel = 0;
+		createInfo.subresourceRange.levelCount = 1;
+		createInfo.subresourceRange.baseArrayLayer = 0;
+		createInfo.subresourceRange.layerCount = 1;
+
+		if (errorHandler(vkCreateImageView(device, &createInfo, hostAllocator(), &target.image_views[i])) != VK_SUCCESS) 
+		{
+			throw std::runtime_error("[!] Failed to create image views!");
+			std::exit(-1);
+		}
+	}
+
+}
+
+
+VkShaderModule Renderer::createShaderModule(std::vector<char> &buffer)
+{
+	return createShaderModule(buffer.data(), buffer.size());
+}
+
+
+// SPIR-V blobs in the pack are word aligned, so modules are created from the mapping itself
+VkShaderModule Renderer::loadShaderModule(const std::string& path)
+{
+	auto load_start = std::chrono::steady_clock::now();
+	VkShaderModule shader_module = VK_NULL_HANDLE;
+	const AssetEntry* entry = assets.find(path, AssetType::Shader);
+	if (entry != nullptr) shader_module = createShaderModule(assets.data(*entry), (size_t)entry->size);
+	else
+	{
+		std::vector<char> buffer;
+		readFile(path, buffer);
+		shader_module = createShaderModule(buffer);
+	}
+	countAssetLoad(load_start, entry != nullptr);
+	return shader_module;
+}
+
+
+void Renderer::countAssetLoad(std::chrono::steady_clock::time_point start, bool packed)
+{
+	asset_load_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	asset_loads++;
+	if (packed) asset_loads_packed++;
+}
+
+
+VkShaderModule Renderer::createShaderModule(const void* code, size_t size)
+{
+	VkShaderModule shaderModule;
+	VkShaderModuleCreateInfo create_info{};
+	create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	create_info.codeSize = size;
+	create_info.pCode = reinterpret_cast<const uint32_t*> (code);
+
+	if (errorHandler(vkCreateShaderModule(device, &create_info, hostAllocator(), &shaderModule)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Shader Module Error - Unable to create Shader module.");
+		std::exit(-1);
+	}
+	return shaderModule;
+}
+
+
+void Renderer::createGraphicsPipeline()
+{
+	// Create Shader Module - from the asset pack or the shader directory
+	const char* vert_file = vertex_layout == VertexLayout::Packed ? SHADER_VERT_PACKED_FILE_DIR : SHADER_VERT_FILE_DIR;
+	auto shaderVertModule = loadShaderModule(vert_file);
+	auto shaderFragModule = loadShaderModule(SHADER_FRAG_FILE_DIR);
+
+	// Create Shader Vertices Stage
+	VkPipelineShaderStageCreateInfo vert_create_info {};
+	vert_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vert_create_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vert_create_info.module = shaderVertModule;
+	vert_create_info.pName = "main";
+
+	// Without occlusion culling every draw reads the visible list - the driver drops the phase list path
+	SpecializationConstants vert_constants;
+	vert_constants.set(0, occlusion_culling);
+	vert_create_info.pSpecializationInfo = vert_constants.info();
+
+	// Create Shader Fragment Stage
+	VkPipelineShaderStageCreateInfo frag_create_info{};
+	frag_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	frag_create_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	frag_create_info.module = shaderFragModule;
+	frag_create_info.pName = "main";
+
+	// Create Shader Stages from Fragments & Verticies
+	VkPipelineShaderStageCreateInfo stages[] = { vert_create_info, frag_create_info };
+
+	// Create Vertices - one interleaved binding, formats follow the vertex layout
+	VkVertexInputBindingDescription vertex_binding{};
+	VkVertexInputAttributeDescription vertex_attributes[VERTEX_ATTRIBUTE_COUNT]{};
+	VkPipelineVertexInputStateCreateInfo vertex_input_create_info{};
+	vertex_input_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertex_input_create_info.vertexAttributeDescriptionCount = vertexInputDescription(vertex_layout, vertex_binding, vertex_attributes);
+	vertex_input_create_info.pVertexAttributeDescriptions = vertex_attributes;
+	vertex_input_create_info.vertexBindingDescriptionCount = 1;
+	vertex_input_create_info.pVertexBindingDescriptions = &vertex_binding;
+
+	VkPipelineInputAssemblyStateCreateInfo assembly_create_info{};
+	assembly_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	assembly_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	assembly_create_info.primitiveRestartEnable = VK_FALSE;
+
+	// Create Viewport Pipeline - viewport and scissor are dynamic so resizes keep the pipeline
+	VkPipelineViewportStateCreateInfo viewport_create_info{};
+	viewport_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewport_create_info.viewportCount = 1;
+	viewport_create_info.pViewports = nullptr;
+	viewport_create_info.scissorCount = 1;  // Currently only 1 scissor implemented
+	viewport_create_info.pScissors = nullptr;
+
+	VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamic_create_info{};
+	dynamic_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamic_create_info.dynamicStateCount = 2;
+	dynamic_create_info.pDynamicStates = dynamic_states;
+
+	// Create Rasterizor
+	VkPipelineRasterizationStateCreateInfo rasterizer_create_info{};
+	rasterizer_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer_create_info.depthClampEnable = VK_FALSE;
+	rasterizer_create_info.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer_create_info.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer_create_info.lineWidth = 1.0f;
+	rasterizer_create_info.cullMode = VK_CULL_MODE_BACK_BIT;
+	rasterizer_create_info.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizer_create_info.depthBiasEnable = VK_FALSE;
+
+	// Create Multisampling
+	VkPipelineMultisampleStateCreateInfo multisample_create_info{};
+	multisample_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisample_create_info.sampleShadingEnable = VK_FALSE;
+	multisample_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;						// Come back and play around with this value
+
+	// Create Color Blend Attachments
+	VkPipelineColorBlendAttachmentState color_blend_attachment{};
+	color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	color_blend_attachment.blendEnable = VK_FALSE;
+
+	// Create Color Blending Pipeline
+	VkPipelineColorBlendStateCreateInfo color_blend_create_info{};
+	color_blend_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	color_blend_create_info.logicOpEnable = VK_FALSE;
+	color_blend_create_info.logicOp = VK_LOGIC_OP_COPY;
+	color_blend_create_info.attachmentCount = 1;
+	color_blend_create_info.pAttachments = &color_blend_attachment;
+	color_blend_create_info.blendConstants[0] = 0.0f;
+	color_blend_create_info.blendConstants[1] = 0.0f;
+	color_blend_create_info.blendConstants[2] = 0.0f;
+	color_blend_create_info.blendConstants[3] = 0.0f;
+
+	// Create Depth Testing - the occlusion phases share one depth buffer
+	VkPipelineDepthStencilStateCreateInfo depth_create_info{};
+	depth_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depth_create_info.depthTestEnable = VK_TRUE;
+	depth_create_info.depthWriteEnable = VK_TRUE;
+	depth_create_info.depthCompareOp = VK_COMPARE_OP_LESS;
+	depth_create_info.depthBoundsTestEnable = VK_FALSE;
+	depth_create_info.stencilTestEnable = VK_FALSE;
+
+	// Create Pipeline Layout - the push constant picks the frustum list or an occlusion phase list
+	VkPushConstantRange push_range{};
+	push_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	push_range.offset = 0;
+	push_range.size = sizeof(ScenePush);
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	VkDescriptorSetLayout set_layouts[2] = { instances.setLayout(), lighting.setLayout() };
+	pipeline_layout_create_info.setLayoutCount = 2;
+	pipeline_layout_create_info.pSetLayouts = set_layouts;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_range;
+
+	// Pipeline layout error handling
+	if (errorHandler(vkCreatePipelineLayout(device, &pipeline_layout_create_info, hostAllocator(), &pipelineLayout)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create pipeline layout!");
+		std::exit(-1);
+	}
+
+	// Create Pipeline
+	VkGraphicsPipelineCreateInfo pipeline_create_info{};
+	pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipeline_create_info.stageCount = 2;
+	pipeline_create_info.pStages = stages;
+	pipeline_create_info.pVertexInputState = &vertex_input_create_info;
+	pipeline_create_info.pInputAssemblyState = &assembly_create_info;
+	pipeline_create_info.pViewportState = &viewport_create_info;
+	pipeline_create_info.pRasterizationState = &rasterizer_create_info;
+	pipeline_create_info.pMultisampleState = &multisample_create_info;
+	pipeline_create_info.pDepthStencilState = &depth_create_info;
+	pipeline_create_info.pColorBlendState = &color_blend_create_info;
+	pipeline_create_info.pDynamicState = &dynamic_create_info;
+	pipeline_create_info.layout = pipelineLayout;
+	pipeline_create_info.renderPass = render_pass;
+	pipeline_create_info.subpass = 0;
+	pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
+
+	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_create_info, hostAllocator(), &graphicsPipeline) != VK_SUCCESS) 
+	{
+		throw std::runtime_error("[!] Failed to create graphics pipeline!");
+		std::exit(-1);
+	}
+
+	// Same state for phase 1, whose render pass has no post attachments
+	occlusion_pipeline = VK_NULL_HANDLE;
+	if (occlusion_pass != VK_NULL_HANDLE)
+	{
+		pipeline_create_info.renderPass = occlusion_pass;
+		if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_create_info, hostAllocator(), &occlusion_pipeline) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[!] Failed to create occlusion pipeline!");
+			std::exit(-1);
+		}
+	}
+
+	// Destroy Shader Module 
+	vkDestroyShaderModule(device, shaderFragModule, hostAllocator());
+	vkDestroyShaderModule(device, shaderVertModule, hostAllocator());
+}
+
+
+// Compute side of occlusion culling - reads the instance set, so it outlives render pass rebuilds
+// Quantized either way so the savings are reported, only the chosen layout is uploaded
+void Renderer::createMesh()
+{
+	// The pack's base mesh replaces the triangle - full layout vertices are copied straight out of the mapping
+	auto load_start = std::chrono::steady_clock::now();
+	const Vertex* vertices = TRIANGLE_VERTICES;
+	size_t vertex_count = sizeof(TRIANGLE_VERTICES) / sizeof(TRIANGLE_VERTICES[0]);
+	const AssetEntry* entry = assets.find(MESH_BASE_ASSET, AssetType::Mesh);
+	if (entry != nullptr)
+	{
+		// A blob that is not whole full layout vertices was packed from something else - reject it rather than read past it
+		if (entry->size == 0 || entry->size % sizeof(Vertex) != 0)
+		{
+			throw std::runtime_error("[!] Mesh Error - " + std::string(MESH_BASE_ASSET) + " is " + std::to_string(entry->size) + " bytes, not a whole number of "
+				+ std::to_string(sizeof(Vertex)) + " byte vertices.");
+			std::exit(-1);
+		}
+		assets.willNeed(*entry);
+		vertices = reinterpret_cast<const Vertex*>(assets.data(*entry));
+		vertex_count = (size_t)(entry->size / sizeof(Vertex));
+		mesh_name = "base";
+	}
+	std::vector <PackedVertex> packed(vertex_count);
+	mesh_stats = quantizeVertices(vertices, vertex_count, packed.data(), mesh_quantization);
+	mesh_vertex_count = mesh_stats.vertex_count;
+
+	// Object space bounds, transformed per instance for culling
+	mesh_bounds = { { vertices[0].position[0], vertices[0].position[1], vertices[0].position[2] }, { vertices[0].position[0], vertices[0].position[1], vertices[0].position[2] } };
+	for (size_t i = 1; i < vertex_count; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			mesh_bounds.min[axis] = std::min(mesh_bounds.min[axis], vertices[i].position[axis]);
+			mesh_bounds.max[axis] = std::max(mesh_bounds.max[axis], vertices[i].position[axis]);
+		}
+	}
+
+	const bool use_packed = vertex_layout == VertexLayout::Packed;
+	const void* source = use_packed ? (const void*)packed.data() : (const void*)vertices;
+	const VkDeviceSize size = use_packed ? mesh_stats.packed_bytes : mesh_stats.full_bytes;
+	createBuffer(device, physical_device, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, mesh_buffer, mesh_memory);
+
+	void* mapped = nullptr;
+	if (errorHandler(vkMapMemory(device, mesh_memory, 0, size, 0, &mapped)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to map mesh vertex buffer.");
+		std::exit(-1);
+	}
+	std::memcpy(mapped, source, (size_t)size);
+	vkUnmapMemory(device, mesh_memory);
+	if (entry != nullptr) assets.dontNeed(*entry);
+	countAssetLoad(load_start, entry != nullptr);
+
+	std::cout << "\n[Mesh] " << mesh_name << ": " << mesh_stats.vertex_count << " vertices, " << mesh_stats.full_bytes << " bytes full, " << mesh_stats.packed_bytes
+		<< " bytes packed (" << (100 - mesh_stats.packed_bytes * 100 / std::max<size_t>(mesh_stats.full_bytes, 1)) << "% smaller), max position error "
+		<< mesh_stats.max_position_error << ", drawing " << (use_packed ? "packed" : "full") << "\n";
+}
+
+
+// Levels go straight from the container or the transcoder into the staging mapping, then one copy per level
+//  - Only textures the device cannot sample in any block format are expanded to RGBA8
+void Renderer::loadTexture(const std::string& path)
+{
+	// Parsed in place when the asset pack holds the file, so level data is read once, by the copy into staging
+	auto load_start = std::chrono::steady_clock::now();
+	Ktx2Texture source;
+	const AssetEntry* entry = assets.find(path, AssetType::Texture);
+	if (entry != nullptr)
+	{
+		assets.willNeed(*entry);
+		loadKtx2(path, assets.data(*entry), (size_t)entry->size, source);
+	}
+	else loadKtx2(path, source);
+
+	Texture texture;
+	texture.name = path;
+	texture.format = chooseTextureFormat(physical_device, source, texture.upload);
+	texture.width = source.width;
+	texture.height = source.height;
+	texture.levels = source.levels;
+
+	// Staging layout - levels back to back, each offset aligned for the copy
+	VkDeviceSize offsets[TEXTURE_MAX_LEVELS];
+	VkDeviceSize staging_size = 0;
+	for (uint32_t level = 0; level < texture.levels; level++)
+	{
+		uint32_t width = std::max(texture.width >> level, 1u);
+		uint32_t height = std::max(texture.height >> level, 1u);
+		VkDeviceSize size = textureLevelSize(texture.format, width, height);
+		offsets[level] = staging_size;
+		staging_size = (staging_size + size + TEXTURE_LEVEL_ALIGNMENT - 1) & ~(VkDeviceSize)(TEXTURE_LEVEL_ALIGNMENT - 1);
+		texture.bytes += size;
+		texture.rgba_bytes += (VkDeviceSize)width * height * 4;
+	}
+
+	VkBuffer staging_buffer = VK_NULL_HANDLE;
+	VkDeviceMemory staging_memory = VK_NULL_HANDLE;
+	createBuffer(device, physical_device, staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_memory);
+
+	void* mapped = nullptr;
+	if (errorHandler(vkMapMemory(device, staging_memory, 0, staging_size, 0, &mapped)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to map texture staging buffer.");
+		std::exit(-1);
+	}
+
+	// No frame is in flight yet, the current slot's arena is free until the first drawFrame() resets it
+	FrameArena& arena = frame_arenas[frame_number % FRAME_ARENA_SLOTS];
+	writeTextureLevels(source, texture.format, static_cast<uint8_t*>(mapped), offsets, jobs, arena);
+	arena.reset();
+	vkUnmapMemory(device, staging_memory);
+	if (entry != nullptr) assets.dontNeed(*entry);
+	countAssetLoad(load_start, entry != nullptr);
+
+	// Sampled image with the full chain
+	VkImageCreateInfo image_create_info{};
+	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.imageType = VK_IMAGE_TYPE_2D;
+	image_create_info.format = texture.format;
+	image_create_info.extent = { texture.width, texture.height, 1 };
+	image_create_info.mipLevels = texture.levels;
+	image_create_info.arrayLayers = 1;
+	image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (errorHandler(vkCreateImage(device, &image_create_info, hostAllocator(), &texture.image)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create texture image.");
+		std::exit(-1);
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(device, texture.image, &requirements);
+
+	VkMemoryAllocateInfo alloc_info{};
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = requirements.size;
+	alloc_info.memoryTypeIndex = findMemoryType(physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (alloc_info.memoryTypeIndex == UINT32_MAX || errorHandler(vkAllocateMemory(device, &alloc_info, hostAllocator(), &texture.memory)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to allocate texture memory.");
+		std::exit(-1);
+	}
+	vkBindImageMemory(device, texture.image, texture.memory, 0);
+
+	VkImageViewCreateInfo view_create_info{};
+	view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_create_info.image = texture.image;
+	view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_create_info.format = texture.format;
+	view_create_info.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.levels, 0, 1 };
+
+	if (errorHandler(vkCreateImageView(device, &view_create_info, hostAllocator(), &texture.view)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create texture image view.");
+		std::exit(-1);
+	}
+
+	// One-off upload on the graphics queue - its timeline value is waited on before the staging buffer goes
+	VkCommandBufferAllocateInfo command_buffer_alloc_info{};
+	command_buffer_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	command_buffer_alloc_info.commandPool = commandPool;
+	command_buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	command_buffer_alloc_info.commandBufferCount = 1;
+
+	VkCommandBuffer upload_commands = VK_NULL_HANDLE;
+	if (errorHandler(vkAllocateCommandBuffers(device, &command_buffer_alloc_info, &upload_commands)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to allocate texture upload Command buffer!");
+		std::exit(-1);
+	}
+
+	VkCommandBufferBeginInfo command_buffer_begin_info{};
+	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(upload_commands, &command_buffer_begin_info);
+
+	VkImageMemoryBarrier to_transfer{};
+	to_transfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	to_transfer.srcAccessMask = 0;
+	to_transfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	to_transfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	to_transfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	to_transfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	to_transfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	to_transfer.image = texture.image;
+	to_transfer.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.levels, 0, 1 };
+	vkCmdPipelineBarrier(upload_commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &to_transfer);
+
+	VkBufferImageCopy regions[TEXTURE_MAX_LEVELS]{};
+	for (uint32_t level = 0; level < texture.levels; level++)
+	{
+		regions[level].bufferOffset = offsets[level];
+		regions[level].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		regions[level].imageOffset = { 0, 0, 0 };
+		regions[level].imageExtent = { std::max(texture.width >> level, 1u), std::max(texture.height >> level, 1u), 1 };
+	}
+	vkCmdCopyBufferToImage(upload_commands, staging_buffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture.levels, regions);
+
+	VkImageMemoryBarrier to_shader = to_transfer;
+	to_shader.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	to_shader.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	to_shader.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	to_shader.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier(upload_commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &to_shader);
+
+	if (vkEndCommandBuffer(upload_commands) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record command buffer!");
+		std::exit(-1);
+	}
+
+	uint64_t value = scheduler.submit(graphics_queue, QueueKind::Graphics, &upload_commands, 1, {});
+	metrics.submits.fetch_add(1, std::memory_order_relaxed);
+	scheduler.wait(QueueKind::Graphics, value);
+
+	vkFreeCommandBuffers(device, commandPool, 1, &upload_commands);
+	vkDestroyBuffer(device, staging_buffer, hostAllocator());
+	vkFreeMemory(device, staging_memory, hostAllocator());
+
+	static const char* upload_names[] = { "copied", "transcoded", "decoded" };
+	std::cout << "\n[Texture] " << path << ": " << texture.width << "x" << texture.height << ", " << texture.levels << " levels, "
+		<< upload_names[(int)texture.upload] << " to " << textureFormatName(texture.format) << ", " << (texture.bytes >> 10) << " KiB (RGBA8 "
+		<< (texture.rgba_bytes >> 10) << " KiB, " << (100 - texture.bytes * 100 / std::max<VkDeviceSize>(texture.rgba_bytes, 1)) << "% smaller)\n";
+
+	metrics.texture_bytes.fetch_add(texture.bytes, std::memory_order_relaxed);
+	metrics.texture_rgba_bytes.fetch_add(texture.rgba_bytes, std::memory_order_relaxed);
+	textures.push_back(texture);
+}
+
+
+void Renderer::createOcclusionPipelines()
+{
+	auto shaderSelectModule = loadShaderModule(SHADER_OCCLUSION_SELECT_FILE_DIR);
+	auto shaderReduceModule = loadShaderModule(SHADER_HIZ_REDUCE_FILE_DIR);
+	auto shaderTestModule = loadShaderModule(SHADER_OCCLUSION_TEST_FILE_DIR);
+	occlusion.createPipelines(instances.setLayout(), shaderSelectModule, shaderReduceModule, shaderTestModule);
+
+	vkDestroyShaderModule(device, shaderTestModule, hostAllocator());
+	vkDestroyShaderModule(device, shaderReduceModule, hostAllocator());
+	vkDestroyShaderModule(device, shaderSelectModule, hostAllocator());
 }
 
 
-void Renderer::createImageViews()
+// Subpass 0 draws the scene, each enabled post effect adds a subpass reading the previous output
+//  - Intermediates alternate between attachments 1 and 2 and never leave tile memory
+//  - The last subpass writes the swap chain image, or the scaled image the upscale pass samples
+//  - Depth is the last attachment - with occlusion culling subpass 0 is phase 2 and loads color and depth from phase 1
+void Renderer::createRenderPass()
 {
-	swapChainImageViews.resize(swapChainImages.size());
+	const uint32_t post_count = static_cast<uint32_t>(post_effects.size());
+	const uint32_t intermediate_count = std::min(post_count, 2u);
+	const uint32_t depth_index = 1 + intermediate_count;
+
+	std::vector<VkAttachmentDescription> attachments(2 + intermediate_count);
+
+	// Color Attachment for Render Pass
+	VkAttachmentDescription& color_attachment = attachments[0];
+	color_attachment.format = windows[0].image_format;
+	color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	color_attachment.loadOp = post_count > 0 ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : VK_ATTACHMENT_LOAD_OP_CLEAR;
+	color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	color_attachment.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	if (dynamic_resolution) color_attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-	for (size_t i = 0; i < swapChainImages.size(); i++) 
+	// Post Intermediates - contents are dead once the render pass ends
+	for (uint32_t i = 1; i <= intermediate_count; i++)
 	{
-		VkImageViewCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		createInfo.image = swapChainImages[i];
-		createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		createInfo.format = swap_chain_image_format;
-		createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-		createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-		createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-		createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-		createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		createInfo.subresourceRange.baseMipLevel = 0;
-		createInfo.subresourceRange.levelCount = 1;
-		createInfo.subresourceRange.baseArrayLayer = 0;
-		createInfo.subresourceRange.layerCount = 1;
+		attachments[i].format = post_format;
+		attachments[i].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[i].loadOp = (i == 1) ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[i].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[i].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	}
+
+	// Depth Attachment - sampled by the pyramid reduction between the phases, dead after the scene subpass
+	VkAttachmentDescription& depth_attachment = attachments[depth_index];
+	depth_attachment.format = OcclusionCuller::DEPTH_FORMAT;
+	depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depth_attachment.loadOp = occlusion_culling ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depth_attachment.initialLayout = occlusion_culling ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+	depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	// Phase 1 already cleared and drew the scene color
+	if (occlusion_culling)
+	{
+		VkAttachmentDescription& scene_attachment = attachments[post_count > 0 ? 1 : 0];
+		scene_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		scene_attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	}
+
+	// Color Attachment References - one output per subpass, one input per post subpass
+	std::vector<VkAttachmentReference> color_refs(1 + post_count);
+	std::vector<VkAttachmentReference> input_refs(post_count);
+	std::vector<VkSubpassDescription> subpasses(1 + post_count);
+
+	uint32_t output = post_count > 0 ? 1 : 0;
+	color_refs[0].attachment = output;
+	color_refs[0].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depth_ref{};
+	depth_ref.attachment = depth_index;
+	depth_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	// Subpass Description
+	subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpasses[0].colorAttachmentCount = 1;
+	subpasses[0].pColorAttachments = &color_refs[0];
+	subpasses[0].pDepthStencilAttachment = &depth_ref;
+
+	for (uint32_t s = 1; s <= post_count; s++)
+	{
+		input_refs[s - 1].attachment = output;
+		input_refs[s - 1].layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		output = (s == post_count) ? 0 : (output == 1 ? 2 : 1);
+		color_refs[s].attachment = output;
+		color_refs[s].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		subpasses[s].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpasses[s].inputAttachmentCount = 1;
+		subpasses[s].pInputAttachments = &input_refs[s - 1];
+		subpasses[s].colorAttachmentCount = 1;
+		subpasses[s].pColorAttachments = &color_refs[s];
+	}
+
+	// Subpass Dependencies - by region so tilers keep the chain on chip
+	//  - Depth is rewritten every frame, so the previous frame's depth writes come first
+	std::vector<VkSubpassDependency> dependencies;
+	VkSubpassDependency external{};
+	external.srcSubpass = VK_SUBPASS_EXTERNAL;
+	external.dstSubpass = 0;
+	external.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	external.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	external.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	external.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	if (occlusion_culling)
+	{
+		// Phase 1 color is loaded, and the reduction must finish sampling depth before it is written again
+		external.srcStageMask |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		external.srcAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		external.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+	}
+	if (dynamic_resolution)
+	{
+		// The previous upscale finished sampling the scaled image
+		external.srcStageMask |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	}
+	dependencies.push_back(external);
+
+	// Upscale pass samples the scaled image
+	if (dynamic_resolution)
+	{
+		VkSubpassDependency upscale{};
+		upscale.srcSubpass = post_count;
+		upscale.dstSubpass = VK_SUBPASS_EXTERNAL;
+		upscale.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		upscale.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		upscale.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		upscale.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		dependencies.push_back(upscale);
+	}
+	for (uint32_t s = 1; s <= post_count; s++)
+	{
+		VkSubpassDependency chain{};
+		chain.srcSubpass = s - 1;
+		chain.dstSubpass = s;
+		chain.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		chain.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		chain.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+		chain.dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		chain.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+		dependencies.push_back(chain);
+	}
 
-		if (errorHandler(vkCreateImageView(device, &createInfo, nullptr, &swapChainImageViews[i])) != VK_SUCCESS) 
+	// Render Pass Info
+	VkRenderPassCreateInfo render_pass_create_info{};
+	render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	render_pass_create_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+	render_pass_create_info.pAttachments = attachments.data();
+	render_pass_create_info.subpassCount = static_cast<uint32_t>(subpasses.size());
+	render_pass_create_info.pSubpasses = subpasses.data();
+	render_pass_create_info.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	render_pass_create_info.pDependencies = dependencies.data();
+
+	// Error Handling
+	if (vkCreateRenderPass(device, &render_pass_create_info, hostAllocator(), &render_pass) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create Render pass.");
+		std::exit(-1);
+	}
+}
+
+
+// Phase 1 of occlusion culling - the scene subpass on its own, so compute can build the pyramid before phase 2
+//  - Scene color is the swap chain or scaled image, or the first post intermediate when post effects run
+//  - Depth ends read-only for the reduction, the main render pass writes it again
+void Renderer::createOcclusionPass()
+{
+	occlusion_pass = VK_NULL_HANDLE;
+	if (!occlusion_culling) return;
+
+	VkAttachmentDescription attachments[2]{};
+	attachments[0].format = post_effects.empty() ? windows[0].image_format : post_format;
+	attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	attachments[1] = attachments[0];
+	attachments[1].format = OcclusionCuller::DEPTH_FORMAT;
+	attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+	VkAttachmentReference color_ref{};
+	color_ref.attachment = 0;
+	color_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depth_ref{};
+	depth_ref.attachment = 1;
+	depth_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &color_ref;
+	subpass.pDepthStencilAttachment = &depth_ref;
+
+	// In - the previous frame's writes to the same images, out - the reduction samples depth
+	VkSubpassDependency dependencies[2]{};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	if (dynamic_resolution) dependencies[0].srcStageMask |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	VkRenderPassCreateInfo render_pass_create_info{};
+	render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	render_pass_create_info.attachmentCount = 2;
+	render_pass_create_info.pAttachments = attachments;
+	render_pass_create_info.subpassCount = 1;
+	render_pass_create_info.pSubpasses = &subpass;
+	render_pass_create_info.dependencyCount = 2;
+	render_pass_create_info.pDependencies = dependencies;
+
+	if (vkCreateRenderPass(device, &render_pass_create_info, hostAllocator(), &occlusion_pass) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create occlusion Render pass.");
+		std::exit(-1);
+	}
+}
+
+void Renderer::createFrameBuffers(RenderWindow& target)
+{
+	// Resize container to hold all of the Frame buffers
+	target.frame_buffers.resize(target.image_views.size());
+
+	// Iterate through the image views and create framebuffers from them
+	for (size_t i = 0; i < target.image_views.size(); i++)
+	{
+		// Swap chain or scaled image first, then the post intermediates in attachment order, then depth
+		std::vector<VkImageView> attachments = { dynamic_resolution ? target.scaled_view : target.image_views[i] };
+		for (uint32_t j = 0; j < 2 && target.post_views[j] != VK_NULL_HANDLE; j++)
 		{
-			throw std::runtime_error("[!] Failed to create image views!");
+			attachments.push_back(target.post_views[j]);
+		}
+		attachments.push_back(target.occlusion.depth_view);
+
+		// Create Frame Buffer Info
+		VkFramebufferCreateInfo frame_buffer_create_info{};
+		frame_buffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		frame_buffer_create_info.renderPass = render_pass;
+		frame_buffer_create_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+		frame_buffer_create_info.pAttachments = attachments.data();
+		frame_buffer_create_info.width = target.extent.width;
+		frame_buffer_create_info.height = target.extent.height;
+		frame_buffer_create_info.layers = 1;
+
+		// Error Handling
+		if (errorHandler(vkCreateFramebuffer(device, &frame_buffer_create_info, hostAllocator(), &target.frame_buffers[i])) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[!] Failed to Create Framebuffer.");
+			std::exit(-1);
+		}
+	}
+
+	// Phase 1 writes the scene color the main pass loads
+	target.occlusion_frame_buffers.clear();
+	if (occlusion_pass == VK_NULL_HANDLE) return;
+
+	target.occlusion_frame_buffers.resize(target.image_views.size());
+	for (size_t i = 0; i < target.image_views.size(); i++)
+	{
+		VkImageView scene_color = dynamic_resolution ? target.scaled_view : target.image_views[i];
+		VkImageView attachments[2] = { post_effects.empty() ? scene_color : target.post_views[0], target.occlusion.depth_view };
+
+		VkFramebufferCreateInfo frame_buffer_create_info{};
+		frame_buffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		frame_buffer_create_info.renderPass = occlusion_pass;
+		frame_buffer_create_info.attachmentCount = 2;
+		frame_buffer_create_info.pAttachments = attachments;
+		frame_buffer_create_info.width = target.extent.width;
+		frame_buffer_create_info.height = target.extent.height;
+		frame_buffer_create_info.layers = 1;
+
+		if (errorHandler(vkCreateFramebuffer(device, &frame_buffer_create_info, hostAllocator(), &target.occlusion_frame_buffers[i])) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[!] Failed to Create occlusion Framebuffer.");
+			std::exit(-1);
+		}
+	}
+}
+
+
+void Renderer::createDebugPipeline()
+{
+	auto shaderVertModule = loadShaderModule(SHADER_DEBUG_VERT_FILE_DIR);
+	auto shaderFragModule = loadShaderModule(SHADER_DEBUG_FRAG_FILE_DIR);
+
+	DebugDraw::instance().createPipeline(shaderVertModule, shaderFragModule);
+	vkDestroyShaderModule(device, shaderFragModule, hostAllocator());
+	vkDestroyShaderModule(device, shaderVertModule, hostAllocator());
+}
+
+
+// Only the swap chain image is attached, so post chain rebuilds leave these alone
+void Renderer::createDebugFrameBuffers(RenderWindow& target)
+{
+	target.debug_frame_buffers.resize(target.image_views.size());
+	for (size_t i = 0; i < target.image_views.size(); i++)
+	{
+		VkFramebufferCreateInfo frame_buffer_create_info{};
+		frame_buffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		frame_buffer_create_info.renderPass = DebugDraw::instance().renderPass();
+		frame_buffer_create_info.attachmentCount = 1;
+		frame_buffer_create_info.pAttachments = &target.image_views[i];
+		frame_buffer_create_info.width = target.extent.width;
+		frame_buffer_create_info.height = target.extent.height;
+		frame_buffer_create_info.layers = 1;
+
+		if (errorHandler(vkCreateFramebuffer(device, &frame_buffer_create_info, hostAllocator(), &target.debug_frame_buffers[i])) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[!] Failed to Create debug Framebuffer.");
+			std::exit(-1);
+		}
+	}
+}
+
+
+// One pipeline per post subpass - fullscreen triangle, input attachment in, push constants for parameters
+void Renderer::createPostPipelines()
+{
+	post_pipelines.clear();
+	if (post_effects.empty()) return;
+
+	// Descriptor Set Layout - previous subpass output as an input attachment
+	VkDescriptorSetLayoutBinding input_binding{};
+	input_binding.binding = 0;
+	input_binding.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+	input_binding.descriptorCount = 1;
+	input_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo set_layout_create_info{};
+	set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	set_layout_create_info.bindingCount = 1;
+	set_layout_create_info.pBindings = &input_binding;
+
+	if (errorHandler(vkCreateDescriptorSetLayout(device, &set_layout_create_info, hostAllocator(), &post_set_layout)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create post descriptor set layout!");
+		std::exit(-1);
+	}
+
+	// Pipeline Layout - shared by every effect
+	VkPushConstantRange push_range{};
+	push_range.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	push_range.offset = 0;
+	push_range.size = sizeof(PostParams);
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount = 1;
+	pipeline_layout_create_info.pSetLayouts = &post_set_layout;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_range;
+
+	if (errorHandler(vkCreatePipelineLayout(device, &pipeline_layout_create_info, hostAllocator(), &post_layout)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create post pipeline layout!");
+		std::exit(-1);
+	}
+
+	// Shared Vertex Stage
+	auto shaderVertModule = loadShaderModule(SHADER_POST_VERT_FILE_DIR);
+
+	VkPipelineShaderStageCreateInfo vert_create_info{};
+	vert_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vert_create_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vert_create_info.module = shaderVertModule;
+	vert_create_info.pName = "main";
+
+	// Fixed Function State - no vertex input, no culling
+	VkPipelineVertexInputStateCreateInfo vertex_input_create_info{};
+	vertex_input_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo assembly_create_info{};
+	assembly_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	assembly_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	assembly_create_info.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo viewport_create_info{};
+	viewport_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewport_create_info.viewportCount = 1;
+	viewport_create_info.scissorCount = 1;
+
+	VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamic_create_info{};
+	dynamic_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamic_create_info.dynamicStateCount = 2;
+	dynamic_create_info.pDynamicStates = dynamic_states;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer_create_info{};
+	rasterizer_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer_create_info.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer_create_info.lineWidth = 1.0f;
+	rasterizer_create_info.cullMode = VK_CULL_MODE_NONE;
+	rasterizer_create_info.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisample_create_info{};
+	multisample_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisample_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineColorBlendAttachmentState color_blend_attachment{};
+	color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	color_blend_attachment.blendEnable = VK_FALSE;
+
+	VkPipelineColorBlendStateCreateInfo color_blend_create_info{};
+	color_blend_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	color_blend_create_info.attachmentCount = 1;
+	color_blend_create_info.pAttachments = &color_blend_attachment;
+
+	// One Pipeline per Effect, bound to its subpass
+	for (size_t i = 0; i < post_effects.size(); i++)
+	{
+		static const char* fragment_files[] = { SHADER_POST_TONEMAP_FILE_DIR, SHADER_POST_GRADE_FILE_DIR, SHADER_POST_VIGNETTE_FILE_DIR };
+
+		auto shaderFragModule = loadShaderModule(fragment_files[static_cast<uint32_t>(post_effects[i])]);
+
+		VkPipelineShaderStageCreateInfo frag_create_info{};
+		frag_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		frag_create_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		frag_create_info.module = shaderFragModule;
+		frag_create_info.pName = "main";
+
+		VkPipelineShaderStageCreateInfo stages[] = { vert_create_info, frag_create_info };
+
+		VkGraphicsPipelineCreateInfo pipeline_create_info{};
+		pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipeline_create_info.stageCount = 2;
+		pipeline_create_info.pStages = stages;
+		pipeline_create_info.pVertexInputState = &vertex_input_create_info;
+		pipeline_create_info.pInputAssemblyState = &assembly_create_info;
+		pipeline_create_info.pViewportState = &viewport_create_info;
+		pipeline_create_info.pRasterizationState = &rasterizer_create_info;
+		pipeline_create_info.pMultisampleState = &multisample_create_info;
+		pipeline_create_info.pColorBlendState = &color_blend_create_info;
+		pipeline_create_info.pDynamicState = &dynamic_create_info;
+		pipeline_create_info.layout = post_layout;
+		pipeline_create_info.renderPass = render_pass;
+		pipeline_create_info.subpass = static_cast<uint32_t>(i + 1);
+		pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
+
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_create_info, hostAllocator(), &pipeline);
+		vkDestroyShaderModule(device, shaderFragModule, hostAllocator());
+		if (errorHandler(result) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[!] Failed to create post pipeline!");
+			std::exit(-1);
+		}
+		post_pipelines.push_back(pipeline);
+	}
+
+	// Destroy Shader Module
+	vkDestroyShaderModule(device, shaderVertModule, hostAllocator());
+}
+
+
+// Post intermediates for one target - sized to its extent, transient so tilers need not back them
+//  - Except the scene color under occlusion culling, which phase 1 stores and the main pass loads
+void Renderer::createPostTargets(RenderWindow& target)
+{
+	target.post_sets.clear();
+	if (post_effects.empty()) return;
+
+	const uint32_t post_count = static_cast<uint32_t>(post_effects.size());
+	const uint32_t intermediate_count = std::min(post_count, 2u);
+
+	for (uint32_t i = 0; i < intermediate_count; i++)
+	{
+		VkImageCreateInfo image_create_info{};
+		image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		image_create_info.imageType = VK_IMAGE_TYPE_2D;
+		image_create_info.format = post_format;
+		image_create_info.extent = { target.extent.width, target.extent.height, 1 };
+		image_create_info.mipLevels = 1;
+		image_create_info.arrayLayers = 1;
+		image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+		image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		image_create_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+		if (i > 0 || !occlusion_culling) image_create_info.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (errorHandler(vkCreateImage(device, &image_create_info, hostAllocator(), &target.post_images[i])) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[!] Failed to create post image.");
+			std::exit(-1);
+		}
+
+		// Lazily allocated memory where the device has it, device local otherwise
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(device, target.post_images[i], &requirements);
+
+		VkMemoryAllocateInfo alloc_info{};
+		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		alloc_info.allocationSize = requirements.size;
+		alloc_info.memoryTypeIndex = findMemoryType(physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+		if (alloc_info.memoryTypeIndex == UINT32_MAX)
+		{
+			alloc_info.memoryTypeIndex = findMemoryType(physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		}
+
+		if (alloc_info.memoryTypeIndex == UINT32_MAX || errorHandler(vkAllocateMemory(device, &alloc_info, hostAllocator(), &target.post_memory[i])) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[!] Failed to allocate post image memory.");
+			std::exit(-1);
+		}
+		vkBindImageMemory(device, target.post_images[i], target.post_memory[i], 0);
+
+		VkImageViewCreateInfo view_create_info{};
+		view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		view_create_info.image = target.post_images[i];
+		view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		view_create_info.format = post_format;
+		view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		view_create_info.subresourceRange.baseMipLevel = 0;
+		view_create_info.subresourceRange.levelCount = 1;
+		view_create_info.subresourceRange.baseArrayLayer = 0;
+		view_create_info.subresourceRange.layerCount = 1;
+
+		if (errorHandler(vkCreateImageView(device, &view_create_info, hostAllocator(), &target.post_views[i])) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[!] Failed to create post image view.");
 			std::exit(-1);
 		}
 	}
 
+	// Descriptor Pool - one input attachment set per post subpass
+	VkDescriptorPoolSize pool_size{};
+	pool_size.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+	pool_size.descriptorCount = post_count;
+
+	VkDescriptorPoolCreateInfo pool_create_info{};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets = post_count;
+	pool_create_info.poolSizeCount = 1;
+	pool_create_info.pPoolSizes = &pool_size;
+
+	if (errorHandler(vkCreateDescriptorPool(device, &pool_create_info, hostAllocator(), &target.post_pool)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create post descriptor pool.");
+		std::exit(-1);
+	}
+
+	std::vector<VkDescriptorSetLayout> set_layouts(post_count, post_set_layout);
+	VkDescriptorSetAllocateInfo set_alloc_info{};
+	set_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	set_alloc_info.descriptorPool = target.post_pool;
+	set_alloc_info.descriptorSetCount = post_count;
+	set_alloc_info.pSetLayouts = set_layouts.data();
+
+	target.post_sets.resize(post_count);
+	if (errorHandler(vkAllocateDescriptorSets(device, &set_alloc_info, target.post_sets.data())) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to allocate post descriptor sets.");
+		std::exit(-1);
+	}
+
+	// Post subpass s reads what subpass s - 1 wrote - intermediates alternate
+	std::vector<VkDescriptorImageInfo> image_infos(post_count);
+	std::vector<VkWriteDescriptorSet> writes(post_count);
+	for (uint32_t s = 0; s < post_count; s++)
+	{
+		image_infos[s].imageView = target.post_views[s % 2];
+		image_infos[s].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		writes[s].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[s].dstSet = target.post_sets[s];
+		writes[s].dstBinding = 0;
+		writes[s].descriptorCount = 1;
+		writes[s].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		writes[s].pImageInfo = &image_infos[s];
+	}
+	vkUpdateDescriptorSets(device, post_count, writes.data(), 0, nullptr);
 }
 
 
-VkShaderModule Renderer::createShaderModule(std::vector<char> &buffer)
+void Renderer::retirePostTargets(RenderWindow& target)
 {
-	VkShaderModule shaderModule;
-	VkShaderModuleCreateInfo create_info{};
-	create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	create_info.codeSize = buffer.size();
-	create_info.pCode = reinterpret_cast<const uint32_t*> (buffer.data());
-
-	if (errorHandler(vkCreateShaderModule(device, &create_info, nullptr, &shaderModule)) != VK_SUCCESS)
+	for (uint32_t i = 0; i < 2; i++)
 	{
-		throw std::runtime_error("[!] Shader Module Error - Unable to create Shader module.");
-		std::exit(-1);
+		deletion_queue.retire(DeletionQueue::IMAGE_VIEW, target.post_views[i], frame_number);
+		deletion_queue.retire(DeletionQueue::IMAGE, target.post_images[i], frame_number);
+		deletion_queue.retire(DeletionQueue::MEMORY, target.post_memory[i], frame_number);
+		target.post_views[i] = VK_NULL_HANDLE;
+		target.post_images[i] = VK_NULL_HANDLE;
+		target.post_memory[i] = VK_NULL_HANDLE;
 	}
-	return shaderModule;
+	deletion_queue.retire(DeletionQueue::DESCRIPTOR_POOL, target.post_pool, frame_number);
+	target.post_pool = VK_NULL_HANDLE;
+	target.post_sets.clear();
 }
 
 
-void Renderer::createGraphicsPipeline()
+// Fullscreen triangle sampling the scaled image - its own render pass, a subpass could only read the same pixel
+void Renderer::createUpscalePipeline()
 {
-	// Get Shader Vertices & Fragment from Buffer
-	std::vector<char> shaderVert;
-	std::vector<char> shaderFrag;
-	if (!readFile(SHADER_VERT_FILE_DIR, shaderVert) || !readFile(SHADER_FRAG_FILE_DIR, shaderFrag))
+	// Render Pass - every swap chain pixel is written, nothing is loaded
+	VkAttachmentDescription color_attachment{};
+	color_attachment.format = windows[0].image_format;
+	color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	color_attachment.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	VkAttachmentReference color_ref{};
+	color_ref.attachment = 0;
+	color_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &color_ref;
+
+	// The acquire semaphore waits at color output, the scene pass already made the scaled image readable
+	VkSubpassDependency external{};
+	external.srcSubpass = VK_SUBPASS_EXTERNAL;
+	external.dstSubpass = 0;
+	external.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	external.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	external.srcAccessMask = 0;
+	external.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	VkRenderPassCreateInfo render_pass_create_info{};
+	render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	render_pass_create_info.attachmentCount = 1;
+	render_pass_create_info.pAttachments = &color_attachment;
+	render_pass_create_info.subpassCount = 1;
+	render_pass_create_info.pSubpasses = &subpass;
+	render_pass_create_info.dependencyCount = 1;
+	render_pass_create_info.pDependencies = &external;
+
+	if (vkCreateRenderPass(device, &render_pass_create_info, hostAllocator(), &upscale_pass) != VK_SUCCESS)
 	{
-		throw std::runtime_error("[!] Failed to read file");
+		throw std::runtime_error("[!] Failed to create upscale Render pass.");
 		std::exit(-1);
 	}
 
-	// Create Shader Module
-	auto shaderVertModule = createShaderModule(shaderVert);
-	auto shaderFragModule = createShaderModule(shaderFrag);
+	// Sampler - bilinear, clamped so the stretch never wraps
+	VkSamplerCreateInfo sampler_create_info{};
+	sampler_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	sampler_create_info.magFilter = VK_FILTER_LINEAR;
+	sampler_create_info.minFilter = VK_FILTER_LINEAR;
+	sampler_create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+	if (errorHandler(vkCreateSampler(device, &sampler_create_info, hostAllocator(), &upscale_sampler)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create upscale sampler!");
+		std::exit(-1);
+	}
 
-	// Create Shader Vertices Stage
-	VkPipelineShaderStageCreateInfo vert_create_info {};
-	vert_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vert_create_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vert_create_info.module = shaderVertModule;
-	vert_create_info.pName = "main";
+	// Descriptor Set Layout - the scaled image
+	VkDescriptorSetLayoutBinding scene_binding{};
+	scene_binding.binding = 0;
+	scene_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	scene_binding.descriptorCount = 1;
+	scene_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-	// Create Shader Fragment Stage
-	VkPipelineShaderStageCreateInfo frag_create_info{};
-	frag_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	frag_create_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	frag_create_info.module = shaderFragModule;
-	frag_create_info.pName = "main";
+	VkDescriptorSetLayoutCreateInfo set_layout_create_info{};
+	set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	set_layout_create_info.bindingCount = 1;
+	set_layout_create_info.pBindings = &scene_binding;
 
-	// Create Shader Stages from Fragments & Verticies
-	VkPipelineShaderStageCreateInfo stages[] = { vert_create_info, frag_create_info };
+	if (errorHandler(vkCreateDescriptorSetLayout(device, &set_layout_create_info, hostAllocator(), &upscale_set_layout)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create upscale descriptor set layout!");
+		std::exit(-1);
+	}
 
-	// Create Vertices
+	VkPushConstantRange push_range{};
+	push_range.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	push_range.offset = 0;
+	push_range.size = sizeof(UpscaleParams);
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount = 1;
+	pipeline_layout_create_info.pSetLayouts = &upscale_set_layout;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_range;
+
+	if (errorHandler(vkCreatePipelineLayout(device, &pipeline_layout_create_info, hostAllocator(), &upscale_layout)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create upscale pipeline layout!");
+		std::exit(-1);
+	}
+
+	// Shader Stages - the post chain's fullscreen triangle
+	// Sharpening is a compile time permutation, its strength stays a push constant
+	const char* upscale_file = upscale_sharpness > 0.0f ? SHADER_UPSCALE_SHARPEN_FILE_DIR : SHADER_UPSCALE_FILE_DIR;
+	auto shaderVertModule = loadShaderModule(SHADER_POST_VERT_FILE_DIR);
+	auto shaderFragModule = loadShaderModule(upscale_file);
+
+	VkPipelineShaderStageCreateInfo stages[2]{};
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].module = shaderVertModule;
+	stages[0].pName = "main";
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].module = shaderFragModule;
+	stages[1].pName = "main";
+
+	// Fixed Function State - no vertex input, no culling
 	VkPipelineVertexInputStateCreateInfo vertex_input_create_info{};
 	vertex_input_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertex_input_create_info.vertexBindingDescriptionCount = 0;
-	vertex_input_create_info.pVertexAttributeDescriptions = 0;
 
 	VkPipelineInputAssemblyStateCreateInfo assembly_create_info{};
 	assembly_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 	assembly_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	assembly_create_info.primitiveRestartEnable = VK_FALSE;
-
-	// Create Viewport
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)swap_chain_extent.width;
-	viewport.height = (float)swap_chain_extent.height;
-
-	// Create Scissor for viewport
-	VkRect2D scissor{};
-	scissor.offset = { 0, 0 };
-	scissor.extent = swap_chain_extent;
 
-	// Create Viewport Pipeline
 	VkPipelineViewportStateCreateInfo viewport_create_info{};
 	viewport_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewport_create_info.viewportCount = 1;
-	viewport_create_info.pViewports = &viewport;
-	viewport_create_info.scissorCount = 1;  // Currently only 1 scissor implemented
-	viewport_create_info.pScissors = &scissor;
+	viewport_create_info.scissorCount = 1;
+
+	VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamic_create_info{};
+	dynamic_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamic_create_info.dynamicStateCount = 2;
+	dynamic_create_info.pDynamicStates = dynamic_states;
 
-	// Create Rasterizor
 	VkPipelineRasterizationStateCreateInfo rasterizer_create_info{};
 	rasterizer_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizer_create_info.depthClampEnable = VK_FALSE;
-	rasterizer_create_info.rasterizerDiscardEnable = VK_FALSE;
 	rasterizer_create_info.polygonMode = VK_POLYGON_MODE_FILL;
 	rasterizer_create_info.lineWidth = 1.0f;
-	rasterizer_create_info.cullMode = VK_CULL_MODE_BACK_BIT;
+	rasterizer_create_info.cullMode = VK_CULL_MODE_NONE;
 	rasterizer_create_info.frontFace = VK_FRONT_FACE_CLOCKWISE;
-	rasterizer_create_info.depthBiasEnable = VK_FALSE;
 
-	// Create Multisampling
 	VkPipelineMultisampleStateCreateInfo multisample_create_info{};
 	multisample_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisample_create_info.sampleShadingEnable = VK_FALSE;
-	multisample_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;						// Come back and play around with this value
+	multisample_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
-	// Create Color Blend Attachments
 	VkPipelineColorBlendAttachmentState color_blend_attachment{};
 	color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 	color_blend_attachment.blendEnable = VK_FALSE;
 
-	// Create Color Blending Pipeline
 	VkPipelineColorBlendStateCreateInfo color_blend_create_info{};
 	color_blend_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	color_blend_create_info.logicOpEnable = VK_FALSE;
-	color_blend_create_info.logicOp = VK_LOGIC_OP_COPY;
 	color_blend_create_info.attachmentCount = 1;
 	color_blend_create_info.pAttachments = &color_blend_attachment;
-	color_blend_create_info.blendConstants[0] = 0.0f;
-	color_blend_create_info.blendConstants[1] = 0.0f;
-	color_blend_create_info.blendConstants[2] = 0.0f;
-	color_blend_create_info.blendConstants[3] = 0.0f;
-
-	// Create Pipeline Layout
-	VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
-	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipeline_layout_create_info.setLayoutCount = 0;
-	pipeline_layout_create_info.pushConstantRangeCount = 0;
-
-	// Pipeline layout error handling
-	if (errorHandler(vkCreatePipelineLayout(device, &pipeline_layout_create_info, nullptr, &pipelineLayout)) != VK_SUCCESS)
-	{
-		throw std::runtime_error("[!] Failed to create pipeline layout!");
-		std::exit(-1);
-	}
 
-	// Create Pipeline
 	VkGraphicsPipelineCreateInfo pipeline_create_info{};
 	pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 	pipeline_create_info.stageCount = 2;
@@ -801,172 +2867,681 @@ void Renderer::createGraphicsPipeline()
 	pipeline_create_info.pRasterizationState = &rasterizer_create_info;
 	pipeline_create_info.pMultisampleState = &multisample_create_info;
 	pipeline_create_info.pColorBlendState = &color_blend_create_info;
-	pipeline_create_info.layout = pipelineLayout;
-	pipeline_create_info.renderPass = render_pass;
+	pipeline_create_info.pDynamicState = &dynamic_create_info;
+	pipeline_create_info.layout = upscale_layout;
+	pipeline_create_info.renderPass = upscale_pass;
 	pipeline_create_info.subpass = 0;
-	pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
 
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &graphicsPipeline) != VK_SUCCESS) 
+	VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_create_info, hostAllocator(), &upscale_pipeline);
+	vkDestroyShaderModule(device, shaderFragModule, hostAllocator());
+	vkDestroyShaderModule(device, shaderVertModule, hostAllocator());
+	if (errorHandler(result) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create upscale pipeline!");
+		std::exit(-1);
+	}
+}
+
+
+// Window sized so every scale fits without reallocating - the scale only moves the viewport
+void Renderer::createScaledTarget(RenderWindow& target)
+{
+	target.upscale_frame_buffers.clear();
+	if (!dynamic_resolution) return;
+
+	VkImageCreateInfo image_create_info{};
+	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.imageType = VK_IMAGE_TYPE_2D;
+	image_create_info.format = target.image_format;
+	image_create_info.extent = { target.extent.width, target.extent.height, 1 };
+	image_create_info.mipLevels = 1;
+	image_create_info.arrayLayers = 1;
+	image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (errorHandler(vkCreateImage(device, &image_create_info, hostAllocator(), &target.scaled_image)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create scaled image.");
+		std::exit(-1);
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(device, target.scaled_image, &requirements);
+
+	VkMemoryAllocateInfo alloc_info{};
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = requirements.size;
+	alloc_info.memoryTypeIndex = findMemoryType(physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (alloc_info.memoryTypeIndex == UINT32_MAX || errorHandler(vkAllocateMemory(device, &alloc_info, hostAllocator(), &target.scaled_memory)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to allocate scaled image memory.");
+		std::exit(-1);
+	}
+	vkBindImageMemory(device, target.scaled_image, target.scaled_memory, 0);
+
+	VkImageViewCreateInfo view_create_info{};
+	view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_create_info.image = target.scaled_image;
+	view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_create_info.format = target.image_format;
+	view_create_info.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	if (errorHandler(vkCreateImageView(device, &view_create_info, hostAllocator(), &target.scaled_view)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create scaled image view.");
+		std::exit(-1);
+	}
+
+	// Descriptor Set - the scaled image, read in the layout the scene pass leaves it in
+	VkDescriptorPoolSize pool_size{};
+	pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pool_size.descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo pool_create_info{};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets = 1;
+	pool_create_info.poolSizeCount = 1;
+	pool_create_info.pPoolSizes = &pool_size;
+
+	if (errorHandler(vkCreateDescriptorPool(device, &pool_create_info, hostAllocator(), &target.upscale_pool)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create upscale descriptor pool.");
+		std::exit(-1);
+	}
+
+	VkDescriptorSetAllocateInfo set_alloc_info{};
+	set_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	set_alloc_info.descriptorPool = target.upscale_pool;
+	set_alloc_info.descriptorSetCount = 1;
+	set_alloc_info.pSetLayouts = &upscale_set_layout;
+
+	if (errorHandler(vkAllocateDescriptorSets(device, &set_alloc_info, &target.upscale_set)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to allocate upscale descriptor set.");
+		std::exit(-1);
+	}
+
+	VkDescriptorImageInfo image_info{};
+	image_info.sampler = upscale_sampler;
+	image_info.imageView = target.scaled_view;
+	image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = target.upscale_set;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &image_info;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+	// Framebuffers - one per swap chain image, independent of the post chain
+	target.upscale_frame_buffers.resize(target.image_views.size());
+	for (size_t i = 0; i < target.image_views.size(); i++)
+	{
+		VkFramebufferCreateInfo frame_buffer_create_info{};
+		frame_buffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		frame_buffer_create_info.renderPass = upscale_pass;
+		frame_buffer_create_info.attachmentCount = 1;
+		frame_buffer_create_info.pAttachments = &target.image_views[i];
+		frame_buffer_create_info.width = target.extent.width;
+		frame_buffer_create_info.height = target.extent.height;
+		frame_buffer_create_info.layers = 1;
+
+		if (errorHandler(vkCreateFramebuffer(device, &frame_buffer_create_info, hostAllocator(), &target.upscale_frame_buffers[i])) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[!] Failed to Create upscale Framebuffer.");
+			std::exit(-1);
+		}
+	}
+}
+
+
+void Renderer::retireScaledTarget(RenderWindow& target)
+{
+	for (auto framebuffer : target.upscale_frame_buffers)
+	{
+		deletion_queue.retire(DeletionQueue::FRAMEBUFFER, framebuffer, frame_number);
+	}
+	deletion_queue.retire(DeletionQueue::IMAGE_VIEW, target.scaled_view, frame_number);
+	deletion_queue.retire(DeletionQueue::IMAGE, target.scaled_image, frame_number);
+	deletion_queue.retire(DeletionQueue::MEMORY, target.scaled_memory, frame_number);
+	deletion_queue.retire(DeletionQueue::DESCRIPTOR_POOL, target.upscale_pool, frame_number);
+	target.upscale_frame_buffers.clear();
+	target.scaled_view = VK_NULL_HANDLE;
+	target.scaled_image = VK_NULL_HANDLE;
+	target.scaled_memory = VK_NULL_HANDLE;
+	target.upscale_pool = VK_NULL_HANDLE;
+	target.upscale_set = VK_NULL_HANDLE;
+}
+
+
+// Rounded so a scale step always moves at least one pixel, never below one pixel
+VkExtent2D Renderer::renderExtent(const RenderWindow& target)
+{
+	if (!dynamic_resolution) return target.extent;
+
+	float scale = resolution.scale();
+	VkExtent2D extent;
+	extent.width = std::max(1u, (uint32_t)(target.extent.width * scale + 0.5f));
+	extent.height = std::max(1u, (uint32_t)(target.extent.height * scale + 0.5f));
+	return extent;
+}
+
+
+// The chain is baked into the render pass - rebuild it and everything created against it
+void Renderer::rebuildPostChain()
+{
+	for (auto& target : windows)
+	{
+		for (auto framebuffer : target.frame_buffers)
+		{
+			deletion_queue.retire(DeletionQueue::FRAMEBUFFER, framebuffer, frame_number);
+		}
+		for (auto framebuffer : target.occlusion_frame_buffers)
+		{
+			deletion_queue.retire(DeletionQueue::FRAMEBUFFER, framebuffer, frame_number);
+		}
+		retirePostTargets(target);
+	}
+	for (auto pipeline : post_pipelines)
+	{
+		deletion_queue.retire(DeletionQueue::PIPELINE, pipeline, frame_number);
+	}
+	deletion_queue.retire(DeletionQueue::PIPELINE, graphicsPipeline, frame_number);
+	deletion_queue.retire(DeletionQueue::PIPELINE, occlusion_pipeline, frame_number);
+	deletion_queue.retire(DeletionQueue::PIPELINE_LAYOUT, pipelineLayout, frame_number);
+	deletion_queue.retire(DeletionQueue::PIPELINE_LAYOUT, post_layout, frame_number);
+	deletion_queue.retire(DeletionQueue::DESCRIPTOR_SET_LAYOUT, post_set_layout, frame_number);
+	deletion_queue.retire(DeletionQueue::RENDER_PASS, render_pass, frame_number);
+	deletion_queue.retire(DeletionQueue::RENDER_PASS, occlusion_pass, frame_number);
+	post_layout = VK_NULL_HANDLE;
+	post_set_layout = VK_NULL_HANDLE;
+
+	// Phase 1 draws into the scene color, which moves between the swap chain image and an intermediate
+	post_effects = post_chain.activeEffects();
+	createRenderPass();
+	createOcclusionPass();
+	createGraphicsPipeline();
+	createPostPipelines();
+	for (auto& target : windows)
+	{
+		createPostTargets(target);
+		createFrameBuffers(target);
+	}
+	invalidateCommandBuffers();
+}
+
+
+void Renderer::createCommandPool()
+{
+	// Get Queue families
+	QueueFamilyIndices queueFamilyIndices = queryQueueFamilies(physical_device);
+
+	// recording a command buffer every frame
+	VkCommandPoolCreateInfo pool_create_info{};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	pool_create_info.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+
+	if (vkCreateCommandPool(device, &pool_create_info, hostAllocator(), &commandPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to Create Command pool.");
+		std::exit(-1);
+	}
+}
+
+
+void Renderer::createCommandBuffer()
+{
+	// Allocate Command Buffer
+	VkCommandBufferAllocateInfo command_buffer_alloc_info{};
+	command_buffer_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	command_buffer_alloc_info.commandPool = commandPool;
+	command_buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	command_buffer_alloc_info.commandBufferCount = 3;
+
+	// Prologue, epilogue and debug lines - window passes are allocated per image on first use
+	VkCommandBuffer frame_buffers[3];
+	if (errorHandler(vkAllocateCommandBuffers(device, &command_buffer_alloc_info, frame_buffers)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to allocate Command buffers!");
+		std::exit(-1);
+	}
+	commandBuffer = frame_buffers[0];
+	copyCommandBuffer = frame_buffers[1];
+	debugCommandBuffer = frame_buffers[2];
+}
+
+
+// Serialized compute when there is no async queue, then the light assignment - false when there is nothing to record
+bool Renderer::writePrologue(VkCommandBuffer command_buffer)
+{
+	const bool inline_compute = !compute.isAsync() && compute.hasWork();
+	const bool assign_lights = lighting.lightCount() != 0;
+	if (!inline_compute && !assign_lights) return false;
+
+	VkCommandBufferBeginInfo command_buffer_begin_info{};
+	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkResetCommandBuffer(command_buffer, 0);
+	if (errorHandler(vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to begin writing to Command Buffer!");
+		std::exit(-1);
+	}
+
+	if (inline_compute) compute.recordInline(command_buffer);
+
+	// Light lists are shared by every window pass in the submit - without lights the shading never reads them
+	if (assign_lights) lighting.recordAssign(command_buffer);
+
+	if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record command buffer!");
+		std::exit(-1);
+	}
+	return true;
+}
+
+
+// Copy the finished main window image into a readback slot if one was requested
+bool Renderer::writeEpilogue(VkCommandBuffer command_buffer)
+{
+	if (readback_slot < 0 || frame_windows.front() != 0) return false;
+
+	VkCommandBufferBeginInfo command_buffer_begin_info{};
+	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkResetCommandBuffer(command_buffer, 0);
+	if (errorHandler(vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to begin writing to Command Buffer!");
+		std::exit(-1);
+	}
+
+	RenderWindow& target = windows[0];
+	VkImageLayout layout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	readback.recordCopy(command_buffer, (uint32_t)readback_slot, target.images[target.image_index], layout, target.image_format, target.extent);
+	readback_slot = -1;
+
+	if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record command buffer!");
+		std::exit(-1);
+	}
+	return true;
+}
+
+
+// Lines queued since the last frame, drawn over the finished image of every window - the cached passes never see them
+//  - Recorded after the previous frame completed, so sealing hands the drawn slot over without racing the GPU
+bool Renderer::writeDebugPass(VkCommandBuffer command_buffer)
+{
+	DebugDraw& debug_draw = DebugDraw::instance();
+	uint32_t vertex_count = debug_draw.seal();
+	metrics.debug_vertices.store(vertex_count, std::memory_order_relaxed);
+	if (vertex_count == 0) return false;
+
+	VkCommandBufferBeginInfo command_buffer_begin_info{};
+	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkResetCommandBuffer(command_buffer, 0);
+	if (errorHandler(vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to begin writing to Command Buffer!");
+		std::exit(-1);
+	}
+
+	for (uint32_t window_index : frame_windows)
+	{
+		RenderWindow& target = windows[window_index];
+		debug_draw.record(command_buffer, target.debug_frame_buffers[target.image_index], target.extent, camera);
+	}
+
+	if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record command buffer!");
+		std::exit(-1);
+	}
+	metrics.draws.fetch_add(frame_windows.size(), std::memory_order_relaxed);
+	return true;
+}
+
+
+// The window's render pass for one swap chain image - everything here is static between invalidations
+//  - With occlusion culling the GPU builds both phase lists, so the recorded draws still need no re-recording
+void Renderer::recordWindowPass(VkCommandBuffer command_buffer, RenderWindow& target, uint32_t image_index)
+{
+	// Begin recording to command buffer
+	VkCommandBufferBeginInfo command_buffer_begin_info{};
+	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	command_buffer_begin_info.flags = 0; // Replayed every frame
+	command_buffer_begin_info.pInheritanceInfo = nullptr; // Optional
+
+	if (errorHandler(vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info))!= VK_SUCCESS)
 	{
-		throw std::runtime_error("[!] Failed to create graphics pipeline!");
+		throw std::runtime_error("[!] Failed to begin writing to Command Buffer!");
 		std::exit(-1);
 	}
 
-	// Destroy Shader Module 
-	vkDestroyShaderModule(device, shaderFragModule, nullptr);
-	vkDestroyShaderModule(device, shaderVertModule, nullptr);
-}
+	// Viewport follows the render extent - dynamic state carries across both phases
+	//  - Scaled rendering draws into the top left corner, the render areas stay full so clears cover the rest
+	const VkExtent2D render_extent = renderExtent(target);
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)render_extent.width;
+	viewport.height = (float)render_extent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(command_buffer, 0, 1, &viewport);
 
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = render_extent;
+	vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+	// This window's occlusion history - every window culls against its own depth
+	VkDescriptorSet instance_set = instances.descriptorSet(target.view);
+	VkBuffer phase_draws = instances.phaseDrawBuffer(target.view);
+	VkDescriptorSet scene_sets[2] = { instance_set, lighting.descriptorSet() };
+	VkClearValue clearColors[4]{};
+	ScenePush push{};
+	push.list_base = -1;
+	push.quantization = mesh_quantization;
+	VkDeviceSize mesh_offset = 0;
+
+	// Phase 1 draws last frame's visible instances, the pyramid built from their depth decides phase 2
+	if (occlusion_culling)
+	{
+		occlusion.recordSelect(command_buffer, instance_set, phase_draws, mesh_vertex_count, instances.capacity());
+
+		clearColors[0].color = clear_color;
+		clearColors[1].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo phaseInfo{};
+		phaseInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		phaseInfo.renderPass = occlusion_pass;
+		phaseInfo.framebuffer = target.occlusion_frame_buffers[image_index];
+		phaseInfo.renderArea.offset = { 0, 0 };
+		phaseInfo.renderArea.extent = target.extent;
+		phaseInfo.clearValueCount = 2;
+		phaseInfo.pClearValues = clearColors;
+
+		push.list_base = 0;
+		vkCmdBeginRenderPass(command_buffer, &phaseInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, occlusion_pipeline);
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 2, scene_sets, 0, nullptr);
+		vkCmdPushConstants(command_buffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ScenePush), &push);
+		vkCmdBindVertexBuffers(command_buffer, 0, 1, &mesh_buffer, &mesh_offset);
+		vkCmdDrawIndirect(command_buffer, phase_draws, 0, 1, sizeof(VkDrawIndirectCommand));
+		vkCmdEndRenderPass(command_buffer);
+
+		occlusion.recordPyramid(command_buffer, target.occlusion);
+		occlusion.recordTest(command_buffer, instance_set, target.occlusion, render_extent, instances.capacity());
+		push.list_base = static_cast<int32_t>(instances.capacity());
+	}
 
-void Renderer::createRenderPass()
-{
-	// Color Attachment for Render Pass
-	VkAttachmentDescription color_attachment{};
-	color_attachment.format = swap_chain_image_format;
-	color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	// Start the Render passing process
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = render_pass;
+	renderPassInfo.framebuffer = target.frame_buffers[image_index];
 
-	// Color Attachment Reference
-	VkAttachmentReference color_attachment_ref{};
-	color_attachment_ref.attachment = 0;
-	color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	// Bind the framebuffer for the swapchain image we want to draw
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = target.extent;
 
-	// Subpass Description
-	VkSubpassDescription subpass_description{};
-	subpass_description.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass_description.colorAttachmentCount = 1;
-	subpass_description.pColorAttachments = &color_attachment_ref;
+	// Define the size of the render area - the scene clears attachment 0, or 1 when post effects run, depth is last
+	const uint32_t attachment_count = 2 + std::min(static_cast<uint32_t>(post_effects.size()), 2u);
+	clearColors[0].color = clear_color;
+	clearColors[1].color = clear_color;
+	clearColors[attachment_count - 1].depthStencil = { 1.0f, 0 };
+	renderPassInfo.clearValueCount = attachment_count;
+	renderPassInfo.pClearValues = clearColors;
 
-	// Render Pass Info
-	VkRenderPassCreateInfo render_pass_create_info{};
-	render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	render_pass_create_info.attachmentCount = 1;
-	render_pass_create_info.pAttachments = &color_attachment;
-	render_pass_create_info.subpassCount = 1;
-	render_pass_create_info.pSubpasses = &subpass_description;
+	// Start render passing
+	vkCmdBeginRenderPass(command_buffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 2, scene_sets, 0, nullptr);
+	vkCmdPushConstants(command_buffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ScenePush), &push);
+	vkCmdBindVertexBuffers(command_buffer, 0, 1, &mesh_buffer, &mesh_offset);
+
+	// Instance count comes from this frame's culling, so the recorded draw stays valid - phase 2 when occlusion culling
+	if (occlusion_culling) vkCmdDrawIndirect(command_buffer, phase_draws, sizeof(VkDrawIndirectCommand), 1, sizeof(VkDrawIndirectCommand));
+	else vkCmdDrawIndirect(command_buffer, instances.drawBuffer(), SceneInstances::DRAW_OFFSET, 1, sizeof(VkDrawIndirectCommand));
+
+	// Post chain - one fullscreen triangle per subpass
+	for (size_t i = 0; i < post_effects.size(); i++)
+	{
+		vkCmdNextSubpass(command_buffer, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, post_pipelines[i]);
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, post_layout, 0, 1, &target.post_sets[i], 0, nullptr);
+		vkCmdPushConstants(command_buffer, post_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PostParams), &post_chain.params);
+		vkCmdDraw(command_buffer, 3, 1, 0, 0);
+	}
+	vkCmdEndRenderPass(command_buffer);
 
-	// Error Handling
-	if (vkCreateRenderPass(device, &render_pass_create_info, nullptr, &render_pass) != VK_SUCCESS)
+	// Upscale - stretches the rendered corner over the whole swap chain image
+	if (dynamic_resolution)
 	{
-		throw std::runtime_error("[!] Failed to create Render pass.");
+		VkRenderPassBeginInfo upscaleInfo{};
+		upscaleInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		upscaleInfo.renderPass = upscale_pass;
+		upscaleInfo.framebuffer = target.upscale_frame_buffers[image_index];
+		upscaleInfo.renderArea.offset = { 0, 0 };
+		upscaleInfo.renderArea.extent = target.extent;
+
+		viewport.width = (float)target.extent.width;
+		viewport.height = (float)target.extent.height;
+		scissor.extent = target.extent;
+
+		UpscaleParams params{};
+		params.uv_scale[0] = (float)render_extent.width / (float)target.extent.width;
+		params.uv_scale[1] = (float)render_extent.height / (float)target.extent.height;
+		params.sharpness = upscale_sharpness;
+
+		vkCmdBeginRenderPass(command_buffer, &upscaleInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+		vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, upscale_pipeline);
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, upscale_layout, 0, 1, &target.upscale_set, 0, nullptr);
+		vkCmdPushConstants(command_buffer, upscale_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(UpscaleParams), &params);
+		vkCmdDraw(command_buffer, 3, 1, 0, 0);
+		vkCmdEndRenderPass(command_buffer);
+	}
+
+	if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) 
+	{
+		throw std::runtime_error("failed to record command buffer!");
 		std::exit(-1);
 	}
 }
 
-void Renderer::createFrameBuffers()
+
+// Cached pass for the target's acquired image - safe to reset, the previous frame has completed
+VkCommandBuffer Renderer::cachedWindowPass(RenderWindow& target)
 {
-	// Resize container to hold all of the Frame buffers
-	swapChainFrameBuffers.resize(swapChainImageViews.size());
+	uint32_t image_index = target.image_index;
 
-	// Iterate through the image views and create framebuffers from them
-	for (size_t i = 0; i < swapChainImageViews.size(); i++)
+	// Grow only - buffers from a larger swap chain may still be pending and are never freed early
+	if (target.command_buffers.size() < target.frame_buffers.size())
 	{
-		VkImageView attachments[] =
-		{
-			swapChainImageViews[i]
-		};
+		size_t first = target.command_buffers.size();
+		target.command_buffers.resize(target.frame_buffers.size());
+		target.recorded_generation.resize(target.frame_buffers.size(), 0);
 
-		// Create Frame Buffer Info
-		VkFramebufferCreateInfo frame_buffer_create_info{};
-		frame_buffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		frame_buffer_create_info.renderPass = render_pass;
-		frame_buffer_create_info.attachmentCount = 1;
-		frame_buffer_create_info.pAttachments = attachments;
-		frame_buffer_create_info.width = swap_chain_extent.width;
-		frame_buffer_create_info.height = swap_chain_extent.height;
-		frame_buffer_create_info.layers = 1;
+		VkCommandBufferAllocateInfo command_buffer_alloc_info{};
+		command_buffer_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		command_buffer_alloc_info.commandPool = commandPool;
+		command_buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		command_buffer_alloc_info.commandBufferCount = static_cast<uint32_t>(target.command_buffers.size() - first);
 
-		// Error Handling
-		if (errorHandler(vkCreateFramebuffer(device, &frame_buffer_create_info, nullptr, &swapChainFrameBuffers[i])) != VK_SUCCESS)
+		if (errorHandler(vkAllocateCommandBuffers(device, &command_buffer_alloc_info, &target.command_buffers[first])) != VK_SUCCESS)
 		{
-			throw std::runtime_error("[!] Failed to Create Framebuffer.");
+			throw std::runtime_error("[!] Failed to allocate Command buffers!");
 			std::exit(-1);
 		}
 	}
+
+	VkCommandBuffer command_buffer = target.command_buffers[image_index];
+	if (target.recorded_generation[image_index] != command_generation)
+	{
+		vkResetCommandBuffer(command_buffer, 0);
+		recordWindowPass(command_buffer, target, image_index);
+		target.recorded_generation[image_index] = command_generation;
+		passes_recorded.fetch_add(1, std::memory_order_relaxed);
+	}
+	return command_buffer;
 }
 
 
-void Renderer::createCommandPool()
+// Every cached pass is re-recorded on its next use
+void Renderer::invalidateCommandBuffers()
 {
-	// Get Queue families
-	QueueFamilyIndices queueFamilyIndices = queryQueueFamilies(physical_device);
+	command_generation++;
+}
 
-	// recording a command buffer every frame
-	VkCommandPoolCreateInfo pool_create_info{};
-	pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-	pool_create_info.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
 
-	if (vkCreateCommandPool(device, &pool_create_info, nullptr, &commandPool) != VK_SUCCESS)
+// Render thread, after simulation - the previous frame has completed, so the mapped instance buffers are free to write
+//  - Growing the buffers rewrites the descriptor set the cached passes bind, which cannot overlap recording
+void Renderer::prepareInstances()
+{
+	// No scene - one identity instance draws the original triangle
+	uint32_t count = scene != nullptr ? static_cast<uint32_t>(scene->size()) : 0;
+	if (count == 0)
 	{
-		throw std::runtime_error("[!] Failed to Create Command pool.");
-		std::exit(-1);
+		if (instances.reserve(1, deletion_queue, frame_number)) invalidateCommandBuffers();
+		instances.worldMatrices()[0] = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+		instances.visibleIndices()[0] = 0;
+		instances.writeBounds(&mesh_bounds, 0, 1);
+		instances.setCamera(camera);
+		instances.setDraw(mesh_vertex_count, 1);
+		metrics.visible_instances.store(1, std::memory_order_relaxed);
+		return;
 	}
+
+	// New buffers start empty and added nodes may reorder the scene - upload and rebuild everything
+	bool replaced = instances.reserve(count, deletion_queue, frame_number);
+	if (replaced) invalidateCommandBuffers();
+	rebuild_instances = replaced || count != bvh.objectCount();
 }
 
 
-void Renderer::createCommandBuffer()
+// Render thread, after prepareInstances() - lights are copied only when they changed, the camera every frame
+void Renderer::updateLighting()
 {
-	// Allocate Command Buffer
-	VkCommandBufferAllocateInfo command_buffer_alloc_info{};
-	command_buffer_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	command_buffer_alloc_info.commandPool = commandPool;
-	command_buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	command_buffer_alloc_info.commandBufferCount = 1;
-
-	if (errorHandler(vkAllocateCommandBuffers(device, &command_buffer_alloc_info, &commandBuffer)) != VK_SUCCESS)
+	if (lights_dirty)
 	{
-		throw std::runtime_error("[!] Failed to allocate Command buffers!");
-		std::exit(-1);
+		lighting.setLights(lights.data(), static_cast<uint32_t>(lights.size()));
+		lights_dirty = false;
 	}
+	lighting.setView(camera_view, camera_projection, ambient_light);
+	metrics.lights.store(lighting.lightCount(), std::memory_order_relaxed);
 }
 
 
-void Renderer::writeCommandBuffer(VkCommandBuffer command_buffer, uint32_t image_index)
+// Task - world matrices written by this frame's simulation
+void Renderer::uploadInstances()
 {
-	// Begin recording to command buffer
-	VkCommandBufferBeginInfo command_buffer_begin_info{};
-	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	command_buffer_begin_info.flags = 0; // Optional
-	command_buffer_begin_info.pInheritanceInfo = nullptr; // Optional
+	if (scene == nullptr || scene->size() == 0) return;
+
+	if (rebuild_instances) std::memcpy(instances.worldMatrices(), scene->worldMatrices(), sizeof(Mat4) * scene->size());
+	else scene->uploadChanged(instances.worldMatrices());
+}
+
 
-	if (errorHandler(vkBeginCommandBuffer(commandBuffer, &command_buffer_begin_info))!= VK_SUCCESS)
+// Task - refit or rebuild the BVH and the occlusion bounds, then cull into the visible list and indirect draw
+void Renderer::cullInstances(FrameArena& arena)
+{
+	if (scene == nullptr || scene->size() == 0) return;
+
+	const uint32_t count = static_cast<uint32_t>(scene->size());
+	const Mat4* world = scene->worldMatrices();
+	if (rebuild_instances)
 	{
-		throw std::runtime_error("[!] Failed to begin writing to Command Buffer!");
-		std::exit(-1);
+		instance_bounds.resize(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			instance_bounds[i] = transformBounds(world[i], mesh_bounds);
+		}
+		bvh.build(instance_bounds.data(), count, jobs, arena);
+		instances.writeBounds(instance_bounds.data(), 0, count);
+	}
+	else if (scene->changedBegin() < scene->changedEnd())
+	{
+		for (uint32_t i = scene->changedBegin(); i < scene->changedEnd(); i++)
+		{
+			instance_bounds[i] = transformBounds(world[i], mesh_bounds);
+		}
+		bvh.refit(instance_bounds.data(), scene->changedBegin(), scene->changedEnd());
+		instances.writeBounds(instance_bounds.data(), scene->changedBegin(), scene->changedEnd());
 	}
 
-	// Start the Render passing process
-	VkRenderPassBeginInfo renderPassInfo{};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = render_pass;
-	renderPassInfo.framebuffer = swapChainFrameBuffers[image_index];
+	// Clip planes from the rows of the column-major view projection - Vulkan depth is [0, w]
+	float planes[6][4];
+	for (int c = 0; c < 4; c++)
+	{
+		const float* column = &camera.m[c * 4];
+		planes[0][c] = column[3] + column[0];
+		planes[1][c] = column[3] - column[0];
+		planes[2][c] = column[3] + column[1];
+		planes[3][c] = column[3] - column[1];
+		planes[4][c] = column[2];
+		planes[5][c] = column[3] - column[2];
+	}
 
-	// Bind the framebuffer for the swapchain image we want to draw
-	renderPassInfo.renderArea.offset = { 0, 0 };
-	renderPassInfo.renderArea.extent = swap_chain_extent;
+	visible_instances.clear();
+	bvh.cullFrustum(planes, visible_instances);
+	sortVisibleInstances(arena);
+
+	// Appended from the culling task - boxes landing after the render thread sealed show up a frame later
+	if (debug_bounds)
+	{
+		const uint32_t color = debugColor(0.2f, 1.0f, 0.4f, 0.8f);
+		for (uint32_t index : visible_instances)
+		{
+			debugBox(instance_bounds[index], color);
+		}
+	}
+	if (!visible_instances.empty())
+	{
+		std::memcpy(instances.visibleIndices(), visible_instances.data(), sizeof(uint32_t) * visible_instances.size());
+	}
+	instances.setCamera(camera);
+	instances.setDraw(mesh_vertex_count, static_cast<uint32_t>(visible_instances.size()));
+	metrics.visible_instances.store(static_cast<uint32_t>(visible_instances.size()), std::memory_order_relaxed);
+}
 
-	// Define the size of the render area
-	VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
-	renderPassInfo.clearValueCount = 1;
-	renderPassInfo.pClearValues = &clearColor;
 
-	// Start render passing
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
-	vkCmdEndRenderPass(commandBuffer);
+// Every instance shares the base pipeline and material for now, so depth alone orders them - front to back for early depth rejection
+void Renderer::sortVisibleInstances(FrameArena& arena)
+{
+	const uint32_t count = static_cast<uint32_t>(visible_instances.size());
+	draw_keys.resize(count);
+	sort_scratch_keys.resize(count);
+	sort_scratch_values.resize(count);
 
-	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) 
+	// Clip depth of each box center - the third and fourth rows of the column-major view projection
+	for (uint32_t i = 0; i < count; i++)
 	{
-		throw std::runtime_error("failed to record command buffer!");
-		std::exit(-1);
+		const Aabb& box = instance_bounds[visible_instances[i]];
+		float center[3] = { (box.min[0] + box.max[0]) * 0.5f, (box.min[1] + box.max[1]) * 0.5f, (box.min[2] + box.max[2]) * 0.5f };
+		float z = camera.m[2] * center[0] + camera.m[6] * center[1] + camera.m[10] * center[2] + camera.m[14];
+		float w = camera.m[3] * center[0] + camera.m[7] * center[1] + camera.m[11] * center[2] + camera.m[15];
+		float depth = w > 1e-5f ? z / w : 0.0f;
+		draw_keys[i] = makeDrawKey(DRAW_PASS_OPAQUE, 0, 0, 0, drawKeyDepth(depth, false));
 	}
+
+	radixSort(draw_keys.data(), visible_instances.data(), count, sort_scratch_keys.data(), sort_scratch_values.data(), jobs, arena);
 }
 
 
@@ -976,66 +3551,461 @@ void Renderer::createSyncObjects()
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
-		vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS ||
-		vkCreateFence(device, &fenceInfo, nullptr, &inFlightFence) != VK_SUCCESS) 
+	// Present still needs a binary semaphore, everything else is timeline values
+	if (vkCreateSemaphore(device, &semaphoreInfo, hostAllocator(), &renderFinishedSemaphore) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create synchronization objects for a frame!");
 		std::exit(-1);
 	}
+	scheduler.create(device);
+
+	// Each window acquires independently
+	for (auto& target : windows)
+	{
+		if (vkCreateSemaphore(device, &semaphoreInfo, hostAllocator(), &target.image_available) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create synchronization objects for a frame!");
+			std::exit(-1);
+		}
+	}
 }
 
 
 void Renderer::drawFrame()
 {
-	vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
-	vkResetFences(device, 1, &inFlightFence);
+	// Frame pacing is measured start to start, so time spent outside drawFrame() counts too
+	auto frame_start = std::chrono::steady_clock::now();
+	if (last_frame_start != std::chrono::steady_clock::time_point()) metrics.frame_time.observe(std::chrono::duration<double>(frame_start - last_frame_start).count());
+	last_frame_start = frame_start;
+
+	// One frame in flight (see FRAMES_IN_FLIGHT) - wait for the last graphics submit to reach its timeline value
+	static_assert(FRAMES_IN_FLIGHT == 1, "Per-frame buffers are rewritten right after this wait, they would need a slot per frame in flight");
+	scheduler.wait(QueueKind::Graphics, scheduler.submitted(QueueKind::Graphics));
+	auto waited = std::chrono::steady_clock::now();
+	metrics.fence_wait.observe(std::chrono::duration<double>(waited - frame_start).count());
+	completed_frame = frame_number;
+	deletion_queue.flush(completed_frame);
+
+	// The previous submit has landed, so its timestamps can steer this frame's scale
+	double gpu_ms = 0.0;
+	last_gpu_ms = -1.0;
+	if (gpu_timer.supported() && frame_number > 0 && gpu_timer.read(gpu_ms))
+	{
+		metrics.gpu_time.observe(gpu_ms * 1e-3);
+		last_gpu_ms = gpu_ms;
+		if (dynamic_resolution && resolution.update(gpu_ms))
+		{
+			invalidateCommandBuffers();
+			metrics.render_scale_percent.store((uint32_t)(resolution.scale() * 100.0f + 0.5f), std::memory_order_relaxed);
+		}
+	}
 
-	uint32_t imageIndex;
-	vkAcquireNextImageKHR(device, swap_chain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+	// This slot's previous frame has retired - nothing its tasks allocated is still referenced
+	FrameArena& arena = frame_arenas[frame_number % FRAME_ARENA_SLOTS];
+	arena.reset();
 
-	vkResetCommandBuffer(commandBuffer, /*VkCommandBufferResetFlagBits*/ 0);
-	writeCommandBuffer(commandBuffer, imageIndex);
+	// Frame task graph - simulation overlaps acquire, culling and upload overlap command recording, submit waits on both
+	//  - Scoped so a throw from a rebuild or an acquire waits for the queued tasks before their counters unwind
+	JobScope simulated(jobs);
+	JobScope prepared(jobs);
+	if (scene != nullptr && !replaying) jobs.run(arena, [this, &arena]() { scene->update(jobs, arena); }, &simulated.counter);
 
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	// Post effects changed since the last frame
+	if (post_chain.consumeDirty()) rebuildPostChain();
+
+	// Acquire from every visible window - out of date windows are rebuilt and skip this frame
+	auto acquire_start = std::chrono::steady_clock::now();
+	frame_windows.clear();
+	for (uint32_t i = 0; i < windows.size(); i++)
+	{
+		RenderWindow& target = windows[i];
+		if (headless)
+		{
+			target.image_index = 0;
+			frame_windows.push_back(i);
+			continue;
+		}
+		if (target.minimized) continue;
 
-	VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
+		VkResult acquired = vkAcquireNextImageKHR(device, target.swap_chain, UINT64_MAX, target.image_available, VK_NULL_HANDLE, &target.image_index);
+		if (acquired == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			recreateSwapChain(target);
+			continue;
+		}
+		if (acquired != VK_SUCCESS && acquired != VK_SUBOPTIMAL_KHR)
+		{
+			errorHandler(acquired);
+			throw std::runtime_error("[!] Failed to acquire swap chain image.");
+		}
+		frame_windows.push_back(i);
+	}
+	if (!headless) metrics.acquire.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - acquire_start).count());
+
+	// Instance buffers are resized here, then culling and upload run while the passes are recorded
+	jobs.wait(simulated.counter);
+	prepareInstances();
+	if (capture.isOpen()) captureFrame();
+	updateLighting();
+	jobs.run(arena, [this]() { uploadInstances(); }, &prepared.counter);
+	jobs.run(arena, [this, &arena]() { cullInstances(arena); }, &prepared.counter);
+
+	// Nothing to draw - the scene still consumed its changes, so they are uploaded regardless
+	if (frame_windows.empty())
+	{
+		jobs.wait(prepared.counter);
+		return;
+	}
 
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
+	// Export follows the main window only
+	if (exporter != nullptr && frame_windows[0] == 0) exportFrames();
 
-	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;
+	// Values baked into the cached passes - a change re-records them
+	if (std::memcmp(&clear_color, &recorded_clear_color, sizeof(clear_color)) != 0 ||
+		std::memcmp(&post_chain.params, &recorded_post_params, sizeof(PostParams)) != 0)
+	{
+		recorded_clear_color = clear_color;
+		recorded_post_params = post_chain.params;
+		invalidateCommandBuffers();
+	}
 
-	if (vkQueueSubmit(graphics_queue, 1, &submitInfo, inFlightFence) != VK_SUCCESS) 
+	// Per-frame work around the cached window passes, all in one submit
+	std::vector <VkCommandBuffer>& command_buffers = frame_command_buffers;
+	command_buffers.clear();
+	if (gpu_timer.supported()) command_buffers.push_back(gpu_timer.beginCommands());
+	if (writePrologue(commandBuffer)) command_buffers.push_back(commandBuffer);
+	for (uint32_t window_index : frame_windows)
 	{
-		throw std::runtime_error("failed to submit draw command buffer!");
-		std::exit(-1);
+		command_buffers.push_back(cachedWindowPass(windows[window_index]));
+	}
+	if (writeDebugPass(debugCommandBuffer)) command_buffers.push_back(debugCommandBuffer);
+	if (writeEpilogue(copyCommandBuffer)) command_buffers.push_back(copyCommandBuffer);
+	if (gpu_timer.supported()) command_buffers.push_back(gpu_timer.endCommands());
+
+	// One submit waits on every window's acquire
+	std::vector <FrameScheduler::WaitPoint>& waits = frame_waits;
+	waits.clear();
+	if (!headless)
+	{
+		for (uint32_t window_index : frame_windows)
+		{
+			waits.push_back(FrameScheduler::binary(windows[window_index].image_available, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT));
+		}
+	}
+
+	// Compute goes first so it overlaps graphics up to the stages that read its results
+	uint64_t compute_value = compute.submit(scheduler);
+	if (compute_value != 0)
+	{
+		waits.push_back(scheduler.after(QueueKind::Compute, compute_value, compute.waitStages()));
+		metrics.submits.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// The cached passes draw whatever culling wrote, so it must be finished before the GPU reads it
+	jobs.wait(prepared.counter);
+
+	// Signals the next graphics timeline value, plus the binary semaphore present waits on
+	scheduler.submit(graphics_queue, QueueKind::Graphics, command_buffers.data(), static_cast<uint32_t>(command_buffers.size()), waits, headless ? VK_NULL_HANDLE : renderFinishedSemaphore);
+	frame_number++;
+	uint32_t draws = static_cast<uint32_t>(frame_windows.size() * ((occlusion_culling ? 2 : 1) + post_effects.size() + (dynamic_resolution ? 1 : 0)));	// Scene draws plus one per post subpass and the upscale
+	metrics.submits.fetch_add(1, std::memory_order_relaxed);
+	metrics.draws.fetch_add(draws, std::memory_order_relaxed);
+
+	// Timestamp buffers are left out, replay adds them whether or not the capture had them
+	if (capture.isOpen())
+	{
+		capture.endFrame({ static_cast<uint32_t>(command_buffers.size()) - (gpu_timer.supported() ? 2u : 0u), draws });
+		if (!capture.isOpen()) std::cout << "\n[Trace] " << capture.framesWritten() << " frames, " << (capture.bytesWritten() >> 10) << " KiB written to " << capture_path << "\n";
+	}
+
+	// Offscreen frames are read back instead of presented
+	if (headless) return;
+
+	// One present for every window drawn this frame
+	const uint32_t present_count = static_cast<uint32_t>(frame_windows.size());
+	VkSwapchainKHR* swapChains = arena.allocateArray<VkSwapchainKHR>(present_count);
+	uint32_t* imageIndices = arena.allocateArray<uint32_t>(present_count);
+	VkResult* results = arena.allocateArray<VkResult>(present_count);
+	for (uint32_t i = 0; i < present_count; i++)
+	{
+		swapChains[i] = windows[frame_windows[i]].swap_chain;
+		imageIndices[i] = windows[frame_windows[i]].image_index;
+		results[i] = VK_SUCCESS;
 	}
 
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
 	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
+	presentInfo.pWaitSemaphores = &renderFinishedSemaphore;
 
-	VkSwapchainKHR swapChains[] = { swap_chain };
-	presentInfo.swapchainCount = 1;
+	presentInfo.swapchainCount = present_count;
 	presentInfo.pSwapchains = swapChains;
-
-	presentInfo.pImageIndices = &imageIndex;
+	presentInfo.pImageIndices = imageIndices;
+	presentInfo.pResults = results;
 
 	vkQueuePresentKHR(present_queue, &presentInfo);
+
+	// Per swap chain results - one stale window does not fail the others
+	for (size_t i = 0; i < frame_windows.size(); i++)
+	{
+		RenderWindow& target = windows[frame_windows[i]];
+		if (results[i] == VK_ERROR_OUT_OF_DATE_KHR || results[i] == VK_SUBOPTIMAL_KHR || target.resized)
+		{
+			target.resized = false;
+			recreateSwapChain(target);
+		}
+		else if (results[i] != VK_SUCCESS)
+		{
+			errorHandler(results[i]);
+			throw std::runtime_error("[!] Failed to present swap chain image.");
+		}
+	}
+}
+
+
+// Prometheus snapshot - runs on the metrics server thread while frames are drawn
+void Renderer::writeMetrics(std::string& out)
+{
+	MetricsWriter writer(out);
+	char labels[64];
+
+	// Frame timing
+	writer.histogram("renderer_frame_seconds", "Time between the starts of consecutive frames.", metrics.frame_time);
+	writer.histogram("renderer_fence_wait_seconds", "Time blocked on the previous frame's graphics timeline.", metrics.fence_wait);
+	writer.histogram("renderer_acquire_seconds", "Time spent acquiring swap chain images per frame.", metrics.acquire);
+	writer.histogram("renderer_gpu_frame_seconds", "GPU time of the graphics submit, from timestamps.", metrics.gpu_time);
+	writer.gauge("renderer_render_scale", "Fraction of the window extent rendered per axis.", (double)metrics.render_scale_percent.load(std::memory_order_relaxed) / 100.0);
+
+	// Work submitted
+	writer.counter("renderer_submits_total", "Queue submits, graphics and compute.", (double)metrics.submits.load(std::memory_order_relaxed));
+	writer.counter("renderer_draws_total", "Draw commands in submitted window passes.", (double)metrics.draws.load(std::memory_order_relaxed));
+	writer.gauge("renderer_visible_instances", "Instances drawn by the last frame after culling.", (double)metrics.visible_instances.load(std::memory_order_relaxed));
+	writer.gauge("renderer_lights", "Lights binned into clusters by the last frame.", (double)metrics.lights.load(std::memory_order_relaxed));
+	writer.counter("renderer_command_passes_recorded_total", "Cached window passes re-recorded.", (double)passes_recorded.load(std::memory_order_relaxed));
+	writer.counter("renderer_swapchain_recreations_total", "Swap chains rebuilt after resize or out of date.", (double)metrics.swap_chain_recreations.load(std::memory_order_relaxed));
+	writer.gauge("renderer_texture_bytes", "Device bytes of every texture level as uploaded.", (double)metrics.texture_bytes.load(std::memory_order_relaxed));
+	writer.gauge("renderer_texture_rgba_bytes", "Bytes the same texture levels would take as RGBA8.", (double)metrics.texture_rgba_bytes.load(std::memory_order_relaxed));
+	writer.gauge("renderer_debug_vertices", "Debug line vertices drawn by the last frame.", (double)metrics.debug_vertices.load(std::memory_order_relaxed));
+	writer.counter("renderer_debug_vertices_dropped_total", "Debug line vertices lost to a full ring slot.", (double)DebugDraw::instance().droppedCount());
+
+	// Validation messages - counted before rate limiting
+	static const char* severity_names[DebugLog::SEVERITY_COUNT] = { "verbose", "info", "warning", "error" };
+	writer.declare("renderer_validation_messages_total", "Validation layer messages by severity.", "counter");
+	for (int severity = 0; severity < DebugLog::SEVERITY_COUNT; severity++)
+	{
+		std::snprintf(labels, sizeof(labels), "severity=\"%s\"", severity_names[severity]);
+		writer.sample("renderer_validation_messages_total", (double)debug_log.receivedCount((DebugLog::Severity)severity), labels);
+	}
+	writer.counter("renderer_validation_messages_dropped_total", "Validation messages lost to a full log ring.", (double)debug_log.droppedCount());
+
+	// Device memory heaps - physical device queries are safe from any thread
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+	budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+	VkPhysicalDeviceMemoryProperties2 memory_properties{};
+	memory_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	memory_properties.pNext = memory_budget ? &budget : nullptr;
+	vkGetPhysicalDeviceMemoryProperties2(physical_device, &memory_properties);
+
+	const VkPhysicalDeviceMemoryProperties& heaps = memory_properties.memoryProperties;
+	writer.declare("renderer_heap_size_bytes", "Device memory heap size.", "gauge");
+	for (uint32_t i = 0; i < heaps.memoryHeapCount; i++)
+	{
+		std::snprintf(labels, sizeof(labels), "heap=\"%u\",device_local=\"%u\"", i, (heaps.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? 1u : 0u);
+		writer.sample("renderer_heap_size_bytes", (double)heaps.memoryHeaps[i].size, labels);
+	}
+	if (memory_budget)
+	{
+		writer.declare("renderer_heap_budget_bytes", "Heap memory this process can use before allocations may fail.", "gauge");
+		for (uint32_t i = 0; i < heaps.memoryHeapCount; i++)
+		{
+			std::snprintf(labels, sizeof(labels), "heap=\"%u\"", i);
+			writer.sample("renderer_heap_budget_bytes", (double)budget.heapBudget[i], labels);
+		}
+		writer.declare("renderer_heap_usage_bytes", "Heap memory this process currently uses.", "gauge");
+		for (uint32_t i = 0; i < heaps.memoryHeapCount; i++)
+		{
+			std::snprintf(labels, sizeof(labels), "heap=\"%u\"", i);
+			writer.sample("renderer_heap_usage_bytes", (double)budget.heapUsage[i], labels);
+		}
+	}
+
+	// Driver host memory from the allocation callbacks
+	writer.declare("renderer_host_memory_bytes", "Live driver host allocations by scope.", "gauge");
+	for (uint32_t scope = 0; scope < HOST_SCOPE_COUNT; scope++)
+	{
+		std::snprintf(labels, sizeof(labels), "scope=\"%s\"", HostAllocator::scopeName((VkSystemAllocationScope)scope));
+		writer.sample("renderer_host_memory_bytes", (double)HostAllocator::instance().stats((VkSystemAllocationScope)scope).bytes, labels);
+	}
+
+	// Vertex memory per mesh in both layouts - written once at import
+	writer.declare("renderer_mesh_vertex_bytes", "Vertex bytes per mesh in the full and packed layouts.", "gauge");
+	std::snprintf(labels, sizeof(labels), "mesh=\"%s\",layout=\"full\"", mesh_name);
+	writer.sample("renderer_mesh_vertex_bytes", (double)mesh_stats.full_bytes, labels);
+	std::snprintf(labels, sizeof(labels), "mesh=\"%s\",layout=\"packed\"", mesh_name);
+	writer.sample("renderer_mesh_vertex_bytes", (double)mesh_stats.packed_bytes, labels);
+	std::snprintf(labels, sizeof(labels), "mesh=\"%s\"", mesh_name);
+	writer.gauge("renderer_mesh_position_error", "Largest quantized position error of the mesh, in mesh units.", (double)mesh_stats.max_position_error, labels);
+
+	writer.counter("renderer_metrics_scrapes_total", "Scrapes served, including this one.", (double)(metrics_server.scrapeCount() + 1));
+}
+
+
+// Rebuild size dependent resources - the old ones are retired, not waited on
+void Renderer::recreateSwapChain(RenderWindow& target)
+{
+	// Nothing to build while the window has no area
+	int width = 0;
+	int height = 0;
+	SDL_Vulkan_GetDrawableSize(target.window, &width, &height);
+	if (width == 0 || height == 0) return;
+
+	// Resources may still be referenced by the last submitted frame
+	for (auto framebuffer : target.frame_buffers)
+	{
+		deletion_queue.retire(DeletionQueue::FRAMEBUFFER, framebuffer, frame_number);
+	}
+	for (auto framebuffer : target.occlusion_frame_buffers)
+	{
+		deletion_queue.retire(DeletionQueue::FRAMEBUFFER, framebuffer, frame_number);
+	}
+	for (auto framebuffer : target.debug_frame_buffers)
+	{
+		deletion_queue.retire(DeletionQueue::FRAMEBUFFER, framebuffer, frame_number);
+	}
+	for (auto imageView : target.image_views)
+	{
+		deletion_queue.retire(DeletionQueue::IMAGE_VIEW, imageView, frame_number);
+	}
+	retirePostTargets(target);
+	retireScaledTarget(target);
+	occlusion.retireTarget(target.occlusion, deletion_queue, frame_number);
+
+	// Old swap chain is handed to the new one, then retired
+	VkSwapchainKHR old_swap_chain = target.swap_chain;
+	VkFormat old_format = target.image_format;
+	createSwapChain(target);
+	deletion_queue.retire(DeletionQueue::SWAPCHAIN, old_swap_chain, frame_number);
+
+	if (target.image_format != old_format)
+	{
+		throw std::runtime_error("[!] Swap Chain Error - Surface format changed on recreation.");
+	}
+
+	createImageViews(target);
+	occlusion.createTarget(target.occlusion, target.extent, occlusion_culling);
+	createScaledTarget(target);
+	createPostTargets(target);
+	createFrameBuffers(target);
+	createDebugFrameBuffers(target);
+	invalidateCommandBuffers();
+	if (exporter != nullptr && &target == &windows[0]) resizeReadback();
+	metrics.swap_chain_recreations.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+// Headless render target - a single image in place of the swap chain images
+void Renderer::createOffscreenTarget(RenderWindow& target)
+{
+	target.image_format = VK_FORMAT_B8G8R8A8_SRGB;
+	target.extent = { target.width, target.height };
+
+	VkImageCreateInfo image_create_info{};
+	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.imageType = VK_IMAGE_TYPE_2D;
+	image_create_info.format = target.image_format;
+	image_create_info.extent = { target.extent.width, target.extent.height, 1 };
+	image_create_info.mipLevels = 1;
+	image_create_info.arrayLayers = 1;
+	image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (errorHandler(vkCreateImage(device, &image_create_info, hostAllocator(), &offscreen_image)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create offscreen image.");
+		std::exit(-1);
+	}
+
+	// Device local memory for the render target
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(device, offscreen_image, &requirements);
+
+	VkMemoryAllocateInfo alloc_info{};
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = requirements.size;
+	alloc_info.memoryTypeIndex = findMemoryType(physical_device, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (alloc_info.memoryTypeIndex == UINT32_MAX || errorHandler(vkAllocateMemory(device, &alloc_info, hostAllocator(), &offscreen_memory)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to allocate offscreen image memory.");
+		std::exit(-1);
+	}
+	vkBindImageMemory(device, offscreen_image, offscreen_memory, 0);
+
+	target.images = { offscreen_image };
+}
+
+
+void Renderer::createReadback(uint32_t slot_count)
+{
+	VkDeviceSize slot_size = (VkDeviceSize)windows[0].extent.width * windows[0].extent.height * 4;
+	readback.create(device, physical_device, slot_count, slot_size);
+}
+
+
+// Export follows the main window through resizes - a larger extent no longer fits the slots, so the ring is rebuilt
+//  - Every copy in flight lands and reaches the exporter first, which drops frames that differ from the stream size
+//  - Export reserves its slot after the acquires and the epilogue consumes it, so none is reserved while a swap chain is rebuilt
+void Renderer::resizeReadback()
+{
+	VkDeviceSize slot_size = (VkDeviceSize)windows[0].extent.width * windows[0].extent.height * 4;
+	if (slot_size <= readback.slotSize()) return;
+
+	scheduler.wait(QueueKind::Graphics, scheduler.submitted(QueueKind::Graphics));
+	completed_frame = frame_number;
+	auto submit = [this](const ReadbackRing::Frame& frame) { exporter->submit(readback, frame); };
+	readback.collect(completed_frame, submit);
+	while (readback.pendingCount() != 0)
+	{
+		exporter->waitForRelease();
+	}
+
+	uint32_t slot_count = readback.slotCount();
+	readback.destroy();
+	createReadback(slot_count);
+}
+
+
+// Reserve a readback slot for the next frame - false when every slot is still in flight
+bool Renderer::requestReadback(uint64_t tag)
+{
+	readback_slot = readback.acquire(frame_number + 1, tag);
+	return readback_slot >= 0;
+}
+
+
+void Renderer::exportFrames()
+{
+	auto submit = [this](const ReadbackRing::Frame& frame) { exporter->submit(readback, frame); };
+	readback.collect(completed_frame, submit);
+
+	// Every frame is exported - only wait when the converters hold every slot
+	while (!requestReadback(frame_number + 1))
+	{
+		exporter->waitForRelease();
+		readback.collect(completed_frame, submit);
+	}
+}
+
+
+void Renderer::finishExport()
+{
+	completed_frame = frame_number;
+	readback.collect(completed_frame, [this](const ReadbackRing::Frame& frame) { exporter->submit(readback, frame); });
+	exporter->finish();
 }
 
 
@@ -0,0 +1,693 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <iostream>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SCENE_GRAPH_X86 1
+#include <immintrin.h>
+#endif
+
+
+#define SCENE_PARALLEL_MIN_NODES 65536				// Below this a single thread wins
+#define SCENE_PARALLEL_MIN_LEVEL 4096				// Smaller levels stay on the calling thread
+#define SCENE_MAX_THREADS 16
+#define SCENE_BLOCK 8								// Nodes per kernel block, slices are aligned to it
+
+
+// Local transform of one node as the 12 non-constant entries of a column-major 4x4
+//  - Row k of column j is local[j * 3 + k] for j < 3, translation is local[9..11]
+//  - Compose kernels read them with a stride, so block results are used in place
+static inline void localMatrix(float qx, float qy, float qz, float qw, float scale_x, float scale_y, float scale_z,
+	float x, float y, float z, float* local)
+{
+	float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+	float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+	float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+	local[0] = (1.0f - 2.0f * (yy + zz)) * scale_x;
+	local[1] = 2.0f * (xy + wz) * scale_x;
+	local[2] = 2.0f * (xz - wy) * scale_x;
+	local[3] = 2.0f * (xy - wz) * scale_y;
+	local[4] = (1.0f - 2.0f * (xx + zz)) * scale_y;
+	local[5] = 2.0f * (yz + wx) * scale_y;
+	local[6] = 2.0f * (xz + wy) * scale_z;
+	local[7] = 2.0f * (yz - wx) * scale_z;
+	local[8] = (1.0f - 2.0f * (xx + yy)) * scale_z;
+	local[9] = x;
+	local[10] = y;
+	local[11] = z;
+}
+
+
+// world = parent * local, scalar path
+static inline void composeScalar(const Mat4* parent, const float* local, uint32_t stride, Mat4& world)
+{
+	if (parent == nullptr)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			world.m[j * 4 + 0] = local[(j * 3 + 0) * stride];
+			world.m[j * 4 + 1] = local[(j * 3 + 1) * stride];
+			world.m[j * 4 + 2] = local[(j * 3 + 2) * stride];
+			world.m[j * 4 + 3] = (j == 3) ? 1.0f : 0.0f;
+		}
+		return;
+	}
+
+	const float* p = parent->m;
+	for (int j = 0; j < 4; j++)
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			float v = p[r] * local[(j * 3 + 0) * stride] + p[4 + r] * local[(j * 3 + 1) * stride] + p[8 + r] * local[(j * 3 + 2) * stride];
+			world.m[j * 4 + r] = (j == 3) ? v + p[12 + r] : v;
+		}
+	}
+}
+
+
+#ifdef SCENE_GRAPH_X86
+
+// world = parent * local - each world column is the parent columns weighted by a local column
+__attribute__((target("sse2")))
+static inline void composeSSE2(const Mat4* parent, const float* local, uint32_t stride, Mat4& world)
+{
+	__m128 c0, c1, c2, c3;
+	if (parent == nullptr)
+	{
+		c0 = _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f);
+		c1 = _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f);
+		c2 = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+		c3 = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+	else
+	{
+		c0 = _mm_load_ps(parent->m + 0);
+		c1 = _mm_load_ps(parent->m + 4);
+		c2 = _mm_load_ps(parent->m + 8);
+		c3 = _mm_load_ps(parent->m + 12);
+	}
+
+	for (int j = 0; j < 4; j++)
+	{
+		__m128 column = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(local[(j * 3 + 0) * stride])), _mm_mul_ps(c1, _mm_set1_ps(local[(j * 3 + 1) * stride]))),
+			_mm_mul_ps(c2, _mm_set1_ps(local[(j * 3 + 2) * stride])));
+		if (j == 3) column = _mm_add_ps(column, c3);
+		_mm_store_ps(world.m + j * 4, column);
+	}
+}
+
+
+// Local matrices for 4 consecutive nodes straight from the SoA arrays, lane i -> local[k * SCENE_BLOCK + i]
+__attribute__((target("sse2")))
+static inline void localBlockSSE2(const float* qx_in, const float* qy_in, const float* qz_in, const float* qw_in,
+	const float* sx_in, const float* sy_in, const float* sz_in, const float* tx_in, const float* ty_in, const float* tz_in, float* local)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	__m128 qx = _mm_loadu_ps(qx_in), qy = _mm_loadu_ps(qy_in), qz = _mm_loadu_ps(qz_in), qw = _mm_loadu_ps(qw_in);
+	__m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+	__m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+	__m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+	__m128 scale_x = _mm_loadu_ps(sx_in), scale_y = _mm_loadu_ps(sy_in), scale_z = _mm_loadu_ps(sz_in);
+
+	_mm_store_ps(local + 0, _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scale_x));
+	_mm_store_ps(local + 8, _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scale_x));
+	_mm_store_ps(local + 16, _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scale_x));
+	_mm_store_ps(local + 24, _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scale_y));
+	_mm_store_ps(local + 32, _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scale_y));
+	_mm_store_ps(local + 40, _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scale_y));
+	_mm_store_ps(local + 48, _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scale_z));
+	_mm_store_ps(local + 56, _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scale_z));
+	_mm_store_ps(local + 64, _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scale_z));
+	_mm_store_ps(local + 72, _mm_loadu_ps(tx_in));
+	_mm_store_ps(local + 80, _mm_loadu_ps(ty_in));
+	_mm_store_ps(local + 88, _mm_loadu_ps(tz_in));
+}
+
+
+// world = parent * local, two world columns per 256-bit register
+__attribute__((target("avx2")))
+static inline void composeAVX2(const Mat4* parent, const float* local, uint32_t stride, Mat4& world)
+{
+	__m256 c0, c1, c2, c3;
+	if (parent == nullptr)
+	{
+		c0 = _mm256_setr_ps(1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f);
+		c1 = _mm256_setr_ps(0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+		c2 = _mm256_setr_ps(0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+		c3 = _mm256_setr_ps(0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	}
+	else
+	{
+		c0 = _mm256_broadcast_ps((const __m128*)(parent->m + 0));
+		c1 = _mm256_broadcast_ps((const __m128*)(parent->m + 4));
+		c2 = _mm256_broadcast_ps((const __m128*)(parent->m + 8));
+		c3 = _mm256_broadcast_ps((const __m128*)(parent->m + 12));
+	}
+
+	// Columns 0|1 then 2|3, the translation column also adds the parent's
+	for (int j = 0; j < 4; j += 2)
+	{
+		__m256 w0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(local[(j * 3 + 0) * stride])), _mm_set1_ps(local[(j * 3 + 3) * stride]), 1);
+		__m256 w1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(local[(j * 3 + 1) * stride])), _mm_set1_ps(local[(j * 3 + 4) * stride]), 1);
+		__m256 w2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(local[(j * 3 + 2) * stride])), _mm_set1_ps(local[(j * 3 + 5) * stride]), 1);
+		__m256 columns = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c0, w0), _mm256_mul_ps(c1, w1)), _mm256_mul_ps(c2, w2));
+		if (j == 2) columns = _mm256_add_ps(columns, _mm256_blend_ps(_mm256_setzero_ps(), c3, 0xF0));
+		_mm256_storeu_ps(world.m + j * 4, columns);
+	}
+}
+
+
+// Local matrices for 8 consecutive nodes, lane i -> local[k * SCENE_BLOCK + i]
+__attribute__((target("avx2")))
+static inline void localBlockAVX2(const float* qx_in, const float* qy_in, const float* qz_in, const float* qw_in,
+	const float* sx_in, const float* sy_in, const float* sz_in, const float* tx_in, const float* ty_in, const float* tz_in, float* local)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 two = _mm256_set1_ps(2.0f);
+
+	__m256 qx = _mm256_loadu_ps(qx_in), qy = _mm256_loadu_ps(qy_in), qz = _mm256_loadu_ps(qz_in), qw = _mm256_loadu_ps(qw_in);
+	__m256 xx = _mm256_mul_ps(qx, qx), yy = _mm256_mul_ps(qy, qy), zz = _mm256_mul_ps(qz, qz);
+	__m256 xy = _mm256_mul_ps(qx, qy), xz = _mm256_mul_ps(qx, qz), yz = _mm256_mul_ps(qy, qz);
+	__m256 wx = _mm256_mul_ps(qw, qx), wy = _mm256_mul_ps(qw, qy), wz = _mm256_mul_ps(qw, qz);
+	__m256 scale_x = _mm256_loadu_ps(sx_in), scale_y = _mm256_loadu_ps(sy_in), scale_z = _mm256_loadu_ps(sz_in);
+
+	_mm256_store_ps(local + 0, _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), scale_x));
+	_mm256_store_ps(local + 8, _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), scale_x));
+	_mm256_store_ps(local + 16, _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), scale_x));
+	_mm256_store_ps(local + 24, _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), scale_y));
+	_mm256_store_ps(local + 32, _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), scale_y));
+	_mm256_store_ps(local + 40, _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), scale_y));
+	_mm256_store_ps(local + 48, _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), scale_z));
+	_mm256_store_ps(local + 56, _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), scale_z));
+	_mm256_store_ps(local + 64, _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), scale_z));
+	_mm256_store_ps(local + 72, _mm256_loadu_ps(tx_in));
+	_mm256_store_ps(local + 80, _mm256_loadu_ps(ty_in));
+	_mm256_store_ps(local + 88, _mm256_loadu_ps(tz_in));
+}
+
+#endif
+
+
+// Sense-free spin barrier for the per-level handoff between update threads
+class LevelBarrier
+{
+public:
+	explicit LevelBarrier(uint32_t count) : count(count) {}
+
+	void wait()
+	{
+		uint32_t phase = generation.load(std::memory_order_acquire);
+		if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == count)
+		{
+			arrived.store(0, std::memory_order_relaxed);
+			generation.fetch_add(1, std::memory_order_release);
+			return;
+		}
+		while (generation.load(std::memory_order_acquire) == phase)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+private:
+	const uint32_t count;
+	std::atomic<uint32_t> arrived{ 0 };
+	std::atomic<uint32_t> generation{ 0 };
+};
+
+
+void SceneGraph::reserve(size_t count)
+{
+	for (auto* component : { &tx, &ty, &tz, &rx, &ry, &rz, &rw, &sx, &sy, &sz })
+	{
+		component->reserve(count);
+	}
+	parent.reserve(count);
+	depth.reserve(count);
+	dirty.reserve(count);
+	changed.reserve(count);
+	world_matrices.reserve(count);
+	slot.reserve(count);
+	node_of.reserve(count);
+}
+
+
+void SceneGraph::clear()
+{
+	for (auto* component : { &tx, &ty, &tz, &rx, &ry, &rz, &rw, &sx, &sy, &sz })
+	{
+		component->clear();
+	}
+	parent.clear();
+	depth.clear();
+	dirty.clear();
+	changed.clear();
+	world_matrices.clear();
+	slot.clear();
+	node_of.clear();
+	level_begin = { 0 };
+	needs_sort = false;
+	any_dirty = false;
+	changed_begin = changed_end = 0;
+}
+
+
+NodeId SceneGraph::addNode(NodeId parent_node)
+{
+	NodeId node = static_cast<NodeId>(slot.size());
+	uint32_t index = static_cast<uint32_t>(parent.size());
+	uint32_t parent_index = (parent_node == NO_PARENT) ? NO_PARENT : slot[parent_node];
+	uint32_t node_depth = (parent_index == NO_PARENT) ? 0 : depth[parent_index] + 1;
+
+	tx.push_back(0.0f); ty.push_back(0.0f); tz.push_back(0.0f);
+	rx.push_back(0.0f); ry.push_back(0.0f); rz.push_back(0.0f); rw.push_back(1.0f);
+	sx.push_back(1.0f); sy.push_back(1.0f); sz.push_back(1.0f);
+	parent.push_back(parent_index);
+	depth.push_back(node_depth);
+	dirty.push_back(1);
+	any_dirty = true;
+	world_matrices.push_back(Mat4{});
+	slot.push_back(index);
+	node_of.push_back(node);
+
+	// Appending to the deepest level or opening a new one keeps the order, anything else re-sorts on update
+	uint32_t levels = static_cast<uint32_t>(level_begin.size() - 1);
+	if (node_depth + 1 == levels) level_begin.back()++;
+	else if (node_depth == levels) level_begin.push_back(index + 1);
+	else needs_sort = true;
+
+	return node;
+}
+
+
+void SceneGraph::setTranslation(NodeId node, float x, float y, float z)
+{
+	uint32_t i = slot[node];
+	tx[i] = x; ty[i] = y; tz[i] = z;
+	dirty[i] = 1;
+	any_dirty = true;
+}
+
+
+void SceneGraph::setRotation(NodeId node, float x, float y, float z, float w)
+{
+	uint32_t i = slot[node];
+	rx[i] = x; ry[i] = y; rz[i] = z; rw[i] = w;
+	dirty[i] = 1;
+	any_dirty = true;
+}
+
+
+void SceneGraph::setScale(NodeId node, float x, float y, float z)
+{
+	uint32_t i = slot[node];
+	sx[i] = x; sy[i] = y; sz[i] = z;
+	dirty[i] = 1;
+	any_dirty = true;
+}
+
+
+// Stable counting sort by depth - every array is permuted, parents are remapped to their new index
+void SceneGraph::sortByDepth()
+{
+	const uint32_t count = static_cast<uint32_t>(parent.size());
+	uint32_t max_depth = 0;
+	for (uint32_t d : depth) max_depth = std::max(max_depth, d);
+
+	level_begin.assign(max_depth + 2, 0);
+	for (uint32_t d : depth) level_begin[d + 1]++;
+	for (uint32_t d = 0; d <= max_depth; d++) level_begin[d + 1] += level_begin[d];
+
+	std::vector <uint32_t> new_index(count);
+	std::vector <uint32_t> cursor(level_begin.begin(), level_begin.end() - 1);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		new_index[i] = cursor[depth[i]]++;
+	}
+
+	auto permute = [&](auto& values)
+	{
+		auto sorted = values;
+		for (uint32_t i = 0; i < count; i++) sorted[new_index[i]] = values[i];
+		values.swap(sorted);
+	};
+	for (auto* component : { &tx, &ty, &tz, &rx, &ry, &rz, &rw, &sx, &sy, &sz })
+	{
+		permute(*component);
+	}
+	permute(depth);
+	permute(dirty);
+	permute(world_matrices);
+	permute(node_of);
+	permute(parent);
+
+	for (auto& p : parent)
+	{
+		if (p != NO_PARENT) p = new_index[p];
+	}
+	for (uint32_t i = 0; i < count; i++)
+	{
+		slot[node_of[i]] = i;
+	}
+
+	// Every slot may have moved, so the whole buffer is rewritten
+	std::fill(dirty.begin(), dirty.end(), 1);
+	needs_sort = false;
+}
+
+
+// Recompute world matrices in [begin, end) of one level - parents are final, the previous level finished first
+void SceneGraph::updateRange(uint32_t begin, uint32_t end, uint32_t& first_changed, uint32_t& last_changed)
+{
+	alignas(32) float block[12 * SCENE_BLOCK];
+	float scalar[12];
+	const uint32_t count = static_cast<uint32_t>(parent.size());
+
+#ifdef SCENE_GRAPH_X86
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	static const bool has_sse2 = __builtin_cpu_supports("sse2");
+#endif
+
+	for (uint32_t b = begin; b < end; b += SCENE_BLOCK)
+	{
+		uint32_t block_end = std::min(b + SCENE_BLOCK, end);
+
+		// A node changes when its own transform or its parent's world did
+		bool any = false;
+		for (uint32_t i = b; i < block_end; i++)
+		{
+			uint32_t p = parent[i];
+			changed[i] = dirty[i] | (p != NO_PARENT ? changed[p] : 0);
+			dirty[i] = 0;
+			any |= changed[i] != 0;
+		}
+		if (!any) continue;
+
+		first_changed = std::min(first_changed, b);
+		last_changed = std::max(last_changed, block_end);
+
+		// Local matrices for the whole block at once - lanes past the level end are computed and ignored, the tail block is scalar
+		uint32_t lanes = 0;
+#ifdef SCENE_GRAPH_X86
+		if (b + SCENE_BLOCK > count) lanes = 0;
+		else if (has_avx2)
+		{
+			localBlockAVX2(&rx[b], &ry[b], &rz[b], &rw[b], &sx[b], &sy[b], &sz[b], &tx[b], &ty[b], &tz[b], block);
+			lanes = 8;
+		}
+		else if (has_sse2)
+		{
+			localBlockSSE2(&rx[b], &ry[b], &rz[b], &rw[b], &sx[b], &sy[b], &sz[b], &tx[b], &ty[b], &tz[b], block);
+			localBlockSSE2(&rx[b + 4], &ry[b + 4], &rz[b + 4], &rw[b + 4], &sx[b + 4], &sy[b + 4], &sz[b + 4], &tx[b + 4], &ty[b + 4], &tz[b + 4], block + 4);
+			lanes = 4;
+		}
+#endif
+
+		for (uint32_t i = b; i < block_end; i++)
+		{
+			if (!changed[i]) continue;
+
+			// Block lanes are strided, the scalar path packs one node
+			const float* local = block + (i - b);
+			uint32_t stride = SCENE_BLOCK;
+			if (lanes == 0)
+			{
+				localMatrix(rx[i], ry[i], rz[i], rw[i], sx[i], sy[i], sz[i], tx[i], ty[i], tz[i], scalar);
+				local = scalar;
+				stride = 1;
+			}
+
+			const Mat4* parent_world = (parent[i] != NO_PARENT) ? &world_matrices[parent[i]] : nullptr;
+#ifdef SCENE_GRAPH_X86
+			if (has_avx2) composeAVX2(parent_world, local, stride, world_matrices[i]);
+			else if (has_sse2) composeSSE2(parent_world, local, stride, world_matrices[i]);
+			else composeScalar(parent_world, local, stride, world_matrices[i]);
+#else
+			composeScalar(parent_world, local, stride, world_matrices[i]);
+#endif
+		}
+	}
+}
+
+
+// Kernel agreement - every SIMD path the CPU supports against the scalar one, on random TRS blocks under random parents
+//  - Catches a lane or slot mix-up in one path that the others would not show, run by --scene-bench and the golden suite
+bool SceneGraph::checkKernels(uint32_t block_count)
+{
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> positive(0.25f, 4.0f);
+
+	alignas(32) float q[4][SCENE_BLOCK], s[3][SCENE_BLOCK], t[3][SCENE_BLOCK];
+	alignas(32) float block[12 * SCENE_BLOCK];
+	float scalar[12];
+	Mat4 parent_world;
+	Mat4 expected[SCENE_BLOCK];
+	Mat4 result;
+
+#ifdef SCENE_GRAPH_X86
+	const bool has_avx2 = __builtin_cpu_supports("avx2");
+	const bool has_sse2 = __builtin_cpu_supports("sse2");
+#endif
+
+	for (uint32_t b = 0; b < block_count; b++)
+	{
+		for (uint32_t i = 0; i < SCENE_BLOCK; i++)
+		{
+			float x = uniform(random), y = uniform(random), z = uniform(random), w = uniform(random);
+			float length = std::sqrt(x * x + y * y + z * z + w * w) + 1e-6f;
+			q[0][i] = x / length; q[1][i] = y / length; q[2][i] = z / length; q[3][i] = w / length;
+			for (int c = 0; c < 3; c++)
+			{
+				s[c][i] = positive(random);
+				t[c][i] = uniform(random) * 10.0f;
+			}
+		}
+		for (int e = 0; e < 16; e++)
+		{
+			parent_world.m[e] = (e % 4 == 3) ? (e == 15 ? 1.0f : 0.0f) : uniform(random) * 2.0f;
+		}
+		const Mat4* parent = (b % 2 == 0) ? &parent_world : nullptr;						// Roots take the identity path
+
+		for (uint32_t i = 0; i < SCENE_BLOCK; i++)
+		{
+			localMatrix(q[0][i], q[1][i], q[2][i], q[3][i], s[0][i], s[1][i], s[2][i], t[0][i], t[1][i], t[2][i], scalar);
+			composeScalar(parent, scalar, 1, expected[i]);
+		}
+
+		auto compare = [&](const char* path, void (*compose)(const Mat4*, const float*, uint32_t, Mat4&))
+		{
+			for (uint32_t i = 0; i < SCENE_BLOCK; i++)
+			{
+				compose(parent, block + i, SCENE_BLOCK, result);
+				for (int e = 0; e < 16; e++)
+				{
+					float a = expected[i].m[e], v = result.m[e];
+					if (std::fabs(a - v) > 1e-4f * (1.0f + std::fabs(a)))
+					{
+						std::cerr << "[!] Scene Error - " << path << " kernels disagree with scalar at block " << b << ", lane " << i
+							<< ", element " << e << ": " << v << " != " << a << "\n";
+						return false;
+					}
+				}
+			}
+			return true;
+		};
+
+#ifdef SCENE_GRAPH_X86
+		if (has_sse2)
+		{
+			localBlockSSE2(q[0], q[1], q[2], q[3], s[0], s[1], s[2], t[0], t[1], t[2], block);
+			localBlockSSE2(q[0] + 4, q[1] + 4, q[2] + 4, q[3] + 4, s[0] + 4, s[1] + 4, s[2] + 4, t[0] + 4, t[1] + 4, t[2] + 4, block + 4);
+			if (!compare("SSE2", composeSSE2)) return false;
+		}
+		if (has_avx2)
+		{
+			localBlockAVX2(q[0], q[1], q[2], q[3], s[0], s[1], s[2], t[0], t[1], t[2], block);
+			if (!compare("AVX2", composeAVX2)) return false;
+		}
+#else
+		(void)compare;
+		(void)block;
+		(void)result;
+#endif
+	}
+	return true;
+}
+
+
+// Shared start of both update paths - false when nothing moved since the last update
+bool SceneGraph::beginUpdate()
+{
+	if (!any_dirty)
+	{
+		changed_begin = changed_end = 0;
+		return false;
+	}
+	any_dirty = false;
+
+	if (needs_sort) sortByDepth();
+	changed.resize(parent.size());
+	return true;
+}
+
+
+void SceneGraph::finishUpdate(uint32_t first_changed, uint32_t last_changed)
+{
+	changed_begin = (first_changed == UINT32_MAX) ? 0 : first_changed;
+	changed_end = (first_changed == UINT32_MAX) ? 0 : last_changed;
+}
+
+
+void SceneGraph::update(uint32_t thread_count)
+{
+	if (!beginUpdate()) return;
+
+	const uint32_t count = static_cast<uint32_t>(parent.size());
+	uint32_t workers = thread_count ? thread_count : std::max(1u, std::thread::hardware_concurrency());
+	workers = std::min(workers, (uint32_t)SCENE_MAX_THREADS);
+	if (count < SCENE_PARALLEL_MIN_NODES) workers = 1;
+
+	const uint32_t levels = static_cast<uint32_t>(level_begin.size() - 1);
+	uint32_t first_changed = UINT32_MAX;
+	uint32_t last_changed = 0;
+
+	if (workers == 1)
+	{
+		for (uint32_t level = 0; level < levels; level++)
+		{
+			updateRange(level_begin[level], level_begin[level + 1], first_changed, last_changed);
+		}
+	}
+	else
+	{
+		// Each level is split into block aligned slices, the barrier hands finished parents to the next level
+		LevelBarrier barrier(workers);
+		std::vector <uint32_t> worker_first(workers, UINT32_MAX);
+		std::vector <uint32_t> worker_last(workers, 0);
+
+		auto run = [&](uint32_t worker)
+		{
+			for (uint32_t level = 0; level < levels; level++)
+			{
+				uint32_t begin = level_begin[level];
+				uint32_t end = level_begin[level + 1];
+				uint32_t slices = (end - begin < SCENE_PARALLEL_MIN_LEVEL) ? 1 : workers;
+				if (worker < slices)
+				{
+					uint32_t blocks = (end - begin + SCENE_BLOCK - 1) / SCENE_BLOCK;
+					uint32_t slice_begin = begin + (blocks * worker / slices) * SCENE_BLOCK;
+					uint32_t slice_end = std::min(end, begin + (blocks * (worker + 1) / slices) * SCENE_BLOCK);
+					updateRange(slice_begin, slice_end, worker_first[worker], worker_last[worker]);
+				}
+				barrier.wait();
+			}
+		};
+
+		std::vector <std::thread> threads;
+		for (uint32_t w = 1; w < workers; w++)
+		{
+			threads.emplace_back(run, w);
+		}
+		run(0);
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		for (uint32_t w = 0; w < workers; w++)
+		{
+			first_changed = std::min(first_changed, worker_first[w]);
+			last_changed = std::max(last_changed, worker_last[w]);
+		}
+	}
+
+	finishUpdate(first_changed, last_changed);
+}
+
+
+// Job system variant - each large level is one parallelFor, waiting on it is the level handoff
+void SceneGraph::update(JobSystem& jobs, FrameArena& arena)
+{
+	if (!beginUpdate()) return;
+
+	const uint32_t count = static_cast<uint32_t>(parent.size());
+	const uint32_t levels = static_cast<uint32_t>(level_begin.size() - 1);
+	const uint32_t slices = (count < SCENE_PARALLEL_MIN_NODES) ? 1 : std::min(jobs.concurrency(), (uint32_t)SCENE_MAX_THREADS);
+
+	uint32_t* slice_first = static_cast<uint32_t*>(arena.allocate(sizeof(uint32_t) * slices * 2, alignof(uint32_t)));
+	uint32_t* slice_last = slice_first + slices;
+	for (uint32_t s = 0; s < slices; s++)
+	{
+		slice_first[s] = UINT32_MAX;
+		slice_last[s] = 0;
+	}
+
+	for (uint32_t level = 0; level < levels; level++)
+	{
+		uint32_t begin = level_begin[level];
+		uint32_t end = level_begin[level + 1];
+		if (slices == 1 || end - begin < SCENE_PARALLEL_MIN_LEVEL)
+		{
+			updateRange(begin, end, slice_first[0], slice_last[0]);
+			continue;
+		}
+
+		// Block aligned slices, one chunk each
+		uint32_t blocks = (end - begin + SCENE_BLOCK - 1) / SCENE_BLOCK;
+		JobCounter level_done;
+		jobs.parallelFor(arena, slices, 1, [=](uint32_t s, uint32_t)
+		{
+			uint32_t slice_begin = begin + (blocks * s / slices) * SCENE_BLOCK;
+			uint32_t slice_end = std::min(end, begin + (blocks * (s + 1) / slices) * SCENE_BLOCK);
+			updateRange(slice_begin, slice_end, slice_first[s], slice_last[s]);
+		}, level_done);
+		jobs.wait(level_done);
+	}
+
+	uint32_t first_changed = UINT32_MAX;
+	uint32_t last_changed = 0;
+	for (uint32_t s = 0; s < slices; s++)
+	{
+		first_changed = std::min(first_changed, slice_first[s]);
+		last_changed = std::max(last_changed, slice_last[s]);
+	}
+	finishUpdate(first_changed, last_changed);
+}
+
+
+size_t SceneGraph::uploadChanged(void* destination) const
+{
+	size_t matrices = changed_end - changed_begin;
+	if (matrices == 0) return 0;
+
+	std::memcpy((Mat4*)destination + changed_begin, &world_matrices[changed_begin], matrices * sizeof(Mat4));
+	return matrices;
+}
+
+
+void SceneGraph::setWorld(uint32_t begin, uint32_t end, const Mat4* matrices)
+{
+	if (begin >= end) return;
+
+	std::memcpy(&world_matrices[begin], matrices, (end - begin) * sizeof(Mat4));
+	if (changed_begin == changed_end)
+	{
+		changed_begin = begin;
+		changed_end = end;
+	}
+	else
+	{
+		changed_begin = std::min(changed_begin, begin);
+		changed_end = std::max(changed_end, end);
+	}
+}
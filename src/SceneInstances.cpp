@@ -0,0 +1,216 @@
+#include "SceneInstances.h"
+#include "HostAllocator.h"
+#include "VulkanHelpers.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+
+void SceneInstances::create(VkDevice dev, VkPhysicalDevice physical, uint32_t view_count)
+{
+	device = dev;
+	physical_device = physical;
+	views.resize(std::max(view_count, 1u));
+	const uint32_t set_count = static_cast<uint32_t>(views.size());
+
+	// Set Layout - camera is a uniform, everything else a storage buffer - the occlusion shaders read the same set
+	VkDescriptorSetLayoutBinding bindings[BINDING_COUNT]{};
+	for (uint32_t i = 0; i < BINDING_COUNT; i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorCount = 1;
+		bindings[i].descriptorType = i == 2 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layout_create_info{};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_create_info.bindingCount = BINDING_COUNT;
+	layout_create_info.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(device, &layout_create_info, hostAllocator(), &set_layout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Scene Error - Failed to create instance set layout.");
+	}
+
+	VkDescriptorPoolSize pool_sizes[2]{};
+	pool_sizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	pool_sizes[0].descriptorCount = (BINDING_COUNT - 1) * set_count;
+	pool_sizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	pool_sizes[1].descriptorCount = set_count;
+
+	VkDescriptorPoolCreateInfo pool_create_info{};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets = set_count;
+	pool_create_info.poolSizeCount = 2;
+	pool_create_info.pPoolSizes = pool_sizes;
+
+	if (vkCreateDescriptorPool(device, &pool_create_info, hostAllocator(), &pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Scene Error - Failed to create instance descriptor pool.");
+	}
+
+	for (View& view : views)
+	{
+		VkDescriptorSetAllocateInfo set_alloc_info{};
+		set_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		set_alloc_info.descriptorPool = pool;
+		set_alloc_info.descriptorSetCount = 1;
+		set_alloc_info.pSetLayouts = &set_layout;
+
+		if (vkAllocateDescriptorSets(device, &set_alloc_info, &view.set) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[!] Scene Error - Failed to allocate instance descriptor set.");
+		}
+	}
+
+	// Camera and draw commands never grow - the phase draws are reset by a transfer at the start of every pass
+	createMapped(DRAW_OFFSET + sizeof(VkDrawIndirectCommand), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, frame);
+	for (View& view : views)
+	{
+		createLocal(PHASE_DRAW_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, view.phase_draws);
+	}
+	Mat4 identity = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+	setCamera(identity);
+	setDraw(0, 0);
+}
+
+
+void SceneInstances::destroy()
+{
+	std::vector <MappedBuffer*> targets = { &world, &visible, &frame, &bounds };
+	for (View& view : views)
+	{
+		targets.insert(targets.end(), { &view.draw_lists, &view.visibility, &view.phase_draws });
+	}
+	for (MappedBuffer* target : targets)
+	{
+		if (target->mapped != nullptr) vkUnmapMemory(device, target->memory);
+		vkDestroyBuffer(device, target->buffer, hostAllocator());
+		vkFreeMemory(device, target->memory, hostAllocator());
+		*target = MappedBuffer{};
+	}
+	views.clear();
+	vkDestroyDescriptorPool(device, pool, hostAllocator());
+	vkDestroyDescriptorSetLayout(device, set_layout, hostAllocator());
+	pool = VK_NULL_HANDLE;
+	set_layout = VK_NULL_HANDLE;
+	instance_capacity = 0;
+}
+
+
+bool SceneInstances::reserve(uint32_t count, DeletionQueue& retired, uint64_t last_frame)
+{
+	if (count <= instance_capacity) return false;
+
+	// Grow by half again so a slowly growing scene does not reallocate every frame
+	uint32_t new_capacity = std::max(count, instance_capacity + instance_capacity / 2);
+	for (MappedBuffer* target : { &world, &visible, &bounds })
+	{
+		retire(*target, retired, last_frame);
+	}
+	for (View& view : views)
+	{
+		retire(view.draw_lists, retired, last_frame);
+		retire(view.visibility, retired, last_frame);
+	}
+	createMapped(sizeof(Mat4) * new_capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, world);
+	createMapped(sizeof(uint32_t) * new_capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, visible);
+	createMapped(sizeof(float) * 8 * new_capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, bounds);
+
+	// Visibility starts as garbage - a stale flag only moves an instance between the two phases
+	for (View& view : views)
+	{
+		createLocal(sizeof(uint32_t) * 2 * new_capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, view.draw_lists);
+		createLocal(sizeof(uint32_t) * new_capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, view.visibility);
+	}
+	instance_capacity = new_capacity;
+
+	writeSets();
+	return true;
+}
+
+
+void SceneInstances::setCamera(const Mat4& view_projection)
+{
+	std::memcpy(frame.mapped, &view_projection, sizeof(Mat4));
+}
+
+
+// The occlusion shaders read the count from the camera block, the base pass from the draw command
+void SceneInstances::setDraw(uint32_t vertex_count, uint32_t instance_count)
+{
+	VkDrawIndirectCommand draw{};
+	draw.vertexCount = vertex_count;
+	draw.instanceCount = instance_count;
+	std::memcpy(static_cast<uint8_t*>(frame.mapped) + DRAW_OFFSET, &draw, sizeof(draw));
+	std::memcpy(static_cast<uint8_t*>(frame.mapped) + sizeof(Mat4), &instance_count, sizeof(instance_count));
+}
+
+
+void SceneInstances::writeBounds(const Aabb* world_bounds, uint32_t first, uint32_t last)
+{
+	float* target = static_cast<float*>(bounds.mapped) + first * 8;
+	for (uint32_t i = first; i < last; i++, target += 8)
+	{
+		const Aabb& box = world_bounds[i];
+		target[0] = box.min[0]; target[1] = box.min[1]; target[2] = box.min[2]; target[3] = 0.0f;
+		target[4] = box.max[0]; target[5] = box.max[1]; target[6] = box.max[2]; target[7] = 0.0f;
+	}
+}
+
+
+void SceneInstances::createMapped(VkDeviceSize size, VkBufferUsageFlags usage, MappedBuffer& target)
+{
+	// Coherent so host writes before the submit need no flush
+	createBuffer(device, physical_device, size, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, target.buffer, target.memory);
+	if (vkMapMemory(device, target.memory, 0, VK_WHOLE_SIZE, 0, &target.mapped) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Scene Error - Failed to map instance buffer.");
+	}
+}
+
+
+void SceneInstances::createLocal(VkDeviceSize size, VkBufferUsageFlags usage, MappedBuffer& target)
+{
+	createBuffer(device, physical_device, size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, target.buffer, target.memory);
+}
+
+
+void SceneInstances::retire(MappedBuffer& target, DeletionQueue& retired, uint64_t last_frame)
+{
+	if (target.mapped != nullptr) vkUnmapMemory(device, target.memory);
+	retired.retire(DeletionQueue::BUFFER, target.buffer, last_frame);
+	retired.retire(DeletionQueue::MEMORY, target.memory, last_frame);
+	target = MappedBuffer{};
+}
+
+
+// Every view's set sees the shared instance data and its own occlusion history
+void SceneInstances::writeSets()
+{
+	for (View& view : views)
+	{
+		VkDescriptorBufferInfo buffer_infos[BINDING_COUNT]{};
+		buffer_infos[0] = { world.buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[1] = { visible.buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[2] = { frame.buffer, 0, CAMERA_SIZE };
+		buffer_infos[3] = { bounds.buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[4] = { view.draw_lists.buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[5] = { view.visibility.buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[6] = { view.phase_draws.buffer, 0, VK_WHOLE_SIZE };
+
+		VkWriteDescriptorSet writes[BINDING_COUNT]{};
+		for (uint32_t i = 0; i < BINDING_COUNT; i++)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = view.set;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = i == 2 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].pBufferInfo = &buffer_infos[i];
+		}
+		vkUpdateDescriptorSets(device, BINDING_COUNT, writes, 0, nullptr);
+	}
+}
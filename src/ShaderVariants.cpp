@@ -0,0 +1,72 @@
+#include "ShaderVariants.h"
+
+#include <stdexcept>
+#include <cstring>
+
+
+SpecializationConstants& SpecializationConstants::set(uint32_t id, uint32_t value)
+{
+	add(id, value);
+	return *this;
+}
+
+
+SpecializationConstants& SpecializationConstants::set(uint32_t id, int32_t value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	add(id, bits);
+	return *this;
+}
+
+
+SpecializationConstants& SpecializationConstants::set(uint32_t id, float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	add(id, bits);
+	return *this;
+}
+
+
+SpecializationConstants& SpecializationConstants::set(uint32_t id, bool value)
+{
+	add(id, value ? VK_TRUE : VK_FALSE);
+	return *this;
+}
+
+
+const VkSpecializationInfo* SpecializationConstants::info()
+{
+	if (count == 0) return nullptr;
+
+	specialization.mapEntryCount = count;
+	specialization.pMapEntries = entries;
+	specialization.dataSize = count * sizeof(uint32_t);
+	specialization.pData = data;
+	return &specialization;
+}
+
+
+// Setting an id twice replaces its value
+void SpecializationConstants::add(uint32_t id, uint32_t bits)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (entries[i].constantID == id)
+		{
+			data[i] = bits;
+			return;
+		}
+	}
+
+	if (count == SPECIALIZATION_MAX_CONSTANTS)
+	{
+		throw std::runtime_error("[!] Shader Error - Too many specialization constants for one stage.");
+	}
+	entries[count].constantID = id;
+	entries[count].offset = count * sizeof(uint32_t);
+	entries[count].size = sizeof(uint32_t);
+	data[count] = bits;
+	count++;
+}
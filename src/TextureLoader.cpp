@@ -0,0 +1,618 @@
+#include "TextureLoader.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define TEXTURE_LOADER_X86 1
+#include <immintrin.h>
+#endif
+
+#ifdef RENDERER_HAVE_BASISU
+#include "basisu_transcoder.h"
+#endif
+
+
+
+#define KTX2_HEADER_SIZE 80					// Identifier, header and index, the level index follows
+#define KTX2_LEVEL_ENTRY_SIZE 24			// Offset, length and uncompressed length
+#define KHR_DF_MODEL_ETC1S 163
+#define KHR_DF_MODEL_UASTC 166
+#define KHR_DF_TRANSFER_SRGB 2
+#define TEXTURE_DECODE_ROWS 16				// Block rows per decode task
+
+
+static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+
+static uint32_t readU32(const uint8_t* data)
+{
+	uint32_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+
+static uint64_t readU64(const uint8_t* data)
+{
+	uint64_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+
+bool textureBlock(VkFormat format, TextureBlock& block)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		block = { 1, 1, 4 };
+		return true;
+
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC4_SNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+	case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+		block = { 4, 4, 8 };
+		return true;
+
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC5_SNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+	case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+	case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+	case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+		block = { 4, 4, 16 };
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+
+VkDeviceSize textureLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+	TextureBlock block;
+	if (!textureBlock(format, block)) return 0;
+	VkDeviceSize blocks_x = (width + block.width - 1) / block.width;
+	VkDeviceSize blocks_y = (height + block.height - 1) / block.height;
+	return blocks_x * blocks_y * block.bytes;
+}
+
+
+const char* textureFormatName(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM: case VK_FORMAT_R8G8B8A8_SRGB: return "RGBA8";
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK: case VK_FORMAT_BC1_RGB_SRGB_BLOCK: case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: return "BC1";
+	case VK_FORMAT_BC2_UNORM_BLOCK: case VK_FORMAT_BC2_SRGB_BLOCK: return "BC2";
+	case VK_FORMAT_BC3_UNORM_BLOCK: case VK_FORMAT_BC3_SRGB_BLOCK: return "BC3";
+	case VK_FORMAT_BC4_UNORM_BLOCK: case VK_FORMAT_BC4_SNORM_BLOCK: return "BC4";
+	case VK_FORMAT_BC5_UNORM_BLOCK: case VK_FORMAT_BC5_SNORM_BLOCK: return "BC5";
+	case VK_FORMAT_BC7_UNORM_BLOCK: case VK_FORMAT_BC7_SRGB_BLOCK: return "BC7";
+	case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK: case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK: return "ETC2 RGB";
+	case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK: case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK: return "ETC2 RGB A1";
+	case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK: case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK: return "ETC2 RGBA";
+	case VK_FORMAT_EAC_R11_UNORM_BLOCK: return "EAC R11";
+	case VK_FORMAT_EAC_R11G11_UNORM_BLOCK: return "EAC RG11";
+	case VK_FORMAT_ASTC_4x4_UNORM_BLOCK: case VK_FORMAT_ASTC_4x4_SRGB_BLOCK: return "ASTC 4x4";
+	default: return "unknown";
+	}
+}
+
+
+void loadKtx2(const std::string& path, Ktx2Texture& texture)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("[!] Texture Error - Failed to open " + path + ".");
+	}
+	size_t size = (size_t)file.tellg();
+	texture.bytes.resize(size);
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(texture.bytes.data()), size);
+	loadKtx2(path, texture.bytes.data(), size, texture);
+}
+
+
+void loadKtx2(const std::string& path, const uint8_t* data, size_t size, Ktx2Texture& texture)
+{
+	texture.data = data;
+	texture.size = size;
+	if (size < KTX2_HEADER_SIZE || std::memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+	{
+		throw std::runtime_error("[!] Texture Error - " + path + " is not a KTX2 file.");
+	}
+
+	texture.name = path;
+	texture.format = (VkFormat)readU32(data + 12);
+	texture.width = readU32(data + 20);
+	texture.height = std::max(readU32(data + 24), 1u);
+	uint32_t depth = readU32(data + 28);
+	uint32_t layers = readU32(data + 32);
+	uint32_t faces = readU32(data + 36);
+	texture.levels = std::max(readU32(data + 40), 1u);
+	texture.supercompression = readU32(data + 44);
+
+	if (texture.width == 0 || depth > 1 || layers > 1 || faces != 1)
+	{
+		throw std::runtime_error("[!] Texture Error - " + path + " is not a single 2D texture.");
+	}
+	if (texture.levels > TEXTURE_MAX_LEVELS || size < KTX2_HEADER_SIZE + (size_t)texture.levels * KTX2_LEVEL_ENTRY_SIZE)
+	{
+		throw std::runtime_error("[!] Texture Error - " + path + " has a bad level index.");
+	}
+
+	// Level index - every level has to lie inside the file
+	for (uint32_t level = 0; level < texture.levels; level++)
+	{
+		const uint8_t* entry = data + KTX2_HEADER_SIZE + level * KTX2_LEVEL_ENTRY_SIZE;
+		texture.level_offset[level] = readU64(entry);
+		texture.level_length[level] = readU64(entry + 8);
+		if (texture.level_offset[level] > size || texture.level_length[level] > size - texture.level_offset[level])
+		{
+			throw std::runtime_error("[!] Texture Error - " + path + " has a level outside the file.");
+		}
+	}
+
+	// Data format descriptor - color model tells Basis payloads apart, samples say whether there is alpha
+	uint32_t dfd_offset = readU32(data + 48);
+	uint32_t dfd_length = readU32(data + 52);
+	if (dfd_length >= 28 && dfd_offset <= size && dfd_length <= size - dfd_offset)
+	{
+		const uint8_t* block = data + dfd_offset + 4;
+		uint32_t color_model = block[8];
+		uint32_t block_size = (uint32_t)block[6] | ((uint32_t)block[7] << 8);
+		uint32_t sample_count = block_size >= 24 && block_size + 4 <= dfd_length ? (block_size - 24) / 16 : 0;
+		texture.srgb = block[10] == KHR_DF_TRANSFER_SRGB;
+		texture.uastc = color_model == KHR_DF_MODEL_UASTC;
+		texture.etc1s = color_model == KHR_DF_MODEL_ETC1S;
+		for (uint32_t i = 0; i < sample_count; i++)
+		{
+			uint32_t channel = block[24 + i * 16 + 3] & 0xF;
+			// UASTC RGBA / RRRG, ETC1S alpha slice
+			if ((texture.uastc && (channel == 3 || channel == 5)) || (texture.etc1s && channel == 15)) texture.alpha = true;
+		}
+	}
+
+	if (texture.basis() != (texture.format == VK_FORMAT_UNDEFINED))
+	{
+		throw std::runtime_error("[!] Texture Error - " + path + " has an unknown payload.");
+	}
+	if (!texture.basis())
+	{
+		// Stored blocks are uploaded as they are - they must be complete and not supercompressed
+		if (texture.supercompression != 0)
+		{
+			throw std::runtime_error("[!] Texture Error - " + path + " is supercompressed, only Basis payloads may be.");
+		}
+		if (textureLevelSize(texture.format, texture.width, texture.height) == 0)
+		{
+			throw std::runtime_error("[!] Texture Error - " + path + " stores format " + std::to_string((int)texture.format) + ", which is not supported.");
+		}
+		for (uint32_t level = 0; level < texture.levels; level++)
+		{
+			if (texture.level_length[level] < textureLevelSize(texture.format, std::max(texture.width >> level, 1u), std::max(texture.height >> level, 1u)))
+			{
+				throw std::runtime_error("[!] Texture Error - " + path + " has a truncated level.");
+			}
+		}
+		texture.srgb = texture.srgb || texture.format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || texture.format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK ||
+			texture.format == VK_FORMAT_BC2_SRGB_BLOCK || texture.format == VK_FORMAT_BC3_SRGB_BLOCK || texture.format == VK_FORMAT_BC7_SRGB_BLOCK;
+	}
+}
+
+
+static bool sampleable(VkPhysicalDevice physical_device, VkFormat format)
+{
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
+	const VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+	return (properties.optimalTilingFeatures & needed) == needed;
+}
+
+
+static VkFormat srgbFormat(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM: return VK_FORMAT_R8G8B8A8_SRGB;
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK: return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+	case VK_FORMAT_BC3_UNORM_BLOCK: return VK_FORMAT_BC3_SRGB_BLOCK;
+	case VK_FORMAT_BC7_UNORM_BLOCK: return VK_FORMAT_BC7_SRGB_BLOCK;
+	case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK: return VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK;
+	case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK: return VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK;
+	case VK_FORMAT_ASTC_4x4_UNORM_BLOCK: return VK_FORMAT_ASTC_4x4_SRGB_BLOCK;
+	default: return format;
+	}
+}
+
+
+// Block formats the host decoder expands - BC1 to BC5, unsigned
+static bool decodable(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		return true;
+	default:
+		return false;
+	}
+}
+
+
+VkFormat chooseTextureFormat(VkPhysicalDevice physical_device, const Ktx2Texture& texture, TextureUpload& upload)
+{
+	const VkFormat rgba = texture.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	if (!texture.basis())
+	{
+		upload = TextureUpload::Direct;
+		if (sampleable(physical_device, texture.format)) return texture.format;
+
+		upload = TextureUpload::Decoded;
+		bool linear = texture.format == VK_FORMAT_BC4_UNORM_BLOCK || texture.format == VK_FORMAT_BC5_UNORM_BLOCK;
+		if (decodable(texture.format)) return linear ? VK_FORMAT_R8G8B8A8_UNORM : rgba;
+		throw std::runtime_error("[!] Texture Error - " + texture.name + ": the device cannot sample format " + std::to_string((int)texture.format) + " and it cannot be decoded.");
+	}
+
+#ifdef RENDERER_HAVE_BASISU
+	static const VkFormat UASTC_OPAQUE[] = { VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_ASTC_4x4_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, VK_FORMAT_BC1_RGB_UNORM_BLOCK };
+	static const VkFormat UASTC_ALPHA[] = { VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_ASTC_4x4_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, VK_FORMAT_BC3_UNORM_BLOCK };
+	static const VkFormat ETC1S_OPAQUE[] = { VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_ASTC_4x4_UNORM_BLOCK };
+	static const VkFormat ETC1S_ALPHA[] = { VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, VK_FORMAT_BC3_UNORM_BLOCK, VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_ASTC_4x4_UNORM_BLOCK };
+
+	const VkFormat* candidates = texture.uastc ? (texture.alpha ? UASTC_ALPHA : UASTC_OPAQUE) : (texture.alpha ? ETC1S_ALPHA : ETC1S_OPAQUE);
+	upload = TextureUpload::Transcoded;
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		VkFormat format = texture.srgb ? srgbFormat(candidates[i]) : candidates[i];
+		if (sampleable(physical_device, format)) return format;
+	}
+	return rgba;
+#else
+	(void)physical_device;
+	(void)rgba;
+	throw std::runtime_error("[!] Texture Error - " + texture.name + " is Basis Universal, build with RENDERER_HAVE_BASISU to transcode it.");
+#endif
+}
+
+
+// Host decode of BC1 - BC5 into 16 RGBA8 texels, row-major
+//  - Palettes are built per block, the per-texel index expansion and alpha merge have an SSE2 path
+//  - Both paths produce identical bits
+
+static uint32_t expand565(uint16_t color)
+{
+	uint32_t r = (color >> 11) & 0x1F;
+	uint32_t g = (color >> 5) & 0x3F;
+	uint32_t b = color & 0x1F;
+	return ((r << 3) | (r >> 2)) | (((g << 2) | (g >> 4)) << 8) | (((b << 3) | (b >> 2)) << 16);
+}
+
+
+static uint32_t mixColor(uint32_t a, uint32_t b, uint32_t weight_a, uint32_t weight_b, uint32_t divisor)
+{
+	uint32_t result = 0;
+	for (uint32_t shift = 0; shift < 24; shift += 8)
+	{
+		uint32_t channel = (((a >> shift) & 0xFF) * weight_a + ((b >> shift) & 0xFF) * weight_b) / divisor;
+		result |= channel << shift;
+	}
+	return result;
+}
+
+
+// Four-color mode always for BC2 / BC3, else chosen by endpoint order - the fourth entry is transparent or black
+static void colorPalette(const uint8_t* block, bool four_color, bool punch_through, uint32_t palette[4])
+{
+	uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+	uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+	uint32_t e0 = expand565(c0);
+	uint32_t e1 = expand565(c1);
+
+	palette[0] = e0 | 0xFF000000;
+	palette[1] = e1 | 0xFF000000;
+	if (four_color || c0 > c1)
+	{
+		palette[2] = mixColor(e0, e1, 2, 1, 3) | 0xFF000000;
+		palette[3] = mixColor(e0, e1, 1, 2, 3) | 0xFF000000;
+	}
+	else
+	{
+		palette[2] = mixColor(e0, e1, 1, 1, 2) | 0xFF000000;
+		palette[3] = punch_through ? 0 : 0xFF000000;
+	}
+}
+
+
+// BC3 alpha and BC4 / BC5 channels - eight values from two endpoints, 3 bit indices
+static void channelBlock(const uint8_t* block, uint8_t values[16])
+{
+	uint32_t a0 = block[0];
+	uint32_t a1 = block[1];
+	uint8_t palette[8];
+	palette[0] = (uint8_t)a0;
+	palette[1] = (uint8_t)a1;
+	if (a0 > a1)
+	{
+		for (uint32_t i = 1; i < 7; i++) palette[i + 1] = (uint8_t)(((7 - i) * a0 + i * a1) / 7);
+	}
+	else
+	{
+		for (uint32_t i = 1; i < 5; i++) palette[i + 1] = (uint8_t)(((5 - i) * a0 + i * a1) / 5);
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	uint64_t indices = 0;
+	for (int i = 0; i < 6; i++) indices |= (uint64_t)block[2 + i] << (8 * i);
+	for (int i = 0; i < 16; i++) values[i] = palette[(indices >> (3 * i)) & 7];
+}
+
+
+static void expandScalar(uint32_t indices, const uint32_t palette[4], uint32_t texels[16])
+{
+	for (int i = 0; i < 16; i++) texels[i] = palette[(indices >> (2 * i)) & 3];
+}
+
+
+static void mergeAlphaScalar(uint32_t texels[16], const uint8_t alpha[16])
+{
+	for (int i = 0; i < 16; i++) texels[i] = (texels[i] & 0x00FFFFFF) | ((uint32_t)alpha[i] << 24);
+}
+
+
+#ifdef TEXTURE_LOADER_X86
+
+// One row of four texels per step - each lane masks its own 2 bit index and selects the palette entry it equals
+__attribute__((target("sse2")))
+static void expandSSE2(uint32_t indices, const uint32_t palette[4], uint32_t texels[16])
+{
+	const __m128i lane_mask = _mm_setr_epi32(0x03, 0x0C, 0x30, 0xC0);
+	const __m128i entries[4] = { _mm_set1_epi32((int)palette[0]), _mm_set1_epi32((int)palette[1]), _mm_set1_epi32((int)palette[2]), _mm_set1_epi32((int)palette[3]) };
+	const __m128i keys[4] = { _mm_setzero_si128(), _mm_setr_epi32(0x01, 0x04, 0x10, 0x40), _mm_setr_epi32(0x02, 0x08, 0x20, 0x80), lane_mask };
+
+	for (int row = 0; row < 4; row++)
+	{
+		__m128i lanes = _mm_and_si128(_mm_set1_epi32((int)((indices >> (8 * row)) & 0xFF)), lane_mask);
+		__m128i result = _mm_and_si128(_mm_cmpeq_epi32(lanes, keys[0]), entries[0]);
+		for (int k = 1; k < 4; k++)
+		{
+			result = _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi32(lanes, keys[k]), entries[k]));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(texels + row * 4), result);
+	}
+}
+
+
+// Sixteen alpha bytes widened into the top byte of each texel
+__attribute__((target("sse2")))
+static void mergeAlphaSSE2(uint32_t texels[16], const uint8_t alpha[16])
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i color_mask = _mm_set1_epi32(0x00FFFFFF);
+	__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(alpha));
+	__m128i words[2] = { _mm_unpacklo_epi8(bytes, zero), _mm_unpackhi_epi8(bytes, zero) };
+
+	for (int row = 0; row < 4; row++)
+	{
+		__m128i word = words[row >> 1];
+		__m128i wide = (row & 1) ? _mm_unpackhi_epi16(word, zero) : _mm_unpacklo_epi16(word, zero);
+		__m128i* target = reinterpret_cast<__m128i*>(texels + row * 4);
+		__m128i color = _mm_and_si128(_mm_loadu_si128(target), color_mask);
+		_mm_storeu_si128(target, _mm_or_si128(color, _mm_slli_epi32(wide, 24)));
+	}
+}
+
+#endif
+
+
+typedef void (*ExpandFunction)(uint32_t, const uint32_t*, uint32_t*);
+typedef void (*MergeFunction)(uint32_t*, const uint8_t*);
+
+
+static void decodeBlock(VkFormat format, const uint8_t* block, uint32_t texels[16], ExpandFunction expand, MergeFunction merge)
+{
+	uint32_t palette[4];
+	uint8_t alpha[16];
+	switch (format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	{
+		bool punch_through = format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		colorPalette(block, false, punch_through, palette);
+		expand(readU32(block + 4), palette, texels);
+		break;
+	}
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+		for (int i = 0; i < 16; i++)
+		{
+			uint32_t nibble = (block[i >> 1] >> ((i & 1) * 4)) & 0xF;
+			alpha[i] = (uint8_t)(nibble * 17);
+		}
+		colorPalette(block + 8, true, false, palette);
+		expand(readU32(block + 12), palette, texels);
+		merge(texels, alpha);
+		break;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+		channelBlock(block, alpha);
+		colorPalette(block + 8, true, false, palette);
+		expand(readU32(block + 12), palette, texels);
+		merge(texels, alpha);
+		break;
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		channelBlock(block, alpha);
+		for (int i = 0; i < 16; i++) texels[i] = alpha[i] | 0xFF000000;
+		break;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	{
+		uint8_t green[16];
+		channelBlock(block, alpha);
+		channelBlock(block + 8, green);
+		for (int i = 0; i < 16; i++) texels[i] = alpha[i] | ((uint32_t)green[i] << 8) | 0xFF000000;
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+
+// Block rows [begin, end) of one level into RGBA8, edge blocks clipped to the level
+static void decodeRows(VkFormat format, const uint8_t* source, uint32_t width, uint32_t height, uint8_t* destination, uint32_t begin, uint32_t end)
+{
+	ExpandFunction expand = expandScalar;
+	MergeFunction merge = mergeAlphaScalar;
+#ifdef TEXTURE_LOADER_X86
+	static const bool has_sse2 = __builtin_cpu_supports("sse2");
+	if (has_sse2)
+	{
+		expand = expandSSE2;
+		merge = mergeAlphaSSE2;
+	}
+#endif
+
+	TextureBlock block;
+	textureBlock(format, block);
+	const uint32_t blocks_x = (width + 3) / 4;
+	const size_t pitch = (size_t)width * 4;
+	uint32_t texels[16];
+
+	for (uint32_t by = begin; by < end; by++)
+	{
+		const uint32_t rows = std::min(4u, height - by * 4);
+		for (uint32_t bx = 0; bx < blocks_x; bx++)
+		{
+			decodeBlock(format, source + ((size_t)by * blocks_x + bx) * block.bytes, texels, expand, merge);
+
+			const uint32_t columns = std::min(4u, width - bx * 4);
+			for (uint32_t y = 0; y < rows; y++)
+			{
+				std::memcpy(destination + (by * 4 + y) * pitch + (size_t)bx * 16, texels + y * 4, columns * 4);
+			}
+		}
+	}
+}
+
+
+void writeTextureLevels(const Ktx2Texture& texture, VkFormat format, uint8_t* staging, const VkDeviceSize* offsets, JobSystem& jobs, FrameArena& arena)
+{
+	const uint8_t* data = texture.data;
+	JobCounter done;
+
+	if (texture.basis())
+	{
+#ifdef RENDERER_HAVE_BASISU
+		static const bool initialized = (basist::basisu_transcoder_init(), true);
+		(void)initialized;
+
+		basist::ktx2_transcoder transcoder;
+		if (!transcoder.init(data, (uint32_t)texture.size) || !transcoder.start_transcoding())
+		{
+			throw std::runtime_error("[!] Texture Error - Failed to start transcoding " + texture.name + ".");
+		}
+
+		basist::transcoder_texture_format target = basist::transcoder_texture_format::cTFRGBA32;
+		switch (format)
+		{
+		case VK_FORMAT_BC7_UNORM_BLOCK: case VK_FORMAT_BC7_SRGB_BLOCK: target = basist::transcoder_texture_format::cTFBC7_RGBA; break;
+		case VK_FORMAT_ASTC_4x4_UNORM_BLOCK: case VK_FORMAT_ASTC_4x4_SRGB_BLOCK: target = basist::transcoder_texture_format::cTFASTC_4x4_RGBA; break;
+		case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK: case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK: target = basist::transcoder_texture_format::cTFETC2_RGBA; break;
+		case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK: case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK: target = basist::transcoder_texture_format::cTFETC1_RGB; break;
+		case VK_FORMAT_BC3_UNORM_BLOCK: case VK_FORMAT_BC3_SRGB_BLOCK: target = basist::transcoder_texture_format::cTFBC3_RGBA; break;
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK: case VK_FORMAT_BC1_RGB_SRGB_BLOCK: target = basist::transcoder_texture_format::cTFBC1_RGB; break;
+		default: break;
+		}
+
+		// One level per task, each with its own transcoder state - the transcoder itself is shared read-only
+		std::atomic<bool> failed{ false };
+		jobs.parallelFor(arena, texture.levels, 1, [&](uint32_t begin, uint32_t end)
+		{
+			basist::ktx2_transcoder_state state;
+			TextureBlock block;
+			textureBlock(format, block);
+			for (uint32_t level = begin; level < end; level++)
+			{
+				uint32_t width = std::max(texture.width >> level, 1u);
+				uint32_t height = std::max(texture.height >> level, 1u);
+				uint32_t capacity = (uint32_t)(textureLevelSize(format, width, height) / block.bytes);
+				if (!transcoder.transcode_image_level(level, 0, 0, staging + offsets[level], capacity, target, 0, 0, 0, -1, -1, &state))
+				{
+					failed.store(true, std::memory_order_relaxed);
+				}
+			}
+		}, done);
+		jobs.wait(done);
+
+		if (failed.load(std::memory_order_relaxed))
+		{
+			throw std::runtime_error("[!] Texture Error - Failed to transcode " + texture.name + ".");
+		}
+#else
+		throw std::runtime_error("[!] Texture Error - " + texture.name + " is Basis Universal, build with RENDERER_HAVE_BASISU to transcode it.");
+#endif
+		return;
+	}
+
+	// Stored blocks the device samples - one copy, nothing decoded
+	if (format == texture.format)
+	{
+		for (uint32_t level = 0; level < texture.levels; level++)
+		{
+			VkDeviceSize size = textureLevelSize(format, std::max(texture.width >> level, 1u), std::max(texture.height >> level, 1u));
+			std::memcpy(staging + offsets[level], data + texture.level_offset[level], (size_t)size);
+		}
+		return;
+	}
+
+	// Host decode - bands of block rows from every level in flight together
+	for (uint32_t level = 0; level < texture.levels; level++)
+	{
+		uint32_t width = std::max(texture.width >> level, 1u);
+		uint32_t height = std::max(texture.height >> level, 1u);
+		const uint8_t* source = data + texture.level_offset[level];
+		uint8_t* destination = staging + offsets[level];
+		VkFormat stored = texture.format;
+
+		jobs.parallelFor(arena, (height + 3) / 4, TEXTURE_DECODE_ROWS, [=](uint32_t begin, uint32_t end)
+		{
+			decodeRows(stored, source, width, height, destination, begin, end);
+		}, done);
+	}
+	jobs.wait(done);
+}
@@ -0,0 +1,262 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define VERTEX_FORMAT_X86 1
+#include <immintrin.h>
+#endif
+
+
+
+// The SIMD path stores normal and tangent with one 8 byte write
+static_assert(offsetof(PackedVertex, tangent) == offsetof(PackedVertex, normal) + 2 * sizeof(int16_t), "normal and tangent must be adjacent");
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex layout is mirrored in vertexInputDescription()");
+
+#define OCTAHEDRAL_MIN_LENGTH 1e-20f		// Zero vectors encode as +Z instead of dividing by zero
+
+
+uint16_t floatToHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t exponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	// Infinity and NaN keep their class
+	if (exponent == 0xFF) return (uint16_t)(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+
+	int32_t half_exponent = (int32_t)exponent - 127 + 15;
+	if (half_exponent >= 31) return (uint16_t)(sign | 0x7C00);
+
+	// Subnormal half, or zero when even the leading bit shifts out - round to nearest even
+	if (half_exponent <= 0)
+	{
+		if (half_exponent < -10) return (uint16_t)sign;
+		mantissa |= 0x800000;
+		uint32_t shift = (uint32_t)(14 - half_exponent);
+		uint32_t half_mantissa = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half_mantissa & 1))) half_mantissa++;
+		return (uint16_t)(sign | half_mantissa);
+	}
+
+	// A rounding carry walks into the exponent, and from the largest finite value into infinity
+	uint32_t half_bits = sign | ((uint32_t)half_exponent << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half_bits & 1))) half_bits++;
+	return (uint16_t)half_bits;
+}
+
+
+float halfToFloat(uint16_t value)
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+
+	if (exponent == 0)
+	{
+		float magnitude = (float)mantissa * (1.0f / 16777216.0f);
+		return sign != 0 ? -magnitude : magnitude;
+	}
+
+	uint32_t bits = exponent == 31 ? (sign | 0x7F800000 | (mantissa << 13)) : (sign | ((exponent + 112) << 23) | (mantissa << 13));
+	float result;
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+
+// Scalar path - the same operations in the same order as the SIMD one, so both produce identical bits
+static void octahedralEncode(const float* v, int16_t out[2])
+{
+	float length = std::max(std::fabs(v[0]) + std::fabs(v[1]) + std::fabs(v[2]), OCTAHEDRAL_MIN_LENGTH);
+	float x = v[0] / length;
+	float y = v[1] / length;
+
+	// Lower hemisphere folds over the diagonals
+	if (v[2] < 0.0f)
+	{
+		float folded_x = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float folded_y = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = folded_x;
+		y = folded_y;
+	}
+	out[0] = (int16_t)std::nearbyint(std::clamp(x, -1.0f, 1.0f) * 32767.0f);
+	out[1] = (int16_t)std::nearbyint(std::clamp(y, -1.0f, 1.0f) * 32767.0f);
+}
+
+
+static void quantizeScalar(const Vertex* vertices, size_t count, PackedVertex* packed, const float origin[3], const float scale[3])
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& v = vertices[i];
+		PackedVertex& out = packed[i];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float unit = std::min(std::max((v.position[axis] - origin[axis]) * scale[axis], 0.0f), 1.0f);
+			out.position[axis] = (uint16_t)(int32_t)(unit * 65535.0f + 0.5f);
+		}
+		octahedralEncode(v.normal, out.normal);
+		octahedralEncode(v.tangent, out.tangent);
+	}
+}
+
+
+#ifdef VERTEX_FORMAT_X86
+
+// One vertex per iteration - position in three lanes, normal and tangent octahedral pairs side by side in four
+__attribute__((target("sse2")))
+static void quantizeSSE2(const Vertex* vertices, size_t count, PackedVertex* packed, const float origin[3], const float scale[3])
+{
+	const __m128 offset = _mm_setr_ps(origin[0], origin[1], origin[2], 0.0f);
+	const __m128 factor = _mm_setr_ps(scale[0], scale[1], scale[2], 0.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 minus_one = _mm_set1_ps(-1.0f);
+	const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 min_length = _mm_set1_ps(OCTAHEDRAL_MIN_LENGTH);
+	const __m128 unorm_scale = _mm_set1_ps(65535.0f);
+	const __m128 snorm_scale = _mm_set1_ps(32767.0f);
+	const __m128 round_half = _mm_set1_ps(0.5f);
+	const __m128i unsigned_bias = _mm_set1_epi32(32768);
+	const __m128i sign_flip = _mm_set1_epi16((short)0x8000);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& v = vertices[i];
+		PackedVertex& out = packed[i];
+
+		// Position - the fourth lane reads normal[0] and is zeroed by the factor, the sign goes there afterwards
+		__m128 unit = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(v.position), offset), factor);
+		unit = _mm_min_ps(_mm_max_ps(unit, zero), one);
+		__m128i position = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(unit, unorm_scale), round_half));
+
+		// SSE2 only packs signed - bias into range, saturate, flip the top bit back
+		position = _mm_packs_epi32(_mm_sub_epi32(position, unsigned_bias), _mm_setzero_si128());
+		position = _mm_xor_si128(position, sign_flip);
+		_mm_storel_epi64((__m128i*)out.position, position);
+
+		// Octahedral - lanes are normal x, y and tangent x, y, z is broadcast per pair
+		__m128 xy = _mm_setr_ps(v.normal[0], v.normal[1], v.tangent[0], v.tangent[1]);
+		__m128 z = _mm_setr_ps(v.normal[2], v.normal[2], v.tangent[2], v.tangent[2]);
+		__m128 abs_xy = _mm_and_ps(xy, abs_mask);
+		__m128 length = _mm_add_ps(_mm_add_ps(abs_xy, _mm_shuffle_ps(abs_xy, abs_xy, _MM_SHUFFLE(2, 3, 0, 1))), _mm_and_ps(z, abs_mask));
+		__m128 encoded = _mm_div_ps(xy, _mm_max_ps(length, min_length));
+
+		__m128 abs_encoded = _mm_and_ps(encoded, abs_mask);
+		__m128 positive = _mm_cmpge_ps(encoded, zero);
+		__m128 sign = _mm_or_ps(_mm_and_ps(positive, one), _mm_andnot_ps(positive, minus_one));
+		__m128 folded = _mm_mul_ps(_mm_sub_ps(one, _mm_shuffle_ps(abs_encoded, abs_encoded, _MM_SHUFFLE(2, 3, 0, 1))), sign);
+		__m128 lower = _mm_cmplt_ps(z, zero);
+		encoded = _mm_or_ps(_mm_and_ps(lower, folded), _mm_andnot_ps(lower, encoded));
+		encoded = _mm_min_ps(_mm_max_ps(encoded, minus_one), one);
+
+		__m128i directions = _mm_cvtps_epi32(_mm_mul_ps(encoded, snorm_scale));
+		_mm_storel_epi64((__m128i*)out.normal, _mm_packs_epi32(directions, directions));
+	}
+}
+
+#endif
+
+
+VertexStats quantizeVertices(const Vertex* vertices, size_t count, PackedVertex* packed, MeshQuantization& quantization)
+{
+	VertexStats stats;
+	stats.vertex_count = static_cast<uint32_t>(count);
+	stats.full_bytes = count * sizeof(Vertex);
+	stats.packed_bytes = count * sizeof(PackedVertex);
+	quantization = {};
+	if (count == 0) return stats;
+
+	// Mesh bounds - flat axes keep a zero extent and quantize to the origin
+	float low[3] = { vertices[0].position[0], vertices[0].position[1], vertices[0].position[2] };
+	float high[3] = { low[0], low[1], low[2] };
+	for (size_t i = 1; i < count; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			low[axis] = std::min(low[axis], vertices[i].position[axis]);
+			high[axis] = std::max(high[axis], vertices[i].position[axis]);
+		}
+	}
+	float scale[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		quantization.origin[axis] = low[axis];
+		quantization.extent[axis] = high[axis] - low[axis];
+		scale[axis] = quantization.extent[axis] > 0.0f ? 1.0f / quantization.extent[axis] : 0.0f;
+	}
+
+#ifdef VERTEX_FORMAT_X86
+	static const bool has_sse2 = __builtin_cpu_supports("sse2");
+	if (has_sse2) quantizeSSE2(vertices, count, packed, low, scale);
+	else quantizeScalar(vertices, count, packed, low, scale);
+#else
+	quantizeScalar(vertices, count, packed, low, scale);
+#endif
+
+	// Sign and UVs have no SIMD win at these sizes, then decode to report the worst position error
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& v = vertices[i];
+		PackedVertex& out = packed[i];
+		out.position[3] = v.tangent[3] < 0.0f ? 0 : 65535;
+		out.uv[0] = floatToHalf(v.uv[0]);
+		out.uv[1] = floatToHalf(v.uv[1]);
+
+		float error = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float decoded = quantization.origin[axis] + (out.position[axis] / 65535.0f) * quantization.extent[axis];
+			error += (decoded - v.position[axis]) * (decoded - v.position[axis]);
+		}
+		stats.max_position_error = std::max(stats.max_position_error, std::sqrt(error));
+	}
+	return stats;
+}
+
+
+uint32_t vertexInputDescription(VertexLayout layout, VkVertexInputBindingDescription& binding, VkVertexInputAttributeDescription* attributes)
+{
+	binding.binding = 0;
+	binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	// Locations match across layouts, shader_base.vert only changes the decode
+	for (uint32_t location = 0; location < VERTEX_ATTRIBUTE_COUNT; location++)
+	{
+		attributes[location].location = location;
+		attributes[location].binding = 0;
+	}
+
+	if (layout == VertexLayout::Packed)
+	{
+		binding.stride = sizeof(PackedVertex);
+		attributes[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+		attributes[0].offset = offsetof(PackedVertex, position);
+		attributes[1].format = VK_FORMAT_R16G16_SNORM;
+		attributes[1].offset = offsetof(PackedVertex, normal);
+		attributes[2].format = VK_FORMAT_R16G16_SNORM;
+		attributes[2].offset = offsetof(PackedVertex, tangent);
+		attributes[3].format = VK_FORMAT_R16G16_SFLOAT;
+		attributes[3].offset = offsetof(PackedVertex, uv);
+		return VERTEX_ATTRIBUTE_COUNT;
+	}
+
+	binding.stride = sizeof(Vertex);
+	attributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attributes[0].offset = offsetof(Vertex, position);
+	attributes[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attributes[1].offset = offsetof(Vertex, normal);
+	attributes[2].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+	attributes[2].offset = offsetof(Vertex, tangent);
+	attributes[3].format = VK_FORMAT_R32G32_SFLOAT;
+	attributes[3].offset = offsetof(Vertex, uv);
+	return VERTEX_ATTRIBUTE_COUNT;
+}
@@ -0,0 +1,58 @@
+#include "VulkanHelpers.h"
+#include "HostAllocator.h"
+
+#include <stdexcept>
+
+
+uint32_t findMemoryType(VkPhysicalDevice physical_device, uint32_t type_filter, VkMemoryPropertyFlags properties)
+{
+	VkPhysicalDeviceMemoryProperties memory_properties;
+	vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+
+	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+	{
+		if ((type_filter & (1u << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+	return UINT32_MAX;
+}
+
+
+void createBuffer(VkDevice device, VkPhysicalDevice physical_device, VkDeviceSize size, VkBufferUsageFlags usage,
+	VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory)
+{
+	// Create Buffer
+	VkBufferCreateInfo buffer_create_info{};
+	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.size = size;
+	buffer_create_info.usage = usage;
+	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &buffer_create_info, hostAllocator(), &buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to create buffer.");
+	}
+
+	// Allocate and bind memory
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(device, buffer, &requirements);
+
+	VkMemoryAllocateInfo alloc_info{};
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = requirements.size;
+	alloc_info.memoryTypeIndex = findMemoryType(physical_device, requirements.memoryTypeBits, properties);
+
+	if (alloc_info.memoryTypeIndex == UINT32_MAX)
+	{
+		throw std::runtime_error("[!] No memory type matches buffer requirements.");
+	}
+
+	if (vkAllocateMemory(device, &alloc_info, hostAllocator(), &memory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[!] Failed to allocate buffer memory.");
+	}
+
+	vkBindBufferMemory(device, buffer, memory, 0);
+}
@@ -3,6 +3,12 @@
 #include <sstream>
 #include <iostream>
 #include "Renderer.h"
+#include "GoldenSuite.h"
+#include "SceneGraph.h"
+#include "Bvh.h"
+#include "AssetPack.h"
+#include <chrono>
+#include <random>
 
 #define WIDTH 400
 #define HEIGHT 400
@@ -10,9 +16,289 @@
 #undef main
 
 
-int main()
+// Transform propagation timing - a fanout-8 hierarchy, one full update then 1% of nodes moved
+static int runSceneBench(uint32_t node_count)
+{
+    // Timings of kernels that disagree with the scalar path are meaningless
+    if (!SceneGraph::checkKernels()) return -1;
+
+    SceneGraph scene;
+    scene.reserve(node_count);
+    for (uint32_t i = 0; i < node_count; i++)
+    {
+        NodeId node = scene.addNode(i == 0 ? SceneGraph::NO_PARENT : (i - 1) / 8);
+        scene.setTranslation(node, 1.0f, 0.0f, 0.0f);
+        scene.setRotation(node, 0.0f, 0.0f, 0.38268343f, 0.92387953f);
+    }
+
+    auto time = [&](const char* label)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        scene.update();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "[Scene] " << label << ": " << elapsed.count() << " ms, " << (scene.changedEnd() - scene.changedBegin()) << " matrices written\n";
+    };
+
+    time("full update");
+    for (uint32_t i = 0; i < node_count / 100; i++)
+    {
+        scene.setTranslation((i * 7919u) % node_count, 0.0f, 1.0f, 0.0f);
+    }
+    time("1% dirty");
+    time("clean");
+
+    // Same propagation through the frame job system - moving the root dirties every node
+    JobSystem jobs;
+    FrameArena arena;
+    jobs.start();
+    arena.create(1 << 20);
+    scene.setTranslation(0, 2.0f, 0.0f, 0.0f);
+    auto start = std::chrono::high_resolution_clock::now();
+    scene.update(jobs, arena);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "[Scene] full update, " << jobs.concurrency() << " job threads: " << elapsed.count() << " ms\n";
+
+    // Spatial index over unit boxes at every node, then one frustum covering the middle of the scene
+    std::vector<Aabb> bounds(node_count);
+    const Aabb unit = { { -0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, 0.5f } };
+    for (uint32_t i = 0; i < node_count; i++)
+    {
+        bounds[i] = transformBounds(scene.worldMatrices()[i], unit);
+    }
+
+    Bvh bvh;
+    std::vector<uint32_t> visible;
+    const float planes[6][4] = { { 1, 0, 0, 2 }, { -1, 0, 0, 2 }, { 0, 1, 0, 2 }, { 0, -1, 0, 2 }, { 0, 0, 1, 2 }, { 0, 0, -1, 2 } };
+    auto timeBvh = [&](const char* label, const std::function<void()>& work)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        work();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "[Bvh] " << label << ": " << elapsed.count() << " ms\n";
+    };
+
+    timeBvh("build", [&]() { bvh.build(bounds.data(), node_count); });
+    timeBvh("build (jobs)", [&]() { arena.reset(); bvh.build(bounds.data(), node_count, jobs, arena); });
+    timeBvh("refit 1%", [&]() { bvh.refit(bounds.data(), 0, node_count / 100); });
+    timeBvh("cull", [&]() { bvh.cullFrustum(planes, visible); });
+    std::cout << "[Bvh] " << bvh.nodeCount() << " nodes, " << visible.size() << " visible\n";
+
+    // Draw packets for the visible nodes - 8 pipelines and 256 materials spread by hash, depth across the frustum
+    const uint32_t packet_count = static_cast<uint32_t>(visible.size());
+    std::vector<uint64_t> culled_keys(packet_count), keys, scratch_keys(packet_count);
+    std::vector<uint32_t> packets, scratch_values(packet_count);
+    for (uint32_t i = 0; i < packet_count; i++)
+    {
+        uint32_t hash = visible[i] * 2654435761u;
+        float depth = (bounds[visible[i]].min[2] + 2.0f) * 0.25f;
+        culled_keys[i] = makeDrawKey(DRAW_PASS_OPAQUE, 0, hash >> 29, (hash >> 8) & 0xFF, drawKeyDepth(depth, false));
+    }
+    auto timeSort = [&](const char* label, const std::function<void()>& work)
+    {
+        keys = culled_keys;
+        packets = visible;
+        auto start = std::chrono::high_resolution_clock::now();
+        work();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "[Sort] " << label << ": " << elapsed.count() << " ms\n";
+    };
+
+    timeSort("radix", [&]() { radixSort(keys.data(), packets.data(), packet_count, scratch_keys.data(), scratch_values.data()); });
+    timeSort("radix (jobs)", [&]() { arena.reset(); radixSort(keys.data(), packets.data(), packet_count, scratch_keys.data(), scratch_values.data(), jobs, arena); });
+    DrawBindCounts before = countDrawBinds(culled_keys.data(), packet_count);
+    DrawBindCounts after = countDrawBinds(keys.data(), packet_count);
+    std::cout << "[Sort] " << packet_count << " packets, pipeline binds " << before.pipelines << " -> " << after.pipelines
+        << ", material binds " << before.materials << " -> " << after.materials << "\n";
+    return 0;
+}
+
+
+// Asset load timing - each pack entry read from its loose file the way readFile() does, then copied out of the mapped pack
+//  - Both paths end in the same copy into a staging stand-in, run twice to compare with a warm page cache
+static int runAssetBench(const std::string& pack_path, const std::string& loose_dir)
+{
+    AssetPack pack;
+    pack.open(pack_path);
+    size_t largest = 0;
+    for (uint32_t i = 0; i < pack.entryCount(); i++)
+    {
+        largest = std::max(largest, (size_t)pack.entries()[i].size);
+    }
+    std::vector<uint8_t> staging(largest);
+
+    double file_ms = 0.0, pack_ms = 0.0;
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < pack.entryCount(); i++)
+    {
+        const AssetEntry& entry = pack.entries()[i];
+
+        // Current path - open, seek for the size, resize a heap buffer, read, then copy
+        auto start = std::chrono::high_resolution_clock::now();
+        std::ifstream file(loose_dir + "/" + entry.name, std::ios::ate | std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "[!] Missing loose file for " << entry.name << " in " << loose_dir << std::endl;
+            return -1;
+        }
+        std::vector<char> buffer((size_t)file.tellg());
+        file.seekg(0);
+        file.read(buffer.data(), buffer.size());
+        std::memcpy(staging.data(), buffer.data(), std::min(buffer.size(), staging.size()));
+        file_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        // Pack path - readahead hint, then one copy out of the mapping
+        start = std::chrono::high_resolution_clock::now();
+        pack.willNeed(entry);
+        std::memcpy(staging.data(), pack.data(entry), (size_t)entry.size);
+        pack_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        bytes += entry.size;
+    }
+
+    std::cout << "[Assets] " << pack.entryCount() << " assets, " << (bytes >> 10) << " KiB: loose files " << file_ms << " ms, pack " << pack_ms << " ms\n";
+    return 0;
+}
+
+
+// Light field for --lights - fixed seed, spread over the default view just in front of the triangle's normal
+//  - Every fourth light is a spot pointing back at the triangle, ranges are short so each cluster sees only its neighbours
+static std::vector<Light> makeLights(uint32_t count)
+{
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Light> lights(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Light& light = lights[i];
+        std::memset(&light, 0, sizeof(light));
+        light.position[0] = unit(random) * 2.0f - 1.0f;
+        light.position[1] = unit(random) * 2.0f - 1.0f;
+        light.position[2] = 0.02f + unit(random) * 0.2f;
+        light.range = 0.05f + unit(random) * 0.2f;
+        for (int c = 0; c < 3; c++)
+        {
+            light.color[c] = 0.2f + unit(random) * 1.8f;
+        }
+        light.type = (uint32_t)(i % 4 == 3 ? LightType::Spot : LightType::Point);
+        light.direction[2] = -1.0f;
+        light.spot_cos_outer = 0.7f;
+        light.spot_cos_inner = 0.9f;
+    }
+    return lights;
+}
+
+
+int main(int argc, char* argv[])
 {
     Renderer vulkan;
+
+    // Command line options
+    GoldenOptions golden;
+    bool run_golden = false;
+    FrameExporter exporter;
+    std::string export_path;
+    ExportFormat export_format = ExportFormat::Y4M;
+    uint32_t export_fps = 60;
+    uint32_t headless_width = 0, headless_height = 0;
+    uint32_t frame_count = 600;
+    uint32_t window_count = 1;
+    std::string capture_path, replay_path;
+    uint32_t capture_frames = 60;
+    uint32_t replay_loops = 10;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--golden" && i + 1 < argc)
+        {
+            run_golden = true;
+            golden.reference_dir = argv[++i];
+        }
+        else if (arg == "--golden-update") golden.update = true;
+        else if (arg == "--golden-tolerance" && i + 1 < argc) golden.tolerance = (uint8_t)std::atoi(argv[++i]);
+        else if (arg == "--device" && i + 1 < argc) vulkan.setPreferredDevice(argv[++i]);
+        else if (arg == "--export" && i + 1 < argc) export_path = argv[++i];
+        else if (arg == "--export-format" && i + 1 < argc) export_format = (std::string(argv[++i]) == "raw") ? ExportFormat::Raw : ExportFormat::Y4M;
+        else if (arg == "--fps" && i + 1 < argc) export_fps = (uint32_t)std::atoi(argv[++i]);
+        else if (arg == "--frames" && i + 1 < argc) frame_count = (uint32_t)std::atoi(argv[++i]);
+        else if (arg == "--headless" && i + 1 < argc) std::sscanf(argv[++i], "%ux%u", &headless_width, &headless_height);
+        else if (arg == "--windows" && i + 1 < argc) window_count = (uint32_t)std::atoi(argv[++i]);
+        else if (arg == "--async-compute" && i + 1 < argc) vulkan.setAsyncCompute(std::string(argv[++i]) != "off");
+        else if (arg == "--metrics" && i + 1 < argc) vulkan.setMetricsEndpoint(argv[++i]);
+        else if (arg == "--occlusion" && i + 1 < argc) vulkan.setOcclusionCulling(std::string(argv[++i]) != "off");
+        else if (arg == "--vertex-format" && i + 1 < argc) vulkan.setVertexLayout(std::string(argv[++i]) == "packed" ? VertexLayout::Packed : VertexLayout::Full);
+        else if (arg == "--debug-bounds") vulkan.setDebugBounds(true);
+        else if (arg == "--texture" && i + 1 < argc) vulkan.addTexture(argv[++i]);
+        else if (arg == "--asset-pack" && i + 1 < argc) vulkan.setAssetPack(argv[++i]);
+        else if (arg == "--asset-bench" && i + 2 < argc)
+        {
+            std::string pack_path = argv[++i];
+            return runAssetBench(pack_path, argv[++i]);
+        }
+        else if (arg == "--capture" && i + 1 < argc) capture_path = argv[++i];
+        else if (arg == "--capture-frames" && i + 1 < argc) capture_frames = (uint32_t)std::atoi(argv[++i]);
+        else if (arg == "--replay" && i + 1 < argc) replay_path = argv[++i];
+        else if (arg == "--loops" && i + 1 < argc) replay_loops = (uint32_t)std::atoi(argv[++i]);
+        else if (arg == "--lights" && i + 1 < argc)
+        {
+            std::vector<Light> lights = makeLights((uint32_t)std::atoi(argv[++i]));
+            vulkan.setLights(lights.data(), (uint32_t)lights.size());
+        }
+        else if (arg == "--frame-budget" && i + 1 < argc) vulkan.setFrameBudget(std::atof(argv[++i]));
+        else if (arg == "--upscale" && i + 1 < argc) vulkan.setUpscaleSharpness(std::string(argv[++i]) == "bilinear" ? 0.0f : 0.25f);
+        else if (arg == "--scene-bench" && i + 1 < argc) return runSceneBench((uint32_t)std::atoi(argv[++i]));
+        else if (arg == "--post" && i + 1 < argc)
+        {
+            // Comma separated effect list, e.g. tonemap,grade,vignette
+            std::stringstream list(argv[++i]);
+            std::string name;
+            PostEffect effect;
+            while (std::getline(list, name, ','))
+            {
+                if (PostChain::parse(name, effect)) vulkan.setPostEffect(effect, true);
+                else std::cerr << "[!] Unknown post effect: " << name << std::endl;
+            }
+        }
+    }
+
+    // Trace replay - headless at the captured extent, settings come from the trace
+    if (!replay_path.empty())
+    {
+        vulkan.runReplay(replay_path, replay_loops);
+        return 0;
+    }
+
+    // Golden-image regression run - headless, exit code is the failure count
+    if (run_golden)
+    {
+        GoldenSuite suite(vulkan, golden);
+        return suite.run();
+    }
+
+    // Command trace of the first frames, windowed or headless
+    if (!capture_path.empty()) vulkan.setCapture(capture_path, capture_frames);
+
+    // Frame stream export - opened before init so the swap chain gets transfer usage
+    if (!export_path.empty())
+    {
+        if (!exporter.open(export_path, export_format, export_fps)) return -1;
+        vulkan.setExporter(&exporter);
+    }
+
+    // Offline render job - fixed frame count, no window
+    if (headless_width != 0 && headless_height != 0)
+    {
+        vulkan.setHeadless(headless_width, headless_height);
+        vulkan.initVulkan();
+        vulkan.runOffline(frame_count);
+        vulkan.deInitVulkan();
+        return 0;
+    }
+
+    // Extra viewports share the device, submit and present of the main window
+    for (uint32_t i = 1; i < window_count; i++)
+    {
+        vulkan.addWindow("Vulkan Renderer - Viewport " + std::to_string(i), WIDTH, HEIGHT);
+    }
+
     vulkan.initVulkan();
     vulkan.eventHandler();
     vulkan.deInitVulkan();
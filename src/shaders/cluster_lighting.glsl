@@ -0,0 +1,41 @@
+// Shared by the light assignment and the base fragment shader - mirrors Light and Params in ClusteredLighting.h
+// The including shader defines LIGHTING_SET, the set the lighting bindings live in
+
+// Type 0 point, 1 spot
+struct Light {
+    vec3 position;
+    float range;
+    vec3 color;
+    uint type;
+    vec3 direction;
+    float spot_cos_outer;
+    float spot_cos_inner;
+    float padding[3];
+};
+
+layout(set = LIGHTING_SET, binding = 0) uniform ClusterParams {
+    mat4 view;
+    mat4 inverse_projection;
+    vec4 ambient;
+    uvec4 grid;             // Clusters along x, y, z, then the light count
+    float depth_scale;
+    float depth_bias;
+    float near_z;
+    uint exponential;
+} clusters;
+
+layout(std430, set = LIGHTING_SET, binding = 1) readonly buffer Lights {
+    Light light[];
+} lights;
+
+// Depth slice coordinate of a view space z - exponential in depth for perspective projections, linear otherwise
+float sliceCoordinate(float view_z) {
+    float depth = clusters.exponential != 0 ? log(abs(view_z)) : view_z;
+    return depth * clusters.depth_scale + clusters.depth_bias;
+}
+
+// View space z where a slice starts
+float sliceViewZ(float slice) {
+    float depth = (slice - clusters.depth_bias) / clusters.depth_scale;
+    return clusters.exponential != 0 ? sign(clusters.near_z) * exp(depth) : depth;
+}
\ No newline at end of file
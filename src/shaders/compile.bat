@@ -1,2 +0,0 @@
-H:/Source_Libraries/Vulkan/Bin/glslc.exe shader_base.vert -o vert.spv
-H:/Source_Libraries/Vulkan/Bin/glslc.exe shader_base.frag -o frag.spv
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 450
+
+// Debug lines - world space vertices from the mapped ring, see DebugDraw.h
+layout(push_constant) uniform DebugPush {
+    mat4 view_projection;
+} push;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec4 inColor;
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    gl_Position = push.view_projection * vec4(inPosition, 1.0);
+    fragColor = inColor;
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#include "post_params.glsl"
+
+layout(location = 0) in vec2 fragUV;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec4 color = subpassLoad(inputColor);
+
+    // Contrast around mid grey, then saturation against Rec.709 luma
+    vec3 graded = (color.rgb - 0.5) * params.contrast + 0.5;
+    float luma = dot(graded, vec3(0.2126, 0.7152, 0.0722));
+    graded = mix(vec3(luma), graded, params.saturation);
+
+    outColor = vec4(max(graded, 0.0), color.a);
+}
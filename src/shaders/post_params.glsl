@@ -0,0 +1,12 @@
+// Shared by every post subpass - mirrors PostParams in PostChain.h
+layout(push_constant) uniform PostParams {
+    float exposure;
+    float contrast;
+    float saturation;
+    float vignette_strength;
+    float vignette_radius;
+    float vignette_softness;
+} params;
+
+// Previous subpass output, same pixel only
+layout(input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput inputColor;
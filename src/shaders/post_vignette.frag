@@ -0,0 +1,14 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#include "post_params.glsl"
+
+layout(location = 0) in vec2 fragUV;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec4 color = subpassLoad(inputColor);
+
+    float dist = length(fragUV - 0.5) * 1.41421356;
+    float falloff = smoothstep(params.vignette_radius, params.vignette_radius - params.vignette_softness, dist);
+    outColor = vec4(color.rgb * mix(1.0 - params.vignette_strength, 1.0, falloff), color.a);
+}
@@ -1,9 +1,59 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#define LIGHTING_SET 1
+#include "cluster_lighting.glsl"
 
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragNormal;
+layout(location = 3) in vec3 fragWorld;
+layout(location = 4) in vec4 fragClip;
 
 layout(location = 0) out vec4 outColor;
 
-void main() {
-    outColor = vec4(fragColor, 1.0);
+// Set 1 - light lists assigned this frame, see ClusteredLighting
+layout(std430, set = 1, binding = 2) readonly buffer Grid {
+    uvec2 range[];
+} grid;
+
+layout(std430, set = 1, binding = 3) readonly buffer Indices {
+    uint index[];
+} indices;
+
+// Inverse square, windowed to reach zero at the range
+float attenuation(float light_distance, float range) {
+    float ratio = light_distance / range;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window / (light_distance * light_distance + 1.0);
 }
+
+void main() {
+    // No lights - the interpolated color, unlit
+    if (clusters.grid.w == 0) {
+        outColor = vec4(fragColor, 1.0);
+        return;
+    }
+
+    // Cluster from the clip position, so a scaled render target maps to the same grid
+    vec2 ndc = fragClip.xy / fragClip.w;
+    float view_z = (clusters.view * vec4(fragWorld, 1.0)).z;
+    vec3 cell = vec3((ndc * 0.5 + 0.5) * vec2(clusters.grid.xy), sliceCoordinate(view_z));
+    uvec3 clamped = uvec3(clamp(cell, vec3(0.0), vec3(clusters.grid.xyz) - 1.0));
+    uvec2 range = grid.range[clamped.x + clusters.grid.x * (clamped.y + clusters.grid.y * clamped.z)];
+
+    // Only the lights whose bounds touch this cluster
+    vec3 normal = normalize(gl_FrontFacing ? fragNormal : -fragNormal);
+    vec3 lit = clusters.ambient.rgb;
+    for (uint i = 0; i < range.y; i++) {
+        Light light = lights.light[indices.index[range.x + i]];
+        vec3 to_light = light.position - fragWorld;
+        float light_distance = length(to_light);
+        if (light_distance >= light.range) continue;
+
+        vec3 direction = to_light / max(light_distance, 1e-4);
+        float falloff = attenuation(light_distance, light.range);
+        if (light.type == 1) falloff *= smoothstep(light.spot_cos_outer, light.spot_cos_inner, dot(-direction, light.direction));
+        lit += light.color * falloff * max(dot(normal, direction), 0.0);
+    }
+    outColor = vec4(fragColor * lit, 1.0);
+}
\ No newline at end of file
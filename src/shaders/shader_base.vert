@@ -1,20 +1,83 @@
 #version 450
 
+// Vertex layouts - PACKED_VERTICES builds vert_packed.spv, see VertexFormat.h
+#ifdef PACKED_VERTICES
+layout(location = 0) in vec4 inPosition;    // unorm16 against the mesh bounds, w = bitangent sign
+layout(location = 1) in vec2 inNormal;      // Octahedral snorm16
+layout(location = 2) in vec2 inTangent;
+#else
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec4 inTangent;
+#endif
+layout(location = 3) in vec2 inUV;
+
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec4 fragTangent;
+layout(location = 3) out vec3 fragWorld;      // Clustered lighting - world position for shading, clip position for the cluster
+layout(location = 4) out vec4 fragClip;
+
+// Set 0 - written by the host each frame, see SceneInstances
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+    mat4 world[];
+} instances;
+
+layout(std430, set = 0, binding = 1) readonly buffer Visible {
+    uint index[];
+} visible;
+
+layout(set = 0, binding = 2) uniform Camera {
+    mat4 view_projection;
+} camera;
+
+// Occlusion phase draw lists, built on the GPU - see OcclusionCuller
+layout(std430, set = 0, binding = 4) readonly buffer Lists {
+    uint index[];
+} lists;
 
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
+// Negative draws the frustum survivors, otherwise the list starting here - mirrors ScenePush in Renderer.h
+layout(push_constant) uniform Push {
+    int list_base;
+    vec4 origin;    // Mesh quantization, packed layout only
+    vec4 extent;
+} push;
 
-vec3 colors[3] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+// Specialization 0 - false when occlusion culling is off, the list lookup is folded away
+layout(constant_id = 0) const bool OCCLUSION_LISTS = true;
+
+#ifdef PACKED_VERTICES
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+#endif
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
+    // Instances surviving the CPU frustum cull packed by the host, or one occlusion phase
+    uint instance = (!OCCLUSION_LISTS || push.list_base < 0) ? visible.index[gl_InstanceIndex] : lists.index[push.list_base + gl_InstanceIndex];
+    mat4 world = instances.world[instance];
+
+#ifdef PACKED_VERTICES
+    vec3 position = push.origin.xyz + inPosition.xyz * push.extent.xyz;
+    vec3 normal = octahedralDecode(inNormal);
+    vec4 tangent = vec4(octahedralDecode(inTangent), inPosition.w * 2.0 - 1.0);
+#else
+    vec3 position = inPosition;
+    vec3 normal = inNormal;
+    vec4 tangent = inTangent;
+#endif
+
+    vec4 world_position = world * vec4(position, 1.0);
+    gl_Position = camera.view_projection * world_position;
+    fragWorld = world_position.xyz;
+    fragClip = gl_Position;
+    fragNormal = mat3(world) * normal;
+    fragTangent = vec4(mat3(world) * tangent.xyz, tangent.w);
+
+    // Barycentric colors from the UVs - the built-in triangle keeps its red, green and blue corners
+    fragColor = vec3(inUV, 1.0 - inUV.x - inUV.y);
 }
\ No newline at end of file
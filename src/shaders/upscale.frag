@@ -0,0 +1,33 @@
+#version 450
+
+// Scene rendered into part of a window sized image, stretched over the whole swap chain image
+layout(location = 0) in vec2 fragUV;
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D scene;
+
+// Mirrors UpscaleParams in DynamicResolution.h
+layout(push_constant) uniform UpscaleParams {
+    vec2 uv_scale;
+    float sharpness;
+} params;
+
+void main() {
+    // Filter taps stay inside the rendered region, the rest of the image is stale
+    vec2 texel = 1.0 / vec2(textureSize(scene, 0));
+    vec2 low = 0.5 * texel;
+    vec2 high = params.uv_scale - 0.5 * texel;
+    vec2 uv = clamp(fragUV * params.uv_scale, low, high);
+    vec4 color = texture(scene, uv);
+
+    // Unsharp mask from the four neighbours - restores some of the edge contrast the stretch softened
+    // Compiled into the upscale_sharpen permutation only, the bilinear one samples once
+#ifdef SHARPEN
+    vec3 blur = texture(scene, clamp(uv + vec2(texel.x, 0.0), low, high)).rgb;
+    blur += texture(scene, clamp(uv - vec2(texel.x, 0.0), low, high)).rgb;
+    blur += texture(scene, clamp(uv + vec2(0.0, texel.y), low, high)).rgb;
+    blur += texture(scene, clamp(uv - vec2(0.0, texel.y), low, high)).rgb;
+    color.rgb = max(color.rgb + params.sharpness * (color.rgb - blur * 0.25), vec3(0.0));
+#endif
+    outColor = color;
+}
\ No newline at end of file